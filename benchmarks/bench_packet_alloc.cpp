@@ -0,0 +1,180 @@
+/**
+ * @file bench_packet_alloc.cpp
+ * @brief Counts heap allocations on the steady-state packet hot path
+ *
+ * Replays one room tick per iteration (8 karts): decode the received
+ * position / drift / boost frames, build the replies, serialize them into
+ * pooled frames for every recipient, and run the compact movement codec.
+ * After warm-up the pools and scratch buffers are primed, so the measured
+ * loop is expected to do zero allocations; the exit code is 1 otherwise.
+ */
+
+#include "net/Packet.h"
+#include "net/PacketView.h"
+#include "net/BufferPool.h"
+#include "net/MovementCodec.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// =============================================================================
+// COUNTING ALLOCATOR
+// =============================================================================
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace knc;
+
+namespace {
+
+constexpr int KARTS = 8;
+constexpr int WARMUP = 1000;
+constexpr int ITERATIONS = 100000;
+
+struct Frame {
+    uint8_t bytes[64];
+    size_t size = 0;
+};
+
+// What the client would have put in the receive ring
+Frame clientFrame(const Packet& packet) {
+    std::vector<uint8_t> raw = packet.serialize();
+    Frame frame;
+    std::copy(raw.begin(), raw.end(), frame.bytes);
+    frame.size = raw.size();
+    return frame;
+}
+
+struct Bench {
+    Frame position[KARTS];
+    Frame drift;
+    Frame boost;
+    
+    // Same reuse the snapshot tick does (GameServer::SnapshotScratch)
+    std::vector<uint8_t> moves;
+    std::vector<MoveState> states;
+    std::vector<MoveState> decoded;
+    std::vector<uint8_t> payload;
+    std::vector<std::shared_ptr<std::vector<uint8_t>>> inFlight;
+    
+    MovementEncoder encoder;
+    MovementDecoder decoder;
+    MovementQuantizer quantizer;
+    float x = 0.0f;
+    
+    Bench() {
+        for (int i = 0; i < KARTS; ++i) {
+            Packet pos(CMD::C_POSITION);
+            pos.writeFloat(10.0f * i).writeFloat(2.0f).writeFloat(-5.0f).writeFloat(0.5f);
+            position[i] = clientFrame(pos);
+        }
+        Packet drift(CMD::C_DRIFT_START);
+        drift.writeInt32(1);
+        this->drift = clientFrame(drift);
+        Packet boost(CMD::C_BOOST_ACTIVATE);
+        boost.writeInt32(2);
+        this->boost = clientFrame(boost);
+        
+        inFlight.reserve(KARTS * 2);
+        states.reserve(KARTS);
+    }
+    
+    // Session::makeShared + Session::send: the frame stays referenced until the write completes
+    void send(const Packet& packet) {
+        auto frame = BufferPool::acquireShared(packet.totalSize());
+        packet.appendTo(*frame);
+        inFlight.push_back(std::move(frame));
+    }
+    
+    void tick() {
+        x += 0.25f;
+        
+        // Receive: decode in place, queued copies for the room worker
+        float sum = 0.0f;
+        for (int i = 0; i < KARTS; ++i) {
+            auto view = PacketView::fromFrame(position[i].bytes, position[i].size);
+            sum += view->readFloat() + x;
+        }
+        for (const Frame* f : {&drift, &boost}) {
+            auto view = PacketView::fromFrame(f->bytes, f->size);
+            Packet queued = view->copy();
+            int32_t playerId = queued.readInt32();
+            
+            // Race broadcast of the drift / boost state
+            Packet reply(view->cmd());
+            reply.writeInt32(playerId).writeUInt8(1);
+            send(reply);
+        }
+        
+        // Snapshot: legacy 0x31 frames coalesced once, one pooled frame per recipient
+        moves.clear();
+        for (int i = 0; i < KARTS; ++i) {
+            Packet pos(CMD::S_POSITION);
+            pos.writeInt32(i).writeFloat(sum + i).writeFloat(2.0f).writeFloat(-5.0f).writeFloat(0.5f);
+            pos.appendTo(moves);
+        }
+        for (int r = 0; r < KARTS; ++r) {
+            auto frame = BufferPool::acquireShared(moves.size());
+            frame->assign(moves.begin(), moves.end());
+            inFlight.push_back(std::move(frame));
+        }
+        
+        // Compact movement, encode + decode round trip
+        states.clear();
+        for (int i = 0; i < KARTS; ++i) {
+            MoveState state;
+            state.entityId = static_cast<uint32_t>(i + 1);
+            state.x = quantizer.quantize(x + i, 0.0f);
+            state.y = quantizer.quantize(2.0f, 0.0f);
+            state.z = quantizer.quantize(-5.0f, 0.0f);
+            state.rot = MovementQuantizer::quantizeAngle(x * 0.01f);
+            states.push_back(state);
+        }
+        payload.clear();
+        encoder.encode(states, payload);
+        decoder.decode(payload.data(), payload.size(), decoded);
+        encoder.acknowledge(static_cast<uint8_t>(decoder.lastSeq()));
+        
+        // Writes completed
+        inFlight.clear();
+    }
+};
+
+} // namespace
+
+int main() {
+    Bench bench;
+    
+    for (int i = 0; i < WARMUP; ++i) {
+        bench.tick();
+    }
+    
+    uint64_t before = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        bench.tick();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocations = g_allocations.load() - before;
+    
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+    std::printf("packet hot path: %d ticks x %d karts\n", ITERATIONS, KARTS);
+    std::printf("  %.1f ns/tick, %llu heap allocations (%.3f per tick)\n",
+                ns, static_cast<unsigned long long>(allocations),
+                static_cast<double>(allocations) / ITERATIONS);
+    
+    return allocations == 0 ? 0 : 1;
+}
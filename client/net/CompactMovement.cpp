@@ -0,0 +1,110 @@
+// CompactMovement.cpp - negotiated compact kart movement
+#include "network/CompactMovement.h"
+
+Packet CompactMovement::BuildOffer() const {
+    Packet packet = Packet::Create(CMD, SUB_CAPS);
+    packet.WriteInt8(static_cast<int8_t>(knc::MOVEMENT_CODEC_VERSION));
+    packet.Finalize();
+    return packet;
+}
+
+void CompactMovement::OnPacket(Packet& packet) {
+    switch (packet.GetFlag()) {
+        case SUB_CAPS: {
+            uint8_t version = static_cast<uint8_t>(packet.ReadInt8());
+            if (version != knc::MOVEMENT_CODEC_VERSION) {
+                return;
+            }
+            m_enabled = true;
+            
+            // race grid follows the version when a race starts
+            if (packet.GetSize() >= 17) {
+                m_quantizer.originX = packet.ReadFloat();
+                m_quantizer.originY = packet.ReadFloat();
+                m_quantizer.originZ = packet.ReadFloat();
+                m_quantizer.step = packet.ReadFloat();
+                m_hasGrid = true;
+                m_encoder.reset();
+                m_decoder.reset();
+            }
+            break;
+        }
+        
+        case SUB_ACK:
+            m_encoder.acknowledge(static_cast<uint8_t>(packet.ReadInt8()));
+            break;
+        
+        case SUB_DATA: {
+            if (!m_hasGrid) {
+                return;
+            }
+            std::vector<uint8_t> payload(packet.GetSize());
+            packet.ReadBytes(payload.data(), payload.size());
+            
+            std::vector<knc::MoveState> states;
+            if (!m_decoder.decode(payload.data(), payload.size(), states)) {
+                return;  // baseline lost, server falls back to a full snapshot
+            }
+            
+            m_remoteKarts.clear();
+            m_remoteKarts.reserve(states.size());
+            for (const auto& state : states) {
+                RemoteKart kart;
+                kart.characterId = static_cast<int32_t>(state.entityId);
+                kart.x = m_quantizer.dequantize(state.x, m_quantizer.originX);
+                kart.y = m_quantizer.dequantize(state.y, m_quantizer.originY);
+                kart.z = m_quantizer.dequantize(state.z, m_quantizer.originZ);
+                kart.rot = knc::MovementQuantizer::dequantizeAngle(state.rot);
+                m_remoteKarts.push_back(kart);
+            }
+            m_ackPending = true;
+            break;
+        }
+        
+        default:
+            break;
+    }
+}
+
+Packet CompactMovement::BuildPosition(int32_t characterId, float x, float y, float z, float rot) {
+    if (!m_enabled || !m_hasGrid) {
+        Packet packet = Packet::Create(CMD_LEGACY_POSITION);
+        packet.WriteFloat(x);
+        packet.WriteFloat(y);
+        packet.WriteFloat(z);
+        packet.WriteFloat(rot);
+        packet.Finalize();
+        return packet;
+    }
+    
+    knc::MoveState state;
+    state.entityId = static_cast<uint32_t>(characterId);
+    state.x = m_quantizer.quantize(x, m_quantizer.originX);
+    state.y = m_quantizer.quantize(y, m_quantizer.originY);
+    state.z = m_quantizer.quantize(z, m_quantizer.originZ);
+    state.rot = knc::MovementQuantizer::quantizeAngle(rot);
+    
+    std::vector<uint8_t> payload;
+    m_encoder.encode({state}, payload);
+    
+    Packet packet = Packet::Create(CMD, SUB_DATA);
+    packet.WriteBytes(payload.data(), payload.size());
+    packet.Finalize();
+    return packet;
+}
+
+Packet CompactMovement::BuildAck() {
+    Packet packet = Packet::Create(CMD, SUB_ACK);
+    packet.WriteInt8(static_cast<int8_t>(m_decoder.lastSeq()));
+    packet.Finalize();
+    m_ackPending = false;
+    return packet;
+}
+
+void CompactMovement::ResetRace() {
+    m_hasGrid = false;
+    m_ackPending = false;
+    m_encoder.reset();
+    m_decoder.reset();
+    m_remoteKarts.clear();
+}
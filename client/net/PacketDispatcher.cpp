@@ -0,0 +1,50 @@
+// PacketDispatcher.cpp - packet routing and handler registration
+#include "network/PacketDispatcher.h"
+
+void PacketDispatcher::Initialize() {
+    // handlers are registered by their owners (scenes, CompactMovement...)
+    // through RegisterHandler once the dispatcher exists
+}
+
+void PacketDispatcher::RegisterHandler(uint16_t cmd, Handler handler) {
+    RegisterHandler(cmd, "?", std::move(handler));
+}
+
+void PacketDispatcher::RegisterHandler(uint16_t cmd, const char* name, Handler handler, Table::Rule rule) {
+    if (cmd <= 0xFF) {
+        m_table.on(static_cast<uint8_t>(cmd), name, std::move(handler), rule);
+    } else {
+        m_table.onFull(cmd, name, std::move(handler), rule);
+    }
+}
+
+void PacketDispatcher::Dispatch(Packet& packet) {
+    const Table::Entry* entry = m_table.find(packet.GetCmd(), packet.GetFlag());
+    
+    switch (m_table.check(entry, packet.GetSize())) {
+        case Table::Verdict::Ok:
+            if (entry->handler) {
+                entry->handler(packet);
+            }
+            break;
+        case Table::Verdict::Unknown:
+            printf("[NET] unhandled cmd 0x%02X flag 0x%02X (%u bytes)\n",
+                   packet.GetCmd(), packet.GetFlag(), packet.GetSize());
+            break;
+        default:
+            printf("[NET] dropped cmd 0x%02X %s: bad size %u\n",
+                   packet.GetCmd(), entry->name, packet.GetSize());
+            break;
+    }
+}
+
+void PacketDispatcher::PrintStats() const {
+    m_table.forEach([](const Table::Entry& entry) {
+        printf("[NET] 0x%04X %-24s packets=%llu bytes=%llu rejected=%llu\n",
+               entry.cmdFull, entry.name,
+               static_cast<unsigned long long>(entry.stats.packets.load()),
+               static_cast<unsigned long long>(entry.stats.bytes.load()),
+               static_cast<unsigned long long>(entry.stats.rejected.load()));
+    });
+    printf("[NET] unknown opcodes: %llu\n", static_cast<unsigned long long>(m_table.unknownCount()));
+}
@@ -0,0 +1,57 @@
+// CompactMovement.h - negotiated compact kart movement (custom server only)
+#pragma once
+
+#include "network/Packet.h"
+#include "net/MovementCodec.h"
+#include <vector>
+
+// kart of another player, decoded from the server snapshot
+struct RemoteKart {
+    int32_t characterId;
+    float x, y, z;
+    float rot;
+};
+
+// CMD 0xF2 (X_COMPACT_MOVE), sub-command in the header flag.
+// Original servers never answer the offer, so the client just keeps
+// sending the legacy 0x31 position packet.
+class CompactMovement {
+public:
+    static constexpr uint8_t CMD = 0xF2;
+    static constexpr uint8_t CMD_LEGACY_POSITION = 0x31;
+    enum SubCmd : uint8_t {
+        SUB_CAPS = 0x00,
+        SUB_ACK = 0x01,
+        SUB_DATA = 0x02,
+    };
+    
+    // send once after entering the lobby
+    Packet BuildOffer() const;
+    
+    // handler for CMD 0xF2 (register with PacketDispatcher)
+    void OnPacket(Packet& packet);
+    
+    bool IsEnabled() const { return m_enabled; }
+    bool HasRaceGrid() const { return m_hasGrid; }
+    
+    // own kart: compact delta once the race grid is known, legacy 0x31 otherwise
+    Packet BuildPosition(int32_t characterId, float x, float y, float z, float rot);
+    
+    // ack of the last decoded server snapshot (send once per received snapshot)
+    bool HasPendingAck() const { return m_ackPending; }
+    Packet BuildAck();
+    
+    const std::vector<RemoteKart>& GetRemoteKarts() const { return m_remoteKarts; }
+    
+    // race finished / left room
+    void ResetRace();
+    
+private:
+    bool m_enabled = false;
+    bool m_hasGrid = false;
+    bool m_ackPending = false;
+    knc::MovementQuantizer m_quantizer;
+    knc::MovementEncoder m_encoder;
+    knc::MovementDecoder m_decoder;
+    std::vector<RemoteKart> m_remoteKarts;
+};
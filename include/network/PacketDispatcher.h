@@ -2,21 +2,27 @@
 #pragma once
 
 #include "network/Packet.h"
+#include "net/DispatchTable.h"
 #include <functional>
-#include <unordered_map>
 #include <cstdio>
 
+// routes received packets through the same opcode table as the server
+// (direct index by cmd / cmd+flag, per-opcode size limits and counters)
 class PacketDispatcher {
 public:
     using Handler = std::function<void(Packet&)>;
+    using Table = knc::DispatchTable<Handler>;
     
     void Initialize();
+    // cmd <= 0xFF: any flag, otherwise the full cmd (cmd | flag << 8)
     void RegisterHandler(uint16_t cmd, Handler handler);
+    void RegisterHandler(uint16_t cmd, const char* name, Handler handler, Table::Rule rule = {});
     void Dispatch(Packet& packet);
     
+    // per-opcode stats
+    const Table& GetTable() const { return m_table; }
+    void PrintStats() const;
+    
 private:
-    // key = cmd for basic, or fullCmd for extended
-    std::unordered_map<uint16_t, Handler> m_handlers;
+    Table m_table;
 };
-
-
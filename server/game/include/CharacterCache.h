@@ -0,0 +1,128 @@
+/**
+ * @file CharacterCache.h
+ * @brief Authoritative in-memory character state with write-behind flushes
+ *
+ * A character is loaded from MariaDB once, at login (attach), and from then
+ * on the cache is the source of truth: gameplay code changes the cached
+ * state through update() and never writes the characters row itself.
+ *
+ * update() diffs the state before and after the change and marks only the
+ * columns that changed, so ten gold changes in a race are one row in the
+ * next flush. A flush thread writes the dirty characters each flushInterval
+ * as transactional batches, one per set of changed columns (a cached
+ * prepared UPDATE each); DB write load follows the flush rate, not the
+ * number of player actions.
+ *
+ * A flush writes only the columns changed through the cache (plus
+ * last_played): writers that still update the characters row directly,
+ * like the web admin's gold grants, are not overwritten by a login.
+ *
+ * release() (disconnect) asks for an immediate flush and drops the entry
+ * once it is written; a player who reconnects before that gets the cached
+ * state back instead of a stale row. shutdown() flushes everything.
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "packets/PacketBuilder.h"
+
+namespace knc {
+
+// Persisted columns of a characters row
+struct CharacterState {
+    int32_t id = 0;
+    int32_t accountId = 0;
+    int32_t level = 1;
+    int32_t xp = 0;
+    int32_t gold = 0;
+    int32_t cash = 0;
+    int32_t wins = 0;
+    int32_t losses = 0;
+    int32_t totalRaces = 0;
+    int32_t playtimeMinutes = 0;
+    int32_t licenseClass = 0;
+    int32_t rankPoints = 0;
+    int32_t driverId = 1;
+    bool tutorialCompleted = false;
+    
+    // Identity, kept for resyncs - never written back
+    std::string name;
+    bool isGM = false;
+    
+    bool operator==(const CharacterState& o) const;
+    bool operator!=(const CharacterState& o) const { return !(*this == o); }
+};
+
+class CharacterCache {
+public:
+    struct Stats {
+        uint64_t updates = 0;        // update() calls that changed something
+        uint64_t flushes = 0;        // batches written
+        uint64_t rowsWritten = 0;
+        uint64_t failedFlushes = 0;
+    };
+    
+    explicit CharacterCache(std::chrono::milliseconds flushInterval = std::chrono::milliseconds(5000));
+    ~CharacterCache();
+    
+    CharacterCache(const CharacterCache&) = delete;
+    CharacterCache& operator=(const CharacterCache&) = delete;
+    
+    void start();
+    // Stop the flush thread and write every dirty character
+    void shutdown();
+    
+    // Login: take the loaded character, or if it is still cached (reconnect
+    // before the flush) overwrite player with the cached values. Only
+    // last_played is written for it with the next flush.
+    void attach(PlayerData& player);
+    
+    // Disconnect: flush soon, then forget the character
+    void release(int32_t characterId);
+    
+    // Apply fn to the cached state; false if the character is not cached
+    bool update(int32_t characterId, const std::function<void(CharacterState&)>& fn);
+    
+    // Copy of the cached state; false if the character is not cached
+    bool get(int32_t characterId, CharacterState& out) const;
+    // Overwrite the character fields of player with the cached state
+    bool fill(int32_t characterId, PlayerData& player) const;
+    
+    // Common gameplay changes
+    bool addGold(int32_t characterId, int32_t delta);
+    bool addRaceResult(int32_t characterId, bool won, int32_t xp, int32_t gold, int32_t rankPoints);
+    
+    // Write the dirty characters now (flush thread, shutdown)
+    void flush();
+    
+    size_t size() const;
+    Stats stats() const;
+
+private:
+    struct Entry {
+        CharacterState state;
+        uint32_t dirty = 0;     // changed columns, see CharacterCache.cpp (0 = clean)
+        bool released = false;  // drop after the next successful flush
+    };
+    
+    void flushLoop();
+    
+    std::unordered_map<int32_t, Entry> m_entries;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::mutex m_flushMutex;  // one flush at a time (thread vs shutdown)
+    std::thread m_thread;
+    std::chrono::milliseconds m_flushInterval;
+    bool m_running = false;
+    bool m_flushRequested = false;
+    Stats m_stats;
+};
+
+} // namespace knc
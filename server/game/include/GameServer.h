@@ -5,12 +5,24 @@
 
 #pragma once
 #include <asio.hpp>
+#include <array>
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
 #include "net/Session.h"
 #include "net/Protocol.h"
+#include "net/DispatchTable.h"
 #include "game/Room.h"
+#include "game/CollisionMesh.h"
+#include "RoomWorkerPool.h"
+#include "CharacterCache.h"
+#include "Inventory.h"
+#include "HandoffTable.h"
+#include "LoginLink.h"
+#include "security/AdmissionControl.h"
 #include "packets/PacketBuilder.h"
 #include "handlers/ShopHandler.h"
 #include "handlers/RaceHandler.h"
@@ -20,22 +32,72 @@ namespace knc {
 
 class GameServer {
 public:
-    explicit GameServer(int port);
+    // Opcode tables: I/O thread handlers, and room worker handlers (see registerHandlers)
+    // Arrival time of a room packet (stamped by RoomWorkerPool::postPacket)
+    using RecvTime = RoomWorkerPool::Clock::time_point;
+    using PacketFn = void (*)(GameServer&, const Session::Ptr&, PacketView&);
+    using RoomPacketFn = void (*)(GameServer&, const Session::Ptr&, PacketView&, Room&, RecvTime);
+    using PacketTable = DispatchTable<PacketFn>;
+    using RoomPacketTable = DispatchTable<RoomPacketFn>;
+    
+    // ioThreads: threads running the io_context (Server.io_threads)
+    // roomWorkers: room simulation threads (Server.room_workers)
+    // snapshotHz: position snapshot rate of racing rooms (Server.snapshot_hz, 10-30)
+    // flushIntervalMs: character write-behind interval (Database.flush_interval_ms)
+    explicit GameServer(int port, int ioThreads = 1, int roomWorkers = 1,
+                        int snapshotHz = GameConst::TICK_RATE, int flushIntervalMs = 5000);
     
     void run();
     void stop();
     
+    // Register with the LoginServer and keep the link open for session handoffs
+    // (call before run); pushed handoffs expire after handoffTtl
+    void connectLoginServer(const LoginLink::Config& config, std::chrono::seconds handoffTtl);
+    
+    // Keep a dropped player's room slot, race state, character and inventory parked
+    // this long for a reconnect of the same account (Server.resume_grace_s, 0 = off)
+    void setResumeGrace(std::chrono::seconds grace) { m_resumeGrace = grace; }
+    
+    // Per-IP/subnet connection caps and rates, pending handshake limit and deadline
+    // ([Admission], call before run)
+    void setAdmission(const AdmissionControl::Config& config) { m_admission.configure(config); }
+    
+    // Collision mesh of a track, for the position checks of rooms on that map
+    // (call before run; maps without one skip the geometry checks)
+    void setTrackCollision(uint8_t mapId, std::shared_ptr<const CollisionMesh> mesh) { m_tracks[mapId] = std::move(mesh); }
+    const CollisionMesh* trackCollision(uint8_t mapId) const { return m_tracks[mapId].get(); }
+    
     // room management
     std::shared_ptr<Room> createRoom(const RoomSettings& settings);
     std::shared_ptr<Room> getRoom(uint32_t roomId);
     void removeRoom(uint32_t roomId);
-    const std::unordered_map<uint32_t, std::shared_ptr<Room>>& rooms() const { return m_rooms; }
+    
+    // Authoritative character state of logged-in players (gold, wins, xp...):
+    // gameplay changes go through here, never straight to the characters table
+    CharacterCache& characters() { return m_characters; }
+    
+    // Inventory loaded at login, null before that. Use it on the session's strand only;
+    // after an inventory DB write apply the same change to it (see Inventory.h)
+    std::shared_ptr<Inventory> inventory(uint32_t sessionId) const;
+    
+    // Run a task on the worker thread owning the room - the only place room state may be touched
+    void postToRoom(const std::shared_ptr<Room>& room, RoomWorkerPool::Task task);
+    // Race state for a room (one RaceHandler per worker, call from the room's worker only)
+    RaceHandler& raceHandler(const Room& room);
+    // Snapshot copy - the live map is only safe to touch under m_roomsMutex
+    std::unordered_map<uint32_t, std::shared_ptr<Room>> rooms() const {
+        std::lock_guard<std::mutex> lock(m_roomsMutex);
+        return m_rooms;
+    }
     
     // session management
-    void addSession(Session::Ptr session);
+    void addSession(const Session::Ptr& session);
     void removeSession(uint32_t sessionId);
     Session::Ptr getSession(uint32_t sessionId);
-    size_t sessionCount() const { return m_sessions.size(); }
+    size_t sessionCount() const {
+        std::lock_guard<std::mutex> lock(m_sessionsMutex);
+        return m_sessions.size();
+    }
     
     // Get all sessions (for lobby broadcast)
     std::vector<Session::Ptr> getSessions() const {
@@ -61,71 +123,197 @@ public:
     }
 
 private:
+    // Adapters so table entries are plain function pointers (no std::function on the hot path)
+    template <void (GameServer::*Fn)(const Session::Ptr&, PacketView&)>
+    static void member(GameServer& server, const Session::Ptr& session, PacketView& packet) {
+        (server.*Fn)(session, packet);
+    }
+    template <void (GameServer::*Fn)(const Session::Ptr&, PacketView&, Room&)>
+    static void roomMember(GameServer& server, const Session::Ptr& session, PacketView& packet, Room& room,
+                           RecvTime) {
+        (server.*Fn)(session, packet, room);
+    }
+    // Room handler that needs the packet's arrival time (movement samples)
+    template <void (GameServer::*Fn)(const Session::Ptr&, PacketView&, Room&, RecvTime)>
+    static void timedRoomMember(GameServer& server, const Session::Ptr& session, PacketView& packet, Room& room,
+                                RecvTime received) {
+        (server.*Fn)(session, packet, room, received);
+    }
+    template <void (*Fn)(Session::Ptr, PacketView&, GameServer*)>
+    static void external(GameServer& server, const Session::Ptr& session, PacketView& packet) {
+        Fn(session, packet, &server);
+    }
+    // External handler that writes inventory rows without updating the session
+    // inventory: the lists it may touch are reloaded after it
+    template <void (*Fn)(Session::Ptr, PacketView&, GameServer*), uint8_t Lists>
+    static void externalInventory(GameServer& server, const Session::Ptr& session, PacketView& packet) {
+        Fn(session, packet, &server);
+        server.refreshInventory(session, Lists);
+    }
+    template <void (*Fn)(Session::Ptr, GameServer*)>
+    static void externalNoPayload(GameServer& server, const Session::Ptr& session, PacketView&) {
+        Fn(session, &server);
+    }
+    
+    void registerHandlers();
+    void logDispatchStats() const;
+    
     void startAccept();
-    void handlePacket(Session::Ptr session, Packet& packet);
-    void onDisconnect(Session::Ptr session);
-    void sendPlayerData(Session::Ptr session);
+    // Close a started session that is not authenticated by the admission deadline
+    void startHandshakeDeadline(const Session::Ptr& session);
+    // Authenticated or gone: frees its pending handshake slot (false if already done)
+    bool endHandshake(uint32_t sessionId);
+    void initSession(const Session::Ptr& session, const std::string& ip);
+    void completeHandoff(const Session::Ptr& session, const std::string& ip, std::optional<Handoff> login);
+    void handlePacket(const Session::Ptr& session, PacketView& packet);
+    void onDisconnect(const Session::Ptr& session);
+    void finishDisconnect(const Session::Ptr& session);
+    
+    // session resumption
+    void parkSession(const Session::Ptr& session);
+    Session::Ptr unpark(uint32_t accountId, uint32_t sessionId = 0);
+    void resumeSession(const Session::Ptr& session, const Session::Ptr& parked);
+    void sendPlayerData(const Session::Ptr& session);
+    
+    // room worker routing
+    void routeToRoom(const Session::Ptr& session, PacketView& packet);
+    void handleRoomPacket(const Session::Ptr& session, PacketView& packet, Room& room,
+                          RecvTime received);
+    void leaveRoom(const Session::Ptr& session, uint32_t roomId);
+    void joinRoom(const Session::Ptr& session, Room& room, const std::string& password, int32_t vehicleTemplateId);
+    void removeFromRoom(const Session::Ptr& session, Room& room);
+    // Room info + the other players, for a joining or resuming player (room worker)
+    void sendRoomState(const Session::Ptr& session, Room& room);
+    
+    // snapshot tick (room worker)
+    void onRoomTick(int worker);
+    void sendRoomSnapshot(Room& room);
+    void appendCompactMovement(std::vector<uint8_t>& out, const Session::Ptr& session, Room& room);
+    void applyPosition(const Session::Ptr& session, Room& room, float x, float y, float z, float rot,
+                       RecvTime received);
+    
+    // compact movement (custom client)
+    void handleCompactCaps(const Session::Ptr& session, PacketView& packet);
+    void handleCompactMove(const Session::Ptr& session, PacketView& packet, Room& room,
+                           RecvTime received);
     
     // auth handlers
-    void handleHeartbeat(Session::Ptr session, Packet& packet);
-    void handleClientAuth(Session::Ptr session, Packet& packet);
-    void handleFullState(Session::Ptr session, Packet& packet);
-    void handleClientInfo(Session::Ptr session, Packet& packet);
-    void handleSessionConfirm(Session::Ptr session, Packet& packet);
+    void handleHeartbeat(const Session::Ptr& session, PacketView& packet);
+    void handleClientAuth(const Session::Ptr& session, PacketView& packet);
+    void handleFullState(const Session::Ptr& session, PacketView& packet);
+    void handleClientInfo(const Session::Ptr& session, PacketView& packet);
+    void handleSessionConfirm(const Session::Ptr& session, PacketView& packet);
     
     // lobby handlers
-    void handleChannelSelect(Session::Ptr session, Packet& packet);
-    void handleLobbyRequest(Session::Ptr session, Packet& packet);
-    void handleServerQuery(Session::Ptr session, Packet& packet);
+    void handleChannelSelect(const Session::Ptr& session, PacketView& packet);
+    void handleLobbyRequest(const Session::Ptr& session, PacketView& packet);
+    void handleServerQuery(const Session::Ptr& session, PacketView& packet);
     
     // room handlers
-    void handleCreateRoom(Session::Ptr session, Packet& packet);
-    void handleJoinRoom(Session::Ptr session, Packet& packet);
-    void handleLeaveRoom(Session::Ptr session, Packet& packet);
-    void handleRoomState(Session::Ptr session, Packet& packet);
+    void handleCreateRoom(const Session::Ptr& session, PacketView& packet);
+    void handleJoinRoom(const Session::Ptr& session, PacketView& packet);
+    void handleLeaveRoom(const Session::Ptr& session, PacketView& packet);
+    void handleRoomState(const Session::Ptr& session, PacketView& packet);
     
     // chat handlers
-    void handleChatMessage(Session::Ptr session, Packet& packet);
-    void handleWhisper(Session::Ptr session, Packet& packet);
-    void handleLobbyChat(Session::Ptr session, Packet& packet);
+    void handleChatMessage(const Session::Ptr& session, PacketView& packet);
+    void handleWhisper(const Session::Ptr& session, PacketView& packet);
+    void handleLobbyChat(const Session::Ptr& session, PacketView& packet);
     
     // game handlers
-    void handleStateChange(Session::Ptr session, Packet& packet);
-    void handlePosition(Session::Ptr session, Packet& packet);
-    void handleLapComplete(Session::Ptr session, Packet& packet);
-    void handleItemPickup(Session::Ptr session, Packet& packet);
-    void handleItemHit(Session::Ptr session, Packet& packet);
-    void handleRaceFinish(Session::Ptr session, Packet& packet);
-    void handleItemUse(Session::Ptr session, Packet& packet);
-    void handleGameStart(Session::Ptr session, Packet& packet);
-    void handlePlayerReady(Session::Ptr session, Packet& packet);
+    void handleStateChange(const Session::Ptr& session, PacketView& packet);
+    
+    // room worker handlers
+    void handlePosition(const Session::Ptr& session, PacketView& packet, Room& room,
+                        RecvTime received);
+    void handleGameStart(const Session::Ptr& session, PacketView& packet, Room& room);
+    void handlePlayerReady(const Session::Ptr& session, PacketView& packet, Room& room);
     
     // shop handlers
-    void handleShopBrowse(Session::Ptr session, Packet& packet);
-    void handleSellItem(Session::Ptr session, Packet& packet);
+    void handleShopBrowse(const Session::Ptr& session, PacketView& packet);
+    void handleSellItem(const Session::Ptr& session, PacketView& packet);
     
     // data handlers
-    void handleRequestData(Session::Ptr session, Packet& packet);
-    void handleUnknown32(Session::Ptr session, Packet& packet);
+    void handleRequestData(const Session::Ptr& session, PacketView& packet);
+    void handleUnknown32(const Session::Ptr& session, PacketView& packet);
+    
+    // garage lists (served from the session inventory)
+    void handleGarageVehicles(const Session::Ptr& session, PacketView& packet);
+    void handleGarageItems(const Session::Ptr& session, PacketView& packet);
+    void handleGarageAccessories(const Session::Ptr& session, PacketView& packet);
+    
+    // Lists (Inventory::List bits) changed in the DB by a handler that bypasses
+    // the session inventory: served from the DB until reloaded
+    void refreshInventory(const Session::Ptr& session, uint8_t lists);
     
     // inventory handlers
-    void handleEquipVehicle(Session::Ptr session, Packet& packet);
-    void handleEquipAccessory(Session::Ptr session, Packet& packet);
-    void handleUseItem(Session::Ptr session, Packet& packet);
+    void handleEquipVehicle(const Session::Ptr& session, PacketView& packet);
+    void handleEquipAccessory(const Session::Ptr& session, PacketView& packet);
+    void handleUseItem(const Session::Ptr& session, PacketView& packet);
     
     asio::io_context m_ioContext;
     asio::ip::tcp::acceptor m_acceptor;
+    asio::steady_timer m_acceptRetry;
+    int m_ioThreads;
+    
+    // Accept-stage throttling. Sessions still in the handshake, with their
+    // deadline timer once reading (null while the handoff is loaded)
+    AdmissionControl m_admission;
+    std::unordered_map<uint32_t, std::shared_ptr<asio::steady_timer>> m_handshakes;  // by session id
+    std::mutex m_handshakesMutex;
+    
+    // Track meshes by map id: set before run, read-only from the room workers
+    std::array<std::shared_ptr<const CollisionMesh>, 256> m_tracks;
     
     std::unordered_map<uint32_t, Session::Ptr> m_sessions;
     mutable std::mutex m_sessionsMutex;
+    std::unordered_map<uint32_t, std::shared_ptr<Inventory>> m_inventories;  // by session id
+    mutable std::mutex m_inventoriesMutex;
     std::unordered_map<uint32_t, std::shared_ptr<Room>> m_rooms;
     mutable std::mutex m_roomsMutex;
     uint32_t m_nextRoomId = 1;
     
+    RoomWorkerPool m_roomWorkers;
+    // Rooms owned by each worker, only touched from that worker's thread
+    std::vector<std::vector<std::shared_ptr<Room>>> m_workerRooms;
+    
+    // Reusable snapshot buffers, one set per worker (indexed by Room::worker())
+    struct MoveSpan {
+        uint32_t sessionId;
+        size_t begin;
+        size_t end;
+    };
+    struct SnapshotScratch {
+        std::vector<uint8_t> common;
+        std::vector<uint8_t> moves;
+        std::vector<MoveSpan> moveSpans;
+        std::vector<MoveState> states;
+        std::vector<uint8_t> payload;
+    };
+    std::vector<SnapshotScratch> m_snapshotScratch;
+    
+    PacketTable m_packetTable;
+    RoomPacketTable m_roomTable;
+    
     // handlers
     ShopHandler m_shopHandler;
-    RaceHandler m_raceHandler;
+    std::vector<std::unique_ptr<RaceHandler>> m_raceHandlers;  // indexed by Room::worker()
     InventoryHandler m_inventoryHandler;
+    
+    CharacterCache m_characters;
+    
+    // Login -> game handoffs, pushed by the LoginServer over m_loginLink
+    HandoffTable m_handoffs;
+    std::unique_ptr<LoginLink> m_loginLink;
+    
+    // Disconnected sessions waiting for their account to reconnect
+    struct ParkedSession {
+        Session::Ptr session;
+        std::shared_ptr<asio::steady_timer> expiry;
+    };
+    std::unordered_map<uint32_t, ParkedSession> m_parked;  // by account id
+    std::mutex m_parkedMutex;
+    std::chrono::seconds m_resumeGrace{0};
 };
 
 } // namespace knc
@@ -0,0 +1,86 @@
+/**
+ * @file HandoffTable.h
+ * @brief Pending login -> game handoffs pushed by the LoginServer
+ *
+ * When the LoginServer redirects a client it pushes the session
+ * (I_SESSION_HANDOFF over the LoginLink) before the client reconnects here,
+ * so the accept path finds it in memory instead of querying and deleting
+ * the active_sessions row.
+ *
+ * Entries are keyed by token and indexed by client IP. Several clients
+ * behind one NAT share an IP: each accept takes the oldest pending handoff
+ * of its IP, which matches the order the LoginServer redirected them in,
+ * instead of every connection getting the newest row. Entries expire after
+ * a TTL (a client that never shows up does not leak).
+ *
+ * Thread-safe: filled from the LoginLink, consumed by the accept path on
+ * any I/O thread.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "packets/PacketBuilder.h"
+
+namespace knc {
+
+struct Handoff {
+    std::string token;
+    std::string clientIp;
+    int32_t accountId = 0;
+    int32_t characterId = 0;
+    // Character summary for the immediate 0xA7 (no DB trip before the client timeout)
+    bool hasCharacter = false;
+    PlayerData player;
+};
+
+class HandoffTable {
+public:
+    explicit HandoffTable(std::chrono::seconds ttl = std::chrono::seconds(30));
+    
+    void setTtl(std::chrono::seconds ttl);
+    
+    // Add (or refresh) a pending handoff
+    void put(Handoff handoff);
+    // Oldest unexpired handoff for this IP, removed from the table
+    std::optional<Handoff> take(const std::string& clientIp);
+    // Drop a handoff (LoginServer revoked it, session kicked...)
+    bool revoke(const std::string& token);
+    
+    size_t size() const;
+    
+    struct Stats {
+        uint64_t pushed = 0;
+        uint64_t hits = 0;      // take() found a handoff
+        uint64_t misses = 0;    // take() found nothing (DB fallback)
+        uint64_t expired = 0;
+    };
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    struct Entry {
+        Handoff handoff;
+        Clock::time_point expires;
+    };
+    
+    void expire(Clock::time_point now);
+    void unindex(const std::string& clientIp, const std::string& token);
+    
+    std::unordered_map<std::string, Entry> m_byToken;
+    // Tokens per IP in arrival order
+    std::unordered_map<std::string, std::deque<std::string>> m_byIp;
+    // All tokens in arrival order - with one TTL that is also expiry order
+    std::deque<std::pair<Clock::time_point, std::string>> m_expiry;
+    std::chrono::seconds m_ttl;
+    Stats m_stats;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace knc
@@ -0,0 +1,109 @@
+/**
+ * @file Inventory.h
+ * @brief Per-session inventory with pre-encoded inventory packets
+ *
+ * The vehicles, items and accessories of a character are loaded once, at
+ * login, and kept with the session. Each list also keeps its encoded
+ * S_INVENTORY_VEHICLES / ITEMS / ACCESSORY frame: the first send after a
+ * change encodes it, every later one (garage tabs, shop, car factory...)
+ * sends the same shared frame without touching the DB or re-serializing.
+ *
+ * The DB stays the source of truth for inventory rows. Code that changes
+ * one (equip, purchase, sell, delete, upgrade) writes it first, then applies
+ * the same change here, which drops only the frame of the list it touched.
+ * Handlers that write the DB without knowing about this cache (shop,
+ * InventoryHandler) mark the lists they may have changed stale instead:
+ * those are served from the DB until a reload replaces them.
+ *
+ * Not thread-safe: like the rest of the session state it is only used on
+ * the session strand.
+ */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "net/Session.h"
+#include "packets/PacketBuilder.h"
+
+namespace knc {
+
+class Database;
+
+class Inventory {
+public:
+    // Load the three lists of a character (blocking - call from a DB worker job)
+    static Inventory load(Database& db, int32_t characterId);
+    
+    int32_t characterId() const { return m_characterId; }
+    
+    const std::vector<VehicleInfo>& vehicles() const { return m_vehicles; }
+    const std::vector<ItemInfo>& items() const { return m_items; }
+    const std::vector<AccessoryInfo>& accessories() const { return m_accessories; }
+    
+    const VehicleInfo* findVehicle(int32_t id) const;
+    const ItemInfo* findItem(int32_t id) const;
+    const AccessoryInfo* findAccessory(int32_t id) const;
+    const VehicleInfo* equippedVehicle() const;
+    
+    // =========================================================================
+    // ENCODED PACKETS (built on first use after a change)
+    // =========================================================================
+    
+    Session::SharedBuffer vehiclesPacket();     // 0x1B
+    Session::SharedBuffer itemsPacket();        // 0x1C
+    Session::SharedBuffer accessoriesPacket();  // 0x1D
+    
+    // =========================================================================
+    // CHANGES (after the DB write succeeded)
+    // =========================================================================
+    
+    // Add, or replace the entry with the same id
+    void putVehicle(const VehicleInfo& vehicle);
+    void putItem(const ItemInfo& item);
+    void putAccessory(const AccessoryInfo& accessory);
+    
+    // False if there was no such entry
+    bool removeVehicle(int32_t id);
+    bool removeItem(int32_t id);
+    bool removeAccessory(int32_t id);
+    
+    // One equipped vehicle at a time: equips id, unequips the others
+    bool equipVehicle(int32_t id);
+    bool setItemEquipped(int32_t id, bool equipped);
+    // One equipped accessory per slot: equips id, unequips the others in its slot
+    bool equipAccessory(int32_t id);
+    bool unequipAccessory(int32_t id);
+    
+    // New quantity of a stack; 0 removes it
+    bool setItemQuantity(int32_t id, int32_t quantity);
+    
+    // =========================================================================
+    // OUT-OF-BAND CHANGES (DB written by code that doesn't update the cache)
+    // =========================================================================
+    
+    enum List : uint8_t { VEHICLES = 1, ITEMS = 2, ACCESSORIES = 4, ALL_LISTS = 7 };
+    
+    // Don't serve these lists until reloaded; returns the generation for reloaded()
+    uint32_t markStale(uint8_t lists);
+    bool isStale(uint8_t lists) const { return (m_stale & lists) != 0; }
+    // Take the stale lists from a fresh load(), unless a newer markStale() came
+    // after that load was started (its own reload is on the way)
+    void reloaded(Inventory&& fresh, uint32_t generation);
+
+private:
+    int32_t m_characterId = 0;
+    
+    std::vector<VehicleInfo> m_vehicles;
+    std::vector<ItemInfo> m_items;
+    std::vector<AccessoryInfo> m_accessories;
+    
+    // Empty when the list changed since it was last encoded
+    Session::SharedBuffer m_vehiclesFrame;
+    Session::SharedBuffer m_itemsFrame;
+    Session::SharedBuffer m_accessoriesFrame;
+    
+    uint8_t m_stale = 0;            // List bits
+    uint32_t m_generation = 0;      // markStale() calls
+};
+
+} // namespace knc
@@ -0,0 +1,81 @@
+/**
+ * @file LoginLink.h
+ * @brief Persistent internal connection to the LoginServer
+ *
+ * Registers the GameServer (I_SERVER_REGISTER) like before, but keeps the
+ * connection open afterwards: the LoginServer pushes every redirect over it
+ * (I_SESSION_HANDOFF) into the HandoffTable, so the session is already in
+ * memory when the client connects here.
+ *
+ * Runs on the GameServer io_context. A lost or refused connection is
+ * retried with backoff (1s doubling to 30s) and re-registers; until then
+ * accepts fall back to the active_sessions table. The backoff only goes
+ * back to 1s once a link has stayed up for a while.
+ *
+ * A LoginServer that closes cleanly right after the registration ack is
+ * the old one-shot kind: the registration stands, nothing is retried and
+ * every accept uses the active_sessions table.
+ */
+
+#pragma once
+#include <asio.hpp>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "net/Protocol.h"
+
+namespace knc {
+
+class HandoffTable;
+class PacketView;
+
+class LoginLink {
+public:
+    struct Config {
+        std::string loginHost = "127.0.0.1";
+        int loginPort = 50017;
+        std::string key;
+        // What the LoginServer lists in the server selection
+        int serverId = 1;
+        std::string name;
+        std::string host = "127.0.0.1";
+        int port = 50018;
+        int maxPlayers = 100;
+        int serverType = 0;
+    };
+    
+    LoginLink(asio::io_context& io, HandoffTable& handoffs, Config config);
+    
+    void start();
+    void stop();
+    
+    bool isRegistered() const { return m_registered; }
+
+private:
+    void connect();
+    void sendRegister();
+    void readHeader();
+    void readPayload();
+    void onPacket(PacketView& packet);
+    void onHandoff(PacketView& packet);
+    void onReadError(const std::error_code& ec);
+    void scheduleReconnect(const std::string& reason);
+    
+    asio::strand<asio::io_context::executor_type> m_strand;
+    asio::ip::tcp::resolver m_resolver;
+    asio::ip::tcp::socket m_socket;
+    asio::steady_timer m_retryTimer;
+    HandoffTable& m_handoffs;
+    Config m_config;
+    
+    std::array<uint8_t, PACKET_HEADER_SIZE> m_header{};
+    std::vector<uint8_t> m_payload;
+    std::vector<uint8_t> m_registerFrame;
+    std::chrono::seconds m_backoff{1};
+    std::chrono::steady_clock::time_point m_registeredAt;
+    bool m_registered = false;
+    bool m_stopped = false;
+};
+
+} // namespace knc
@@ -0,0 +1,108 @@
+/**
+ * @file RoomWorkerPool.h
+ * @brief Fixed set of room simulation threads, decoupled from network I/O
+ *
+ * Every Room is pinned to one worker for its whole life. I/O threads only
+ * decode frames and post them to the owning worker's queue (multi-producer,
+ * single-consumer), so room and race state is touched by exactly one thread
+ * and needs no lock. New rooms go to the least loaded worker.
+ *
+ * An optional fixed-rate tick runs on every worker between task batches
+ * (room snapshots).
+ *
+ * Routed packets (positions, drift, boost...) are queued as plain Job
+ * records with the payload stored inline rather than as a Task closure, and
+ * the queue vectors keep their capacity between batches, so the per-packet
+ * path does not allocate once warmed up.
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "net/Session.h"
+
+namespace knc {
+
+class Room;
+
+class RoomWorkerPool {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+    using TickHandler = std::function<void(int worker)>;
+    // received: when the I/O thread queued the packet, not when the worker runs it
+    using PacketHandler = std::function<void(const Session::Ptr&, PacketView&, Room&, Clock::time_point received)>;
+    
+    // Payloads up to this size are copied inline into the queued job
+    static constexpr size_t INLINE_PAYLOAD = 128;
+    
+    explicit RoomWorkerPool(int workers);
+    ~RoomWorkerPool();
+    
+    // Call before start(): handler(workerIndex) runs on each worker every interval
+    void setTick(std::chrono::milliseconds interval, TickHandler handler);
+    // Call before start(): receives every packet queued with postPacket()
+    void setPacketHandler(PacketHandler handler);
+    
+    void start();
+    void stop();
+    
+    int workerCount() const { return static_cast<int>(m_workers.size()); }
+    
+    // Load balancing: pick a worker for a new room / forget it when the room is removed
+    int assign();
+    void release(int worker);
+    // Players joining (+1) or leaving (-1) a room owned by worker
+    void addLoad(int worker, int delta);
+    
+    // Queue a task on a worker (thread-safe, called from the I/O threads)
+    void post(int worker, Task task);
+    // Queue a received packet for a room; the view is copied, it may point into a receive ring.
+    // The packet is stamped here so a worker backlog does not squeeze the gaps between samples
+    void postPacket(int worker, const Session::Ptr& session, const std::shared_ptr<Room>& room,
+                    const PacketView& packet);
+    
+    // True when called from inside worker's own thread
+    bool isWorkerThread(int worker) const;
+
+private:
+    // Either a task or a routed packet; one queue keeps them in posting order
+    struct Job {
+        Task task;
+        Session::Ptr session;
+        std::shared_ptr<Room> room;
+        PacketHeader header{};
+        Clock::time_point received;
+        size_t size = 0;
+        uint8_t payload[INLINE_PAYLOAD];
+        std::vector<uint8_t> overflow;  // larger payloads only
+    };
+    
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<Job> queue;       // producers append, the worker swaps the whole batch out
+        std::atomic<int> rooms{0};
+        std::atomic<int> players{0};
+        std::thread thread;
+        int index = 0;
+    };
+    
+    void enqueue(int worker, Job&& job);
+    void run(Job& job);
+    void workerLoop(Worker& worker);
+    
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<bool> m_running{false};
+    std::chrono::milliseconds m_tickInterval{0};
+    TickHandler m_tickHandler;
+    PacketHandler m_packetHandler;
+};
+
+} // namespace knc
@@ -13,12 +13,7 @@
 namespace knc {
 
 class GameServer;
-
-// Position with timestamp for movement validation
-struct PositionRecord {
-    float x, y, z;
-    std::chrono::steady_clock::time_point timestamp;
-};
+class CollisionMesh;
 
 // Violation types
 enum class ViolationType {
@@ -38,42 +33,51 @@ enum class ViolationSeverity {
     Critical  // Perm ban
 };
 
+// Per-session state lives in Session::antiCheat (no shared maps, no lock).
+// Validation runs from room packet handlers on the session's room worker
 class AntiCheatHandler {
 public:
     // Validation functions (called by other handlers)
-    static bool validatePosition(Session::Ptr session, float x, float y, float z);
+    // With the room's track mesh, also rejects moves through walls and flags
+    // sustained driving away from the track geometry. received: arrival time of
+    // the sample, so speeds don't depend on when the room worker gets to it
+    static bool validatePosition(Session::Ptr session, float x, float y, float z,
+                                 std::chrono::steady_clock::time_point received,
+                                 const CollisionMesh* track = nullptr);
     static bool validateSpeed(Session::Ptr session, float speed, int mapId);
     static bool validateLapTime(Session::Ptr session, int mapId, int lapTimeMs);
     static bool validateItemUse(Session::Ptr session, int itemId, int targetId);
-    static bool validatePacketRate(Session::Ptr session);
     
     // Violation handling
     static void reportViolation(Session::Ptr session, ViolationType type, 
                                 ViolationSeverity severity, const std::string& details);
     
+    // Position history handoff between room workers (see AntiCheatState.h).
+    // acquire: false while another room still owns it; a new owner starts empty.
+    static bool acquireHistory(Session& session, uint32_t roomId);
+    static void releaseHistory(Session& session, uint32_t roomId);
+    
     // Statistics
-    static int getViolationCount(uint32_t sessionId);
-    static void clearViolations(uint32_t sessionId);
+    static int getViolationCount(const Session& session);
+    static void clearViolations(Session& session);
     
-    // Configuration
+    // Configuration (at startup, before any session: read without locking)
     static void setMaxSpeed(int mapId, float maxSpeed);
     static void setMinLapTime(int mapId, int minTimeMs);
     
     // Constants
     static constexpr float DEFAULT_MAX_SPEED = 500.0f;       // Units per second
     static constexpr float TELEPORT_THRESHOLD = 100.0f;      // Units (instant movement)
-    static constexpr int PACKET_FLOOD_THRESHOLD = 100;       // Packets per second
     static constexpr int MIN_LAP_TIME_MS = 15000;            // 15 seconds minimum lap
     static constexpr int VIOLATION_THRESHOLD_KICK = 3;       // Violations before kick
     static constexpr int VIOLATION_THRESHOLD_BAN = 10;       // Violations before temp ban
+    static constexpr float OFF_TRACK_DISTANCE = 30.0f;       // Units from the nearest triangle
+    static constexpr int OFF_TRACK_SAMPLES = 60;             // Consecutive positions (~1s) before reporting
+    static constexpr float WALL_MARGIN = 1.0f;               // Units past a wall before it counts as crossed
+    static constexpr float WALL_NORMAL_UP = 0.3f;            // |normal along the track's up axis| below this: wall
+    static constexpr float WORLD_LIMIT = 1.0e6f;             // Units from 0 on any axis, farther is corrupt
     
 private:
-    // Per-session tracking
-    static std::unordered_map<uint32_t, std::vector<PositionRecord>> s_positionHistory;
-    static std::unordered_map<uint32_t, int> s_violationCounts;
-    static std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> s_lastPacketTime;
-    static std::unordered_map<uint32_t, int> s_packetCounts;
-    
     // Map-specific limits
     static std::unordered_map<int, float> s_maxSpeeds;
     static std::unordered_map<int, int> s_minLapTimes;
@@ -81,9 +85,14 @@ private:
     // Helper functions
     static float calculateSpeed(const PositionRecord& prev, const PositionRecord& curr);
     static float calculateDistance(float x1, float y1, float z1, float x2, float y2, float z2);
+    // action: High = kick, Critical = temp ban, anything else = none
     static void logViolation(Session::Ptr session, ViolationType type, 
-                             ViolationSeverity severity, const std::string& details);
+                             ViolationSeverity severity, const std::string& details,
+                             ViolationSeverity action);
     static void takeAction(Session::Ptr session, ViolationSeverity severity);
+    // prev: last accepted position in this room, null if none
+    static bool validateTrack(Session::Ptr session, const PositionRecord* prev,
+                              float x, float y, float z, const CollisionMesh& track);
 };
 
 } // namespace knc
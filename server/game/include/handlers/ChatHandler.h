@@ -13,10 +13,10 @@ class GameServer;
 
 class ChatHandler {
 public:
-    void handleChatMessage(Session::Ptr session, Packet& packet, GameServer* server);
-    void handleWhisper(Session::Ptr session, Packet& packet, GameServer* server);
+    void handleChatMessage(const Session::Ptr& session, PacketView& packet, GameServer* server);
+    void handleWhisper(const Session::Ptr& session, PacketView& packet, GameServer* server);
     
-    void sendChatMessage(Session::Ptr target, uint32_t senderId, 
+    void sendChatMessage(const Session::Ptr& target, uint32_t senderId, 
                          const std::u16string& message, uint8_t channel);
 };
 
@@ -13,10 +13,10 @@ class GameServer;
 
 class GameHandler {
 public:
-    void handlePosition(Session::Ptr session, Packet& packet, GameServer* server);
-    void handleItemUse(Session::Ptr session, Packet& packet, GameServer* server);
-    void handleFinish(Session::Ptr session, Packet& packet, GameServer* server);
-    void handleLapComplete(Session::Ptr session, Packet& packet, GameServer* server);
+    void handlePosition(Session::Ptr session, PacketView& packet, GameServer* server);
+    void handleItemUse(Session::Ptr session, PacketView& packet, GameServer* server);
+    void handleFinish(Session::Ptr session, PacketView& packet, GameServer* server);
+    void handleLapComplete(Session::Ptr session, PacketView& packet, GameServer* server);
 };
 
 } // namespace knc
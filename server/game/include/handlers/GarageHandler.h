@@ -41,27 +41,27 @@ struct GarageItem {
 class GarageHandler {
 public:
     // Garage requests
-    static void handleOpenGarage(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleOpenGarage(Session::Ptr session, PacketView& packet, GameServer* server);
     static void handleGetVehicleList(Session::Ptr session, GameServer* server);
     static void handleGetItemList(Session::Ptr session, GameServer* server);
     static void handleGetAccessoryList(Session::Ptr session, GameServer* server);
     static void handleGetDriverList(Session::Ptr session, GameServer* server);
     
     // Equipment actions
-    static void handleEquipVehicle(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleEquipItem(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleEquipAccessory(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleEquipDriver(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleEquipVehicle(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleEquipItem(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleEquipAccessory(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleEquipDriver(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Modification
-    static void handleUpgradeVehicle(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleRepairVehicle(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleDeleteItem(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleUpgradeVehicle(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleRepairVehicle(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleDeleteItem(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Car Factory (vehicle customization)
     static void handleEnterCarFactory(Session::Ptr session, GameServer* server);
-    static void handleCustomizeVehicle(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleSaveCustomization(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleCustomizeVehicle(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleSaveCustomization(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Helpers
     static void sendVehicleList(Session::Ptr session, int characterId);
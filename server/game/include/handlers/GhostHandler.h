@@ -28,16 +28,16 @@ class GhostHandler {
 public:
     // Ghost Mode menu
     static void handleOpenGhostMenu(Session::Ptr session, GameServer* server);
-    static void handleSelectMap(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleSelectMap(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Ghost race
-    static void handleStartGhostRace(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleGhostRaceComplete(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleSaveGhost(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleStartGhostRace(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleGhostRaceComplete(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleSaveGhost(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Ghost data
-    static void handleGetGhostList(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleDownloadGhost(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleGetGhostList(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleDownloadGhost(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Helpers
     static std::vector<GhostRecord> getGhostsForMap(int32_t mapId, int limit = 10);
@@ -12,10 +12,10 @@ class InventoryHandler {
 public:
     // requests
     void handleInventoryRequest(Session::Ptr session, GameServer* server);
-    void handleEquipVehicle(Session::Ptr session, Packet& packet, GameServer* server);
-    void handleEquipAccessory(Session::Ptr session, Packet& packet, GameServer* server);
-    void handleUseItem(Session::Ptr session, Packet& packet, GameServer* server);
-    void handleSellItem(Session::Ptr session, Packet& packet, GameServer* server);
+    void handleEquipVehicle(Session::Ptr session, PacketView& packet, GameServer* server);
+    void handleEquipAccessory(Session::Ptr session, PacketView& packet, GameServer* server);
+    void handleUseItem(Session::Ptr session, PacketView& packet, GameServer* server);
+    void handleSellItem(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // send inventory data
     void sendVehicleList(Session::Ptr session);
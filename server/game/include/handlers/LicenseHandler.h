@@ -14,10 +14,10 @@ class GameServer;
 class LicenseHandler {
 public:
     // Tutorial/License requests
-    static void handleStartTutorial(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleTutorialComplete(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleLicenseTest(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleLicenseResult(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleStartTutorial(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleTutorialComplete(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleLicenseTest(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleLicenseResult(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Progress queries
     static void handleGetLicenseProgress(Session::Ptr session, GameServer* server);
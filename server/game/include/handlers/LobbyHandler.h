@@ -39,20 +39,20 @@ class LobbyHandler {
 public:
     // Room management
     static void handleRoomListRequest(Session::Ptr session, GameServer* server);
-    static void handleCreateRoom(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleJoinRoom(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleQuickMatch(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleCreateRoom(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleJoinRoom(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleQuickMatch(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Player list
     static void handlePlayerListRequest(Session::Ptr session, GameServer* server);
-    static void handlePlayerProfile(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handlePlayerProfile(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Chat & Whisper
-    static void handleLobbyChat(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleWhisper(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleAddFriend(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleRemoveFriend(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleBlockPlayer(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleLobbyChat(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleWhisper(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleAddFriend(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleRemoveFriend(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleBlockPlayer(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Helpers
     static void sendRoomList(Session::Ptr session, GameServer* server);
@@ -22,11 +22,11 @@ struct MissionData {
 class MissionHandler {
 public:
     // Mission list/info
-    static void handleGetMissionList(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleGetMissionDetails(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleGetMissionList(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleGetMissionDetails(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Mission completion
-    static void handleClaimReward(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleClaimReward(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Progress tracking (called internally by other handlers)
     static void updateRaceProgress(int characterId, bool won);
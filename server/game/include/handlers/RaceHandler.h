@@ -35,17 +35,17 @@ class RaceHandler {
 public:
     // race flow
     void handleStartRace(Session::Ptr session, Room* room, GameServer* server);
-    void handlePosition(Session::Ptr session, Packet& packet, Room* room);
-    void handleLapComplete(Session::Ptr session, Packet& packet, Room* room);
-    void handleFinish(Session::Ptr session, Packet& packet, Room* room, GameServer* server);
-    void handleItemPickup(Session::Ptr session, Packet& packet, Room* room);
-    void handleItemUse(Session::Ptr session, Packet& packet, Room* room);
-    void handleItemHit(Session::Ptr session, Packet& packet, Room* room);
+    void handlePosition(Session::Ptr session, PacketView& packet, Room* room);
+    void handleLapComplete(Session::Ptr session, PacketView& packet, Room* room);
+    void handleFinish(Session::Ptr session, PacketView& packet, Room* room, GameServer* server);
+    void handleItemPickup(Session::Ptr session, PacketView& packet, Room* room);
+    void handleItemUse(Session::Ptr session, PacketView& packet, Room* room);
+    void handleItemHit(Session::Ptr session, PacketView& packet, Room* room);
     
     // Mini Turbo / Boost
-    void handleDriftStart(Session::Ptr session, Packet& packet, Room* room);
-    void handleDriftEnd(Session::Ptr session, Packet& packet, Room* room);
-    void handleBoostActivate(Session::Ptr session, Packet& packet, Room* room);
+    void handleDriftStart(Session::Ptr session, PacketView& packet, Room* room);
+    void handleDriftEnd(Session::Ptr session, PacketView& packet, Room* room);
+    void handleBoostActivate(Session::Ptr session, PacketView& packet, Room* room);
     void handleBoostEnd(Session::Ptr session, Room* room);
     
     // race management
@@ -13,10 +13,10 @@ class GameServer;
 
 class RoomHandler {
 public:
-    void handleReady(Session::Ptr session, Packet& packet, GameServer* server);
+    void handleReady(Session::Ptr session, PacketView& packet, GameServer* server);
     void handleLeaveRoom(Session::Ptr session, GameServer* server);
     void handleStartGame(Session::Ptr session, GameServer* server);
-    void handleTeamChange(Session::Ptr session, Packet& packet, GameServer* server);
+    void handleTeamChange(Session::Ptr session, PacketView& packet, GameServer* server);
 };
 
 } // namespace knc
@@ -36,12 +36,12 @@ class ScenarioHandler {
 public:
     // Menu navigation
     static void handleOpenScenarioMenu(Session::Ptr session, GameServer* server);
-    static void handleSelectChapter(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleSelectStage(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleSelectChapter(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleSelectStage(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Gameplay
-    static void handleStartScenario(Session::Ptr session, Packet& packet, GameServer* server);
-    static void handleScenarioComplete(Session::Ptr session, Packet& packet, GameServer* server);
+    static void handleStartScenario(Session::Ptr session, PacketView& packet, GameServer* server);
+    static void handleScenarioComplete(Session::Ptr session, PacketView& packet, GameServer* server);
     
     // Data
     static void handleGetProgress(Session::Ptr session, GameServer* server);
@@ -0,0 +1,47 @@
+/**
+ * @file PacketSchemas.h
+ * @brief Wire layouts of the PacketBuilder inventory structs
+ *
+ * Maps VehicleInfo / ItemInfo / AccessoryInfo onto the certified
+ * VehicleData / ItemData / AccessoryData layouts (docs/packets/STRUCTURES.md).
+ * Fields are listed in wire order; members with no wire slot (ownerId) are
+ * simply not listed.
+ */
+
+#pragma once
+#include "net/PacketSchema.h"
+#include "packets/PacketBuilder.h"
+
+namespace knc {
+
+// VehicleData (0x2C): template, unique id, durability, max durability, 7 stats
+using VehicleInfoSchema = schema::Schema<VehicleInfo,
+    schema::Field<&VehicleInfo::templateId>,
+    schema::Field<&VehicleInfo::id>,
+    schema::Field<&VehicleInfo::durability>,
+    schema::Field<&VehicleInfo::maxDurability>,
+    schema::Field<&VehicleInfo::stats>>;
+static_assert(VehicleInfoSchema::WIRE_SIZE == sizeof(VehicleData), "VehicleInfo must encode as VehicleData");
+
+// ItemData (0x38): expiration, enhancement, bound and reserved are not tracked yet
+using ItemInfoSchema = schema::Schema<ItemInfo,
+    schema::Field<&ItemInfo::templateId>,
+    schema::Field<&ItemInfo::id>,
+    schema::Field<&ItemInfo::quantity>,
+    schema::Field<&ItemInfo::slot>,
+    schema::Field<&ItemInfo::equipped, int32_t>,
+    schema::Pad<4 * 3 + 24>>;
+static_assert(ItemInfoSchema::WIRE_SIZE == sizeof(ItemData), "ItemInfo must encode as ItemData");
+
+// AccessoryData (0x1C)
+using AccessoryInfoSchema = schema::Schema<AccessoryInfo,
+    schema::Field<&AccessoryInfo::templateId>,
+    schema::Field<&AccessoryInfo::id>,
+    schema::Field<&AccessoryInfo::slot>,
+    schema::Field<&AccessoryInfo::bonus1>,
+    schema::Field<&AccessoryInfo::bonus2>,
+    schema::Field<&AccessoryInfo::bonus3>,
+    schema::Field<&AccessoryInfo::equipped, int32_t>>;
+static_assert(AccessoryInfoSchema::WIRE_SIZE == sizeof(AccessoryData), "AccessoryInfo must encode as AccessoryData");
+
+} // namespace knc
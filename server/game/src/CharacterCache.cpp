@@ -0,0 +1,313 @@
+/**
+ * @file CharacterCache.cpp
+ * @brief Authoritative in-memory character state with write-behind flushes
+ */
+
+#include "CharacterCache.h"
+#include "db/Database.h"
+#include "logging/Logger.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace knc {
+
+namespace {
+    // Written columns, one dirty bit each
+    enum Field { LEVEL, XP, GOLD, CASH, WINS, LOSSES, TOTAL_RACES, PLAYTIME, LICENSE, RANK_POINTS,
+                 DRIVER, TUTORIAL, FIELD_COUNT };
+    const char* const COLUMNS[FIELD_COUNT] = {
+        "level", "experience", "gold", "cash", "wins", "losses", "total_races", "playtime_minutes",
+        "license_class", "rank_points", "equipped_driver_id", "tutorial_completed"};
+    // No column changed, the row is only touched (login)
+    constexpr uint32_t LAST_PLAYED = 1u << FIELD_COUNT;
+    
+    int32_t fieldValue(const CharacterState& s, int field) {
+        switch (field) {
+            case LEVEL:       return s.level;
+            case XP:          return s.xp;
+            case GOLD:        return s.gold;
+            case CASH:        return s.cash;
+            case WINS:        return s.wins;
+            case LOSSES:      return s.losses;
+            case TOTAL_RACES: return s.totalRaces;
+            case PLAYTIME:    return s.playtimeMinutes;
+            case LICENSE:     return s.licenseClass;
+            case RANK_POINTS: return s.rankPoints;
+            case DRIVER:      return s.driverId;
+            case TUTORIAL:    return s.tutorialCompleted ? 1 : 0;
+        }
+        return 0;
+    }
+    
+    uint32_t changedFields(const CharacterState& before, const CharacterState& after) {
+        uint32_t mask = 0;
+        for (int f = 0; f < FIELD_COUNT; ++f) {
+            if (fieldValue(before, f) != fieldValue(after, f)) mask |= 1u << f;
+        }
+        return mask;
+    }
+    
+    // One prepared statement per column set; last_played follows activity, so
+    // it is refreshed with each write
+    std::string flushSql(uint32_t mask) {
+        std::string sql = "UPDATE characters SET ";
+        for (int f = 0; f < FIELD_COUNT; ++f) {
+            if (mask & (1u << f)) sql += std::string(COLUMNS[f]) + " = ?, ";
+        }
+        return sql + "last_played = NOW() WHERE id = ?";
+    }
+    
+    DBParams flushParams(const CharacterState& s, uint32_t mask) {
+        DBParams params;
+        for (int f = 0; f < FIELD_COUNT; ++f) {
+            if (mask & (1u << f)) params.emplace_back(fieldValue(s, f));
+        }
+        params.emplace_back(s.id);
+        return params;
+    }
+    
+    void applyTo(const CharacterState& s, PlayerData& player) {
+        player.id = s.id;
+        player.accountId = s.accountId;
+        player.level = s.level;
+        player.xp = s.xp;
+        player.gold = s.gold;
+        player.cash = s.cash;
+        player.wins = s.wins;
+        player.losses = s.losses;
+        player.totalRaces = s.totalRaces;
+        player.playtimeMinutes = s.playtimeMinutes;
+        player.licenseClass = s.licenseClass;
+        player.rankPoints = s.rankPoints;
+        player.driverId = s.driverId;
+        player.tutorialCompleted = s.tutorialCompleted;
+    }
+}
+
+bool CharacterState::operator==(const CharacterState& o) const {
+    return id == o.id && accountId == o.accountId && level == o.level && xp == o.xp &&
+           gold == o.gold && cash == o.cash && wins == o.wins && losses == o.losses &&
+           totalRaces == o.totalRaces && playtimeMinutes == o.playtimeMinutes &&
+           licenseClass == o.licenseClass && rankPoints == o.rankPoints &&
+           driverId == o.driverId && tutorialCompleted == o.tutorialCompleted;
+}
+
+CharacterCache::CharacterCache(std::chrono::milliseconds flushInterval)
+    : m_flushInterval(flushInterval.count() > 0 ? flushInterval : std::chrono::milliseconds(5000))
+{
+}
+
+CharacterCache::~CharacterCache() {
+    shutdown();
+}
+
+void CharacterCache::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return;
+    m_running = true;
+    m_thread = std::thread(&CharacterCache::flushLoop, this);
+}
+
+void CharacterCache::shutdown() {
+    bool wasRunning;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        wasRunning = m_running;
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    
+    // Whatever is still dirty goes out now
+    flush();
+    
+    Stats s = stats();
+    if (wasRunning) {
+        LOG_INFOF("CHAR", "Write-behind: updates={} flushes={} rows={} failed={}",
+                  s.updates, s.flushes, s.rowsWritten, s.failedFlushes);
+    }
+}
+
+// =============================================================================
+// STATE
+// =============================================================================
+
+void CharacterCache::attach(PlayerData& player) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(player.id);
+    if (it != m_entries.end()) {
+        // Reconnected before the last flush: the cached state is newer than the row
+        applyTo(it->second.state, player);
+        it->second.released = false;
+        it->second.dirty |= LAST_PLAYED;
+        return;
+    }
+    
+    Entry entry;
+    entry.state.id = player.id;
+    entry.state.accountId = player.accountId;
+    entry.state.level = player.level;
+    entry.state.xp = player.xp;
+    entry.state.gold = player.gold;
+    entry.state.cash = player.cash;
+    entry.state.wins = player.wins;
+    entry.state.losses = player.losses;
+    entry.state.totalRaces = player.totalRaces;
+    entry.state.playtimeMinutes = player.playtimeMinutes;
+    entry.state.licenseClass = player.licenseClass;
+    entry.state.rankPoints = player.rankPoints;
+    entry.state.driverId = player.driverId;
+    entry.state.tutorialCompleted = player.tutorialCompleted;
+    entry.state.name = player.name;
+    entry.state.isGM = player.isGM;
+    entry.dirty = LAST_PLAYED;  // The row itself is as loaded
+    m_entries.emplace(player.id, entry);
+}
+
+void CharacterCache::release(int32_t characterId) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(characterId);
+        if (it == m_entries.end()) return;
+        it->second.released = true;
+        m_flushRequested = true;
+    }
+    m_cv.notify_one();
+}
+
+bool CharacterCache::update(int32_t characterId, const std::function<void(CharacterState&)>& fn) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(characterId);
+    if (it == m_entries.end()) return false;
+    
+    CharacterState before = it->second.state;
+    fn(it->second.state);
+    it->second.state.id = before.id;
+    if (uint32_t changed = changedFields(before, it->second.state)) {
+        it->second.dirty |= changed;
+        ++m_stats.updates;
+    }
+    return true;
+}
+
+bool CharacterCache::get(int32_t characterId, CharacterState& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(characterId);
+    if (it == m_entries.end()) return false;
+    out = it->second.state;
+    return true;
+}
+
+bool CharacterCache::fill(int32_t characterId, PlayerData& player) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(characterId);
+    if (it == m_entries.end()) return false;
+    applyTo(it->second.state, player);
+    player.name = it->second.state.name;
+    player.isGM = it->second.state.isGM;
+    return true;
+}
+
+bool CharacterCache::addGold(int32_t characterId, int32_t delta) {
+    return update(characterId, [delta](CharacterState& s) {
+        s.gold = std::max(0, s.gold + delta);
+    });
+}
+
+bool CharacterCache::addRaceResult(int32_t characterId, bool won, int32_t xp, int32_t gold, int32_t rankPoints) {
+    return update(characterId, [=](CharacterState& s) {
+        ++s.totalRaces;
+        if (won) ++s.wins;
+        else ++s.losses;
+        s.xp += xp;
+        s.gold = std::max(0, s.gold + gold);
+        s.rankPoints = std::max(0, s.rankPoints + rankPoints);
+    });
+}
+
+size_t CharacterCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+CharacterCache::Stats CharacterCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+// =============================================================================
+// FLUSH
+// =============================================================================
+
+void CharacterCache::flush() {
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    
+    // Rows grouped by their set of changed columns: one statement and batch each
+    struct Batch {
+        std::vector<int32_t> ids;
+        std::vector<DBParams> rows;
+    };
+    std::map<uint32_t, Batch> batches;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            Entry& entry = it->second;
+            if (entry.dirty != 0) {
+                const uint32_t mask = entry.dirty & ~LAST_PLAYED;
+                Batch& batch = batches[mask];
+                batch.ids.push_back(it->first);
+                batch.rows.push_back(flushParams(entry.state, mask));
+                entry.dirty = 0;
+            } else if (entry.released) {
+                // Written by an earlier flush and gone from the server
+                it = m_entries.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+    
+    for (const auto& [mask, batch] : batches) {
+        bool ok = Database::instance().executeBatch(flushSql(mask), batch.rows);
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (ok) {
+            ++m_stats.flushes;
+            m_stats.rowsWritten += batch.rows.size();
+            // Drop released characters that did not change again meanwhile
+            for (int32_t id : batch.ids) {
+                auto it = m_entries.find(id);
+                if (it != m_entries.end() && it->second.released && it->second.dirty == 0) {
+                    m_entries.erase(it);
+                }
+            }
+            continue;
+        }
+        
+        // Keep these columns dirty, the next flush retries them
+        ++m_stats.failedFlushes;
+        for (int32_t id : batch.ids) {
+            auto it = m_entries.find(id);
+            if (it != m_entries.end()) it->second.dirty |= mask | LAST_PLAYED;
+        }
+        LOG_ERRORF("CHAR", "Write-behind flush of {} characters failed, retrying next interval", batch.rows.size());
+    }
+}
+
+void CharacterCache::flushLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        m_cv.wait_for(lock, m_flushInterval, [this]() { return !m_running || m_flushRequested; });
+        if (!m_running) break;
+        m_flushRequested = false;
+        
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+} // namespace knc
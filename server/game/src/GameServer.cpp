@@ -5,6 +5,7 @@
 
 #include "GameServer.h"
 #include "packets/PacketBuilder.h"
+#include "net/BufferPool.h"
 #include "logging/Logger.h"
 #include "security/BanManager.h"
 #include "db/Database.h"
@@ -15,281 +16,565 @@
 #include "handlers/LobbyHandler.h"
 #include "handlers/GhostHandler.h"
 #include "handlers/ScenarioHandler.h"
+#include <algorithm>
 
 namespace knc {
 
-GameServer::GameServer(int port)
-    : m_acceptor(m_ioContext, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), static_cast<uint16_t>(port)))
+GameServer::GameServer(int port, int ioThreads, int roomWorkers, int snapshotHz, int flushIntervalMs)
+    : m_ioContext(ioThreads > 0 ? ioThreads : 1)
+    , m_acceptor(m_ioContext, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), static_cast<uint16_t>(port)))
+    , m_acceptRetry(m_ioContext)
+    , m_ioThreads(ioThreads > 0 ? ioThreads : 1)
+    , m_roomWorkers(roomWorkers)
+    , m_characters(std::chrono::milliseconds(flushIntervalMs))
 {
+    // One RaceHandler per worker: race state of a room only lives on its worker thread
+    for (int i = 0; i < m_roomWorkers.workerCount(); ++i) {
+        m_raceHandlers.push_back(std::make_unique<RaceHandler>());
+    }
+    m_workerRooms.resize(m_roomWorkers.workerCount());
+    m_snapshotScratch.resize(m_roomWorkers.workerCount());
+    
+    m_roomWorkers.setPacketHandler([this](const Session::Ptr& session, PacketView& packet, Room& room,
+                                          RecvTime received) {
+        handleRoomPacket(session, packet, room, received);
+    });
+    
+    snapshotHz = std::clamp(snapshotHz, GameConst::MIN_SNAPSHOT_HZ, GameConst::MAX_SNAPSHOT_HZ);
+    m_roomWorkers.setTick(std::chrono::milliseconds(1000 / snapshotHz), [this](int worker) {
+        onRoomTick(worker);
+    });
+    
+    registerHandlers();
     startAccept();
 }
 
 void GameServer::run() {
-    LOG_INFO("GAME", "Server running...");
+    LOG_INFO("GAME", "Server running on " + std::to_string(m_ioThreads) + " I/O thread(s)...");
+    
+    m_roomWorkers.start();
+    m_characters.start();
+    
+    // The calling thread is one of the I/O threads
+    std::vector<std::thread> threads;
+    threads.reserve(m_ioThreads - 1);
+    for (int i = 1; i < m_ioThreads; ++i) {
+        threads.emplace_back([this]() { m_ioContext.run(); });
+    }
+    
     m_ioContext.run();
+    
+    for (auto& t : threads) {
+        t.join();
+    }
+    
+    m_roomWorkers.stop();
+    // Last write of every dirty character, before main closes the DB pool
+    m_characters.shutdown();
+    logDispatchStats();
+}
+
+void GameServer::connectLoginServer(const LoginLink::Config& config, std::chrono::seconds handoffTtl) {
+    m_handoffs.setTtl(handoffTtl);
+    m_loginLink = std::make_unique<LoginLink>(m_ioContext, m_handoffs, config);
+    m_loginLink->start();
 }
 
 void GameServer::stop() {
+    if (m_loginLink) m_loginLink->stop();
     m_ioContext.stop();
+    m_roomWorkers.stop();
     LOG_INFO("GAME", "Server stopped");
 }
 
 void GameServer::startAccept() {
-    m_acceptor.async_accept([this](std::error_code ec, asio::ip::tcp::socket socket) {
-        if (!ec) {
-            std::string ip = socket.remote_endpoint().address().to_string();
+    // Each accepted socket gets its own strand: a session's handlers never run
+    // concurrently, while different sessions spread across the I/O threads
+    m_acceptor.async_accept(asio::make_strand(m_ioContext), [this](std::error_code ec, asio::ip::tcp::socket socket) {
+        if (ec == asio::error::operation_aborted) return;
+        if (ec) {
+            // Out of file descriptors and the like: back off instead of spinning on accept
+            LOG_WARN("GAME", "Accept failed: " + ec.message());
+            m_acceptRetry.expires_after(std::chrono::milliseconds(100));
+            m_acceptRetry.async_wait([this](std::error_code ec) {
+                if (!ec) startAccept();
+            });
+            return;
+        }
+        
+        // Refused before a Session, its receive ring or any DB work exists
+        std::error_code epEc;
+        auto address = socket.remote_endpoint(epEc).address();
+        AdmissionControl::Verdict verdict = AdmissionControl::Verdict::Admit;
+        if (epEc) {
+            socket.close(epEc);
+        } else if (BanManager::instance().isBanned(address)) {
+            LOG_WARN("GAME", "Rejected banned IP: " + address.to_string());
+            socket.close(epEc);
+        } else if ((verdict = m_admission.admit(address)) != AdmissionControl::Verdict::Admit) {
+            LOG_DEBUGF("GAME", "Refused {}: {}", address.to_string(), AdmissionControl::verdictName(verdict));
+            socket.close(epEc);
+        } else {
+            auto session = std::make_shared<Session>(std::move(socket));
+            LOG_INFO("GAME", "New connection from " + session->remoteAddress() + " (ID: " + std::to_string(session->id()) + ")");
             
-            if (BanManager::instance().isBanned(ip)) {
-                LOG_WARN("GAME", "Rejected banned IP: " + ip);
-                socket.close();
-            } else {
-                auto session = std::make_shared<Session>(std::move(socket));
-                LOG_INFO("GAME", "New connection from " + session->remoteAddress() + " (ID: " + std::to_string(session->id()) + ")");
-                
-                session->setPacketHandler([this](Session::Ptr s, Packet& pkt) {
-                    handlePacket(s, pkt);
-                });
-                
-                session->setDisconnectHandler([this](Session::Ptr s) {
-                    onDisconnect(s);
-                });
-                
-                addSession(session);
-                session->start();
-                
-                // Look up session from DB (stored by LoginServer during redirect)
-                auto& db = Database::instance();
-                auto sessions = db.query(
-                    "SELECT account_id, character_id, token FROM active_sessions WHERE client_ip = '" +
-                    db.escapeString(ip) + "' ORDER BY created_at DESC LIMIT 1"
-                );
-                
-                if (!sessions.empty()) {
-                    session->accountId = std::stoi(sessions[0]["account_id"]);
-                    session->characterId = std::stoi(sessions[0]["character_id"]);
-                    session->sessionToken = sessions[0]["token"];
-                    
-                    LOG_INFO("GAME", "Found pending session for IP " + ip + 
-                             ": account=" + std::to_string(session->accountId) +
-                             " char=" + std::to_string(session->characterId));
-                    
-                    // Client after redirect checks byte_8CCDC0 flag set by receiving 0xA7
-                    // We MUST send 0xA7 IMMEDIATELY before client's 1000ms timeout
-                    
-                    // Load character data
-                    auto chars = db.queryPrepared(
-                        "SELECT name, level, experience, gold, cash, wins, losses FROM characters WHERE account_id = ? LIMIT 1",
-                        {std::to_string(session->accountId)}
-                    );
-                    
-                    if (!chars.empty()) {
-                        PlayerData player;
-                        player.name = chars[0]["name"];
-                        player.level = std::stoi(chars[0]["level"]);
-                        player.xp = std::stoi(chars[0]["experience"]);
-                        player.gold = std::stoi(chars[0]["gold"]);
-                        player.cash = std::stoi(chars[0]["cash"]);
-                        player.wins = std::stoi(chars[0]["wins"]);
-                        player.losses = std::stoi(chars[0]["losses"]);
-                        player.driverId = 1;
-                        
-                        // Send 0xA7 IMMEDIATELY - sets client's byte_8CCDC0 flag
-                        session->send(PacketBuilder::sessionConfirm(session->accountId, player));
-                        LOG_INFO("GAME", "Sent 0xA7 SESSION_CONFIRM");
-                        
-                        // Also send 0x12 (SHOW_LOBBY) immediately
-                        Packet showLobby(CMD::S_SHOW_LOBBY);
-                        session->send(showLobby);
-                        LOG_INFO("GAME", "Sent 0x12 SHOW_LOBBY");
-                        
-                        // And room list (0x3F)
-                        Packet roomList(CMD::S_ROOM_INFO);
-                        roomList.writeInt32(0);
-                        session->send(roomList);
-                        LOG_INFO("GAME", "Sent 0x3F ROOM_LIST count=0");
-                    }
-                    
-                    // Delete the pending session from DB (one-time use)
-                    db.execute("DELETE FROM active_sessions WHERE client_ip = '" + 
-                               db.escapeString(ip) + "'");
-                } else {
-                    LOG_WARN("GAME", "No pending session found for IP " + ip + " - sending basic init");
-                    // Send basic init packets - client might be connecting directly
-                    session->send(PacketBuilder::connectionOk());
-                    session->send(PacketBuilder::displayMessage(u"", 1));
-                }
-                
-                LOG_INFO("GAME", "Client initialized: " + session->remoteAddress());
+            session->setPacketHandler([this](const Session::Ptr& s, PacketView& pkt) {
+                handlePacket(s, pkt);
+            });
+            
+            session->setDisconnectHandler([this](Session::Ptr s) {
+                onDisconnect(s);
+            });
+            
+            addSession(session);
+            {
+                // Holds its pending handshake slot until endHandshake
+                std::lock_guard<std::mutex> lock(m_handshakesMutex);
+                m_handshakes.emplace(session->id(), nullptr);
             }
+            
+            // The pending login is loaded on a DB worker; the session starts
+            // reading once it is back on its strand with the data
+            initSession(session, address.to_string());
         }
         
         startAccept();
     });
 }
 
-static std::string toHex(uint8_t v) {
-    const char* hex = "0123456789ABCDEF";
-    return std::string(1, hex[v >> 4]) + hex[v & 0xF];
+void GameServer::startHandshakeDeadline(const Session::Ptr& session) {
+    auto deadline = std::make_shared<asio::steady_timer>(session->executor(), m_admission.config().handshakeTimeout);
+    {
+        std::lock_guard<std::mutex> lock(m_handshakesMutex);
+        auto it = m_handshakes.find(session->id());
+        if (it == m_handshakes.end()) return;
+        it->second = deadline;
+    }
+    
+    std::weak_ptr<Session> weak = session;
+    deadline->async_wait([this, weak](std::error_code ec) {
+        auto session = weak.lock();
+        if (ec || !session) return;
+        if (endHandshake(session->id())) {
+            // Half-open or silent: never sent what the handshake needs
+            LOG_INFO("GAME", "Handshake timeout: " + session->remoteAddress() + " (ID: " + std::to_string(session->id()) + ")");
+            session->stop();
+        }
+    });
 }
 
-void GameServer::handlePacket(Session::Ptr session, Packet& packet) {
-    uint8_t cmd = packet.cmd();
-    
-    // log received packet
-    std::string hexDump;
-    const auto& payload = packet.payload();
-    for (size_t i = 0; i < std::min<size_t>(32, payload.size()); ++i) {
-        if (i > 0) hexDump += " ";
-        hexDump += toHex(payload[i]);
+bool GameServer::endHandshake(uint32_t sessionId) {
+    std::shared_ptr<asio::steady_timer> deadline;
+    {
+        std::lock_guard<std::mutex> lock(m_handshakesMutex);
+        auto it = m_handshakes.find(sessionId);
+        if (it == m_handshakes.end()) return false;
+        deadline = std::move(it->second);
+        m_handshakes.erase(it);
+    }
+    // The timer belongs to the session strand
+    if (deadline) {
+        asio::post(deadline->get_executor(), [deadline]() { deadline->cancel(); });
+    }
+    m_admission.handshakeDone();
+    return true;
+}
+
+void GameServer::initSession(const Session::Ptr& session, const std::string& ip) {
+    // Normal path: the LoginServer already pushed this client's session over the
+    // LoginLink - no DB round-trip before the client's 0xA7 timeout
+    if (auto handoff = m_handoffs.take(ip)) {
+        asio::post(session->executor(), [this, session, ip, handoff = std::move(*handoff)]() mutable {
+            // The active_sessions row is only there for recovery now, drop it off the hot path
+            Database::instance().executeAsync(session->executor(),
+                "DELETE FROM active_sessions WHERE token = ?", {handoff.token});
+            completeHandoff(session, ip, std::move(handoff));
+        });
+        return;
     }
-    if (payload.size() > 32) hexDump += "...";
-    
-    LOG_DEBUG("GAME", "RECV from " + session->remoteAddress() + ": CMD=0x" + toHex(cmd) + 
-             " Flag=0x" + toHex(packet.flag()) + " Size=" + std::to_string(packet.payloadSize()) +
-             " Data=[" + hexDump + "]");
     
-    switch (cmd) {
-        // ===== AUTH =====
-        case CMD::C_HEARTBEAT:      handleHeartbeat(session, packet); break;
-        case CMD::C_CLIENT_AUTH:    handleClientAuth(session, packet); break;
-        case CMD::C_FULL_STATE:     handleFullState(session, packet); break;
-        case CMD::C_CLIENT_INFO:    handleClientInfo(session, packet); break;
-        case CMD::S_SESSION_CONFIRM: handleSessionConfirm(session, packet); break;
-        
-        // ===== LOBBY =====
-        case CMD::C_SERVER_QUERY:   handleServerQuery(session, packet); break;
-        
-        // ===== ROOM =====
-        case CMD::C_CREATE_ROOM:    handleCreateRoom(session, packet); break;  // 0x63
-        case CMD::C_JOIN_ROOM:      handleJoinRoom(session, packet); break;    // 0x3F
-        case CMD::C_LEAVE_ROOM:     handleLeaveRoom(session, packet); break;   // 0x22
-        case CMD::C_ROOM_STATE_REQ: handleRoomState(session, packet); break;   // 0x30
-        case CMD::C_PLAYER_READY:   handlePlayerReady(session, packet); break; // 0x23
-        case CMD::C_GAME_START:     handleGameStart(session, packet); break;   // 0x40
-        
-        // ===== CHAT =====
-        case CMD::C_CHAT_MESSAGE:   handleChatMessage(session, packet); break;
-        case CMD::C_WHISPER:        handleWhisper(session, packet); break;
-        case CMD::C_LOBBY_CHAT:     handleLobbyChat(session, packet); break;     // 0xB4
-        
-        // ===== GAME/RACE =====
-        case CMD::C_STATE_CHANGE:   handleStateChange(session, packet); break;
-        case CMD::C_POSITION:       handlePosition(session, packet); break;
-        case CMD::C_LAP_COMPLETE:   handleLapComplete(session, packet); break;
-        case CMD::C_ITEM_PICKUP:    handleItemPickup(session, packet); break;
-        case CMD::C_ITEM_HIT:       handleItemHit(session, packet); break;
-        case CMD::C_RACE_FINISH:    handleRaceFinish(session, packet); break;
-        case CMD::C_ITEM_USE:       handleItemUse(session, packet); break;
-        
-        // ===== SHOP =====
-        case CMD::C_SHOP_ENTER:     m_shopHandler.handleEnterShop(session, this); break;
-        case CMD::C_SHOP_EXIT:      m_shopHandler.handleExitShop(session, this); break;
-        case CMD::C_PURCHASE:       m_shopHandler.handlePurchase(session, packet, this); break;
-        case CMD::C_SHOP_BROWSE:    handleShopBrowse(session, packet); break;
-        case CMD::C_SELL_ITEM:      handleSellItem(session, packet); break;
-        
-        // ===== INVENTORY =====
-        case CMD::C_EQUIP_VEHICLE:    handleEquipVehicle(session, packet); break;
-        case CMD::C_EQUIP_ACCESSORY:  handleEquipAccessory(session, packet); break;
-        case CMD::C_USE_ITEM:         handleUseItem(session, packet); break;
-        
-        // ===== TUTORIAL/LICENSE =====
-        case CMD::C_START_TUTORIAL:   LicenseHandler::handleStartTutorial(session, packet, this); break;
-        case CMD::C_TUTORIAL_COMPLETE: LicenseHandler::handleTutorialComplete(session, packet, this); break;
-        case CMD::C_LICENSE_TEST:     LicenseHandler::handleLicenseTest(session, packet, this); break;
-        case CMD::C_LICENSE_RESULT:   LicenseHandler::handleLicenseResult(session, packet, this); break;
-        
-        // ===== MISSION/QUEST =====
-        case CMD::C_MISSION_LIST:     MissionHandler::handleGetMissionList(session, packet, this); break;
-        case CMD::C_MISSION_DETAILS:  MissionHandler::handleGetMissionDetails(session, packet, this); break;
-        case CMD::C_CLAIM_REWARD:     MissionHandler::handleClaimReward(session, packet, this); break;
-        
-        // ===== GARAGE =====
-        case CMD::C_OPEN_GARAGE:      GarageHandler::handleOpenGarage(session, packet, this); break;
-        case CMD::C_GARAGE_VEHICLES:  GarageHandler::handleGetVehicleList(session, this); break;
-        case CMD::C_GARAGE_ITEMS:     GarageHandler::handleGetItemList(session, this); break;
-        case CMD::C_GARAGE_ACCESSORIES: GarageHandler::handleGetAccessoryList(session, this); break;
-        case CMD::C_UPGRADE_VEHICLE:  GarageHandler::handleUpgradeVehicle(session, packet, this); break;
-        case CMD::C_REPAIR_VEHICLE:   GarageHandler::handleRepairVehicle(session, packet, this); break;
-        case CMD::C_DELETE_ITEM:      GarageHandler::handleDeleteItem(session, packet, this); break;
-        
-        // ===== QUICK MATCH =====
-        case CMD::C_QUICK_MATCH:      LobbyHandler::handleQuickMatch(session, packet, this); break;
+    // Recovery: LoginLink down or GameServer restarted since the redirect, so
+    // look up what the login server stored in the DB (on a DB worker)
+    Database::instance().runAsync(session->executor(),
+        [ip](Database& db) {
+            std::optional<Handoff> login;
+            auto sessions = db.queryStmt(
+                "SELECT account_id, character_id, token FROM active_sessions WHERE client_ip = ? ORDER BY created_at DESC LIMIT 1",
+                {ip}
+            );
+            if (sessions.empty()) return login;
+            
+            Handoff& handoff = login.emplace();
+            handoff.clientIp = ip;
+            handoff.accountId = sessions[0].getInt32("account_id");
+            handoff.characterId = sessions[0].getInt32("character_id");
+            handoff.token = sessions[0].getString("token");
+            
+            // Load character data
+            auto chars = db.queryStmt(
+                "SELECT name, level, experience, gold, cash, wins, losses FROM characters WHERE account_id = ? LIMIT 1",
+                {handoff.accountId}
+            );
+            if (!chars.empty()) {
+                handoff.hasCharacter = true;
+                handoff.player.name = chars[0].getString("name");
+                handoff.player.level = chars[0].getInt32("level");
+                handoff.player.xp = chars[0].getInt32("experience");
+                handoff.player.gold = chars[0].getInt32("gold");
+                handoff.player.cash = chars[0].getInt32("cash");
+                handoff.player.wins = chars[0].getInt32("wins");
+                handoff.player.losses = chars[0].getInt32("losses");
+                handoff.player.driverId = 1;
+            }
+            
+            // Delete the pending session from DB (one-time use). By token: other
+            // clients behind the same NAT keep theirs
+            db.executeStmt("DELETE FROM active_sessions WHERE token = ?", {handoff.token});
+            return login;
+        },
+        [this, session, ip](std::optional<Handoff> login) {
+            completeHandoff(session, ip, std::move(login));
+        });
+}
+
+void GameServer::completeHandoff(const Session::Ptr& session, const std::string& ip, std::optional<Handoff> login) {
+    // On the session strand. Reading only starts now, so the first packet
+    // handler sees accountId/characterId filled in
+    session->start();
+    
+    if (login) {
+        session->accountId = login->accountId;
+        session->characterId = login->characterId;
+        session->sessionToken = std::move(login->token);
+        session->handshakeState = Session::HandshakeState::Redirected;
+        endHandshake(session->id());
         
-        // ===== FRIENDS =====
-        case CMD::C_ADD_FRIEND:       LobbyHandler::handleAddFriend(session, packet, this); break;
-        case CMD::C_REMOVE_FRIEND:    LobbyHandler::handleRemoveFriend(session, packet, this); break;
-        case CMD::C_BLOCK_PLAYER:     LobbyHandler::handleBlockPlayer(session, packet, this); break;
-        case CMD::C_PLAYER_PROFILE:   LobbyHandler::handlePlayerProfile(session, packet, this); break;
+        LOG_INFO("GAME", "Found pending session for IP " + ip + 
+                 ": account=" + std::to_string(session->accountId) +
+                 " char=" + std::to_string(session->characterId));
         
-        // ===== DRIFT / MINI TURBO =====
-        case CMD::C_DRIFT_START: {
-            auto room = getRoom(session->roomId);
-            if (room) m_raceHandler.handleDriftStart(session, packet, room.get());
-            break;
+        // Reconnect inside the grace window: re-attach to the parked state
+        if (auto parked = unpark(session->accountId)) {
+            if (parked->characterId == session->characterId) {
+                resumeSession(session, parked);
+                return;
+            }
+            finishDisconnect(parked);
         }
-        case CMD::C_DRIFT_END: {
-            auto room = getRoom(session->roomId);
-            if (room) m_raceHandler.handleDriftEnd(session, packet, room.get());
-            break;
+        
+        // Client after redirect checks byte_8CCDC0 flag set by receiving 0xA7
+        // We MUST send 0xA7 IMMEDIATELY before client's 1000ms timeout
+        if (login->hasCharacter) {
+            // Send 0xA7 IMMEDIATELY - sets client's byte_8CCDC0 flag
+            session->send(PacketBuilder::sessionConfirm(session->accountId, login->player));
+            LOG_INFO("GAME", "Sent 0xA7 SESSION_CONFIRM");
+            
+            // Also send 0x12 (SHOW_LOBBY) immediately
+            Packet showLobby(CMD::S_SHOW_LOBBY);
+            session->send(showLobby);
+            LOG_INFO("GAME", "Sent 0x12 SHOW_LOBBY");
+            
+            // And room list (0x3F)
+            Packet roomList(CMD::S_ROOM_INFO);
+            roomList.writeInt32(0);
+            session->send(roomList);
+            LOG_INFO("GAME", "Sent 0x3F ROOM_LIST count=0");
         }
-        case CMD::C_BOOST_ACTIVATE: {
-            auto room = getRoom(session->roomId);
-            if (room) m_raceHandler.handleBoostActivate(session, packet, room.get());
-            break;
+    } else {
+        LOG_WARN("GAME", "No pending session found for IP " + ip + " - sending basic init");
+        // Has to log in over this connection now, within the handshake deadline
+        startHandshakeDeadline(session);
+        // Send basic init packets - client might be connecting directly
+        session->send(PacketBuilder::connectionOk());
+        session->send(PacketBuilder::displayMessage(u"", 1));
+    }
+    
+    LOG_INFO("GAME", "Client initialized: " + session->remoteAddress());
+}
+
+static std::string toHex(uint8_t v) {
+    const char* hex = "0123456789ABCDEF";
+    return std::string(1, hex[v >> 4]) + hex[v & 0xF];
+}
+
+// =============================================================================
+// DISPATCH TABLES
+// =============================================================================
+
+namespace {
+    constexpr uint32_t stateBit(Session::HandshakeState state) {
+        return 1u << static_cast<int>(state);
+    }
+    
+    // Everything past the handshake needs a session the login server handed over
+    constexpr uint32_t IN_GAME = stateBit(Session::HandshakeState::Redirected);
+    
+    const char* verdictName(GameServer::PacketTable::Verdict verdict) {
+        switch (verdict) {
+            case GameServer::PacketTable::Verdict::BadSize:  return "bad size";
+            case GameServer::PacketTable::Verdict::BadState: return "not allowed in this state";
+            default:                                         return "unknown";
         }
-        case CMD::C_BOOST_END: {
-            auto room = getRoom(session->roomId);
-            if (room) m_raceHandler.handleBoostEnd(session, room.get());
-            break;
+    }
+}
+
+void GameServer::registerHandlers() {
+    using Rule = PacketTable::Rule;
+    const Rule inGame{0, 0xFFFF, IN_GAME};
+    auto& t = m_packetTable;
+    
+    // ===== AUTH =====
+    t.on(CMD::C_HEARTBEAT,       "HEARTBEAT",       &member<&GameServer::handleHeartbeat>);
+    t.on(CMD::C_CLIENT_AUTH,     "CLIENT_AUTH",     &member<&GameServer::handleClientAuth>);
+    t.on(CMD::C_FULL_STATE,      "FULL_STATE",      &member<&GameServer::handleFullState>);
+    t.on(CMD::C_CLIENT_INFO,     "CLIENT_INFO",     &member<&GameServer::handleClientInfo>);
+    t.on(CMD::S_SESSION_CONFIRM, "SESSION_CONFIRM", &member<&GameServer::handleSessionConfirm>, {10});
+    
+    // ===== LOBBY =====
+    t.on(CMD::C_SERVER_QUERY,    "SERVER_QUERY",    &member<&GameServer::handleServerQuery>);
+    
+    // ===== ROOM =====
+    t.on(CMD::C_CREATE_ROOM,     "CREATE_ROOM",     &member<&GameServer::handleCreateRoom>, inGame);   // 0x63
+    t.on(CMD::C_JOIN_ROOM,       "JOIN_ROOM",       &member<&GameServer::handleJoinRoom>, inGame);     // 0x3F
+    t.on(CMD::C_LEAVE_ROOM,      "LEAVE_ROOM",      &member<&GameServer::handleLeaveRoom>, inGame);    // 0x22
+    t.on(CMD::C_ROOM_STATE_REQ,  "ROOM_STATE_REQ",  &member<&GameServer::handleRoomState>, inGame);    // 0x30
+    t.on(CMD::C_PLAYER_READY,    "PLAYER_READY",    &member<&GameServer::routeToRoom>, inGame);        // 0x23
+    t.on(CMD::C_GAME_START,      "GAME_START",      &member<&GameServer::routeToRoom>, inGame);        // 0x40
+    
+    // ===== CHAT =====
+    t.on(CMD::C_CHAT_MESSAGE,    "CHAT_MESSAGE",    &member<&GameServer::handleChatMessage>, inGame);
+    t.on(CMD::C_WHISPER,         "WHISPER",         &member<&GameServer::handleWhisper>, inGame);
+    t.on(CMD::C_LOBBY_CHAT,      "LOBBY_CHAT",      &member<&GameServer::handleLobbyChat>, inGame);    // 0xB4
+    
+    // ===== GAME/RACE (room worker, see m_roomTable) =====
+    t.on(CMD::C_STATE_CHANGE,    "STATE_CHANGE",    &member<&GameServer::handleStateChange>);
+    t.on(CMD::C_POSITION,        "POSITION",        &member<&GameServer::routeToRoom>, {16, 0xFFFF, IN_GAME});
+    t.on(CMD::C_LAP_COMPLETE,    "LAP_COMPLETE",    &member<&GameServer::routeToRoom>, inGame);
+    t.on(CMD::C_ITEM_PICKUP,     "ITEM_PICKUP",     &member<&GameServer::routeToRoom>, inGame);
+    t.on(CMD::C_ITEM_HIT,        "ITEM_HIT",        &member<&GameServer::routeToRoom>, inGame);
+    t.on(CMD::C_RACE_FINISH,     "RACE_FINISH",     &member<&GameServer::routeToRoom>, inGame);
+    t.on(CMD::C_ITEM_USE,        "ITEM_USE",        &member<&GameServer::routeToRoom>, inGame);
+    
+    // ===== SHOP =====
+    t.on(CMD::C_SHOP_ENTER, "SHOP_ENTER", [](GameServer& s, const Session::Ptr& session, PacketView&) {
+        s.m_shopHandler.handleEnterShop(session, &s);
+    }, inGame);
+    t.on(CMD::C_SHOP_EXIT, "SHOP_EXIT", [](GameServer& s, const Session::Ptr& session, PacketView&) {
+        s.m_shopHandler.handleExitShop(session, &s);
+    }, inGame);
+    t.on(CMD::C_PURCHASE, "PURCHASE", [](GameServer& s, const Session::Ptr& session, PacketView& packet) {
+        s.m_shopHandler.handlePurchase(session, packet, &s);
+        s.refreshInventory(session, Inventory::ALL_LISTS);
+    }, inGame);
+    t.on(CMD::C_SHOP_BROWSE,     "SHOP_BROWSE",     &member<&GameServer::handleShopBrowse>, inGame);
+    t.on(CMD::C_SELL_ITEM,       "SELL_ITEM",       &member<&GameServer::handleSellItem>, inGame);
+    
+    // ===== INVENTORY =====
+    t.on(CMD::C_EQUIP_VEHICLE,   "EQUIP_VEHICLE",   &member<&GameServer::handleEquipVehicle>, inGame);
+    t.on(CMD::C_EQUIP_ACCESSORY, "EQUIP_ACCESSORY", &member<&GameServer::handleEquipAccessory>, inGame);
+    t.on(CMD::C_USE_ITEM,        "USE_ITEM",        &member<&GameServer::handleUseItem>, inGame);
+    
+    // ===== TUTORIAL/LICENSE =====
+    t.on(CMD::C_START_TUTORIAL,    "START_TUTORIAL",    &external<&LicenseHandler::handleStartTutorial>, inGame);
+    t.on(CMD::C_TUTORIAL_COMPLETE, "TUTORIAL_COMPLETE", &external<&LicenseHandler::handleTutorialComplete>, inGame);
+    t.on(CMD::C_LICENSE_TEST,      "LICENSE_TEST",      &external<&LicenseHandler::handleLicenseTest>, inGame);
+    t.on(CMD::C_LICENSE_RESULT,    "LICENSE_RESULT",    &external<&LicenseHandler::handleLicenseResult>, inGame);
+    
+    // ===== MISSION/QUEST =====
+    t.on(CMD::C_MISSION_LIST,    "MISSION_LIST",    &external<&MissionHandler::handleGetMissionList>, inGame);
+    t.on(CMD::C_MISSION_DETAILS, "MISSION_DETAILS", &external<&MissionHandler::handleGetMissionDetails>, inGame);
+    t.on(CMD::C_CLAIM_REWARD,    "CLAIM_REWARD",
+         &externalInventory<&MissionHandler::handleClaimReward, Inventory::ALL_LISTS>, inGame);
+    
+    // ===== GARAGE =====
+    t.on(CMD::C_OPEN_GARAGE,        "OPEN_GARAGE",        &external<&GarageHandler::handleOpenGarage>, inGame);
+    t.on(CMD::C_GARAGE_VEHICLES,    "GARAGE_VEHICLES",    &member<&GameServer::handleGarageVehicles>, inGame);
+    t.on(CMD::C_GARAGE_ITEMS,       "GARAGE_ITEMS",       &member<&GameServer::handleGarageItems>, inGame);
+    t.on(CMD::C_GARAGE_ACCESSORIES, "GARAGE_ACCESSORIES", &member<&GameServer::handleGarageAccessories>, inGame);
+    t.on(CMD::C_UPGRADE_VEHICLE,    "UPGRADE_VEHICLE",
+         &externalInventory<&GarageHandler::handleUpgradeVehicle, Inventory::VEHICLES>, inGame);
+    t.on(CMD::C_REPAIR_VEHICLE,     "REPAIR_VEHICLE",
+         &externalInventory<&GarageHandler::handleRepairVehicle, Inventory::VEHICLES>, inGame);
+    t.on(CMD::C_DELETE_ITEM,        "DELETE_ITEM",
+         &externalInventory<&GarageHandler::handleDeleteItem, Inventory::ALL_LISTS>, inGame);
+    
+    // ===== QUICK MATCH =====
+    t.on(CMD::C_QUICK_MATCH,     "QUICK_MATCH",     &external<&LobbyHandler::handleQuickMatch>, inGame);
+    
+    // ===== FRIENDS =====
+    t.on(CMD::C_ADD_FRIEND,      "ADD_FRIEND",      &external<&LobbyHandler::handleAddFriend>, inGame);
+    t.on(CMD::C_REMOVE_FRIEND,   "REMOVE_FRIEND",   &external<&LobbyHandler::handleRemoveFriend>, inGame);
+    t.on(CMD::C_BLOCK_PLAYER,    "BLOCK_PLAYER",    &external<&LobbyHandler::handleBlockPlayer>, inGame);
+    t.on(CMD::C_PLAYER_PROFILE,  "PLAYER_PROFILE",  &external<&LobbyHandler::handlePlayerProfile>, inGame);
+    
+    // ===== DRIFT / MINI TURBO =====
+    t.on(CMD::C_DRIFT_START,     "DRIFT_START",     &member<&GameServer::routeToRoom>, inGame);
+    t.on(CMD::C_DRIFT_END,       "DRIFT_END",       &member<&GameServer::routeToRoom>, inGame);
+    t.on(CMD::C_BOOST_ACTIVATE,  "BOOST_ACTIVATE",  &member<&GameServer::routeToRoom>, inGame);
+    t.on(CMD::C_BOOST_END,       "BOOST_END",       &member<&GameServer::routeToRoom>, inGame);
+    
+    // ===== GHOST MODE =====
+    t.on(CMD::C_GHOST_MENU,       "GHOST_MENU",       &externalNoPayload<&GhostHandler::handleOpenGhostMenu>, inGame);
+    t.on(CMD::C_GHOST_SELECT_MAP, "GHOST_SELECT_MAP", &external<&GhostHandler::handleSelectMap>, inGame);
+    t.on(CMD::C_GHOST_START,      "GHOST_START",      &external<&GhostHandler::handleStartGhostRace>, inGame);
+    t.on(CMD::C_GHOST_COMPLETE,   "GHOST_COMPLETE",   &external<&GhostHandler::handleGhostRaceComplete>, inGame);
+    t.on(CMD::C_GHOST_SAVE,       "GHOST_SAVE",       &external<&GhostHandler::handleSaveGhost>, inGame);
+    t.on(CMD::C_GHOST_LIST,       "GHOST_LIST",       &external<&GhostHandler::handleGetGhostList>, inGame);
+    t.on(CMD::C_GHOST_DOWNLOAD,   "GHOST_DOWNLOAD",   &external<&GhostHandler::handleDownloadGhost>, inGame);
+    
+    // ===== SCENARIO MODE =====
+    t.on(CMD::C_SCENARIO_MENU,     "SCENARIO_MENU",     &externalNoPayload<&ScenarioHandler::handleOpenScenarioMenu>, inGame);
+    t.on(CMD::C_SCENARIO_CHAPTER,  "SCENARIO_CHAPTER",  &external<&ScenarioHandler::handleSelectChapter>, inGame);
+    t.on(CMD::C_SCENARIO_STAGE,    "SCENARIO_STAGE",    &external<&ScenarioHandler::handleSelectStage>, inGame);
+    t.on(CMD::C_SCENARIO_START,    "SCENARIO_START",    &external<&ScenarioHandler::handleStartScenario>, inGame);
+    t.on(CMD::C_SCENARIO_COMPLETE, "SCENARIO_COMPLETE", &external<&ScenarioHandler::handleScenarioComplete>, inGame);
+    t.on(CMD::C_SCENARIO_PROGRESS, "SCENARIO_PROGRESS", &externalNoPayload<&ScenarioHandler::handleGetProgress>, inGame);
+    t.on(CMD::C_SCENARIO_CHAPTERS, "SCENARIO_CHAPTERS", &externalNoPayload<&ScenarioHandler::handleGetChapterList>, inGame);
+    
+    // ===== DATA REQUESTS =====
+    t.on(CMD::C_REQUEST_DATA,    "REQUEST_DATA",    &member<&GameServer::handleRequestData>);  // 0x4D - 276 byte data request
+    t.on(CMD::C_UNKNOWN_32,      "UNKNOWN_32",      &member<&GameServer::handleUnknown32>);    // 0x32 - Unknown data (8 bytes)
+    
+    // ===== CHANNEL SELECT (from redirect) =====
+    t.on(CMD::C_CHANNEL_SELECT,  "CHANNEL_SELECT",  &member<&GameServer::handleChannelSelect>);  // 0x18 - client sends after redirect
+    
+    // ===== CUSTOM CLIENT EXTENSIONS =====
+    t.on(CMD::X_COMPACT_MOVE, "COMPACT_MOVE", &member<&GameServer::routeToRoom>, {1, 0xFFFF, IN_GAME});
+    t.onFull(CMD::X_COMPACT_MOVE | (CMD::CompactMove::CAPS << 8), "COMPACT_MOVE_CAPS",
+             &member<&GameServer::handleCompactCaps>, {1, 0xFFFF, IN_GAME});
+    
+    // ===== ACK/MISC =====
+    auto ignore = [](GameServer&, const Session::Ptr&, PacketView&) {};
+    t.on(CMD::C_ACK, "ACK", ignore);        // 0x8E - just acknowledge
+    t.on(0x0B,       "ACK_REPLY", ignore);  // ACK reply - ignore
+    
+    // ===== DISCONNECT =====
+    t.on(CMD::C_DISCONNECT, "DISCONNECT", [](GameServer&, const Session::Ptr& session, PacketView&) {
+        LOG_INFO("GAME", "Client requested disconnect: " + session->remoteAddress());
+        session->kick();
+    });
+    
+    // ===== ROOM WORKER =====
+    auto& r = m_roomTable;
+    r.on(CMD::C_PLAYER_READY,   "PLAYER_READY",   &roomMember<&GameServer::handlePlayerReady>);
+    r.on(CMD::C_GAME_START,     "GAME_START",     &roomMember<&GameServer::handleGameStart>);
+    r.on(CMD::C_POSITION,       "POSITION",       &timedRoomMember<&GameServer::handlePosition>);
+    r.on(CMD::C_LAP_COMPLETE, "LAP_COMPLETE", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleLapComplete(session, packet, &room);
+    });
+    r.on(CMD::C_ITEM_PICKUP, "ITEM_PICKUP", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleItemPickup(session, packet, &room);
+    });
+    r.on(CMD::C_ITEM_HIT, "ITEM_HIT", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleItemHit(session, packet, &room);
+    });
+    r.on(CMD::C_RACE_FINISH, "RACE_FINISH", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleFinish(session, packet, &room, &s);
+    });
+    r.on(CMD::C_ITEM_USE, "ITEM_USE", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleItemUse(session, packet, &room);
+    });
+    r.on(CMD::C_DRIFT_START, "DRIFT_START", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleDriftStart(session, packet, &room);
+    });
+    r.on(CMD::C_DRIFT_END, "DRIFT_END", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleDriftEnd(session, packet, &room);
+    });
+    r.on(CMD::C_BOOST_ACTIVATE, "BOOST_ACTIVATE", [](GameServer& s, const Session::Ptr& session, PacketView& packet, Room& room, RecvTime) {
+        s.raceHandler(room).handleBoostActivate(session, packet, &room);
+    });
+    r.on(CMD::C_BOOST_END, "BOOST_END", [](GameServer& s, const Session::Ptr& session, PacketView&, Room& room, RecvTime) {
+        s.raceHandler(room).handleBoostEnd(session, &room);
+    });
+    r.on(CMD::X_COMPACT_MOVE,   "COMPACT_MOVE",   &timedRoomMember<&GameServer::handleCompactMove>);
+}
+
+void GameServer::handlePacket(const Session::Ptr& session, PacketView& packet) {
+    // log received packet (the hex dump is only built when debug logging is on)
+    if (Logger::instance().enabled(LogLevel::LVL_DEBUG)) {
+        std::string hexDump;
+        const uint8_t* payload = packet.data();
+        for (size_t i = 0; i < std::min<size_t>(32, packet.size()); ++i) {
+            if (i > 0) hexDump += " ";
+            hexDump += toHex(payload[i]);
         }
+        if (packet.size() > 32) hexDump += "...";
         
-        // ===== GHOST MODE =====
-        case CMD::C_GHOST_MENU:       GhostHandler::handleOpenGhostMenu(session, this); break;
-        case CMD::C_GHOST_SELECT_MAP: GhostHandler::handleSelectMap(session, packet, this); break;
-        case CMD::C_GHOST_START:      GhostHandler::handleStartGhostRace(session, packet, this); break;
-        case CMD::C_GHOST_COMPLETE:   GhostHandler::handleGhostRaceComplete(session, packet, this); break;
-        case CMD::C_GHOST_SAVE:       GhostHandler::handleSaveGhost(session, packet, this); break;
-        case CMD::C_GHOST_LIST:       GhostHandler::handleGetGhostList(session, packet, this); break;
-        case CMD::C_GHOST_DOWNLOAD:   GhostHandler::handleDownloadGhost(session, packet, this); break;
-        
-        // ===== SCENARIO MODE =====
-        case CMD::C_SCENARIO_MENU:     ScenarioHandler::handleOpenScenarioMenu(session, this); break;
-        case CMD::C_SCENARIO_CHAPTER:  ScenarioHandler::handleSelectChapter(session, packet, this); break;
-        case CMD::C_SCENARIO_STAGE:    ScenarioHandler::handleSelectStage(session, packet, this); break;
-        case CMD::C_SCENARIO_START:    ScenarioHandler::handleStartScenario(session, packet, this); break;
-        case CMD::C_SCENARIO_COMPLETE: ScenarioHandler::handleScenarioComplete(session, packet, this); break;
-        case CMD::C_SCENARIO_PROGRESS: ScenarioHandler::handleGetProgress(session, this); break;
-        case CMD::C_SCENARIO_CHAPTERS: ScenarioHandler::handleGetChapterList(session, this); break;
-        
-        // ===== DATA REQUESTS =====
-        case CMD::C_REQUEST_DATA:  // 0x4D - 276 byte data request
-            handleRequestData(session, packet);
-            break;
-        case CMD::C_UNKNOWN_32:  // 0x32 - Unknown data (8 bytes)
-            handleUnknown32(session, packet);
-            break;
-        
-        // ===== CHANNEL SELECT (from redirect) =====
-        case CMD::C_CHANNEL_SELECT:  // 0x18 - client sends after redirect
-            handleChannelSelect(session, packet);
-            break;
-        
-        // ===== ACK/MISC =====
-        case CMD::C_ACK:  // 0x8E - just acknowledge
-            break;
-        case 0x0B:  // ACK reply - ignore
-            break;
-        
-        // ===== DISCONNECT =====
-        case CMD::C_DISCONNECT:
-            LOG_INFO("GAME", "Client requested disconnect: " + session->remoteAddress());
-            session->stop();
-            break;
-        
-        default:
-            LOG_DEBUG("GAME", "Unhandled CMD: 0x" + toHex(cmd));
-            break;
+        LOG_DEBUGF("GAME", "RECV from {}: CMD=0x{:02X} Flag=0x{:02X} Size={} Data=[{}]",
+                   session->remoteAddress(), packet.cmd(), packet.flag(), packet.payloadSize(), hexDump);
+    }
+    
+    const auto* entry = m_packetTable.find(packet.cmd(), packet.flag());
+    auto verdict = m_packetTable.check(entry, packet.size(), stateBit(session->handshakeState));
+    if (verdict == PacketTable::Verdict::Ok) {
+        entry->handler(*this, session, packet);
+        return;
+    }
+    
+    LOG_DEBUGF("GAME", "Dropped CMD 0x{:02X} ({}{}{}) from {}", packet.cmd(),
+               entry ? entry->name : "", entry ? ": " : "", verdictName(verdict), session->remoteAddress());
+}
+
+void GameServer::logDispatchStats() const {
+    auto dump = [](const char* table, const auto& entry) {
+        uint64_t packets = entry.stats.packets.load(std::memory_order_relaxed);
+        uint64_t rejected = entry.stats.rejected.load(std::memory_order_relaxed);
+        if (packets == 0 && rejected == 0) return;
+        LOG_INFO("STATS", std::string(table) + " 0x" + toHex(entry.cmdFull & 0xFF) +
+                 (entry.perFlag ? "/" + toHex(entry.cmdFull >> 8) : std::string()) + " " + entry.name +
+                 " packets=" + std::to_string(packets) +
+                 " bytes=" + std::to_string(entry.stats.bytes.load(std::memory_order_relaxed)) +
+                 " rejected=" + std::to_string(rejected));
+    };
+    m_packetTable.forEach([&](const auto& entry) { dump("io", entry); });
+    m_roomTable.forEach([&](const auto& entry) { dump("room", entry); });
+    LOG_INFO("STATS", "Unknown opcodes: " + std::to_string(m_packetTable.unknownCount()));
+}
+
+// =============================================================================
+// ROOM WORKER ROUTING
+// =============================================================================
+
+void GameServer::postToRoom(const std::shared_ptr<Room>& room, RoomWorkerPool::Task task) {
+    m_roomWorkers.post(room->worker(), std::move(task));
+}
+
+RaceHandler& GameServer::raceHandler(const Room& room) {
+    return *m_raceHandlers[room.worker()];
+}
+
+void GameServer::routeToRoom(const Session::Ptr& session, PacketView& packet) {
+    auto room = getRoom(session->roomId);
+    if (!room) {
+        LOG_DEBUGF("ROOM", "CMD 0x{:02X} outside of a room from {}", packet.cmd(), session->remoteAddress());
+        return;
+    }
+    
+    // The view points into the session receive ring: the worker queue copies the payload
+    m_roomWorkers.postPacket(room->worker(), session, room, packet);
+}
+
+void GameServer::handleRoomPacket(const Session::Ptr& session, PacketView& packet, Room& room,
+                                  RecvTime received) {
+    // Runs on the room worker. The player may have left while the packet was queued.
+    if (!room.getPlayer(session->id())) {
+        return;
+    }
+    
+    const auto* entry = m_roomTable.find(packet.cmd(), packet.flag());
+    if (m_roomTable.check(entry, packet.size()) == RoomPacketTable::Verdict::Ok) {
+        entry->handler(*this, session, packet, room, received);
+    } else {
+        LOG_DEBUG("ROOM", "Unrouted room CMD: 0x" + toHex(packet.cmd()));
+    }
+}
+
+void GameServer::leaveRoom(const Session::Ptr& session, uint32_t roomId) {
+    auto room = getRoom(roomId);
+    if (room) {
+        postToRoom(room, [this, session, room]() {
+            removeFromRoom(session, *room);
+        });
     }
 }
 
@@ -297,31 +582,31 @@ void GameServer::handlePacket(Session::Ptr session, Packet& packet) {
 // AUTH HANDLERS
 // =============================================================================
 
-void GameServer::handleHeartbeat(Session::Ptr session, Packet& packet) {
+void GameServer::handleHeartbeat(const Session::Ptr& session, PacketView& packet) {
     (void)packet;
     (void)session;
     // do NOT respond - 0x12 would trigger lobby transition!
     // heartbeat is just keep-alive, no response needed
 }
 
-void GameServer::handleClientAuth(Session::Ptr session, Packet& packet) {
+void GameServer::handleClientAuth(const Session::Ptr& session, PacketView& packet) {
     (void)packet;
     LOG_INFO("GAME", "Client auth from " + session->remoteAddress());
     sendPlayerData(session);
 }
 
-void GameServer::handleFullState(Session::Ptr session, Packet& packet) {
+void GameServer::handleFullState(const Session::Ptr& session, PacketView& packet) {
     (void)packet;
     session->send(PacketBuilder::initResponse());
 }
 
-void GameServer::handleClientInfo(Session::Ptr session, Packet& packet) {
+void GameServer::handleClientInfo(const Session::Ptr& session, PacketView& packet) {
     (void)packet;
     LOG_INFO("GAME", "Client info from " + session->remoteAddress());
     session->send(PacketBuilder::ack());
 }
 
-void GameServer::handleSessionConfirm(Session::Ptr session, Packet& packet) {
+void GameServer::handleSessionConfirm(const Session::Ptr& session, PacketView& packet) {
     // Client sends 0xA7 after redirect - this is the first packet from client
     // Format: [version:4][state:4][charName:wstring][driverID:4]
     
@@ -360,7 +645,7 @@ void GameServer::handleSessionConfirm(Session::Ptr session, Packet& packet) {
 // CHANNEL SELECT (after redirect from LoginServer)
 // =============================================================================
 
-void GameServer::handleChannelSelect(Session::Ptr session, Packet& packet) {
+void GameServer::handleChannelSelect(const Session::Ptr& session, PacketView& packet) {
     // Client sends 0x18 after redirect - same format as to LoginServer
     // Format: [screen:int32][channelId:int32]
     
@@ -389,7 +674,7 @@ void GameServer::handleChannelSelect(Session::Ptr session, Packet& packet) {
 // LOBBY HANDLERS
 // =============================================================================
 
-void GameServer::handleLobbyRequest(Session::Ptr session, Packet& packet) {
+void GameServer::handleLobbyRequest(const Session::Ptr& session, PacketView& packet) {
     (void)packet;
     LOG_INFO("GAME", "Lobby request from " + session->remoteAddress());
     
@@ -414,7 +699,7 @@ void GameServer::handleLobbyRequest(Session::Ptr session, Packet& packet) {
     session->send(PacketBuilder::showLobby(roomList));
 }
 
-void GameServer::handleServerQuery(Session::Ptr session, Packet& packet) {
+void GameServer::handleServerQuery(const Session::Ptr& session, PacketView& packet) {
     (void)packet;
     // respond with server info
     session->send(PacketBuilder::ack());
@@ -424,7 +709,7 @@ void GameServer::handleServerQuery(Session::Ptr session, Packet& packet) {
 // ROOM HANDLERS
 // =============================================================================
 
-void GameServer::handleCreateRoom(Session::Ptr session, Packet& packet) {
+void GameServer::handleCreateRoom(const Session::Ptr& session, PacketView& packet) {
     RoomSettings settings;
     settings.name = packet.readString(32);
     settings.password = packet.readString(16);
@@ -437,8 +722,12 @@ void GameServer::handleCreateRoom(Session::Ptr session, Packet& packet) {
     auto room = createRoom(settings);
     
     if (room) {
-        room->addPlayer(session);
         session->roomId = room->id();
+        postToRoom(room, [this, session, room]() {
+            if (room->addPlayer(session)) {
+                m_roomWorkers.addLoad(room->worker(), 1);
+            }
+        });
         
         session->send(PacketBuilder::createRoomResponse(room->id(), true));
         
@@ -457,7 +746,7 @@ void GameServer::handleCreateRoom(Session::Ptr session, Packet& packet) {
     }
 }
 
-void GameServer::handleJoinRoom(Session::Ptr session, Packet& packet) {
+void GameServer::handleJoinRoom(const Session::Ptr& session, PacketView& packet) {
     uint32_t roomId = packet.readUInt32();
     std::string password = packet.readString(16);
     
@@ -469,48 +758,69 @@ void GameServer::handleJoinRoom(Session::Ptr session, Packet& packet) {
         return;
     }
     
+    if (session->roomId == roomId) {
+        return;  // Already in this room
+    }
+    
+    // Check if already in a room
+    if (session->roomId != 0) {
+        leaveRoom(session, session->roomId.exchange(0));
+    }
+    
+    // Equipped vehicle from the session inventory; only without one (not loaded yet,
+    // or vehicles changed by a handler and not reloaded) ask a DB worker. Either way
+    // the join itself runs on the room's worker
+    auto inv = inventory(session->id());
+    if (inv && !inv->isStale(Inventory::VEHICLES)) {
+        const VehicleInfo* vehicle = inv->equippedVehicle();
+        int32_t vehicleTemplateId = vehicle ? vehicle->templateId : 1;  // 1 = default
+        postToRoom(room, [this, session, room, password, vehicleTemplateId]() {
+            joinRoom(session, *room, password, vehicleTemplateId);
+        });
+        return;
+    }
+    
+    int characterId = session->characterId;
+    Database::instance().runAsync(session->executor(),
+        [characterId](Database& db) {
+            auto vehResult = db.queryStmt(
+                "SELECT vehicle_type_id FROM vehicles WHERE character_id = ? AND equipped = 1 LIMIT 1",
+                {characterId}
+            );
+            return vehResult.empty() ? 1 : vehResult[0].getInt32("vehicle_type_id", 1);  // 1 = default
+        },
+        [this, session, room, password](int32_t vehicleTemplateId) {
+            postToRoom(room, [this, session, room, password, vehicleTemplateId]() {
+                joinRoom(session, *room, password, vehicleTemplateId);
+            });
+        });
+}
+
+void GameServer::joinRoom(const Session::Ptr& session, Room& room, const std::string& password, int32_t vehicleTemplateId) {
     // Check if game already started
-    if (room->state() != RoomState::Waiting) {
+    if (room.state() != RoomState::Waiting) {
         session->send(PacketBuilder::displayMessage(u"Game in progress", 0));
         return;
     }
     
-    if (room->isFull()) {
+    if (room.isFull()) {
         // 0x21 is NOT "room full" message! Use displayMessage instead
         session->send(PacketBuilder::displayMessage(u"Room is full", 0));
         return;
     }
     
-    if (room->settings().isPrivate && room->settings().password != password) {
+    if (room.settings().isPrivate && room.settings().password != password) {
         session->send(PacketBuilder::displayMessage(u"Wrong password", 0));
         return;
     }
     
-    // Check if already in a room
-    if (session->roomId != 0) {
-        auto oldRoom = getRoom(session->roomId);
-        if (oldRoom) {
-            oldRoom->removePlayer(session->id());
-        }
-    }
-    
-    // Get player's equipped vehicle
-    auto& db = Database::instance();
-    int32_t vehicleTemplateId = 1;  // Default
-    auto vehResult = db.query(
-        "SELECT vehicle_type_id FROM vehicles WHERE character_id = " + 
-        std::to_string(session->characterId) + " AND equipped = 1 LIMIT 1"
-    );
-    if (!vehResult.empty()) {
-        vehicleTemplateId = std::stoi(vehResult[0]["vehicle_type_id"]);
-    }
-    
     // Add player to room
-    if (room->addPlayer(session, session->characterId, session->characterName, vehicleTemplateId)) {
-        session->roomId = room->id();
+    if (room.addPlayer(session, session->characterId, session->characterName, vehicleTemplateId)) {
+        session->roomId = room.id();
+        m_roomWorkers.addLoad(room.worker(), 1);
         
         // Build PlayerData for join packet
-        auto* roomPlayer = room->getPlayer(session->id());
+        auto* roomPlayer = room.getPlayer(session->id());
         PlayerData pd;
         pd.id = session->characterId;
         for (char16_t c : session->characterName) {
@@ -521,84 +831,95 @@ void GameServer::handleJoinRoom(Session::Ptr session, Packet& packet) {
         pd.ready = false;
         
         // Notify other players in room
-        room->broadcastExcept(PacketBuilder::playerJoin(pd), session->id());
+        room.broadcastExcept(PacketBuilder::playerJoin(pd), session->id());
         
-        // Send room info to joining player
-        RoomData rd;
-        rd.id = room->id();
-        rd.name = room->name();
-        rd.mode = static_cast<uint8_t>(room->settings().mode);
-        rd.maxPlayers = room->settings().maxPlayers;
-        rd.mapId = room->settings().mapId;
-        rd.laps = room->settings().laps;
-        rd.currentPlayers = static_cast<uint8_t>(room->playerCount());
-        session->send(PacketBuilder::roomInfo(rd));
-        
-        // Send info about all existing players to the joining player
-        for (const auto& existingPlayer : room->getPlayers()) {
-            if (existingPlayer.sessionId != session->id()) {
-                PlayerData epd;
-                epd.id = existingPlayer.characterId;
-                for (char16_t c : existingPlayer.name) {
-                    if (c > 0 && c < 128) epd.name += static_cast<char>(c);
-                }
-                epd.slot = existingPlayer.slot;
-                epd.vehicleTemplateId = existingPlayer.vehicleTemplateId;
-                epd.ready = existingPlayer.ready;
-                session->send(PacketBuilder::playerJoin(epd));
-            }
-        }
+        sendRoomState(session, room);
         
         LOG_INFO("ROOM", "Player " + std::to_string(session->characterId) + 
-                 " joined room " + std::to_string(roomId) + 
-                 " (total: " + std::to_string(room->playerCount()) + ")");
+                 " joined room " + std::to_string(room.id()) + 
+                 " (total: " + std::to_string(room.playerCount()) + ")");
     }
 }
 
-void GameServer::handleLeaveRoom(Session::Ptr session, Packet& packet) {
-    (void)packet;
-    
-    auto room = getRoom(session->roomId);
-    if (room) {
-        bool wasHost = room->isHost(session->id());
-        uint32_t oldHostSession = room->hostSessionId();
-        
-        room->removePlayer(session->id());
-        
-        if (!room->isEmpty()) {
-            // Notify others that player left
-            room->broadcast(PacketBuilder::playerLeft(session->characterId));
-            
-            // If host changed, notify all players
-            if (wasHost && room->hostSessionId() != oldHostSession) {
-                auto* newHost = room->getPlayer(room->hostSessionId());
-                if (newHost) {
-                    // Send player update to indicate new host
-                    PlayerData hostData;
-                    hostData.id = newHost->characterId;
-                    for (char16_t c : newHost->name) {
-                        if (c > 0 && c < 128) hostData.name += static_cast<char>(c);
-                    }
-                    hostData.slot = newHost->slot;
-                    room->broadcast(PacketBuilder::playerUpdate(hostData));
-                    LOG_INFO("ROOM", "Host transferred to char " + std::to_string(newHost->characterId));
-                }
+void GameServer::sendRoomState(const Session::Ptr& session, Room& room) {
+    // Send room info to the player
+    RoomData rd;
+    rd.id = room.id();
+    rd.name = room.name();
+    rd.mode = static_cast<uint8_t>(room.settings().mode);
+    rd.maxPlayers = room.settings().maxPlayers;
+    rd.mapId = room.settings().mapId;
+    rd.laps = room.settings().laps;
+    rd.currentPlayers = static_cast<uint8_t>(room.playerCount());
+    session->send(PacketBuilder::roomInfo(rd));
+    
+    // Send info about all existing players to the joining player
+    for (const auto& existingPlayer : room.getPlayers()) {
+        if (existingPlayer.sessionId != session->id()) {
+            PlayerData epd;
+            epd.id = existingPlayer.characterId;
+            for (char16_t c : existingPlayer.name) {
+                if (c > 0 && c < 128) epd.name += static_cast<char>(c);
             }
-        } else {
-            // Room is empty, remove it
-            LOG_INFO("ROOM", "Room " + std::to_string(room->id()) + " is now empty, removing");
-            removeRoom(room->id());
+            epd.slot = existingPlayer.slot;
+            epd.vehicleTemplateId = existingPlayer.vehicleTemplateId;
+            epd.ready = existingPlayer.ready;
+            session->send(PacketBuilder::playerJoin(epd));
         }
     }
+}
+
+void GameServer::handleLeaveRoom(const Session::Ptr& session, PacketView& packet) {
+    (void)packet;
+    
+    leaveRoom(session, session->roomId.exchange(0));
     
-    session->roomId = 0;
     session->send(PacketBuilder::playerDisconnect(session->characterId));
     session->send(PacketBuilder::showLobby({}));
     
     LOG_INFO("ROOM", "Player " + std::to_string(session->characterId) + " left room");
 }
 
-void GameServer::handleRoomState(Session::Ptr session, Packet& packet) {
+void GameServer::removeFromRoom(const Session::Ptr& session, Room& room) {
+    if (!room.getPlayer(session->id())) {
+        return;
+    }
+    
+    bool wasHost = room.isHost(session->id());
+    uint32_t oldHostSession = room.hostSessionId();
+    
+    room.removePlayer(session->id());
+    m_roomWorkers.addLoad(room.worker(), -1);
+    // Packets of this room queued before the leave have run: the next room may take over
+    AntiCheatHandler::releaseHistory(*session, room.id());
+    
+    if (!room.isEmpty()) {
+        // Notify others that player left
+        room.broadcast(PacketBuilder::playerLeft(session->characterId));
+        
+        // If host changed, notify all players
+        if (wasHost && room.hostSessionId() != oldHostSession) {
+            auto* newHost = room.getPlayer(room.hostSessionId());
+            if (newHost) {
+                // Send player update to indicate new host
+                PlayerData hostData;
+                hostData.id = newHost->characterId;
+                for (char16_t c : newHost->name) {
+                    if (c > 0 && c < 128) hostData.name += static_cast<char>(c);
+                }
+                hostData.slot = newHost->slot;
+                room.broadcast(PacketBuilder::playerUpdate(hostData));
+                LOG_INFO("ROOM", "Host transferred to char " + std::to_string(newHost->characterId));
+            }
+        }
+    } else {
+        // Room is empty, remove it
+        LOG_INFO("ROOM", "Room " + std::to_string(room.id()) + " is now empty, removing");
+        removeRoom(room.id());
+    }
+}
+
+void GameServer::handleRoomState(const Session::Ptr& session, PacketView& packet) {
     if (packet.flag() == 0x01) {
         session->send(PacketBuilder::ack());
     }
@@ -608,7 +929,7 @@ void GameServer::handleRoomState(Session::Ptr session, Packet& packet) {
 // CHAT HANDLERS
 // =============================================================================
 
-void GameServer::handleChatMessage(Session::Ptr session, Packet& packet) {
+void GameServer::handleChatMessage(const Session::Ptr& session, PacketView& packet) {
     // 0x2D can be chat OR room creation depending on context
     // If not in a room and payload > 40 bytes, it's likely room creation
     
@@ -644,8 +965,12 @@ void GameServer::handleChatMessage(Session::Ptr session, Packet& packet) {
         
         auto room = createRoom(settings);
         if (room) {
-            room->addPlayer(session);
             session->roomId = room->id();
+            postToRoom(room, [this, session, room]() {
+                if (room->addPlayer(session)) {
+                    m_roomWorkers.addLoad(room->worker(), 1);
+                }
+            });
             
             // send room created response (0x63)
             session->send(PacketBuilder::createRoomResponse(room->id(), true));
@@ -672,22 +997,27 @@ void GameServer::handleChatMessage(Session::Ptr session, Packet& packet) {
     std::u16string msg = packet.readWString();
     auto room = getRoom(session->roomId);
     if (room) {
-        room->broadcast(PacketBuilder::chatMessage("Player", msg));
+        postToRoom(room, [room, msg]() {
+            room->broadcast(PacketBuilder::chatMessage("Player", msg));
+        });
     }
     
     LOG_DEBUG("CHAT", "Chat from " + session->remoteAddress());
 }
 
-void GameServer::handleWhisper(Session::Ptr session, Packet& packet) {
+void GameServer::handleWhisper(const Session::Ptr& session, PacketView& packet) {
     std::u16string targetName = packet.readWString();
     std::u16string msg = packet.readWString();
     
     // Find target session by character name
     Session::Ptr targetSession = nullptr;
-    for (auto& [id, sess] : m_sessions) {
-        if (sess && sess->characterName == targetName) {
-            targetSession = sess;
-            break;
+    {
+        std::lock_guard<std::mutex> lock(m_sessionsMutex);
+        for (auto& [id, sess] : m_sessions) {
+            if (sess && sess->characterName == targetName) {
+                targetSession = sess;
+                break;
+            }
         }
     }
     
@@ -708,7 +1038,7 @@ void GameServer::handleWhisper(Session::Ptr session, Packet& packet) {
     }
 }
 
-void GameServer::handleLobbyChat(Session::Ptr session, Packet& packet) {
+void GameServer::handleLobbyChat(const Session::Ptr& session, PacketView& packet) {
     // 0xB4 - Lobby chat
     // client sends: wstring message, int32 type
     std::u16string message = packet.readWString();
@@ -787,9 +1117,10 @@ void GameServer::handleLobbyChat(Session::Ptr session, Packet& packet) {
     resp.writeWString(message);          // message
     resp.writeInt32(0);                  // type 0 = chat
     
+    auto data = Session::makeShared(resp);
     std::lock_guard<std::mutex> lock(m_sessionsMutex);
     for (auto& [id, sess] : m_sessions) {
-        sess->send(resp);
+        sess->send(data);
     }
 }
 
@@ -797,88 +1128,252 @@ void GameServer::handleLobbyChat(Session::Ptr session, Packet& packet) {
 // GAME HANDLERS
 // =============================================================================
 
-void GameServer::handleStateChange(Session::Ptr session, Packet& packet) {
+void GameServer::handleStateChange(const Session::Ptr& session, PacketView& packet) {
     (void)packet;
     LOG_DEBUG("GAME", "State change from " + session->remoteAddress());
 }
 
-void GameServer::handlePosition(Session::Ptr session, Packet& packet) {
+void GameServer::handlePosition(const Session::Ptr& session, PacketView& packet, Room& room,
+                                RecvTime received) {
     float x = packet.readFloat();
     float y = packet.readFloat();
     float z = packet.readFloat();
     float rot = packet.readFloat();
     
-    // Anti-cheat validation
-    if (!AntiCheatHandler::validatePosition(session, x, y, z)) {
+    applyPosition(session, room, x, y, z, rot, received);
+}
+
+void GameServer::applyPosition(const Session::Ptr& session, Room& room, float x, float y, float z, float rot,
+                               RecvTime received) {
+    // The previous room's worker may still be using the history (room switch)
+    if (!AntiCheatHandler::acquireHistory(*session, room.id())) {
+        return;
+    }
+    
+    // Anti-cheat validation (also rejects non-finite / out-of-world coordinates)
+    const CollisionMesh* track = trackCollision(room.settings().mapId);
+    if (!AntiCheatHandler::validatePosition(session, x, y, z, received, track)) {
         LOG_WARN("GAME", "Position validation failed for " + session->remoteAddress());
         return;  // Don't broadcast invalid position
     }
     
-    auto room = getRoom(session->roomId);
-    if (room) {
-        room->broadcastExcept(PacketBuilder::position(session->characterId, x, y, z, rot), session->id());
+    if (!room.hasQuantizer()) {
+        // Anchored on server data when the track is loaded, else on this (validated) sample
+        if (track) {
+            CollisionMesh::Vec3 origin = track->boundsMin();
+            room.initQuantizer(origin.x, origin.y, origin.z);
+        } else {
+            room.initQuantizer(x, y, z);
+        }
     }
+    
+    // Only keep the latest sample, the snapshot tick sends it
+    room.updatePosition(session->id(), session->characterId, x, y, z, rot);
 }
 
 // =============================================================================
-// RACE HANDLERS
+// COMPACT MOVEMENT (custom client only, see net/MovementCodec.h)
 // =============================================================================
 
-void GameServer::handleLapComplete(Session::Ptr session, Packet& packet) {
-    auto room = getRoom(session->roomId);
-    if (room) {
-        m_raceHandler.handleLapComplete(session, packet, room.get());
+void GameServer::handleCompactCaps(const Session::Ptr& session, PacketView& packet) {
+    uint8_t version = packet.readUInt8();
+    if (version != MOVEMENT_CODEC_VERSION) {
+        LOG_INFO("GAME", "Compact movement v" + std::to_string(version) + " not supported, staying on 0x31");
+        return;
     }
+    
+    session->compactMovement = true;
+    
+    Packet accept(CMD::X_COMPACT_MOVE, CMD::CompactMove::CAPS);
+    accept.writeUInt8(MOVEMENT_CODEC_VERSION);
+    session->send(accept);
+    LOG_INFO("GAME", "Compact movement enabled for " + session->remoteAddress());
 }
 
-void GameServer::handleItemPickup(Session::Ptr session, Packet& packet) {
-    auto room = getRoom(session->roomId);
-    if (room) {
-        m_raceHandler.handleItemPickup(session, packet, room.get());
+void GameServer::handleCompactMove(const Session::Ptr& session, PacketView& packet, Room& room,
+                                   RecvTime received) {
+    if (!session->compactMovement) return;
+    
+    MovementChannel& channel = room.movementChannel(session->id());
+    
+    if (packet.flag() == CMD::CompactMove::ACK) {
+        channel.down.acknowledge(packet.readUInt8());
+        return;
+    }
+    
+    // DATA: the client's own kart, quantized with the race grid it received
+    if (packet.flag() != CMD::CompactMove::DATA || !channel.capsSent) return;
+    
+    std::vector<MoveState>& states = m_snapshotScratch[room.worker()].states;
+    if (!channel.up.decode(packet.data(), packet.size(), states)) {
+        // Lost baseline: it will fall back to a full snapshot once our acks stop matching
+        LOG_DEBUG("GAME", "Undecodable compact movement from " + session->remoteAddress());
+        return;
+    }
+    channel.ackPending = true;
+    
+    const MovementQuantizer& q = room.quantizer();
+    for (const auto& state : states) {
+        if (state.entityId != static_cast<uint32_t>(session->characterId)) continue;
+        applyPosition(session, room,
+                      q.dequantize(state.x, q.originX),
+                      q.dequantize(state.y, q.originY),
+                      q.dequantize(state.z, q.originZ),
+                      MovementQuantizer::dequantizeAngle(state.rot), received);
     }
 }
 
-void GameServer::handleItemHit(Session::Ptr session, Packet& packet) {
-    auto room = getRoom(session->roomId);
-    if (room) {
-        m_raceHandler.handleItemHit(session, packet, room.get());
+// =============================================================================
+// SNAPSHOT TICK (room worker)
+// =============================================================================
+
+void GameServer::onRoomTick(int worker) {
+    for (auto& room : m_workerRooms[worker]) {
+        if (!room->isPlaying()) {
+            if (!room->positions().empty()) {
+                room->clearPositions();  // Race over, next race starts from scratch
+            }
+            continue;
+        }
+        sendRoomSnapshot(*room);
     }
 }
 
-void GameServer::handleRaceFinish(Session::Ptr session, Packet& packet) {
-    auto room = getRoom(session->roomId);
-    if (room) {
-        m_raceHandler.handleFinish(session, packet, room.get(), this);
+void GameServer::sendRoomSnapshot(Room& room) {
+    auto& positions = room.positions();
+    if (positions.empty()) return;
+    
+    // Per-worker scratch: cleared, never shrunk, so a steady race doesn't allocate
+    SnapshotScratch& scratch = m_snapshotScratch[room.worker()];
+    
+    // Frames every member gets: POSITION_ADD for newly seen players + standings if changed
+    std::vector<uint8_t>& common = scratch.common;
+    common.clear();
+    
+    for (auto& [sid, sample] : positions) {
+        if (!sample.announced) {
+            Packet add(CMD::S_POSITION_ADD);
+            add.writeInt32(sample.characterId);
+            add.appendTo(common);
+            sample.announced = true;
+        }
+    }
+    
+    Packet standings(CMD::S_POSITION_LIST);
+    standings.reserve(4 + positions.size() * 12);
+    standings.writeInt32(static_cast<int32_t>(positions.size()));
+    RaceHandler& race = raceHandler(room);
+    for (const auto& [sid, sample] : positions) {
+        const RacePlayer* rp = race.getPlayer(room.id(), sample.characterId);
+        standings.writeInt32(sample.characterId);
+        standings.writeInt32(rp ? rp->position : 0);
+        standings.writeInt32(rp ? rp->totalTime : 0);
+    }
+    if (standings.payload() != room.lastStandings()) {
+        room.lastStandings() = standings.payload();
+        standings.appendTo(common);
+    }
+    
+    // Latest legacy 0x31 frame per player that moved since the last tick, serialized
+    // once into one flat buffer; moveSpans maps the sender to [begin, end) in it
+    std::vector<uint8_t>& moves = scratch.moves;
+    moves.clear();
+    scratch.moveSpans.clear();
+    for (auto& [sid, sample] : positions) {
+        if (!sample.dirty) continue;
+        sample.dirty = false;
+        size_t begin = moves.size();
+        PacketBuilder::position(sample.characterId, sample.x, sample.y, sample.z, sample.rot).appendTo(moves);
+        scratch.moveSpans.push_back({sid, begin, moves.size()});
+    }
+    
+    // One pooled buffer (one socket write) per recipient: common frames + everyone else's movement
+    for (auto& session : room.sessions()) {
+        auto data = BufferPool::acquireShared(common.size() + moves.size());
+        data->assign(common.begin(), common.end());
+        
+        if (session->compactMovement && room.hasQuantizer()) {
+            appendCompactMovement(*data, session, room);
+        } else {
+            for (const auto& span : scratch.moveSpans) {
+                if (span.sessionId != session->id()) {
+                    data->insert(data->end(), moves.begin() + span.begin, moves.begin() + span.end);
+                }
+            }
+        }
+        
+        if (!data->empty()) {
+            session->send(Session::SharedBuffer(std::move(data)));
+        }
     }
 }
 
-void GameServer::handleItemUse(Session::Ptr session, Packet& packet) {
-    auto room = getRoom(session->roomId);
-    if (room) {
-        m_raceHandler.handleItemUse(session, packet, room.get());
+void GameServer::appendCompactMovement(std::vector<uint8_t>& out, const Session::Ptr& session, Room& room) {
+    MovementChannel& channel = room.movementChannel(session->id());
+    const MovementQuantizer& q = room.quantizer();
+    SnapshotScratch& scratch = m_snapshotScratch[room.worker()];
+    
+    if (!channel.capsSent) {
+        // Race grid, the client quantizes its own kart with it from now on
+        Packet caps(CMD::X_COMPACT_MOVE, CMD::CompactMove::CAPS);
+        caps.writeUInt8(MOVEMENT_CODEC_VERSION);
+        caps.writeFloat(q.originX);
+        caps.writeFloat(q.originY);
+        caps.writeFloat(q.originZ);
+        caps.writeFloat(q.step);
+        caps.appendTo(out);
+        channel.capsSent = true;
+    }
+    
+    if (channel.ackPending && channel.up.lastSeq() >= 0) {
+        Packet ack(CMD::X_COMPACT_MOVE, CMD::CompactMove::ACK);
+        ack.writeUInt8(static_cast<uint8_t>(channel.up.lastSeq()));
+        ack.appendTo(out);
+        channel.ackPending = false;
+    }
+    
+    // Full state of every other kart; the encoder only emits what changed since the acked baseline
+    std::vector<MoveState>& states = scratch.states;
+    states.clear();
+    for (const auto& [sid, sample] : room.positions()) {
+        if (sid == session->id()) continue;
+        MoveState state;
+        state.entityId = static_cast<uint32_t>(sample.characterId);
+        state.x = q.quantize(sample.x, q.originX);
+        state.y = q.quantize(sample.y, q.originY);
+        state.z = q.quantize(sample.z, q.originZ);
+        state.rot = MovementQuantizer::quantizeAngle(sample.rot);
+        states.push_back(state);
+    }
+    
+    std::vector<uint8_t>& payload = scratch.payload;
+    payload.clear();
+    if (channel.down.encode(states, payload) > 0) {
+        Packet data(CMD::X_COMPACT_MOVE, CMD::CompactMove::DATA);
+        data.writeBytes(payload.data(), payload.size());
+        data.appendTo(out);
     }
 }
 
-void GameServer::handleGameStart(Session::Ptr session, Packet& packet) {
+// =============================================================================
+// RACE HANDLERS (room worker)
+// =============================================================================
+
+void GameServer::handleGameStart(const Session::Ptr& session, PacketView& packet, Room& room) {
     (void)packet;
-    auto room = getRoom(session->roomId);
-    if (!room) {
-        LOG_WARN("ROOM", "GameStart: player not in room");
-        return;
-    }
     
     // Only host can start
-    if (!room->isHost(session->id())) {
+    if (!room.isHost(session->id())) {
         session->send(PacketBuilder::displayMessage(u"Only host can start", 0));
         LOG_WARN("ROOM", "Non-host tried to start game: char " + std::to_string(session->characterId));
         return;
     }
     
     // Check if can start (minimum players, all ready)
-    if (!room->canStart()) {
-        if (room->playerCount() < 2 && room->settings().mode != GameMode::Tutorial) {
+    if (!room.canStart()) {
+        if (room.playerCount() < 2 && room.settings().mode != GameMode::Tutorial) {
             session->send(PacketBuilder::displayMessage(u"Need more players", 0));
-        } else if (!room->areAllPlayersReady()) {
+        } else if (!room.areAllPlayersReady()) {
             session->send(PacketBuilder::displayMessage(u"Players not ready", 0));
         }
         LOG_WARN("ROOM", "Cannot start game: canStart=false");
@@ -886,22 +1381,19 @@ void GameServer::handleGameStart(Session::Ptr session, Packet& packet) {
     }
     
     LOG_INFO("ROOM", "Host " + std::to_string(session->characterId) + 
-             " starting game in room " + std::to_string(room->id()));
+             " starting game in room " + std::to_string(room.id()));
     
-    m_raceHandler.handleStartRace(session, room.get(), this);
+    raceHandler(room).handleStartRace(session, &room, this);
 }
 
-void GameServer::handlePlayerReady(Session::Ptr session, Packet& packet) {
+void GameServer::handlePlayerReady(const Session::Ptr& session, PacketView& packet, Room& room) {
     bool ready = packet.readUInt8() != 0;
     
-    auto room = getRoom(session->roomId);
-    if (!room) return;
-    
     // Update ready status in room
-    room->setPlayerReady(session->id(), ready);
+    room.setPlayerReady(session->id(), ready);
     
     // Get player data for broadcast
-    auto* roomPlayer = room->getPlayer(session->id());
+    auto* roomPlayer = room.getPlayer(session->id());
     if (!roomPlayer) return;
     
     // Build PlayerData for update packet
@@ -914,17 +1406,17 @@ void GameServer::handlePlayerReady(Session::Ptr session, Packet& packet) {
     pd.ready = ready;
     
     // Broadcast ready state to all in room
-    room->broadcast(PacketBuilder::playerUpdate(pd));
+    room.broadcast(PacketBuilder::playerUpdate(pd));
     
     LOG_INFO("ROOM", "Player " + std::to_string(session->characterId) + 
              " ready=" + std::to_string(ready) + 
-             " (ready count: " + std::to_string(room->readyCount()) + "/" + 
-             std::to_string(room->playerCount()) + ")");
+             " (ready count: " + std::to_string(room.readyCount()) + "/" + 
+             std::to_string(room.playerCount()) + ")");
     
     // Notify host if all players are ready
-    if (room->areAllPlayersReady() && room->playerCount() >= 2) {
-        for (auto& sess : room->sessions()) {
-            if (room->isHost(sess->id())) {
+    if (room.areAllPlayersReady() && room.playerCount() >= 2) {
+        for (auto& sess : room.sessions()) {
+            if (room.isHost(sess->id())) {
                 sess->send(PacketBuilder::displayMessage(u"All players ready!", 1));
                 break;
             }
@@ -936,287 +1428,438 @@ void GameServer::handlePlayerReady(Session::Ptr session, Packet& packet) {
 // SHOP HANDLERS
 // =============================================================================
 
-void GameServer::handleShopBrowse(Session::Ptr session, Packet& packet) {
+void GameServer::handleShopBrowse(const Session::Ptr& session, PacketView& packet) {
     m_shopHandler.handleBrowse(session, packet, this);
 }
 
-void GameServer::handleSellItem(Session::Ptr session, Packet& packet) {
+void GameServer::handleSellItem(const Session::Ptr& session, PacketView& packet) {
     m_inventoryHandler.handleSellItem(session, packet, this);
+    refreshInventory(session, Inventory::ALL_LISTS);
+}
+
+// =============================================================================
+// GARAGE LISTS
+// =============================================================================
+
+// Garage tabs are flipped constantly: send the cached frame, no DB, no encoding.
+// GarageHandler (DB query) only covers a session whose inventory is not loaded,
+// or whose list was changed by a handler and is still being reloaded.
+
+void GameServer::handleGarageVehicles(const Session::Ptr& session, PacketView& packet) {
+    (void)packet;
+    auto inv = inventory(session->id());
+    if (inv && !inv->isStale(Inventory::VEHICLES)) {
+        session->send(inv->vehiclesPacket());
+        return;
+    }
+    GarageHandler::handleGetVehicleList(session, this);
+}
+
+void GameServer::handleGarageItems(const Session::Ptr& session, PacketView& packet) {
+    (void)packet;
+    auto inv = inventory(session->id());
+    if (inv && !inv->isStale(Inventory::ITEMS)) {
+        session->send(inv->itemsPacket());
+        return;
+    }
+    GarageHandler::handleGetItemList(session, this);
+}
+
+void GameServer::handleGarageAccessories(const Session::Ptr& session, PacketView& packet) {
+    (void)packet;
+    auto inv = inventory(session->id());
+    if (inv && !inv->isStale(Inventory::ACCESSORIES)) {
+        session->send(inv->accessoriesPacket());
+        return;
+    }
+    GarageHandler::handleGetAccessoryList(session, this);
 }
 
 // =============================================================================
 // INVENTORY HANDLERS
 // =============================================================================
 
-void GameServer::handleEquipVehicle(Session::Ptr session, Packet& packet) {
+void GameServer::handleEquipVehicle(const Session::Ptr& session, PacketView& packet) {
     m_inventoryHandler.handleEquipVehicle(session, packet, this);
+    refreshInventory(session, Inventory::VEHICLES);
 }
 
-void GameServer::handleEquipAccessory(Session::Ptr session, Packet& packet) {
+void GameServer::handleEquipAccessory(const Session::Ptr& session, PacketView& packet) {
     m_inventoryHandler.handleEquipAccessory(session, packet, this);
+    refreshInventory(session, Inventory::ACCESSORIES);
 }
 
-void GameServer::handleUseItem(Session::Ptr session, Packet& packet) {
+void GameServer::handleUseItem(const Session::Ptr& session, PacketView& packet) {
     m_inventoryHandler.handleUseItem(session, packet, this);
+    refreshInventory(session, Inventory::ITEMS);
+}
+
+void GameServer::refreshInventory(const Session::Ptr& session, uint8_t lists) {
+    auto inv = inventory(session->id());
+    if (!inv) return;
+    
+    // The handlers write with the blocking API before returning, so a load
+    // queued now sees their rows
+    const uint32_t generation = inv->markStale(lists);
+    const uint32_t sessionId = session->id();
+    Database::instance().runAsync(session->executor(),
+        [characterId = inv->characterId()](Database& db) {
+            return Inventory::load(db, characterId);
+        },
+        [this, inv, sessionId, generation](Inventory fresh) {
+            // Moved to a resumed session meanwhile: that one owns it now
+            if (inventory(sessionId) != inv) return;
+            inv->reloaded(std::move(fresh), generation);
+        });
 }
 
 // =============================================================================
 // PLAYER DATA
 // =============================================================================
 
-void GameServer::sendPlayerData(Session::Ptr session) {
+void GameServer::sendPlayerData(const Session::Ptr& session) {
     LOG_INFO("GAME", "Sending player data to " + session->remoteAddress() + 
              " (account=" + std::to_string(session->accountId) + ")");
     
-    auto& db = Database::instance();
-    
-    // =========================================================================
-    // 1. Load character data (all columns)
-    // =========================================================================
-    auto chars = db.query(
-        "SELECT id, name, level, experience, gold, cash, wins, losses, "
-        "COALESCE(total_races, 0) AS total_races, "
-        "COALESCE(playtime_minutes, 0) AS playtime_minutes, "
-        "COALESCE(license_class, 0) AS license_class, "
-        "COALESCE(rank_points, 0) AS rank_points, "
-        "COALESCE(equipped_driver_id, 1) AS equipped_driver_id, "
-        "COALESCE(tutorial_completed, 0) AS tutorial_completed, "
-        "COALESCE(is_gm, 0) AS is_gm "
-        "FROM characters WHERE account_id = " + std::to_string(session->accountId) + " LIMIT 1"
-    );
-    
-    PlayerData player;
-    player.level = 1;
-    player.gold = 1000;
+    // Everything the login sequence sends, loaded in one DB worker job
+    struct PlayerLoad {
+        bool found = false;
+        PlayerData player;
+        Inventory inventory;
+    };
+    
+    int accountId = session->accountId;
+    Database::instance().runAsync(session->executor(),
+        [accountId](Database& db) {
+            PlayerLoad load;
+            PlayerData& player = load.player;
+            player.level = 1;
+            player.gold = 1000;
+            
+            // =================================================================
+            // 1. Load character data (all columns)
+            // =================================================================
+            auto chars = db.queryStmt(
+                "SELECT id, name, level, experience, gold, cash, wins, losses, "
+                "COALESCE(total_races, 0) AS total_races, "
+                "COALESCE(playtime_minutes, 0) AS playtime_minutes, "
+                "COALESCE(license_class, 0) AS license_class, "
+                "COALESCE(rank_points, 0) AS rank_points, "
+                "COALESCE(equipped_driver_id, 1) AS equipped_driver_id, "
+                "COALESCE(tutorial_completed, 0) AS tutorial_completed, "
+                "COALESCE(is_gm, 0) AS is_gm "
+                "FROM characters WHERE account_id = ? LIMIT 1",
+                {accountId}
+            );
+            if (chars.empty()) return load;
+            load.found = true;
+            
+            // Parse character data
+            player.id = chars[0].getInt32("id");
+            player.accountId = accountId;
+            player.name = chars[0].getString("name");
+            player.level = chars[0].getInt32("level");
+            player.xp = chars[0].getInt32("experience");
+            player.gold = chars[0].getInt32("gold");
+            player.cash = chars[0].getInt32("cash");
+            player.wins = chars[0].getInt32("wins");
+            player.losses = chars[0].getInt32("losses");
+            player.totalRaces = chars[0].getInt32("total_races");
+            player.playtimeMinutes = chars[0].getInt32("playtime_minutes");
+            player.licenseClass = chars[0].getInt32("license_class");
+            player.rankPoints = chars[0].getInt32("rank_points");
+            player.driverId = chars[0].getInt32("equipped_driver_id");
+            player.tutorialCompleted = chars[0].getBool("tutorial_completed");
+            player.isGM = chars[0].getBool("is_gm");
+            
+            // =================================================================
+            // 2. Load the inventory (kept with the session from now on)
+            // =================================================================
+            load.inventory = Inventory::load(db, player.id);
+            if (const VehicleInfo* vehicle = load.inventory.equippedVehicle()) {
+                player.vehicleId = vehicle->id;
+                player.vehicleTemplateId = vehicle->templateId;
+            }
+            
+            return load;
+        },
+        [this, session](PlayerLoad load) {
+            // Back on the session strand: only packet building and sends from here
+            PlayerData& player = load.player;
+            
+            if (!load.found) {
+                LOG_WARN("GAME", "No character found for account " + std::to_string(session->accountId));
+                
+                // Try to trigger character creation screen
+                // Send 0x11 (Menu state) to initialize UI, then 0x03 (character creation)
+                Packet menuPkt(CMD::S_SHOW_MENU);  // 0x11
+                session->send(menuPkt);
+                LOG_INFO("GAME", "Sent SHOW_MENU (0x11) to " + session->remoteAddress());
+                
+                Packet createPkt(CMD::S_TRIGGER);  // 0x03
+                session->send(createPkt);
+                session->handshakeState = Session::HandshakeState::AwaitingCharacterCreation;
+                endHandshake(session->id());
+                LOG_INFO("GAME", "Sent CHARACTER_CREATION (0x03) to " + session->remoteAddress());
+                return;
+            }
+            
+            // From here the cache owns the character (and writes last_played)
+            m_characters.attach(player);
+            auto inventory = std::make_shared<Inventory>(std::move(load.inventory));
+            {
+                std::lock_guard<std::mutex> lock(m_inventoriesMutex);
+                m_inventories[session->id()] = inventory;
+            }
+            session->characterId = player.id;
+            session->handshakeState = Session::HandshakeState::Redirected;
+            endHandshake(session->id());
+            
+            LOG_INFO("GAME", "Character loaded: " + player.name + 
+                     " (ID=" + std::to_string(player.id) + 
+                     " Level=" + std::to_string(player.level) +
+                     " Gold=" + std::to_string(player.gold) +
+                     " Cash=" + std::to_string(player.cash) +
+                     " Wins=" + std::to_string(player.wins) + ")");
+            if (player.vehicleId != 0) {
+                LOG_DEBUG("GAME", "Equipped vehicle: ID=" + std::to_string(player.vehicleId) + 
+                          " Template=" + std::to_string(player.vehicleTemplateId));
+            }
+            
+            // =================================================================
+            // 1. Send connection OK (0x0A) with real player data FIRST
+            // =================================================================
+            session->send(PacketBuilder::connectionOkWithPlayer(player));
+            LOG_INFO("GAME", "SEND 0x0A CONNECTION_OK (38 bytes with player data)");
+            
+            // =================================================================
+            // 2. Send display message (0x02) to confirm connection
+            // =================================================================
+            session->send(PacketBuilder::displayMessage(u"", 1));
+            LOG_INFO("GAME", "SEND 0x02 DISPLAY_MESSAGE (code=1 OK)");
+            
+            // =================================================================
+            // 3. Send session confirm (0x07/0xA7 with PlayerInfo 1224 bytes)
+            // =================================================================
+            session->send(PacketBuilder::sessionConfirm(session->accountId, player));
+            LOG_INFO("GAME", "SEND 0xA7 SESSION_CONFIRM (PlayerInfo 1224 bytes)");
+            
+            // =================================================================
+            // 4. Send VEHICLES (0x1B), ITEMS (0x1C) and ACCESSORIES (0x1D)
+            // =================================================================
+            session->send(inventory->vehiclesPacket());
+            LOG_INFO("GAME", "SEND 0x1B INVENTORY_VEHICLES (" + std::to_string(inventory->vehicles().size()) + " vehicles)");
+            
+            session->send(inventory->itemsPacket());
+            LOG_INFO("GAME", "SEND 0x1C INVENTORY_ITEMS (" + std::to_string(inventory->items().size()) + " items)");
+            
+            session->send(inventory->accessoriesPacket());
+            LOG_INFO("GAME", "SEND 0x1D INVENTORY_ACCESSORIES (" + std::to_string(inventory->accessories().size()) + " accessories)");
+            
+            // =================================================================
+            // 5. Check tutorial completion - NEW PLAYERS GO TO TUTORIAL!
+            // =================================================================
+            if (!player.tutorialCompleted) {
+                // New player - send to TutorialMenu (state 14) instead of lobby
+                // CMD 0x16 -> sub_47E8B0 -> state 14 (TutorialMenu)
+                Packet tutorialMenu(CMD::S_UI_STATE_14);
+                // 0x16 handler reads NO data - just triggers state change
+                session->send(tutorialMenu);
+                LOG_INFO("GAME", "SEND 0x16 UI_STATE_14 (Tutorial required - tutorial_completed=0)");
+                return;
+            }
+            
+            // =================================================================
+            // 6. Send lobby UI (0x12) + room list (0x3F) - Only for players with completed tutorial
+            // =================================================================
+            Packet showLobby(CMD::S_SHOW_LOBBY);
+            session->send(showLobby);
+            LOG_INFO("GAME", "SEND 0x12 SHOW_LOBBY");
+            
+            // send room list (0x3F) - client reads only int32 count
+            Packet roomList(CMD::S_ROOM_INFO);
+            size_t roomCount;
+            {
+                std::lock_guard<std::mutex> lock(m_roomsMutex);
+                roomCount = m_rooms.size();
+            }
+            roomList.writeInt32(static_cast<int32_t>(roomCount));  // Just the count
+            session->send(roomList);
+            LOG_INFO("GAME", "SEND 0x3F ROOM_LIST (count=" + std::to_string(roomCount) + ")");
+        });
+}
+
+// =============================================================================
+// SESSION/ROOM MANAGEMENT
+// =============================================================================
+
+void GameServer::onDisconnect(const Session::Ptr& session) {
+    LOG_INFO("GAME", "Client disconnected: " + session->remoteAddress() + " (ID: " + std::to_string(session->id()) + ")");
     
-    if (chars.empty()) {
-        LOG_WARN("GAME", "No character found for account " + std::to_string(session->accountId));
-        
-        // Try to trigger character creation screen
-        // Send 0x11 (Menu state) to initialize UI, then 0x03 (character creation)
-        Packet menuPkt(CMD::S_SHOW_MENU);  // 0x11
-        session->send(menuPkt);
-        LOG_INFO("GAME", "Sent SHOW_MENU (0x11) to " + session->remoteAddress());
-        
-        Packet createPkt(CMD::S_TRIGGER);  // 0x03
-        session->send(createPkt);
-        LOG_INFO("GAME", "Sent CHARACTER_CREATION (0x03) to " + session->remoteAddress());
-        return;
-    }
+    // The socket is gone either way: free its admission slots
+    endHandshake(session->id());
+    std::error_code ec;
+    auto address = asio::ip::make_address(session->remoteAddress(), ec);
+    if (!ec) m_admission.release(address);
     
-    // Parse character data
-    player.id = std::stoi(chars[0]["id"]);
-    player.accountId = session->accountId;
-    player.name = chars[0]["name"];
-    player.level = std::stoi(chars[0]["level"]);
-    player.xp = std::stoi(chars[0]["experience"]);
-    player.gold = std::stoi(chars[0]["gold"]);
-    player.cash = std::stoi(chars[0]["cash"]);
-    player.wins = std::stoi(chars[0]["wins"]);
-    player.losses = std::stoi(chars[0]["losses"]);
-    player.totalRaces = std::stoi(chars[0]["total_races"]);
-    player.playtimeMinutes = std::stoi(chars[0]["playtime_minutes"]);
-    player.licenseClass = std::stoi(chars[0]["license_class"]);
-    player.rankPoints = std::stoi(chars[0]["rank_points"]);
-    player.driverId = std::stoi(chars[0]["equipped_driver_id"]);
-    player.tutorialCompleted = chars[0]["tutorial_completed"] == "1";
-    player.isGM = chars[0]["is_gm"] == "1";
-    
-    session->characterId = player.id;
-    
-    LOG_INFO("GAME", "Character loaded: " + player.name + 
-             " (ID=" + std::to_string(player.id) + 
-             " Level=" + std::to_string(player.level) +
-             " Gold=" + std::to_string(player.gold) +
-             " Cash=" + std::to_string(player.cash) +
-             " Wins=" + std::to_string(player.wins) + ")");
-    
-    // =========================================================================
-    // 2. Load equipped vehicle
-    // =========================================================================
-    auto equippedVeh = db.query(
-        "SELECT id, vehicle_type_id FROM vehicles "
-        "WHERE character_id = " + std::to_string(player.id) + " AND equipped = 1 LIMIT 1"
-    );
-    if (!equippedVeh.empty()) {
-        player.vehicleId = std::stoi(equippedVeh[0]["id"]);
-        player.vehicleTemplateId = std::stoi(equippedVeh[0]["vehicle_type_id"]);
-        LOG_DEBUG("GAME", "Equipped vehicle: ID=" + std::to_string(player.vehicleId) + 
-                  " Template=" + std::to_string(player.vehicleTemplateId));
-    }
-    
-    // =========================================================================
-    // 3. Send connection OK (0x0A) with real player data FIRST
-    // =========================================================================
-    session->send(PacketBuilder::connectionOkWithPlayer(player));
-    LOG_INFO("GAME", "SEND 0x0A CONNECTION_OK (38 bytes with player data)");
-    
-    // =========================================================================
-    // 4. Send display message (0x02) to confirm connection
-    // =========================================================================
-    session->send(PacketBuilder::displayMessage(u"", 1));
-    LOG_INFO("GAME", "SEND 0x02 DISPLAY_MESSAGE (code=1 OK)");
-    
-    // =========================================================================
-    // 5. Send session confirm (0x07/0xA7 with PlayerInfo 1224 bytes)
-    // =========================================================================
-    session->send(PacketBuilder::sessionConfirm(session->accountId, player));
-    LOG_INFO("GAME", "SEND 0xA7 SESSION_CONFIRM (PlayerInfo 1224 bytes)");
-    
-    // =========================================================================
-    // 4. Load and send VEHICLES inventory (0x1B)
-    // =========================================================================
-    auto vehicles = db.query(
-        "SELECT id, vehicle_type_id, durability, max_durability, "
-        "COALESCE(stat_speed, 50) AS stat_speed, "
-        "COALESCE(stat_accel, 50) AS stat_accel, "
-        "COALESCE(stat_handling, 50) AS stat_handling, "
-        "COALESCE(stat_drift, 40) AS stat_drift, "
-        "COALESCE(stat_boost, 30) AS stat_boost, "
-        "COALESCE(stat_weight, 50) AS stat_weight, "
-        "COALESCE(stat_special, 0) AS stat_special, "
-        "equipped "
-        "FROM vehicles WHERE character_id = " + std::to_string(player.id)
-    );
-    
-    std::vector<VehicleInfo> vehicleList;
-    for (const auto& v : vehicles) {
-        VehicleInfo vi;
-        vi.id = std::stoi(v.at("id"));
-        vi.templateId = std::stoi(v.at("vehicle_type_id"));
-        vi.ownerId = player.id;  // Character ID
-        vi.durability = std::stoi(v.at("durability"));
-        vi.maxDurability = std::stoi(v.at("max_durability"));
-        vi.stats[0] = std::stoi(v.at("stat_speed"));
-        vi.stats[1] = std::stoi(v.at("stat_accel"));
-        vi.stats[2] = std::stoi(v.at("stat_handling"));
-        vi.stats[3] = std::stoi(v.at("stat_drift"));
-        vi.stats[4] = std::stoi(v.at("stat_boost"));
-        vi.stats[5] = std::stoi(v.at("stat_weight"));
-        vi.stats[6] = std::stoi(v.at("stat_special"));
-        vi.equipped = v.at("equipped") == "1";
-        vehicleList.push_back(vi);
-    }
-    session->send(PacketBuilder::inventoryVehicles(vehicleList));
-    LOG_INFO("GAME", "SEND 0x1B INVENTORY_VEHICLES (" + std::to_string(vehicleList.size()) + " vehicles)");
-    
-    // =========================================================================
-    // 5. Load and send ITEMS inventory (0x1C)
-    // =========================================================================
-    auto items = db.query(
-        "SELECT id, item_type_id, quantity, slot, COALESCE(equipped, 0) AS equipped "
-        "FROM items WHERE character_id = " + std::to_string(player.id)
-    );
-    
-    std::vector<ItemInfo> itemList;
-    for (const auto& item : items) {
-        ItemInfo ii;
-        ii.id = std::stoi(item.at("id"));
-        ii.templateId = std::stoi(item.at("item_type_id"));
-        ii.ownerId = player.id;  // Character ID
-        ii.quantity = std::stoi(item.at("quantity"));
-        ii.slot = std::stoi(item.at("slot"));
-        ii.equipped = item.at("equipped") == "1";
-        itemList.push_back(ii);
-    }
-    session->send(PacketBuilder::inventoryItems(itemList));
-    LOG_INFO("GAME", "SEND 0x1C INVENTORY_ITEMS (" + std::to_string(itemList.size()) + " items)");
-    
-    // =========================================================================
-    // 6. Load and send ACCESSORIES inventory (0x1D)
-    // =========================================================================
-    auto accessories = db.query(
-        "SELECT id, accessory_type_id, slot, bonus1, bonus2, bonus3, equipped "
-        "FROM accessories WHERE character_id = " + std::to_string(player.id)
-    );
-    
-    std::vector<AccessoryInfo> accessoryList;
-    for (const auto& acc : accessories) {
-        AccessoryInfo ai;
-        ai.id = std::stoi(acc.at("id"));
-        ai.templateId = std::stoi(acc.at("accessory_type_id"));
-        ai.slot = std::stoi(acc.at("slot"));
-        ai.bonus1 = std::stoi(acc.at("bonus1"));
-        ai.bonus2 = std::stoi(acc.at("bonus2"));
-        ai.bonus3 = std::stoi(acc.at("bonus3"));
-        ai.equipped = acc.at("equipped") == "1";
-        accessoryList.push_back(ai);
-    }
-    session->send(PacketBuilder::inventoryAccessories(accessoryList));
-    LOG_INFO("GAME", "SEND 0x1D INVENTORY_ACCESSORIES (" + std::to_string(accessoryList.size()) + " accessories)");
-    
-    // =========================================================================
-    // 7. Update last_played in DB
-    // =========================================================================
-    db.execute("UPDATE characters SET last_played = NOW() WHERE id = " + std::to_string(player.id));
-    
-    // =========================================================================
-    // 8. Check tutorial completion - NEW PLAYERS GO TO TUTORIAL!
-    // =========================================================================
-    if (!player.tutorialCompleted) {
-        // New player - send to TutorialMenu (state 14) instead of lobby
-        // CMD 0x16 -> sub_47E8B0 -> state 14 (TutorialMenu)
-        Packet tutorialMenu(CMD::S_UI_STATE_14);
-        // 0x16 handler reads NO data - just triggers state change
-        session->send(tutorialMenu);
-        LOG_INFO("GAME", "SEND 0x16 UI_STATE_14 (Tutorial required - tutorial_completed=0)");
+    // A player who dropped out of the game gets a grace window to come back; a kick or quit does not
+    if (m_resumeGrace.count() > 0 && session->isResumable() && session->accountId != 0 && session->characterId != 0 &&
+        session->handshakeState == Session::HandshakeState::Redirected) {
+        parkSession(session);
         return;
     }
     
-    // =========================================================================
-    // 9. Send lobby UI (0x12) + room list (0x3F) - Only for players with completed tutorial
-    // =========================================================================
-    Packet showLobby(CMD::S_SHOW_LOBBY);
-    session->send(showLobby);
-    LOG_INFO("GAME", "SEND 0x12 SHOW_LOBBY");
+    finishDisconnect(session);
+}
+
+void GameServer::finishDisconnect(const Session::Ptr& session) {
+    // remove from room - the room worker drops the room itself once it is empty
+    leaveRoom(session, session->roomId.exchange(0));
     
-    // send room list (0x3F) - client reads only int32 count
-    Packet roomList(CMD::S_ROOM_INFO);
+    // Write the character out and drop it from the cache
+    if (session->characterId != 0) {
+        m_characters.release(static_cast<int32_t>(session->characterId));
+    }
     {
-        std::lock_guard<std::mutex> lock(m_roomsMutex);
-        roomList.writeInt32(static_cast<int32_t>(m_rooms.size()));  // Just the count
+        std::lock_guard<std::mutex> lock(m_inventoriesMutex);
+        m_inventories.erase(session->id());
     }
-    session->send(roomList);
-    LOG_INFO("GAME", "SEND 0x3F ROOM_LIST (count=" + std::to_string(m_rooms.size()) + ")");
+    
+    removeSession(session->id());
 }
 
 // =============================================================================
-// SESSION/ROOM MANAGEMENT
+// SESSION RESUMPTION
 // =============================================================================
 
-void GameServer::onDisconnect(Session::Ptr session) {
-    LOG_INFO("GAME", "Client disconnected: " + session->remoteAddress() + " (ID: " + std::to_string(session->id()) + ")");
-    
-    // remove from room
-    auto room = getRoom(session->roomId);
-    if (room) {
-        room->removePlayer(session->id());
-        if (!room->isEmpty()) {
-            room->broadcast(PacketBuilder::playerLeft(session->characterId));
+void GameServer::parkSession(const Session::Ptr& session) {
+    auto expiry = std::make_shared<asio::steady_timer>(m_ioContext, m_resumeGrace);
+    Session::Ptr replaced;
+    {
+        std::lock_guard<std::mutex> lock(m_parkedMutex);
+        ParkedSession& slot = m_parked[session->accountId];
+        if (slot.session) {
+            // Dropped again before the first drop was resumed: the older one is gone for good
+            replaced = std::move(slot.session);
+            slot.expiry->cancel();
         }
+        slot = ParkedSession{session, expiry};
     }
+    if (replaced) finishDisconnect(replaced);
     
-    // clean empty rooms
+    // Out of the lobby lists; the room keeps the slot (sends to it are dropped),
+    // the character cache and the inventory keep their state
+    removeSession(session->id());
+    
+    expiry->async_wait([this, session](std::error_code ec) {
+        if (ec) return;  // resumed (cancelled)
+        if (unpark(session->accountId, session->id())) {
+            LOG_INFO("GAME", "Resume window of account " + std::to_string(session->accountId) + " expired");
+            finishDisconnect(session);
+        }
+    });
+    
+    LOG_INFO("GAME", "Parked account " + std::to_string(session->accountId) +
+             " char=" + std::to_string(session->characterId) +
+             " room=" + std::to_string(session->roomId.load()) +
+             " for " + std::to_string(m_resumeGrace.count()) + "s");
+}
+
+Session::Ptr GameServer::unpark(uint32_t accountId, uint32_t sessionId) {
+    std::lock_guard<std::mutex> lock(m_parkedMutex);
+    auto it = m_parked.find(accountId);
+    if (it == m_parked.end()) return nullptr;
+    if (sessionId != 0 && it->second.session->id() != sessionId) return nullptr;
+    
+    Session::Ptr session = std::move(it->second.session);
+    it->second.expiry->cancel();
+    m_parked.erase(it);
+    return session;
+}
+
+void GameServer::resumeSession(const Session::Ptr& session, const Session::Ptr& parked) {
+    // On the new session's strand, identity already set from the handoff
+    session->characterName = parked->characterName;
+    session->handshakeState = Session::HandshakeState::Redirected;
+    // Reconnecting does not wipe the record of a dropped session
+    session->antiCheat.violations = parked->antiCheat.violations.load();
+    
+    std::shared_ptr<Inventory> inventory;
     {
-        std::lock_guard<std::mutex> lock(m_roomsMutex);
-        for (auto it = m_rooms.begin(); it != m_rooms.end(); ) {
-            if (it->second->isEmpty()) {
-                LOG_INFO("GAME", "Removing empty room: " + std::to_string(it->first));
-                it = m_rooms.erase(it);
-            } else {
-                ++it;
+        std::lock_guard<std::mutex> lock(m_inventoriesMutex);
+        auto it = m_inventories.find(parked->id());
+        if (it != m_inventories.end()) {
+            inventory = std::move(it->second);
+            m_inventories.erase(it);
+            m_inventories[session->id()] = inventory;
+        }
+    }
+    
+    // Compact resync: player info from the character cache and the inventory
+    // frames already encoded - no DB, nothing re-serialized
+    PlayerData player;
+    m_characters.fill(static_cast<int32_t>(session->characterId), player);
+    if (inventory && !inventory->isStale(Inventory::VEHICLES)) {
+        if (const VehicleInfo* vehicle = inventory->equippedVehicle()) {
+            player.vehicleId = vehicle->id;
+            player.vehicleTemplateId = vehicle->templateId;
+        }
+    }
+    session->send(PacketBuilder::sessionConfirm(session->accountId, player));
+    if (inventory && inventory->isStale(Inventory::ALL_LISTS)) {
+        // A reload was in flight for the old session: start one for this one
+        // and serve the lists from the DB meanwhile
+        refreshInventory(session, Inventory::ALL_LISTS);
+        GarageHandler::handleGetVehicleList(session, this);
+        GarageHandler::handleGetItemList(session, this);
+        GarageHandler::handleGetAccessoryList(session, this);
+    } else if (inventory) {
+        session->send(inventory->vehiclesPacket());
+        session->send(inventory->itemsPacket());
+        session->send(inventory->accessoriesPacket());
+    }
+    
+    uint32_t roomId = parked->roomId.exchange(0);
+    auto room = roomId != 0 ? getRoom(roomId) : nullptr;
+    if (room) {
+        // Same slot, same race entry (RaceHandler keys players by character):
+        // the other players see nothing of the reconnect
+        session->roomId = roomId;
+        postToRoom(room, [this, session, room, oldSessionId = parked->id()]() {
+            if (room->rebindSession(oldSessionId, session)) {
+                sendRoomState(session, *room);
+                return;
             }
+            session->roomId = 0;
+            session->send(PacketBuilder::showLobby({}));
+        });
+    } else {
+        Packet showLobby(CMD::S_SHOW_LOBBY);
+        session->send(showLobby);
+        Packet roomList(CMD::S_ROOM_INFO);
+        {
+            std::lock_guard<std::mutex> lock(m_roomsMutex);
+            roomList.writeInt32(static_cast<int32_t>(m_rooms.size()));
         }
+        session->send(roomList);
     }
     
-    removeSession(session->id());
+    LOG_INFO("GAME", "Resumed account " + std::to_string(session->accountId) +
+             " char=" + std::to_string(session->characterId) +
+             " on session " + std::to_string(session->id()) +
+             (room ? " (room " + std::to_string(roomId) + ")" : std::string()));
 }
 
 std::shared_ptr<Room> GameServer::createRoom(const RoomSettings& settings) {
     std::lock_guard<std::mutex> lock(m_roomsMutex);
     auto room = std::make_shared<Room>(m_nextRoomId++, settings);
+    room->setWorker(m_roomWorkers.assign());
     m_rooms[room->id()] = room;
-    LOG_INFO("GAME", "Created room: " + settings.name + " (ID: " + std::to_string(room->id()) + ")");
+    m_roomWorkers.post(room->worker(), [this, room]() {
+        m_workerRooms[room->worker()].push_back(room);
+    });
+    LOG_INFO("GAME", "Created room: " + settings.name + " (ID: " + std::to_string(room->id()) + 
+             ", worker " + std::to_string(room->worker()) + ")");
     return room;
 }
 
@@ -1228,10 +1871,20 @@ std::shared_ptr<Room> GameServer::getRoom(uint32_t roomId) {
 
 void GameServer::removeRoom(uint32_t roomId) {
     std::lock_guard<std::mutex> lock(m_roomsMutex);
-    m_rooms.erase(roomId);
+    auto it = m_rooms.find(roomId);
+    if (it != m_rooms.end()) {
+        int worker = it->second->worker();
+        m_roomWorkers.release(worker);
+        m_roomWorkers.post(worker, [this, worker, roomId]() {
+            auto& rooms = m_workerRooms[worker];
+            rooms.erase(std::remove_if(rooms.begin(), rooms.end(),
+                [roomId](const auto& r) { return r->id() == roomId; }), rooms.end());
+        });
+        m_rooms.erase(it);
+    }
 }
 
-void GameServer::addSession(Session::Ptr session) {
+void GameServer::addSession(const Session::Ptr& session) {
     std::lock_guard<std::mutex> lock(m_sessionsMutex);
     m_sessions[session->id()] = session;
 }
@@ -1241,6 +1894,12 @@ void GameServer::removeSession(uint32_t sessionId) {
     m_sessions.erase(sessionId);
 }
 
+std::shared_ptr<Inventory> GameServer::inventory(uint32_t sessionId) const {
+    std::lock_guard<std::mutex> lock(m_inventoriesMutex);
+    auto it = m_inventories.find(sessionId);
+    return (it != m_inventories.end()) ? it->second : nullptr;
+}
+
 Session::Ptr GameServer::getSession(uint32_t sessionId) {
     std::lock_guard<std::mutex> lock(m_sessionsMutex);
     auto it = m_sessions.find(sessionId);
@@ -1251,7 +1910,7 @@ Session::Ptr GameServer::getSession(uint32_t sessionId) {
 // DATA HANDLERS
 // =============================================================================
 
-void GameServer::handleRequestData(Session::Ptr session, Packet& packet) {
+void GameServer::handleRequestData(const Session::Ptr& session, PacketView& packet) {
     // CMD 0x4D - Client requests 276 bytes of data
     // Payload: 276 bytes request data
     if (packet.remaining() < 276) {
@@ -1268,7 +1927,7 @@ void GameServer::handleRequestData(Session::Ptr session, Packet& packet) {
     // Actual implementation depends on what data the client expects
 }
 
-void GameServer::handleUnknown32(Session::Ptr session, Packet& packet) {
+void GameServer::handleUnknown32(const Session::Ptr& session, PacketView& packet) {
     // CMD 0x32 - Unknown purpose (8 bytes)
     // Possibly some state sync or timing data
     if (packet.remaining() < 8) {
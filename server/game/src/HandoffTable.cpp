@@ -0,0 +1,122 @@
+/**
+ * @file HandoffTable.cpp
+ * @brief Pending login -> game handoffs pushed by the LoginServer
+ */
+
+#include "HandoffTable.h"
+
+namespace knc {
+
+HandoffTable::HandoffTable(std::chrono::seconds ttl)
+    : m_ttl(ttl.count() > 0 ? ttl : std::chrono::seconds(30))
+{
+}
+
+void HandoffTable::setTtl(std::chrono::seconds ttl) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (ttl.count() > 0) m_ttl = ttl;
+}
+
+void HandoffTable::put(Handoff handoff) {
+    if (handoff.token.empty()) return;
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = Clock::now();
+    expire(now);
+    
+    std::string token = handoff.token;
+    std::string ip = handoff.clientIp;
+    auto expires = now + m_ttl;
+    
+    auto it = m_byToken.find(token);
+    if (it != m_byToken.end()) {
+        // Same token pushed again (LoginLink reconnect replay): refresh it, keep its place
+        if (it->second.handoff.clientIp != ip) {
+            unindex(it->second.handoff.clientIp, token);
+            m_byIp[ip].push_back(token);
+        }
+        it->second.handoff = std::move(handoff);
+        it->second.expires = expires;
+    } else {
+        m_byToken.emplace(token, Entry{std::move(handoff), expires});
+        m_byIp[ip].push_back(token);
+    }
+    m_expiry.emplace_back(expires, std::move(token));
+    ++m_stats.pushed;
+}
+
+std::optional<Handoff> HandoffTable::take(const std::string& clientIp) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = Clock::now();
+    expire(now);
+    
+    auto ipIt = m_byIp.find(clientIp);
+    if (ipIt != m_byIp.end()) {
+        auto& tokens = ipIt->second;
+        while (!tokens.empty()) {
+            std::string token = std::move(tokens.front());
+            tokens.pop_front();
+            
+            auto it = m_byToken.find(token);
+            if (it == m_byToken.end()) continue;
+            
+            Handoff handoff = std::move(it->second.handoff);
+            m_byToken.erase(it);
+            if (tokens.empty()) m_byIp.erase(ipIt);
+            ++m_stats.hits;
+            return handoff;
+        }
+        m_byIp.erase(ipIt);
+    }
+    
+    ++m_stats.misses;
+    return std::nullopt;
+}
+
+bool HandoffTable::revoke(const std::string& token) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_byToken.find(token);
+    if (it == m_byToken.end()) return false;
+    unindex(it->second.handoff.clientIp, token);
+    m_byToken.erase(it);
+    return true;
+}
+
+size_t HandoffTable::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_byToken.size();
+}
+
+HandoffTable::Stats HandoffTable::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void HandoffTable::expire(Clock::time_point now) {
+    while (!m_expiry.empty() && m_expiry.front().first <= now) {
+        const std::string& token = m_expiry.front().second;
+        auto it = m_byToken.find(token);
+        // A refreshed token has a later expiry queued behind this one
+        if (it != m_byToken.end() && it->second.expires <= now) {
+            unindex(it->second.handoff.clientIp, token);
+            m_byToken.erase(it);
+            ++m_stats.expired;
+        }
+        m_expiry.pop_front();
+    }
+}
+
+void HandoffTable::unindex(const std::string& clientIp, const std::string& token) {
+    auto ipIt = m_byIp.find(clientIp);
+    if (ipIt == m_byIp.end()) return;
+    auto& tokens = ipIt->second;
+    for (auto t = tokens.begin(); t != tokens.end(); ++t) {
+        if (*t == token) {
+            tokens.erase(t);
+            break;
+        }
+    }
+    if (tokens.empty()) m_byIp.erase(ipIt);
+}
+
+} // namespace knc
@@ -0,0 +1,306 @@
+/**
+ * @file Inventory.cpp
+ * @brief Per-session inventory with pre-encoded inventory packets
+ */
+
+#include "Inventory.h"
+#include "db/Database.h"
+#include "packets/PacketSchemas.h"
+#include <algorithm>
+
+namespace knc {
+
+namespace {
+    template <typename T>
+    T* findById(std::vector<T>& list, int32_t id) {
+        auto it = std::find_if(list.begin(), list.end(), [id](const T& e) { return e.id == id; });
+        return it != list.end() ? &*it : nullptr;
+    }
+    
+    template <typename T>
+    const T* findById(const std::vector<T>& list, int32_t id) {
+        auto it = std::find_if(list.begin(), list.end(), [id](const T& e) { return e.id == id; });
+        return it != list.end() ? &*it : nullptr;
+    }
+    
+    template <typename T>
+    void put(std::vector<T>& list, const T& entry) {
+        if (T* existing = findById(list, entry.id)) *existing = entry;
+        else list.push_back(entry);
+    }
+    
+    template <typename T>
+    bool remove(std::vector<T>& list, int32_t id) {
+        auto it = std::find_if(list.begin(), list.end(), [id](const T& e) { return e.id == id; });
+        if (it == list.end()) return false;
+        list.erase(it);
+        return true;
+    }
+    
+    template <typename Schema, typename T>
+    Session::SharedBuffer encode(uint8_t cmd, const std::vector<T>& list) {
+        Packet pkt(cmd);
+        pkt.reserve(4 + list.size() * Schema::WIRE_SIZE);
+        Schema::writeList(pkt, list);
+        return Session::makeShared(pkt);
+    }
+}
+
+// =============================================================================
+// LOADING
+// =============================================================================
+
+Inventory Inventory::load(Database& db, int32_t characterId) {
+    Inventory inv;
+    inv.m_characterId = characterId;
+    
+    // Vehicles
+    auto vehicles = db.queryStmt(
+        "SELECT id, vehicle_type_id, durability, max_durability, "
+        "COALESCE(stat_speed, 50) AS stat_speed, "
+        "COALESCE(stat_accel, 50) AS stat_accel, "
+        "COALESCE(stat_handling, 50) AS stat_handling, "
+        "COALESCE(stat_drift, 40) AS stat_drift, "
+        "COALESCE(stat_boost, 30) AS stat_boost, "
+        "COALESCE(stat_weight, 50) AS stat_weight, "
+        "COALESCE(stat_special, 0) AS stat_special, "
+        "equipped "
+        "FROM vehicles WHERE character_id = ?",
+        {characterId}
+    );
+    static const char* const STAT_COLUMNS[7] = {
+        "stat_speed", "stat_accel", "stat_handling", "stat_drift",
+        "stat_boost", "stat_weight", "stat_special"
+    };
+    const int vId = vehicles.column("id");
+    const int vTemplate = vehicles.column("vehicle_type_id");
+    const int vDurability = vehicles.column("durability");
+    const int vMaxDurability = vehicles.column("max_durability");
+    const int vEquipped = vehicles.column("equipped");
+    int vStats[7];
+    for (int i = 0; i < 7; ++i) vStats[i] = vehicles.column(STAT_COLUMNS[i]);
+    
+    inv.m_vehicles.reserve(vehicles.size());
+    for (const auto& row : vehicles) {
+        VehicleInfo vi;
+        vi.id = row.getInt32(vId);
+        vi.templateId = row.getInt32(vTemplate);
+        vi.ownerId = characterId;
+        vi.durability = row.getInt32(vDurability);
+        vi.maxDurability = row.getInt32(vMaxDurability);
+        for (int i = 0; i < 7; ++i) vi.stats[i] = row.getInt32(vStats[i]);
+        vi.equipped = row.getBool(vEquipped);
+        inv.m_vehicles.push_back(vi);
+    }
+    
+    // Items
+    auto items = db.queryStmt(
+        "SELECT id, item_type_id, quantity, slot, COALESCE(equipped, 0) AS equipped "
+        "FROM items WHERE character_id = ?",
+        {characterId}
+    );
+    const int iId = items.column("id");
+    const int iTemplate = items.column("item_type_id");
+    const int iQuantity = items.column("quantity");
+    const int iSlot = items.column("slot");
+    const int iEquipped = items.column("equipped");
+    
+    inv.m_items.reserve(items.size());
+    for (const auto& row : items) {
+        ItemInfo ii;
+        ii.id = row.getInt32(iId);
+        ii.templateId = row.getInt32(iTemplate);
+        ii.ownerId = characterId;
+        ii.quantity = row.getInt32(iQuantity);
+        ii.slot = row.getInt32(iSlot);
+        ii.equipped = row.getBool(iEquipped);
+        inv.m_items.push_back(ii);
+    }
+    
+    // Accessories
+    auto accessories = db.queryStmt(
+        "SELECT id, accessory_type_id, slot, bonus1, bonus2, bonus3, equipped "
+        "FROM accessories WHERE character_id = ?",
+        {characterId}
+    );
+    const int aId = accessories.column("id");
+    const int aTemplate = accessories.column("accessory_type_id");
+    const int aSlot = accessories.column("slot");
+    const int aBonus1 = accessories.column("bonus1");
+    const int aBonus2 = accessories.column("bonus2");
+    const int aBonus3 = accessories.column("bonus3");
+    const int aEquipped = accessories.column("equipped");
+    
+    inv.m_accessories.reserve(accessories.size());
+    for (const auto& row : accessories) {
+        AccessoryInfo ai;
+        ai.id = row.getInt32(aId);
+        ai.templateId = row.getInt32(aTemplate);
+        ai.slot = row.getInt32(aSlot);
+        ai.bonus1 = row.getInt32(aBonus1);
+        ai.bonus2 = row.getInt32(aBonus2);
+        ai.bonus3 = row.getInt32(aBonus3);
+        ai.equipped = row.getBool(aEquipped);
+        inv.m_accessories.push_back(ai);
+    }
+    
+    return inv;
+}
+
+// =============================================================================
+// LOOKUP
+// =============================================================================
+
+const VehicleInfo* Inventory::findVehicle(int32_t id) const {
+    return findById(m_vehicles, id);
+}
+
+const ItemInfo* Inventory::findItem(int32_t id) const {
+    return findById(m_items, id);
+}
+
+const AccessoryInfo* Inventory::findAccessory(int32_t id) const {
+    return findById(m_accessories, id);
+}
+
+const VehicleInfo* Inventory::equippedVehicle() const {
+    for (const auto& v : m_vehicles) {
+        if (v.equipped) return &v;
+    }
+    return nullptr;
+}
+
+// =============================================================================
+// ENCODED PACKETS
+// =============================================================================
+
+Session::SharedBuffer Inventory::vehiclesPacket() {
+    if (!m_vehiclesFrame) {
+        m_vehiclesFrame = encode<VehicleInfoSchema>(CMD::S_INVENTORY_VEHICLES, m_vehicles);
+    }
+    return m_vehiclesFrame;
+}
+
+Session::SharedBuffer Inventory::itemsPacket() {
+    if (!m_itemsFrame) {
+        m_itemsFrame = encode<ItemInfoSchema>(CMD::S_INVENTORY_ITEMS, m_items);
+    }
+    return m_itemsFrame;
+}
+
+Session::SharedBuffer Inventory::accessoriesPacket() {
+    if (!m_accessoriesFrame) {
+        m_accessoriesFrame = encode<AccessoryInfoSchema>(CMD::S_INVENTORY_ACCESSORY, m_accessories);
+    }
+    return m_accessoriesFrame;
+}
+
+// =============================================================================
+// CHANGES
+// =============================================================================
+
+void Inventory::putVehicle(const VehicleInfo& vehicle) {
+    put(m_vehicles, vehicle);
+    m_vehiclesFrame.reset();
+}
+
+void Inventory::putItem(const ItemInfo& item) {
+    put(m_items, item);
+    m_itemsFrame.reset();
+}
+
+void Inventory::putAccessory(const AccessoryInfo& accessory) {
+    put(m_accessories, accessory);
+    m_accessoriesFrame.reset();
+}
+
+bool Inventory::removeVehicle(int32_t id) {
+    if (!remove(m_vehicles, id)) return false;
+    m_vehiclesFrame.reset();
+    return true;
+}
+
+bool Inventory::removeItem(int32_t id) {
+    if (!remove(m_items, id)) return false;
+    m_itemsFrame.reset();
+    return true;
+}
+
+bool Inventory::removeAccessory(int32_t id) {
+    if (!remove(m_accessories, id)) return false;
+    m_accessoriesFrame.reset();
+    return true;
+}
+
+bool Inventory::equipVehicle(int32_t id) {
+    if (!findById(m_vehicles, id)) return false;
+    for (auto& v : m_vehicles) v.equipped = (v.id == id);
+    m_vehiclesFrame.reset();
+    return true;
+}
+
+bool Inventory::setItemEquipped(int32_t id, bool equipped) {
+    ItemInfo* item = findById(m_items, id);
+    if (!item) return false;
+    if (item->equipped != equipped) {
+        item->equipped = equipped;
+        m_itemsFrame.reset();
+    }
+    return true;
+}
+
+bool Inventory::equipAccessory(int32_t id) {
+    AccessoryInfo* acc = findById(m_accessories, id);
+    if (!acc) return false;
+    const int32_t slot = acc->slot;
+    for (auto& a : m_accessories) {
+        if (a.slot == slot) a.equipped = (a.id == id);
+    }
+    m_accessoriesFrame.reset();
+    return true;
+}
+
+bool Inventory::unequipAccessory(int32_t id) {
+    AccessoryInfo* acc = findById(m_accessories, id);
+    if (!acc) return false;
+    if (acc->equipped) {
+        acc->equipped = false;
+        m_accessoriesFrame.reset();
+    }
+    return true;
+}
+
+bool Inventory::setItemQuantity(int32_t id, int32_t quantity) {
+    if (quantity <= 0) return removeItem(id);
+    ItemInfo* item = findById(m_items, id);
+    if (!item) return false;
+    if (item->quantity != quantity) {
+        item->quantity = quantity;
+        m_itemsFrame.reset();
+    }
+    return true;
+}
+
+// =============================================================================
+// OUT-OF-BAND CHANGES
+// =============================================================================
+
+uint32_t Inventory::markStale(uint8_t lists) {
+    m_stale |= lists;
+    if (lists & VEHICLES) m_vehiclesFrame.reset();
+    if (lists & ITEMS) m_itemsFrame.reset();
+    if (lists & ACCESSORIES) m_accessoriesFrame.reset();
+    return ++m_generation;
+}
+
+void Inventory::reloaded(Inventory&& fresh, uint32_t generation) {
+    if (generation != m_generation) return;
+    
+    // Lists that stayed fresh keep their entries and encoded frames
+    if (m_stale & VEHICLES) m_vehicles = std::move(fresh.m_vehicles);
+    if (m_stale & ITEMS) m_items = std::move(fresh.m_items);
+    if (m_stale & ACCESSORIES) m_accessories = std::move(fresh.m_accessories);
+    m_stale = 0;
+}
+
+} // namespace knc
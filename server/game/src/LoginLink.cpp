@@ -0,0 +1,218 @@
+/**
+ * @file LoginLink.cpp
+ * @brief Persistent internal connection to the LoginServer
+ */
+
+#include "LoginLink.h"
+#include "HandoffTable.h"
+#include "net/Packet.h"
+#include "net/PacketView.h"
+#include "logging/Logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace knc {
+
+namespace {
+    constexpr std::chrono::seconds MAX_BACKOFF{30};
+    // A link that lasted this long was healthy: the next drop retries from 1s again
+    constexpr std::chrono::seconds STABLE_LINK{30};
+    // Clean close this soon after the ack: one-shot LoginServer
+    constexpr std::chrono::seconds ONE_SHOT_WINDOW{5};
+}
+
+LoginLink::LoginLink(asio::io_context& io, HandoffTable& handoffs, Config config)
+    : m_strand(asio::make_strand(io))
+    , m_resolver(m_strand)
+    , m_socket(m_strand)
+    , m_retryTimer(m_strand)
+    , m_handoffs(handoffs)
+    , m_config(std::move(config))
+{
+}
+
+void LoginLink::start() {
+    asio::post(m_strand, [this]() {
+        m_stopped = false;
+        connect();
+    });
+}
+
+void LoginLink::stop() {
+    asio::post(m_strand, [this]() {
+        m_stopped = true;
+        m_registered = false;
+        m_retryTimer.cancel();
+        m_resolver.cancel();
+        std::error_code ec;
+        m_socket.close(ec);
+    });
+}
+
+// =============================================================================
+// CONNECTION
+// =============================================================================
+
+void LoginLink::connect() {
+    if (m_stopped) return;
+    
+    LOG_INFOF("LINK", "Connecting to LoginServer {}:{}", m_config.loginHost, m_config.loginPort);
+    m_resolver.async_resolve(m_config.loginHost, std::to_string(m_config.loginPort),
+        [this](std::error_code ec, asio::ip::tcp::resolver::results_type endpoints) {
+            if (ec) {
+                scheduleReconnect("resolve: " + ec.message());
+                return;
+            }
+            asio::async_connect(m_socket, endpoints,
+                [this](std::error_code ec, const asio::ip::tcp::endpoint&) {
+                    if (ec) {
+                        scheduleReconnect("connect: " + ec.message());
+                        return;
+                    }
+                    sendRegister();
+                });
+        });
+}
+
+void LoginLink::sendRegister() {
+    Packet pkt(CMD::I_SERVER_REGISTER);
+    pkt.writeString(m_config.key);
+    pkt.writeInt32(m_config.serverId);
+    pkt.writeString(m_config.name);
+    pkt.writeString(m_config.host);
+    pkt.writeInt32(m_config.port);
+    pkt.writeInt32(m_config.maxPlayers);
+    pkt.writeInt32(m_config.serverType);
+    m_registerFrame = pkt.serialize();
+    
+    asio::async_write(m_socket, asio::buffer(m_registerFrame),
+        [this](std::error_code ec, size_t) {
+            if (ec) {
+                scheduleReconnect("register: " + ec.message());
+                return;
+            }
+            readHeader();
+        });
+}
+
+void LoginLink::scheduleReconnect(const std::string& reason) {
+    std::error_code ignored;
+    m_socket.close(ignored);
+    if (m_stopped) return;
+    
+    if (m_registered) {
+        LOG_WARNF("LINK", "LoginServer link lost ({}), handoffs fall back to the DB until it is back", reason);
+    } else {
+        LOG_WARNF("LINK", "LoginServer link failed ({}), retrying in {}s", reason, m_backoff.count());
+    }
+    if (m_registered && std::chrono::steady_clock::now() - m_registeredAt >= STABLE_LINK) {
+        m_backoff = std::chrono::seconds(1);
+    }
+    m_registered = false;
+    
+    m_retryTimer.expires_after(m_backoff);
+    m_retryTimer.async_wait([this](std::error_code ec) {
+        if (!ec) connect();
+    });
+    m_backoff = std::min(m_backoff * 2, MAX_BACKOFF);
+}
+
+// =============================================================================
+// RECEIVING
+// =============================================================================
+
+void LoginLink::readHeader() {
+    asio::async_read(m_socket, asio::buffer(m_header),
+        [this](std::error_code ec, size_t) {
+            if (ec) {
+                onReadError(ec);
+                return;
+            }
+            readPayload();
+        });
+}
+
+void LoginLink::readPayload() {
+    PacketHeader header;
+    std::memcpy(&header, m_header.data(), sizeof(header));
+    m_payload.resize(header.size);
+    
+    asio::async_read(m_socket, asio::buffer(m_payload),
+        [this](std::error_code ec, size_t) {
+            if (ec) {
+                onReadError(ec);
+                return;
+            }
+            PacketHeader header;
+            std::memcpy(&header, m_header.data(), sizeof(header));
+            PacketView packet(header, m_payload.data(), m_payload.size());
+            onPacket(packet);
+            if (m_socket.is_open()) readHeader();
+        });
+}
+
+void LoginLink::onReadError(const std::error_code& ec) {
+    if (m_registered && ec == asio::error::eof &&
+        std::chrono::steady_clock::now() - m_registeredAt < ONE_SHOT_WINDOW) {
+        // Old LoginServer: one reply, then close. Reconnecting would only re-register forever
+        std::error_code ignored;
+        m_socket.close(ignored);
+        LOG_INFO("LINK", "LoginServer closed the link after registering (one-shot LoginServer): "
+                 "staying registered, sessions are looked up in active_sessions");
+        return;
+    }
+    scheduleReconnect(ec.message());
+}
+
+void LoginLink::onPacket(PacketView& packet) {
+    if (!m_registered) {
+        // First reply is the registration result: [ok:u8]
+        if (packet.size() == 0 || packet.data()[0] != 1) {
+            // Wrong key or rejected: keep retrying slowly, the LoginServer may be reconfigured
+            m_backoff = MAX_BACKOFF;
+            scheduleReconnect("registration rejected");
+            return;
+        }
+        // Backoff is only reset once the link proves stable (scheduleReconnect)
+        m_registered = true;
+        m_registeredAt = std::chrono::steady_clock::now();
+        LOG_INFO("LINK", "Registered with LoginServer, receiving session handoffs");
+        return;
+    }
+    
+    if (packet.cmd() == CMD::I_SESSION_HANDOFF) {
+        onHandoff(packet);
+    }
+}
+
+void LoginLink::onHandoff(PacketView& packet) {
+    Handoff handoff;
+    handoff.token = packet.readString(128);
+    handoff.clientIp = packet.readString(64);
+    handoff.accountId = packet.readInt32();
+    handoff.characterId = packet.readInt32();
+    handoff.hasCharacter = packet.readUInt8() != 0;
+    if (handoff.hasCharacter) {
+        PlayerData& player = handoff.player;
+        player.id = handoff.characterId;
+        player.accountId = handoff.accountId;
+        player.name = packet.readString(64);
+        player.level = packet.readInt32();
+        player.xp = packet.readInt32();
+        player.gold = packet.readInt32();
+        player.cash = packet.readInt32();
+        player.wins = packet.readInt32();
+        player.losses = packet.readInt32();
+        player.driverId = 1;
+    }
+    
+    if (handoff.token.empty() || handoff.clientIp.empty() || handoff.accountId <= 0) {
+        LOG_WARN("LINK", "Malformed session handoff ignored");
+        return;
+    }
+    
+    LOG_DEBUGF("LINK", "Handoff for {}: account={} char={}", handoff.clientIp, handoff.accountId, handoff.characterId);
+    m_handoffs.put(std::move(handoff));
+}
+
+} // namespace knc
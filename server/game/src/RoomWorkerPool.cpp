@@ -0,0 +1,197 @@
+/**
+ * @file RoomWorkerPool.cpp
+ * @brief Room simulation worker threads
+ */
+
+#include "RoomWorkerPool.h"
+#include "game/Room.h"
+#include "logging/Logger.h"
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace knc {
+
+RoomWorkerPool::RoomWorkerPool(int workers) {
+    if (workers < 1) workers = 1;
+    m_workers.reserve(workers);
+    for (int i = 0; i < workers; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers.back()->index = i;
+    }
+}
+
+void RoomWorkerPool::setTick(std::chrono::milliseconds interval, TickHandler handler) {
+    m_tickInterval = interval;
+    m_tickHandler = std::move(handler);
+}
+
+void RoomWorkerPool::setPacketHandler(PacketHandler handler) {
+    m_packetHandler = std::move(handler);
+}
+
+RoomWorkerPool::~RoomWorkerPool() {
+    stop();
+}
+
+void RoomWorkerPool::start() {
+    if (m_running.exchange(true)) return;
+    
+    for (auto& worker : m_workers) {
+        Worker* w = worker.get();
+        w->thread = std::thread([this, w]() { workerLoop(*w); });
+    }
+    
+    LOG_INFO("ROOM", "Started " + std::to_string(m_workers.size()) + " room worker(s)");
+}
+
+void RoomWorkerPool::stop() {
+    if (!m_running.exchange(false)) return;
+    
+    for (auto& worker : m_workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->cv.notify_one();
+    }
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+int RoomWorkerPool::assign() {
+    // Weighted by players so a few full racing rooms outweigh many empty ones
+    int best = 0;
+    int bestLoad = std::numeric_limits<int>::max();
+    for (int i = 0; i < workerCount(); ++i) {
+        int load = m_workers[i]->players.load(std::memory_order_relaxed) * 4 +
+                   m_workers[i]->rooms.load(std::memory_order_relaxed);
+        if (load < bestLoad) {
+            bestLoad = load;
+            best = i;
+        }
+    }
+    m_workers[best]->rooms.fetch_add(1, std::memory_order_relaxed);
+    return best;
+}
+
+void RoomWorkerPool::release(int worker) {
+    if (worker < 0 || worker >= workerCount()) return;
+    m_workers[worker]->rooms.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void RoomWorkerPool::addLoad(int worker, int delta) {
+    if (worker < 0 || worker >= workerCount()) return;
+    m_workers[worker]->players.fetch_add(delta, std::memory_order_relaxed);
+}
+
+void RoomWorkerPool::post(int worker, Task task) {
+    Job job;
+    job.task = std::move(task);
+    enqueue(worker, std::move(job));
+}
+
+void RoomWorkerPool::postPacket(int worker, const Session::Ptr& session, const std::shared_ptr<Room>& room,
+                                const PacketView& packet) {
+    Job job;
+    job.session = session;
+    job.room = room;
+    job.header = packet.header();
+    job.received = Clock::now();
+    job.size = packet.size();
+    if (job.size <= INLINE_PAYLOAD) {
+        std::memcpy(job.payload, packet.data(), job.size);
+    } else {
+        job.overflow.assign(packet.data(), packet.data() + job.size);
+    }
+    enqueue(worker, std::move(job));
+}
+
+void RoomWorkerPool::enqueue(int worker, Job&& job) {
+    if (worker < 0 || worker >= workerCount()) return;
+    
+    Worker& w = *m_workers[worker];
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        wake = w.queue.empty();
+        w.queue.push_back(std::move(job));
+    }
+    // Only the first job of a batch needs to wake the worker
+    if (wake) {
+        w.cv.notify_one();
+    }
+}
+
+void RoomWorkerPool::run(Job& job) {
+    if (job.task) {
+        job.task();
+        return;
+    }
+    if (!m_packetHandler || !job.session || !job.room) return;
+    
+    const uint8_t* data = job.size <= INLINE_PAYLOAD ? job.payload : job.overflow.data();
+    PacketView view(job.header, data, job.size);
+    LogSessionScope logSession(job.session->id());
+    m_packetHandler(job.session, view, *job.room, job.received);
+}
+
+bool RoomWorkerPool::isWorkerThread(int worker) const {
+    if (worker < 0 || worker >= workerCount()) return false;
+    return m_workers[worker]->thread.get_id() == std::this_thread::get_id();
+}
+
+void RoomWorkerPool::workerLoop(Worker& worker) {
+    using clock = std::chrono::steady_clock;
+    
+    std::vector<Job> batch;
+    const bool ticking = m_tickHandler && m_tickInterval.count() > 0;
+    auto nextTick = clock::now() + m_tickInterval;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            auto ready = [&]() { return !worker.queue.empty() || !m_running; };
+            if (ticking) {
+                worker.cv.wait_until(lock, nextTick, ready);
+            } else {
+                worker.cv.wait(lock, ready);
+            }
+            if (worker.queue.empty() && !m_running) {
+                break;
+            }
+            batch.swap(worker.queue);
+        }
+        
+        // Run the batch without holding the queue lock
+        for (auto& job : batch) {
+            try {
+                run(job);
+            } catch (const std::exception& e) {
+                LOG_ERROR("ROOM", std::string("Room task failed: ") + e.what());
+            }
+        }
+        // Keeps its capacity: swapped back in as the producers' queue next time
+        batch.clear();
+        
+        if (ticking) {
+            auto now = clock::now();
+            if (now >= nextTick) {
+                try {
+                    m_tickHandler(worker.index);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("ROOM", std::string("Room tick failed: ") + e.what());
+                }
+                // Fixed rate; skip missed ticks instead of bursting to catch up
+                nextTick += m_tickInterval;
+                if (nextTick <= now) {
+                    nextTick = now + m_tickInterval;
+                }
+            }
+        }
+    }
+}
+
+} // namespace knc
@@ -8,37 +8,39 @@
 #include "packets/PacketBuilder.h"
 #include "db/Database.h"
 #include "logging/Logger.h"
+#include "security/BanManager.h"
+#include "game/CollisionMesh.h"
 #include <cmath>
-#include <mutex>
 
 namespace knc {
 
 // Static member definitions
-std::unordered_map<uint32_t, std::vector<PositionRecord>> AntiCheatHandler::s_positionHistory;
-std::unordered_map<uint32_t, int> AntiCheatHandler::s_violationCounts;
-std::unordered_map<uint32_t, std::chrono::steady_clock::time_point> AntiCheatHandler::s_lastPacketTime;
-std::unordered_map<uint32_t, int> AntiCheatHandler::s_packetCounts;
 std::unordered_map<int, float> AntiCheatHandler::s_maxSpeeds;
 std::unordered_map<int, int> AntiCheatHandler::s_minLapTimes;
 
-static std::mutex s_mutex;
-
-bool AntiCheatHandler::validatePosition(Session::Ptr session, float x, float y, float z) {
-    std::lock_guard<std::mutex> lock(s_mutex);
-    
-    uint32_t sessionId = session->id();
-    auto now = std::chrono::steady_clock::now();
+bool AntiCheatHandler::validatePosition(Session::Ptr session, float x, float y, float z,
+                                        std::chrono::steady_clock::time_point received,
+                                        const CollisionMesh* track) {
+    // NaN / huge values would poison the history and the room's quantizer grid
+    if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z) ||
+        std::fabs(x) > WORLD_LIMIT || std::fabs(y) > WORLD_LIMIT || std::fabs(z) > WORLD_LIMIT) {
+        reportViolation(session, ViolationType::InvalidData, ViolationSeverity::Medium,
+            "Invalid position: " + std::to_string(x) + ", " + std::to_string(y) + ", " + std::to_string(z));
+        return false;
+    }
     
-    PositionRecord currentPos{x, y, z, now};
+    PositionRecord currentPos{x, y, z, received};
     
-    auto& history = s_positionHistory[sessionId];
+    // Caller's room owns the history (acquireHistory)
+    AntiCheatState& state = session->antiCheat;
+    auto& history = state.positions;
     
     if (!history.empty()) {
         const auto& lastPos = history.back();
         
         // Calculate time delta
         auto timeDelta = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now - lastPos.timestamp
+            received - lastPos.timestamp
         ).count();
         
         if (timeDelta > 0) {
@@ -66,10 +68,46 @@ bool AntiCheatHandler::validatePosition(Session::Ptr session, float x, float y,
         }
     }
     
-    // Store position (keep last 60 positions = ~1 second at 60fps)
-    history.push_back(currentPos);
-    if (history.size() > 60) {
-        history.erase(history.begin());
+    if (track && !validateTrack(session, history.empty() ? nullptr : &history.back(), x, y, z, *track)) {
+        return false;
+    }
+    
+    // Ring buffer: overwrites the oldest once full
+    history.push(currentPos);
+    
+    return true;
+}
+
+bool AntiCheatHandler::validateTrack(Session::Ptr session, const PositionRecord* prev,
+                                     float x, float y, float z, const CollisionMesh& track) {
+    AntiCheatState& state = session->antiCheat;
+    
+    // Through a wall: the move from the last accepted position crosses a steep
+    // triangle by more than the margin (floors and ramps are driven over)
+    if (prev) {
+        CollisionMesh::Vec3 from{prev->x, prev->y, prev->z};
+        CollisionMesh::Vec3 move{x - prev->x, y - prev->y, z - prev->z};
+        float length = calculateDistance(prev->x, prev->y, prev->z, x, y, z);
+        CollisionMesh::Hit hit;
+        if (length > WALL_MARGIN && track.raycast(from, move, length, &hit) &&
+            std::fabs(track.up(hit.normal)) < WALL_NORMAL_UP && length - hit.distance > WALL_MARGIN) {
+            reportViolation(session, ViolationType::InvalidData, ViolationSeverity::Medium,
+                "Moved through a wall on " + track.name() + " at (" + std::to_string(hit.point.x) + ", " +
+                std::to_string(hit.point.y) + ", " + std::to_string(hit.point.z) + ")");
+            return false;
+        }
+    }
+    
+    // Off the track: one sample is a jump or a respawn, a second of them is not
+    if (track.nearestSurface({x, y, z}, OFF_TRACK_DISTANCE) > OFF_TRACK_DISTANCE) {
+        if (++state.offTrackSamples >= OFF_TRACK_SAMPLES) {
+            state.offTrackSamples = 0;
+            reportViolation(session, ViolationType::InvalidData, ViolationSeverity::Low,
+                "Off track on " + track.name() + " at (" + std::to_string(x) + ", " +
+                std::to_string(y) + ", " + std::to_string(z) + ")");
+        }
+    } else {
+        state.offTrackSamples = 0;
     }
     
     return true;
@@ -108,14 +146,11 @@ bool AntiCheatHandler::validateLapTime(Session::Ptr session, int mapId, int lapT
             "Impossible lap time on map " + std::to_string(mapId) + ": " + 
             std::to_string(lapTimeMs) + "ms (min: " + std::to_string(minTime) + "ms)");
         
-        // Log to database for analysis
-        auto& db = Database::instance();
-        db.execute(
+        // Log to database for analysis (posted: this runs on the room worker)
+        Database::instance().executeAsync(session->executor(),
             "INSERT INTO speed_records (character_id, map_id, lap_time, total_time, max_speed, avg_speed, is_valid) "
-            "VALUES (" + std::to_string(session->characterId) + ", " + 
-            std::to_string(mapId) + ", " + std::to_string(lapTimeMs) + ", " +
-            std::to_string(lapTimeMs) + ", 0, 0, 0)"
-        );
+            "VALUES (?, ?, ?, ?, 0, 0, 0)",
+            {session->characterId, mapId, lapTimeMs, lapTimeMs});
         
         return false;
     }
@@ -134,40 +169,10 @@ bool AntiCheatHandler::validateItemUse(Session::Ptr session, int itemId, int tar
     return true;
 }
 
-bool AntiCheatHandler::validatePacketRate(Session::Ptr session) {
-    std::lock_guard<std::mutex> lock(s_mutex);
-    
-    uint32_t sessionId = session->id();
-    auto now = std::chrono::steady_clock::now();
-    
-    auto& lastTime = s_lastPacketTime[sessionId];
-    auto& count = s_packetCounts[sessionId];
-    
-    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - lastTime).count();
-    
-    if (elapsed >= 1) {
-        // Reset counter every second
-        count = 1;
-        lastTime = now;
-    } else {
-        count++;
-        
-        if (count > PACKET_FLOOD_THRESHOLD) {
-            reportViolation(session, ViolationType::PacketFlood, ViolationSeverity::Medium,
-                "Packet flood: " + std::to_string(count) + " packets/sec");
-            return false;
-        }
-    }
-    
-    return true;
-}
-
 void AntiCheatHandler::reportViolation(Session::Ptr session, ViolationType type, 
                                        ViolationSeverity severity, const std::string& details) {
-    std::lock_guard<std::mutex> lock(s_mutex);
-    
     uint32_t sessionId = session->id();
-    s_violationCounts[sessionId]++;
+    int totalViolations = ++session->antiCheat.violations;
     
     // Log to file
     std::string typeStr;
@@ -193,45 +198,63 @@ void AntiCheatHandler::reportViolation(Session::Ptr session, ViolationType type,
              ", char=" + std::to_string(session->characterId) + 
              ", ip=" + session->remoteAddress() + ")");
     
-    // Log to database
-    logViolation(session, type, severity, details);
-    
-    // Take action based on severity and violation count
-    int totalViolations = s_violationCounts[sessionId];
-    
+    // Action based on severity and violation count
+    ViolationSeverity action = ViolationSeverity::Low;
     if (severity == ViolationSeverity::Critical || 
         totalViolations >= VIOLATION_THRESHOLD_BAN) {
-        takeAction(session, ViolationSeverity::Critical);
+        action = ViolationSeverity::Critical;
     } else if (severity == ViolationSeverity::High || 
                totalViolations >= VIOLATION_THRESHOLD_KICK) {
-        takeAction(session, ViolationSeverity::High);
+        action = ViolationSeverity::High;
+    }
+    
+    // Log to database, with the action taken in the same row
+    logViolation(session, type, severity, details, action);
+    
+    if (action != ViolationSeverity::Low) {
+        takeAction(session, action);
     } else if (severity == ViolationSeverity::Medium) {
         // Warning - send message to client
         session->send(PacketBuilder::displayMessage(u"MSG_CHEAT_WARNING", 2));
     }
 }
 
-int AntiCheatHandler::getViolationCount(uint32_t sessionId) {
-    std::lock_guard<std::mutex> lock(s_mutex);
-    auto it = s_violationCounts.find(sessionId);
-    return (it != s_violationCounts.end()) ? it->second : 0;
+bool AntiCheatHandler::acquireHistory(Session& session, uint32_t roomId) {
+    AntiCheatState& state = session.antiCheat;
+    uint32_t owner = state.owner.load(std::memory_order_acquire);
+    if (owner == roomId) return true;
+    if (owner != 0 || !state.owner.compare_exchange_strong(owner, roomId, std::memory_order_acquire)) {
+        return false;
+    }
+    // A new room starts on the grid: the previous room's positions don't apply
+    state.positions.clear();
+    state.offTrackSamples = 0;
+    return true;
 }
 
-void AntiCheatHandler::clearViolations(uint32_t sessionId) {
-    std::lock_guard<std::mutex> lock(s_mutex);
-    s_violationCounts.erase(sessionId);
-    s_positionHistory.erase(sessionId);
-    s_lastPacketTime.erase(sessionId);
-    s_packetCounts.erase(sessionId);
+void AntiCheatHandler::releaseHistory(Session& session, uint32_t roomId) {
+    // Publishes this worker's last writes to the next owner
+    uint32_t owner = roomId;
+    session.antiCheat.owner.compare_exchange_strong(owner, 0, std::memory_order_release,
+                                                    std::memory_order_relaxed);
+}
+
+int AntiCheatHandler::getViolationCount(const Session& session) {
+    return session.antiCheat.violations.load();
+}
+
+void AntiCheatHandler::clearViolations(Session& session) {
+    // From the worker of the room that owns the history
+    session.antiCheat.violations = 0;
+    session.antiCheat.positions.clear();
+    session.antiCheat.offTrackSamples = 0;
 }
 
 void AntiCheatHandler::setMaxSpeed(int mapId, float maxSpeed) {
-    std::lock_guard<std::mutex> lock(s_mutex);
     s_maxSpeeds[mapId] = maxSpeed;
 }
 
 void AntiCheatHandler::setMinLapTime(int mapId, int minTimeMs) {
-    std::lock_guard<std::mutex> lock(s_mutex);
     s_minLapTimes[mapId] = minTimeMs;
 }
 
@@ -254,9 +277,8 @@ float AntiCheatHandler::calculateDistance(float x1, float y1, float z1, float x2
 }
 
 void AntiCheatHandler::logViolation(Session::Ptr session, ViolationType type, 
-                                    ViolationSeverity severity, const std::string& details) {
-    auto& db = Database::instance();
-    
+                                    ViolationSeverity severity, const std::string& details,
+                                    ViolationSeverity action) {
     std::string typeStr;
     switch (type) {
         case ViolationType::SpeedHack: typeStr = "speedhack"; break;
@@ -275,75 +297,50 @@ void AntiCheatHandler::logViolation(Session::Ptr session, ViolationType type,
         case ViolationSeverity::Critical: severityStr = "critical"; break;
     }
     
-    // Escape details for SQL
-    std::string escapedDetails = details;
-    size_t pos = 0;
-    while ((pos = escapedDetails.find("'", pos)) != std::string::npos) {
-        escapedDetails.replace(pos, 1, "''");
-        pos += 2;
+    DBParams params{session->characterId, session->accountId, session->remoteAddress(),
+                    typeStr, severityStr, details};
+    std::string sql = "INSERT INTO anticheat_logs (character_id, account_id, ip_address, violation_type, severity, details";
+    if (action == ViolationSeverity::Critical || action == ViolationSeverity::High) {
+        sql += ", action_taken) VALUES (?, ?, ?, ?, ?, ?, ?)";
+        params.emplace_back(action == ViolationSeverity::Critical ? "temp_ban" : "kick");
+    } else {
+        sql += ") VALUES (?, ?, ?, ?, ?, ?)";
     }
     
-    try {
-        db.execute(
-            "INSERT INTO anticheat_logs (character_id, account_id, ip_address, violation_type, severity, details) "
-            "VALUES (" + 
-            std::to_string(session->characterId) + ", " +
-            std::to_string(session->accountId) + ", '" +
-            session->remoteAddress() + "', '" +
-            typeStr + "', '" +
-            severityStr + "', '" +
-            escapedDetails + "')"
-        );
-    } catch (const std::exception& e) {
-        LOG_ERROR("ANTICHEAT", "Failed to log violation: " + std::string(e.what()));
-    }
+    // Posted to a DB worker: reportViolation runs on the room worker
+    Database::instance().executeAsync(session->executor(), std::move(sql), std::move(params),
+        [characterId = session->characterId](bool ok) {
+            if (!ok) LOG_ERROR("ANTICHEAT", "Failed to log violation: char=" + std::to_string(characterId));
+        });
 }
 
 void AntiCheatHandler::takeAction(Session::Ptr session, ViolationSeverity severity) {
-    auto& db = Database::instance();
-    
+    // The action is already recorded in the anticheat_logs row (logViolation)
     switch (severity) {
         case ViolationSeverity::High:
             // Kick player
             LOG_WARN("ANTICHEAT", "Kicking player: char=" + std::to_string(session->characterId));
             session->send(PacketBuilder::displayMessage(u"MSG_KICKED_CHEAT", 2));
-            session->stop();
-            
-            // Update log with action
-            db.execute(
-                "UPDATE anticheat_logs SET action_taken = 'kick' "
-                "WHERE character_id = " + std::to_string(session->characterId) + 
-                " ORDER BY id DESC LIMIT 1"
-            );
+            session->kick();
             break;
-            
+        
         case ViolationSeverity::Critical:
             // Temp ban (24 hours)
             LOG_WARN("ANTICHEAT", "Banning player: char=" + std::to_string(session->characterId));
             
-            db.execute(
-                "INSERT INTO bans (account_id, ip_address, reason, banned_by, expires_at) VALUES (" +
-                std::to_string(session->accountId) + ", '" +
-                session->remoteAddress() + "', " +
-                "'Anti-cheat violation', 'SYSTEM', DATE_ADD(NOW(), INTERVAL 24 HOUR))"
-            );
+            // Takes effect on the next accept without waiting for a reload
+            BanManager::instance().banIP(session->remoteAddress(), "Anti-cheat violation", "SYSTEM", 24 * 60);
+            BanManager::instance().banAccount(session->accountId, "Anti-cheat violation", "SYSTEM", 24 * 60);
             
-            db.execute(
-                "UPDATE accounts SET is_banned = 1, ban_reason = 'Anti-cheat violation', "
-                "ban_expires_at = DATE_ADD(NOW(), INTERVAL 24 HOUR) "
-                "WHERE id = " + std::to_string(session->accountId)
-            );
+            Database::instance().executeAsync(session->executor(),
+                "UPDATE accounts SET is_banned = 1, ban_reason = ?, "
+                "ban_expires_at = DATE_ADD(NOW(), INTERVAL 24 HOUR) WHERE id = ?",
+                {"Anti-cheat violation", session->accountId});
             
             session->send(PacketBuilder::displayMessage(u"MSG_BANNED_CHEAT", 2));
-            session->stop();
-            
-            db.execute(
-                "UPDATE anticheat_logs SET action_taken = 'temp_ban' "
-                "WHERE character_id = " + std::to_string(session->characterId) + 
-                " ORDER BY id DESC LIMIT 1"
-            );
+            session->kick();
             break;
-            
+        
         default:
             break;
     }
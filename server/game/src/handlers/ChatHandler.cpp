@@ -9,7 +9,7 @@
 
 namespace knc {
 
-void ChatHandler::handleChatMessage(Session::Ptr session, Packet& packet, GameServer* server) {
+void ChatHandler::handleChatMessage(const Session::Ptr& session, PacketView& packet, GameServer* server) {
     // Read chat message structure (~116 bytes)
     // int32 senderId, wchar_t[42] message, int32[7] unknowns, int32 channel
     
@@ -52,14 +52,14 @@ void ChatHandler::handleChatMessage(Session::Ptr session, Packet& packet, GameSe
         chatPkt.writeInt32(channel);
         
         // Broadcast to all lobby sessions
-        auto data = chatPkt.serialize();
+        auto data = Session::makeShared(chatPkt);
         for (auto& sess : server->getLobbySessions()) {
             if (sess) sess->send(data);
         }
     }
 }
 
-void ChatHandler::handleWhisper(Session::Ptr session, Packet& packet, GameServer* server) {
+void ChatHandler::handleWhisper(const Session::Ptr& session, PacketView& packet, GameServer* server) {
     // Private message - Format: targetName (wstring) + message (wstring)
     std::u16string targetName = packet.readWString();
     std::u16string message = packet.readWString();
@@ -91,7 +91,7 @@ void ChatHandler::handleWhisper(Session::Ptr session, Packet& packet, GameServer
     }
 }
 
-void ChatHandler::sendChatMessage(Session::Ptr target, uint32_t senderId,
+void ChatHandler::sendChatMessage(const Session::Ptr& target, uint32_t senderId,
                                    const std::u16string& message, uint8_t channel) {
     Packet pkt(CMD::S_CHAT_MESSAGE);
     pkt.writeUInt32(senderId);
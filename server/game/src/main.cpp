@@ -7,10 +7,13 @@
 #include "logging/Logger.h"
 #include "config/IniConfig.h"
 #include "db/Database.h"
-#include "net/Packet.h"
-#include <asio.hpp>
+#include "security/BanManager.h"
+#include "security/RateLimiter.h"
+#include <cstdio>
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <algorithm>
 
 // Check all required tables exist
 bool checkDatabaseHealth(knc::Database& db) {
@@ -48,66 +51,90 @@ bool checkDatabaseHealth(knc::Database& db) {
     return allOk;
 }
 
-// Register this GameServer with the LoginServer
-bool registerWithLoginServer(const knc::IniConfig& config) {
-    std::string loginHost = config.getString("LoginServer.host", "127.0.0.1");
-    int loginPort = config.getInt("LoginServer.port", 50017);
-    std::string key = config.getString("LoginServer.key", "knc_internal_key_2025");
-    
-    int serverId = config.getInt("Server.id", 1);
-    std::string name = config.getString("Server.name", "KnC Server");
-    std::string host = config.getString("Server.host", "127.0.0.1");
-    int port = config.getInt("Server.port", 50018);
-    int maxPlayers = config.getInt("Server.max_players", 100);
-    int serverType = config.getInt("Server.type", 0);
+// "rate,burst" per second (burst defaults to two seconds worth)
+knc::RateLimiter::Budget parseBudget(const std::string& text, knc::RateLimiter::Budget fallback) {
+    int rate = 0, burst = 0;
+    int n = std::sscanf(text.c_str(), "%d,%d", &rate, &burst);
+    if (n < 1 || rate < 0) return fallback;
+    return knc::RateLimiter::Budget{static_cast<uint32_t>(rate),
+                                    static_cast<uint32_t>(n == 2 && burst > 0 ? burst : rate * 2)};
+}
+
+// Packet budgets, per opcode as RateLimit.op_XX (hex)
+knc::RateLimiter::Config rateLimitConfig(const knc::IniConfig& config) {
+    knc::RateLimiter::Config limits;
+    limits.enabled = config.getBool("RateLimit.enabled", true);
+    limits.total = parseBudget(config.getString("RateLimit.total"), limits.total);
+    limits.opcode.fill(parseBudget(config.getString("RateLimit.default"), limits.opcode[0]));
+    for (int cmd = 0; cmd < 256; ++cmd) {
+        char key[32];
+        std::snprintf(key, sizeof(key), "RateLimit.op_%02X", cmd);
+        limits.opcode[cmd] = parseBudget(config.getString(key), limits.opcode[cmd]);
+    }
+    limits.maxDropsPerSec = static_cast<uint32_t>(std::max(0, config.getInt("RateLimit.max_drops_per_s", 200)));
+    return limits;
+}
+
+// Accept-stage throttling per IP and /24 (/64 for IPv6)
+knc::AdmissionControl::Config admissionConfig(const knc::IniConfig& config) {
+    knc::AdmissionControl::Config admission;
+    admission.enabled = config.getBool("Admission.enabled", true);
+    admission.maxPerIp = static_cast<uint32_t>(std::max(0, config.getInt("Admission.max_per_ip", 8)));
+    admission.maxPerSubnet = static_cast<uint32_t>(std::max(0, config.getInt("Admission.max_per_subnet", 32)));
+    admission.ipRate = parseBudget(config.getString("Admission.ip_rate"), admission.ipRate);
+    admission.subnetRate = parseBudget(config.getString("Admission.subnet_rate"), admission.subnetRate);
+    admission.maxPending = static_cast<uint32_t>(std::max(0, config.getInt("Admission.max_pending", 256)));
+    admission.handshakeTimeout = std::chrono::milliseconds(
+        std::max(1000, config.getInt("Admission.handshake_timeout_ms", 10000)));
+    return admission;
+}
+
+// Track collision meshes for the position checks: [Tracks] game_dir is the
+// client install with the PAKs, map_<id> the folder holding that map's track.COL
+void loadTrackCollision(knc::GameServer& server, const knc::IniConfig& config) {
+    std::string gameDir = config.getString("Tracks.game_dir", "");
+    if (gameDir.empty()) {
+        LOG_INFO("MAIN", "Tracks.game_dir not set: no track geometry checks");
+        return;
+    }
+    if (!knc::CollisionMesh::openGameData(gameDir)) {
+        LOG_WARN("MAIN", "Can't open the game PAKs in " + gameDir + ": no track geometry checks");
+        return;
+    }
     
-    LOG_INFO("MAIN", "Registering with LoginServer " + loginHost + ":" + std::to_string(loginPort));
+    // Vertical axis of track.COL (docs/formats/FILE_FORMATS.md 7.1): z or y
+    std::string up = config.getString("Tracks.up_axis", "z");
+    int upAxis = (up == "y" || up == "Y") ? knc::CollisionMesh::AXIS_Y : knc::CollisionMesh::AXIS_Z;
     
-    try {
-        asio::io_context io;
-        asio::ip::tcp::socket socket(io);
-        asio::ip::tcp::resolver resolver(io);
-        
-        auto endpoints = resolver.resolve(loginHost, std::to_string(loginPort));
-        asio::connect(socket, endpoints);
-        
-        // Build registration packet
-        knc::Packet pkt(knc::CMD::I_SERVER_REGISTER);
-        pkt.writeString(key);
-        pkt.writeInt32(serverId);
-        pkt.writeString(name);
-        pkt.writeString(host);
-        pkt.writeInt32(port);
-        pkt.writeInt32(maxPlayers);
-        pkt.writeInt32(serverType);
-        
-        auto data = pkt.serialize();
-        asio::write(socket, asio::buffer(data));
-        
-        // Read response
-        uint8_t respHeader[8];
-        asio::read(socket, asio::buffer(respHeader, 8));
-        
-        uint16_t respSize = *reinterpret_cast<uint16_t*>(respHeader);
-        if (respSize > 0) {
-            std::vector<uint8_t> respData(respSize);
-            asio::read(socket, asio::buffer(respData));
-            
-            if (respData[0] == 1) {
-                LOG_INFO("MAIN", "Successfully registered with LoginServer");
-                socket.close();
-                return true;
-            }
+    int loaded = 0, failed = 0;
+    for (int mapId = 0; mapId < 256; ++mapId) {
+        std::string mapDir = config.getString("Tracks.map_" + std::to_string(mapId), "");
+        if (mapDir.empty()) continue;
+        if (auto mesh = knc::CollisionMesh::loadFromPak(mapDir, upAxis)) {
+            server.setTrackCollision(static_cast<uint8_t>(mapId), std::move(mesh));
+            ++loaded;
+        } else {
+            ++failed;
         }
-        
-        LOG_ERROR("MAIN", "LoginServer rejected registration");
-        socket.close();
-        return false;
-        
-    } catch (const std::exception& e) {
-        LOG_ERROR("MAIN", "Failed to register with LoginServer: " + std::string(e.what()));
-        return false;
     }
+    LOG_INFO("MAIN", "Track collision: " + std::to_string(loaded) + " maps loaded, " +
+             std::to_string(failed) + " failed (" + (upAxis == knc::CollisionMesh::AXIS_Y ? "Y" : "Z") + " up)");
+}
+
+// LoginServer link: registration + session handoffs
+knc::LoginLink::Config loginLinkConfig(const knc::IniConfig& config) {
+    knc::LoginLink::Config link;
+    link.loginHost = config.getString("LoginServer.host", "127.0.0.1");
+    link.loginPort = config.getInt("LoginServer.port", 50017);
+    link.key = config.getString("LoginServer.key", "knc_internal_key_2025");
+    
+    link.serverId = config.getInt("Server.id", 1);
+    link.name = config.getString("Server.name", "KnC Server");
+    link.host = config.getString("Server.host", "127.0.0.1");
+    link.port = config.getInt("Server.port", 50018);
+    link.maxPlayers = config.getInt("Server.max_players", 100);
+    link.serverType = config.getInt("Server.type", 0);
+    return link;
 }
 
 int main(int argc, char* argv[]) {
@@ -136,11 +163,40 @@ int main(int argc, char* argv[]) {
     else if (logLevel == "WARN") level = knc::LogLevel::LVL_WARN;
     else if (logLevel == "ERROR") level = knc::LogLevel::LVL_ERROR;
     
-    knc::Logger::instance().init(logFile, level);
+    // Async backend: per-thread rings drained by a writer thread
+    knc::AsyncLogConfig logBackend;
+    logBackend.enabled = config.getBool("Logging.async", true);
+    logBackend.ringSlots = static_cast<size_t>(std::max(16, config.getInt("Logging.ring_slots", 1024)));
+    logBackend.flushIntervalMs = config.getInt("Logging.flush_ms", 50);
+    logBackend.maxFileSize = static_cast<size_t>(std::max(1, config.getInt("Logging.max_file_mb", 10))) * 1024 * 1024;
+    // "binary": compact records for tools/log_decoder, the console keeps WARN and above
+    logBackend.binary = config.getString("Logging.format", "text") == "binary";
+    // Records below this level are dropped (and counted) when a thread's ring is full
+    std::string dropBelow = config.getString("Logging.drop_below", "WARN");
+    if (dropBelow == "DEBUG") logBackend.dropBelow = knc::LogLevel::LVL_DEBUG;
+    else if (dropBelow == "INFO") logBackend.dropBelow = knc::LogLevel::LVL_INFO;
+    else if (dropBelow == "ERROR") logBackend.dropBelow = knc::LogLevel::LVL_ERROR;
+    
+    knc::Logger::instance().init(logFile, level, logBackend);
+    
+    // Before the first accept: sessions read the budgets without locking
+    knc::RateLimiter::configure(rateLimitConfig(config));
     
     std::string serverName = config.getString("Server.name", "KnC Server");
     int port = config.getInt("Server.port", 50018);
     
+    // 0 = one I/O thread per hardware core
+    int ioThreads = config.getInt("Server.io_threads", 1);
+    if (ioThreads <= 0) {
+        ioThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    int roomWorkers = config.getInt("Server.room_workers", 1);
+    if (roomWorkers <= 0) {
+        roomWorkers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    // Position snapshot rate of racing rooms, clamped to 10-30 Hz
+    int snapshotHz = config.getInt("Server.snapshot_hz", knc::GameConst::TICK_RATE);
+    
     LOG_INFO("MAIN", "=== " + serverName + " Starting ===");
     
     // Initialize database
@@ -150,7 +206,19 @@ int main(int argc, char* argv[]) {
     dbConfig.database = config.getString("Database.name", "knc_emu");
     dbConfig.user = config.getString("Database.user", "knc");
     dbConfig.password = config.getString("Database.password", "knc_password");
-    dbConfig.poolSize = 5;
+    dbConfig.workerThreads = std::max(1, config.getInt("Database.workers", 4));
+    dbConfig.statementCacheSize = config.getInt("Database.statement_cache", 64);
+    // Session handlers, anti-cheat and ban writes go through the DB workers; the
+    // pool covers all of them plus the character flush thread and shrinks back when idle
+    dbConfig.poolMin = config.getInt("Database.pool_min", 5);
+    dbConfig.poolMax = config.getInt("Database.pool_max",
+                                     std::max(dbConfig.poolMin, dbConfig.workerThreads + 1));
+    dbConfig.acquireTimeoutMs = config.getInt("Database.acquire_timeout_ms", 2000);
+    dbConfig.validateIdleMs = config.getInt("Database.validate_idle_ms", 30000);
+    dbConfig.idleTimeoutMs = config.getInt("Database.idle_timeout_ms", 300000);
+    dbConfig.statsIntervalSec = config.getInt("Database.stats_interval_s", 300);
+    // Character changes are written behind, batched every flush interval
+    int flushIntervalMs = config.getInt("Database.flush_interval_ms", 5000);
     
     LOG_INFO("MAIN", "Connecting to database " + dbConfig.host + ":" + std::to_string(dbConfig.port) + "/" + dbConfig.database);
     
@@ -165,14 +233,23 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    // Register with LoginServer
-    if (!registerWithLoginServer(config)) {
-        LOG_WARN("MAIN", "Running without LoginServer registration - server won't appear in list");
-    }
+    // Active bans into memory; expired ones are dropped on a timer from here on
+    knc::BanManager::instance().loadFromDB();
     
     try {
-        knc::GameServer server(port);
-        LOG_INFO("MAIN", serverName + " listening on port " + std::to_string(port));
+        knc::GameServer server(port, ioThreads, roomWorkers, snapshotHz, flushIntervalMs);
+        
+        // Registers in the background and retries while the LoginServer is down;
+        // pushed handoffs wait this long for their client to connect
+        int handoffTtl = config.getInt("LoginServer.handoff_ttl_s", 30);
+        server.connectLoginServer(loginLinkConfig(config), std::chrono::seconds(handoffTtl));
+        server.setAdmission(admissionConfig(config));
+        loadTrackCollision(server, config);
+        // Dropped players keep their room slot and state this long (0 = leave immediately)
+        server.setResumeGrace(std::chrono::seconds(std::max(0, config.getInt("Server.resume_grace_s", 30))));
+        LOG_INFO("MAIN", serverName + " listening on port " + std::to_string(port) +
+                 " (" + std::to_string(ioThreads) + " I/O threads, " +
+                 std::to_string(roomWorkers) + " room workers)");
         server.run();
     } catch (const std::exception& e) {
         LOG_ERROR("MAIN", std::string("Fatal error: ") + e.what());
@@ -180,7 +257,10 @@ int main(int argc, char* argv[]) {
     }
     
     // Cleanup
+    knc::BanManager::instance().saveToDB();
+    knc::BanManager::instance().shutdown();
     knc::Database::instance().shutdown();
+    knc::Logger::instance().shutdown();
     
     return 0;
 }
@@ -665,18 +665,27 @@ void WebServer::setupRoutes() {
                          "FROM ghost_records g "
                          "LEFT JOIN characters c ON g.character_id = c.id "
                          "LEFT JOIN maps m ON g.map_id = m.id ";
+        DBParams params;
         
         if (mapId > 0) {
-            sql += "WHERE g.map_id = " + std::to_string(mapId) + " ";
+            sql += "WHERE g.map_id = ? ";
+            params.emplace_back(mapId);
         }
         
-        sql += "ORDER BY g.time ASC LIMIT " + std::to_string(limit);
+        sql += "ORDER BY g.time ASC LIMIT ?";
+        params.emplace_back(limit);
         
-        auto results = Database::instance().query(sql);
+        auto results = Database::instance().queryStmt(sql, params);
+        const int idCol = results.column("id");
+        const int timeCol = results.column("time");
+        const int playerCol = results.column("player_name");
+        const int mapCol = results.column("map_name");
+        const int validCol = results.column("is_valid");
+        const int createdCol = results.column("created_at");
         
         json ghosts = json::array();
-        for (auto& row : results) {
-            int timeMs = std::stoi(row["time"]);
+        for (const auto& row : results) {
+            int timeMs = row.getInt32(timeCol);
             int minutes = timeMs / 60000;
             int seconds = (timeMs % 60000) / 1000;
             int ms = timeMs % 1000;
@@ -684,13 +693,13 @@ void WebServer::setupRoutes() {
             snprintf(timeStr, sizeof(timeStr), "%d:%02d.%03d", minutes, seconds, ms);
             
             ghosts.push_back({
-                {"id", std::stoi(row["id"])},
-                {"player_name", row["player_name"]},
-                {"map_name", row["map_name"]},
+                {"id", row.getInt32(idCol)},
+                {"player_name", row.getString(playerCol)},
+                {"map_name", row.getString(mapCol)},
                 {"time_ms", timeMs},
                 {"time_formatted", std::string(timeStr)},
-                {"is_valid", row["is_valid"] == "1"},
-                {"created_at", row["created_at"]}
+                {"is_valid", row.getBool(validCol)},
+                {"created_at", row.getString(createdCol)}
             });
         }
         
@@ -940,24 +949,34 @@ void WebServer::setupRoutes() {
                          "a.username, ROUND(c.wins * 100.0 / NULLIF(c.wins + c.losses, 0), 1) as winrate "
                          "FROM characters c "
                          "JOIN accounts a ON c.account_id = a.id "
-                         "ORDER BY " + sortBy + " DESC LIMIT " + std::to_string(limit);
-        
-        auto results = Database::instance().query(sql);
+                         "ORDER BY " + sortBy + " DESC LIMIT ?";
+        
+        // sortBy is one of four columns: at most four cached statements
+        auto results = Database::instance().queryStmt(sql, {limit});
+        const int idCol = results.column("id");
+        const int nameCol = results.column("name");
+        const int accountCol = results.column("username");
+        const int levelCol = results.column("level");
+        const int goldCol = results.column("gold");
+        const int winsCol = results.column("wins");
+        const int lossesCol = results.column("losses");
+        const int racesCol = results.column("total_races");
+        const int winrateCol = results.column("winrate");
         
         json players = json::array();
         int rank = 1;
-        for (auto& row : results) {
+        for (const auto& row : results) {
             players.push_back({
                 {"rank", rank++},
-                {"id", std::stoi(row["id"])},
-                {"name", row["name"]},
-                {"account", row["username"]},
-                {"level", std::stoi(row["level"])},
-                {"gold", std::stoi(row["gold"])},
-                {"wins", std::stoi(row["wins"])},
-                {"losses", std::stoi(row["losses"])},
-                {"total_races", std::stoi(row["total_races"])},
-                {"winrate", row["winrate"].empty() ? "0" : row["winrate"]}
+                {"id", row.getInt32(idCol)},
+                {"name", row.getString(nameCol)},
+                {"account", row.getString(accountCol)},
+                {"level", row.getInt32(levelCol)},
+                {"gold", row.getInt32(goldCol)},
+                {"wins", row.getInt32(winsCol)},
+                {"losses", row.getInt32(lossesCol)},
+                {"total_races", row.getInt32(racesCol)},
+                {"winrate", row.isNull(winrateCol) ? "0" : row.getString(winrateCol)}
             });
         }
         
@@ -45,7 +45,9 @@ int main(int argc, char* argv[]) {
     dbConfig.database = config.get<std::string>("database.name", "knc_emu");
     dbConfig.user = config.get<std::string>("database.user", "knc");
     dbConfig.password = config.get<std::string>("database.password", "knc_password");
-    dbConfig.poolSize = config.get("database.pool_size", 3);
+    dbConfig.poolMin = config.get("database.pool_size", 3);
+    dbConfig.poolMax = config.get("database.pool_max", dbConfig.poolMin * 2);
+    dbConfig.acquireTimeoutMs = config.get("database.acquire_timeout_ms", 2000);
     
     LOG_INFO("MAIN", "Connecting to database...");
     if (!knc::Database::instance().init(dbConfig)) {
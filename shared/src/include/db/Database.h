@@ -1,14 +1,45 @@
 /**
  * @file Database.h
- * @brief MariaDB connection pool
+ * @brief MariaDB connection pool and asynchronous executor
+ *
+ * The blocking calls (query, execute...) are for startup code and for the DB
+ * workers themselves. Network and room threads go through queryAsync /
+ * executeAsync / runAsync: the work runs on a dedicated DB worker thread and
+ * the completion is posted back to the caller's executor (usually the session
+ * strand), so a slow MariaDB round-trip never stalls packet processing.
+ *
+ * queryStmt / executeStmt use server-side prepared statements: parameters are
+ * bound with their type (no escaping, no string building), each connection
+ * keeps its prepared statements keyed by SQL text so a hot query is parsed
+ * once per connection, and results come back as a typed, columnar ResultSet.
+ * query() / queryPrepared() and their vector<map> rows are kept for older callers.
+ *
+ * The pool is elastic: it keeps poolMin connections open, grows up to poolMax
+ * when every connection is busy, and a caller that still finds none waits up
+ * to acquireTimeoutMs instead of failing at once. A connection is pinged only
+ * when it sat idle for validateIdleMs or its last statement lost the server.
+ * A maintenance thread reconnects broken slots, closes connections idle past
+ * idleTimeoutMs (down to poolMin) and logs wait/utilization stats.
  */
 
 #pragma once
+#include "db/ResultSet.h"
+#include <asio.hpp>
 #include <string>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <atomic>
 #include <map>
+#include <unordered_map>
+#include <variant>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
 
 #ifdef KNC_HAS_MARIADB
 #include <mysql.h>
@@ -22,16 +53,60 @@ struct DBConfig {
     std::string database = "knc_emu";
     std::string user = "knc";
     std::string password = "knc_password";
-    int poolSize = 5;
+    int poolMin = 5;                // connections kept open
+    int poolMax = 20;               // upper bound when every connection is busy
+    int acquireTimeoutMs = 2000;    // how long a query waits for a free connection
+    int validateIdleMs = 30000;     // ping before use after this much idle time
+    int idleTimeoutMs = 300000;     // close connections above poolMin idle this long
+    int statsIntervalSec = 300;     // pool stats in the log, 0 = off
+    int workerThreads = 4;  // DB worker threads serving the async calls
+    int statementCacheSize = 64;  // prepared statements kept per connection
+};
+
+using DBBlob = std::vector<uint8_t>;
+
+// One typed statement parameter
+struct DBValue {
+    std::variant<std::nullptr_t, int64_t, double, std::string, DBBlob> value;
+    
+    DBValue() : value(nullptr) {}
+    DBValue(std::nullptr_t) : value(nullptr) {}
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>>>
+    DBValue(T v) : value(static_cast<int64_t>(v)) {}
+    DBValue(double v) : value(v) {}
+    DBValue(const char* v) : value(std::string(v ? v : "")) {}
+    DBValue(std::string v) : value(std::move(v)) {}
+    DBValue(std::string_view v) : value(std::string(v)) {}
+    DBValue(DBBlob v) : value(std::move(v)) {}
+};
+
+using DBParams = std::vector<DBValue>;
+
+// Snapshot of the connection pool
+struct DBPoolStats {
+    int open = 0;               // connections (idle + in use + connecting)
+    int idle = 0;
+    int inUse = 0;
+    int broken = 0;             // waiting for the background reconnect
+    int waiting = 0;            // callers blocked on a free connection
+    uint64_t acquires = 0;
+    uint64_t waits = 0;         // acquires that had to block
+    uint64_t timeouts = 0;      // acquires that gave up
+    uint64_t totalWaitUs = 0;
+    uint64_t maxWaitUs = 0;
+    uint64_t reconnects = 0;
 };
 
 class Database {
 public:
+    using Row = std::map<std::string, std::string>;
+    using Rows = std::vector<Row>;
+    
     static Database& instance() {
         static Database inst;
         return inst;
     }
-
+    
     bool init(const DBConfig& config);
     void shutdown();
     
@@ -58,17 +133,109 @@ public:
         const std::string& sql, 
         const std::vector<std::string>& params
     );
+    
+    // =========================================================================
+    // PREPARED STATEMENTS - Typed binding, cached per connection
+    // =========================================================================
+    
+    // Example: queryStmt("SELECT level FROM characters WHERE id = ?", {characterId})
+    ResultSet queryStmt(const std::string& sql, const DBParams& params = {});
+    
+    // Affected rows, -1 on error
+    int64_t executeStmt(const std::string& sql, const DBParams& params = {});
+    
+    // Same statement once per parameter set, in one transaction on one connection
+    // (all or nothing); false on error
+    bool executeBatch(const std::string& sql, const std::vector<DBParams>& rows);
+    
+    // =========================================================================
+    // ASYNC METHODS - Never block the calling thread
+    // =========================================================================
+    
+    // queryStmt on a DB worker, done(result) is posted to executor
+    void queryAsync(const asio::any_io_executor& executor, std::string sql,
+                    DBParams params, std::function<void(ResultSet)> done);
+    
+    // executeStmt on a DB worker, done(success) is posted to executor (if given)
+    void executeAsync(const asio::any_io_executor& executor, std::string sql,
+                      DBParams params, std::function<void(bool)> done = nullptr);
+    
+    // Several dependent statements in one trip: work(db) runs on a DB worker with the
+    // blocking API, done(result) is posted to executor
+    template <typename Work, typename Done>
+    void runAsync(const asio::any_io_executor& executor, Work work, Done done) {
+        post([this, executor, work = std::move(work), done = std::move(done)]() mutable {
+            auto result = work(*this);
+            asio::post(executor, [done = std::move(done), result = std::move(result)]() mutable {
+                done(std::move(result));
+            });
+        });
+    }
+    
+    // Fire and forget: work(db) runs on a DB worker, nothing is posted back
+    void runAsync(std::function<void(Database&)> work);
+    
+    // Jobs waiting for a DB worker
+    size_t pendingJobs();
+    
+    DBPoolStats poolStats();
 
 private:
     Database() = default;
     ~Database() { shutdown(); }
     
+    // Queue a job for the workers (runs inline when no worker is running)
+    void post(std::function<void()> job);
+    void startWorkers(int count);
+    void stopWorkers();
+    void workerLoop();
+    
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_jobsMutex;
+    std::condition_variable m_jobsCv;
+    bool m_stopping = false;
+    
 #ifdef KNC_HAS_MARIADB
-    MYSQL* getConnection();
-    void releaseConnection(MYSQL* conn);
-    std::queue<MYSQL*> m_pool;
-#endif
+    using Clock = std::chrono::steady_clock;
+    
+    // A pooled connection with the statements prepared on it
+    struct Connection {
+        MYSQL* mysql = nullptr;
+        std::unordered_map<std::string, MYSQL_STMT*> statements;
+        Clock::time_point lastUsed;
+        bool suspect = false;  // last statement lost the server: ping before reuse
+    };
+    
+    // Free connection, waiting up to acquireTimeoutMs; nullptr on timeout
+    Connection* getConnection();
+    void releaseConnection(Connection* conn);
+    MYSQL* connect();
+    void closeStatements(Connection* conn);
+    void closeConnection(Connection* conn);
+    // Ping a connection that was idle long or suspect, reconnect if needed
+    bool validate(Connection* conn);
     
+    void maintenanceLoop();
+    void logPoolStats();
+    
+    // Cached statement for sql on conn (prepared on first use), nullptr on error
+    MYSQL_STMT* statement(Connection* conn, const std::string& sql);
+    // Bind, execute and (for SELECT) fetch; false on error
+    bool runStatement(Connection* conn, const std::string& sql, const DBParams& params,
+                      ResultSet* result, int64_t* affected);
+    
+    std::vector<Connection*> m_idle;    // most recently used at the back
+    std::vector<Connection*> m_broken;  // lost their server, reconnected in the background
+    std::condition_variable m_poolCv;   // a connection was released / a slot freed
+    std::condition_variable m_maintenanceCv;
+    std::thread m_maintenance;
+    int m_open = 0;
+    int m_waiting = 0;
+    bool m_poolStopping = false;
+    DBPoolStats m_stats;
+#endif
+
     std::mutex m_mutex;
     DBConfig m_config;
     bool m_initialized = false;
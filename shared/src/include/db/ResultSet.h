@@ -0,0 +1,138 @@
+/**
+ * @file ResultSet.h
+ * @brief Typed, columnar result of a database query
+ *
+ * Column names are stored once per result and every cell lives in one flat
+ * array (row-major, 16 bytes per cell); text and blob bytes go to a single
+ * shared buffer. A 50-row leaderboard is three allocations instead of a
+ * std::map plus a string per column per row.
+ *
+ *   auto chars = db.queryStmt("SELECT id, name, level FROM characters WHERE account_id = ?", {accountId});
+ *   const int level = chars.column("level");       // resolve once
+ *   for (const auto& row : chars) {
+ *       int32_t lvl = row.getInt32(level);
+ *       std::string_view name = row.getText("name");  // by name: one lookup per call
+ *   }
+ *
+ * Accessors convert where it makes sense (integer <-> double, numeric text
+ * -> number, anything -> text); NULL or an unknown column gives the fallback.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace knc {
+
+class ResultSet {
+    struct Cell;
+
+public:
+    enum class Type : uint8_t { Null, Int, Double, Text, Blob };
+    
+    class Row {
+    public:
+        Row(const ResultSet* set, size_t index) : m_set(set), m_index(index) {}
+        
+        size_t index() const { return m_index; }
+        
+        Type type(int col) const { return cell(col) ? cell(col)->type : Type::Null; }
+        bool isNull(int col) const { return type(col) == Type::Null; }
+        
+        int64_t getInt64(int col, int64_t fallback = 0) const;
+        int32_t getInt32(int col, int32_t fallback = 0) const { return static_cast<int32_t>(getInt64(col, fallback)); }
+        bool getBool(int col) const { return getInt64(col, 0) != 0; }
+        double getDouble(int col, double fallback = 0.0) const;
+        // Text and blob bytes, valid as long as the ResultSet; numbers give ""
+        std::string_view getText(int col) const;
+        // Any value as text ("" for NULL)
+        std::string getString(int col) const;
+        
+        // Same by column name (one lookup per call)
+        int64_t getInt64(std::string_view name, int64_t fallback = 0) const { return getInt64(m_set->column(name), fallback); }
+        int32_t getInt32(std::string_view name, int32_t fallback = 0) const { return getInt32(m_set->column(name), fallback); }
+        bool getBool(std::string_view name) const { return getBool(m_set->column(name)); }
+        double getDouble(std::string_view name, double fallback = 0.0) const { return getDouble(m_set->column(name), fallback); }
+        std::string_view getText(std::string_view name) const { return getText(m_set->column(name)); }
+        std::string getString(std::string_view name) const { return getString(m_set->column(name)); }
+        bool isNull(std::string_view name) const { return isNull(m_set->column(name)); }
+    
+    private:
+        const Cell* cell(int col) const;
+        
+        const ResultSet* m_set;
+        size_t m_index;
+    };
+    
+    class Iterator {
+    public:
+        Iterator(const ResultSet* set, size_t index) : m_set(set), m_index(index) {}
+        
+        Row operator*() const { return Row(m_set, m_index); }
+        Iterator& operator++() { ++m_index; return *this; }
+        bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+        bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+    
+    private:
+        const ResultSet* m_set;
+        size_t m_index;
+    };
+    
+    // =========================================================================
+    // READING
+    // =========================================================================
+    
+    size_t size() const { return m_rows; }
+    bool empty() const { return m_rows == 0; }
+    size_t columnCount() const { return m_columns.size(); }
+    const std::vector<std::string>& columns() const { return m_columns; }
+    
+    // Index of a column, -1 if the query has no such column
+    int column(std::string_view name) const;
+    
+    Row operator[](size_t row) const { return Row(this, row); }
+    Row front() const { return Row(this, 0); }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, m_rows); }
+    
+    // Old row format, for callers still on query()/queryPrepared()
+    std::vector<std::map<std::string, std::string>> toMaps() const;
+    
+    // =========================================================================
+    // BUILDING (Database fills results row by row, cell by cell)
+    // =========================================================================
+    
+    void setColumns(std::vector<std::string> names);
+    void reserveRows(size_t rows);
+    void addRow() { ++m_rows; }
+    void addNull();
+    void addInt(int64_t value);
+    void addDouble(double value);
+    void addText(std::string_view value);
+    void addBlob(const void* data, size_t len);
+
+private:
+    struct Cell {
+        Type type = Type::Null;
+        uint32_t length = 0;     // Text / Blob bytes
+        union {
+            int64_t i;
+            double d;
+            uint64_t offset;     // Text / Blob start in m_bytes
+        };
+        Cell() : i(0) {}
+    };
+    
+    void addBytes(Type type, const void* data, size_t len);
+    
+    std::vector<std::string> m_columns;
+    std::vector<Cell> m_cells;   // m_rows * columnCount(), row-major
+    std::string m_bytes;
+    size_t m_rows = 0;
+};
+
+} // namespace knc
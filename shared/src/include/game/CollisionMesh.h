@@ -0,0 +1,107 @@
+/**
+ * @file CollisionMesh.h
+ * @brief Track collision mesh (track.COL) with a BVH for position queries
+ *
+ * Loads the collision triangles and zones of a track (format in
+ * docs/formats/FILE_FORMATS.md, section 7) and builds a bounding volume
+ * hierarchy over the triangles, split with the surface area heuristic
+ * (binned). Queries walk the tree and only test triangles in the leaves
+ * they reach, so a position check costs microseconds on tracks with tens
+ * of thousands of triangles:
+ * - nearestSurface: distance from a point to the closest triangle
+ * - raycast / groundBelow: first triangle hit along a ray
+ * - zoneAt: START / BOOST / ITEM... zone containing a point
+ *
+ * The up axis is a load parameter (Z by default, see FILE_FORMATS.md 7.1):
+ * groundBelow, zoneAt and wall/floor tests go through upAxis() / up().
+ *
+ * Immutable once loaded: share one mesh per track between rooms and
+ * threads without locking.
+ */
+
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace knc {
+
+class CollisionMesh {
+public:
+    struct Vec3 {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+    };
+    
+    struct Hit {
+        float distance = 0.0f;
+        Vec3 point;
+        Vec3 normal;            // Unit length, facing the ray origin
+        uint32_t triangle = 0;
+    };
+    
+    struct Zone {
+        std::string name;       // "START", "BOOST", "ITEM"...
+        Vec3 corners[4];        // The 12 floats of the record, read as 4 points
+        Vec3 min, max;          // Bounds of the corners
+    };
+    
+    // Vertical axis of the track data
+    static constexpr int AXIS_Y = 1;
+    static constexpr int AXIS_Z = 2;
+    
+    // Parse a track.COL image; null (and a warning) if it is malformed
+    static std::shared_ptr<const CollisionMesh> load(const uint8_t* data, size_t size, const std::string& name,
+                                                     int upAxis = AXIS_Z);
+    
+    // <mapDir>/track.COL from the game PAKs, e.g. "Data/Public/World/Forest/Forest01".
+    // openGameData() scans the PAK files once, before the first loadFromPak
+    static bool openGameData(const std::string& gameDir);
+    static std::shared_ptr<const CollisionMesh> loadFromPak(const std::string& mapDir, int upAxis = AXIS_Z);
+    
+    // Distance to the closest point on any triangle, +inf if none is within maxDistance
+    float nearestSurface(const Vec3& p, float maxDistance = std::numeric_limits<float>::max()) const;
+    
+    // First triangle hit from origin along dir (any length) within maxDistance
+    bool raycast(const Vec3& origin, const Vec3& dir, float maxDistance, Hit* hit = nullptr) const;
+    // Straight down from p (against the up axis)
+    bool groundBelow(const Vec3& p, float maxDrop, Hit* hit = nullptr) const;
+    
+    // Zone whose bounds contain p (zones are flat: `height` above/below counts as inside)
+    const Zone* zoneAt(const Vec3& p, float height = 5.0f) const;
+    
+    int upAxis() const { return m_upAxis; }
+    // Component of v along the up axis (height of a point, verticality of a normal)
+    float up(const Vec3& v) const { return m_upAxis == AXIS_Y ? v.y : v.z; }
+    
+    const std::string& name() const { return m_name; }
+    size_t triangleCount() const { return m_triangles.size(); }
+    const std::vector<Zone>& zones() const { return m_zones; }
+    Vec3 boundsMin() const;
+    Vec3 boundsMax() const;
+
+private:
+    struct Triangle {
+        Vec3 a, b, c;
+    };
+    
+    // Inner node: children at first and first + 1. Leaf: count triangles from first
+    struct Node {
+        Vec3 min, max;
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+    
+    void build();
+    // Returns the number of leaves cut short by the depth limit
+    uint32_t split(uint32_t nodeIndex, uint32_t depth, std::vector<uint32_t>& order, std::vector<Vec3>& centroids);
+    
+    std::string m_name;
+    int m_upAxis = AXIS_Z;
+    std::vector<Triangle> m_triangles;   // Reordered so every leaf is one contiguous range
+    std::vector<Node> m_nodes;           // Root at 0
+    std::vector<Zone> m_zones;
+};
+
+} // namespace knc
@@ -9,6 +9,8 @@
 #include <memory>
 #include <cstdint>
 #include <unordered_map>
+#include <atomic>
+#include "net/MovementCodec.h"
 
 namespace knc {
 
@@ -55,6 +57,26 @@ struct RoomPlayer {
     int32_t driverId = 1;         // Driver/skin ID
 };
 
+// Latest movement sample of a player. Overwritten by every C_POSITION and only
+// sent on the room snapshot tick, so intermediate samples are simply dropped.
+struct PositionSample {
+    int32_t characterId = 0;
+    float x = 0, y = 0, z = 0, rot = 0;
+    bool dirty = false;       // Changed since the last snapshot
+    bool announced = false;   // POSITION_ADD already sent for this race
+};
+
+// Compact movement codec state between the room and one X_COMPACT_MOVE client
+struct MovementChannel {
+    MovementEncoder down;     // Other karts -> this client
+    MovementDecoder up{1};    // This client's own kart, nothing else accepted
+    bool capsSent = false;    // Quantizer of the current race sent
+    bool ackPending = false;  // Uplink seq to acknowledge on the next tick
+};
+
+// A room is owned by a single room worker thread (see RoomWorkerPool): everything
+// below is only touched from that thread, except state()/playerCount()/isFull()/
+// isEmpty() which are atomics so the lobby room list can read them from I/O threads.
 class Room {
 public:
     Room(uint32_t id, const RoomSettings& settings);
@@ -62,7 +84,7 @@ public:
     // Info
     uint32_t id() const { return m_id; }
     const std::string& name() const { return m_settings.name; }
-    RoomState state() const { return m_state; }
+    RoomState state() const { return m_state.load(std::memory_order_relaxed); }
     const RoomSettings& settings() const { return m_settings; }
     RoomSettings& settings() { return m_settings; }
     
@@ -71,9 +93,12 @@ public:
                    const std::u16string& name, int32_t vehicleTemplateId);
     bool addPlayer(std::shared_ptr<Session> session);  // Legacy compatibility
     void removePlayer(uint32_t sessionId);
-    size_t playerCount() const { return m_sessions.size(); }
-    bool isFull() const { return m_sessions.size() >= m_settings.maxPlayers; }
-    bool isEmpty() const { return m_sessions.empty(); }
+    // A resumed player's new connection takes over the slot, ready state and
+    // host role of the old one (see GameServer session resumption)
+    bool rebindSession(uint32_t oldSessionId, std::shared_ptr<Session> session);
+    size_t playerCount() const { return m_playerCount.load(std::memory_order_relaxed); }
+    bool isFull() const { return playerCount() >= m_settings.maxPlayers; }
+    bool isEmpty() const { return playerCount() == 0; }
     
     // Player lookup
     RoomPlayer* getPlayer(uint32_t sessionId);
@@ -103,8 +128,12 @@ public:
     // State
     void setState(RoomState state);
     bool canStart() const;
-    bool isPlaying() const { return m_state == RoomState::Racing || m_state == RoomState::Loading; }
-    bool isWaiting() const { return m_state == RoomState::Waiting; }
+    bool isPlaying() const { return state() == RoomState::Racing || state() == RoomState::Loading; }
+    bool isWaiting() const { return state() == RoomState::Waiting; }
+    
+    // Owning room worker index, fixed at creation
+    int worker() const { return m_worker; }
+    void setWorker(int worker) { m_worker = worker; }
     
     // Broadcast
     void broadcast(const class Packet& packet);
@@ -112,15 +141,36 @@ public:
     
     // Get sessions
     const std::vector<std::shared_ptr<Session>>& sessions() const { return m_sessions; }
+    
+    // Snapshot state (sessionId -> latest sample)
+    void updatePosition(uint32_t sessionId, int32_t characterId, float x, float y, float z, float rot);
+    std::unordered_map<uint32_t, PositionSample>& positions() { return m_positions; }
+    void clearPositions();
+    // Payload of the last POSITION_LIST sent, to only resend standings when they change
+    std::vector<uint8_t>& lastStandings() { return m_lastStandings; }
+    
+    // Compact movement: race quantizer (origin = track bounds, or the first valid sample
+    // of the race when the track is not loaded) and per-client codecs
+    const MovementQuantizer& quantizer() const { return m_quantizer; }
+    bool hasQuantizer() const { return m_hasQuantizer; }
+    void initQuantizer(float x, float y, float z);
+    MovementChannel& movementChannel(uint32_t sessionId) { return m_moveChannels[sessionId]; }
 
 private:
     uint32_t m_id;
     RoomSettings m_settings;
-    RoomState m_state = RoomState::Waiting;
+    std::atomic<RoomState> m_state{RoomState::Waiting};
+    std::atomic<size_t> m_playerCount{0};
+    int m_worker = 0;
     uint32_t m_hostSessionId = 0;
     
     std::vector<std::shared_ptr<Session>> m_sessions;
     std::unordered_map<uint32_t, RoomPlayer> m_players;  // sessionId -> RoomPlayer
+    std::unordered_map<uint32_t, PositionSample> m_positions;
+    std::vector<uint8_t> m_lastStandings;
+    MovementQuantizer m_quantizer;
+    bool m_hasQuantizer = false;
+    std::unordered_map<uint32_t, MovementChannel> m_moveChannels;
 };
 
 } // namespace knc
@@ -0,0 +1,60 @@
+/**
+ * @file BinaryLog.h
+ * @brief On-disk layout of binary log files (Logging.format = binary)
+ *
+ * The server writes records as they sit in the log rings, unformatted; the
+ * log_decoder tool turns them back into text or JSON lines. All integers are
+ * little-endian.
+ *
+ *   FileHeader
+ *   then a stream of frames, each starting with a one-byte Tag:
+ *
+ *   CATEGORY  [tag][id:u16][len:u8][name]             before the first record using id
+ *   FORMAT    [tag][id:u16][len:u16][format string]   before the first record using id
+ *   RECORD    RecordHeader + payload
+ *
+ * A record with formatId 0 carries its message as plain text; any other id
+ * carries LogFormat.h encoded arguments for that format string. Definitions
+ * are repeated in every file, so each rotated file decodes on its own.
+ */
+
+#pragma once
+#include <cstdint>
+
+namespace knc {
+namespace binlog {
+
+constexpr char MAGIC[8] = {'K', 'N', 'C', 'B', 'L', 'O', 'G', '\0'};
+constexpr uint32_t VERSION = 1;
+
+enum Tag : uint8_t {
+    TAG_CATEGORY = 1,
+    TAG_FORMAT = 2,
+    TAG_RECORD = 3,
+};
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    int64_t wallMs;   // system clock (ms since epoch) ...
+    int64_t monoNs;   // ... at this steady clock value: wall = wallMs + (t - monoNs) / 1e6
+};
+
+struct RecordHeader {
+    uint8_t tag;          // TAG_RECORD
+    uint8_t level;        // LogLevel
+    uint16_t categoryId;
+    uint16_t formatId;    // 0 = text payload
+    uint32_t sessionId;   // 0 = not logged on behalf of a session
+    int64_t monoNs;
+    uint16_t length;      // payload bytes that follow
+};
+#pragma pack(pop)
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader layout");
+static_assert(sizeof(RecordHeader) == 20, "RecordHeader layout");
+
+} // namespace binlog
+} // namespace knc
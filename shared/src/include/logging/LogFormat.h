@@ -0,0 +1,232 @@
+/**
+ * @file LogFormat.h
+ * @brief Minimal {}-style formatting for the LOG_*F macros
+ *
+ * C++17 has no std::format and the servers don't pull in fmt, so this covers
+ * what log lines actually use:
+ *
+ *   {}       any supported argument
+ *   {:x}     integer in hex ({:X} upper case)
+ *   {:02X}   zero padded to a width
+ *   {{ }}    literal braces
+ *
+ * Supported arguments: integers, enums (as their value), floating point,
+ * bool, char, const char*, std::string and std::string_view. Arguments are
+ * only referenced until format() returns, nothing is copied.
+ *
+ * encodeArgs() / formatEncoded() split the same thing in two: the producer
+ * stores the raw arguments ([type][value]...), whoever writes the line (the
+ * log writer thread, or the offline decoder for binary logs) formats them.
+ */
+
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace knc {
+namespace logfmt {
+
+struct Spec {
+    int base = 10;
+    bool upper = false;
+    char fill = ' ';
+    int width = 0;
+};
+
+namespace detail {
+    
+    inline void pad(std::string& out, size_t len, const Spec& spec) {
+        if (spec.width > 0 && len < static_cast<size_t>(spec.width)) {
+            out.append(spec.width - len, spec.fill);
+        }
+    }
+    
+    template <typename T>
+    void appendInt(std::string& out, T value, const Spec& spec) {
+        char buf[72];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value, spec.base);
+        size_t len = static_cast<size_t>(res.ptr - buf);
+        if (spec.upper) {
+            for (size_t i = 0; i < len; ++i) {
+                if (buf[i] >= 'a' && buf[i] <= 'f') buf[i] = static_cast<char>(buf[i] - 'a' + 'A');
+            }
+        }
+        pad(out, len, spec);
+        out.append(buf, len);
+    }
+    
+    inline void appendText(std::string& out, std::string_view text, const Spec& spec) {
+        pad(out, text.size(), spec);
+        out.append(text.data(), text.size());
+    }
+    
+    template <typename T>
+    void append(std::string& out, const void* arg, const Spec& spec) {
+        const T& value = *static_cast<const T*>(arg);
+        if constexpr (std::is_same_v<T, bool>) {
+            appendText(out, value ? "true" : "false", spec);
+        } else if constexpr (std::is_same_v<T, char>) {
+            appendText(out, std::string_view(&value, 1), spec);
+        } else if constexpr (std::is_enum_v<T>) {
+            appendInt(out, static_cast<std::underlying_type_t<T>>(value), spec);
+        } else if constexpr (std::is_integral_v<T>) {
+            // Bytes print as numbers, not characters
+            if constexpr (sizeof(T) == 1) appendInt(out, static_cast<int>(value), spec);
+            else appendInt(out, value, spec);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            char buf[32];
+            int len = std::snprintf(buf, sizeof(buf), "%g", static_cast<double>(value));
+            appendText(out, std::string_view(buf, len > 0 ? static_cast<size_t>(len) : 0), spec);
+        } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+            appendText(out, value ? std::string_view(value) : std::string_view("(null)"), spec);
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            appendText(out, std::string_view(value), spec);
+        } else {
+            static_assert(sizeof(T) == 0, "Type not supported by logfmt");
+        }
+    }
+    
+    // Type-erased reference to one argument
+    struct Arg {
+        const void* value;
+        void (*append)(std::string&, const void*, const Spec&);
+    };
+    
+    template <typename T>
+    Arg makeArg(const T& value) {
+        if constexpr (std::is_array_v<T>) {
+            static_assert(std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>, "Only char arrays");
+            // String literals decay to a pointer we can point at
+            return Arg{&value, [](std::string& out, const void* arg, const Spec& spec) {
+                appendText(out, std::string_view(static_cast<const char*>(arg)), spec);
+            }};
+        } else {
+            return Arg{&value, &append<T>};
+        }
+    }
+    
+    // Parse the part between ':' and '}' ("x", "X", "02X", "8")
+    inline Spec parseSpec(std::string_view text) {
+        Spec spec;
+        size_t i = 0;
+        if (i < text.size() && text[i] == '0') {
+            spec.fill = '0';
+            ++i;
+        }
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+            spec.width = spec.width * 10 + (text[i] - '0');
+            ++i;
+        }
+        if (i < text.size()) {
+            if (text[i] == 'x') spec.base = 16;
+            else if (text[i] == 'X') { spec.base = 16; spec.upper = true; }
+            else if (text[i] == 'b') spec.base = 2;
+        }
+        return spec;
+    }
+    
+    void vformat(std::string& out, std::string_view fmt, const Arg* args, size_t count);
+
+} // namespace detail
+
+// Append the formatted text to out; missing arguments print as "{?}", extra ones are ignored
+template <typename... Args>
+void formatTo(std::string& out, std::string_view fmt, const Args&... args) {
+    if constexpr (sizeof...(Args) == 0) {
+        detail::vformat(out, fmt, nullptr, 0);
+    } else {
+        const detail::Arg list[] = { detail::makeArg(args)... };
+        detail::vformat(out, fmt, list, sizeof...(Args));
+    }
+}
+
+template <typename... Args>
+std::string format(std::string_view fmt, const Args&... args) {
+    std::string out;
+    out.reserve(fmt.size() + 16 * sizeof...(Args));
+    formatTo(out, fmt, args...);
+    return out;
+}
+
+// =============================================================================
+// ENCODED ARGUMENTS
+// =============================================================================
+
+enum class ArgType : uint8_t { Int = 1, UInt, Float, String, Bool, Char };
+
+// Most arguments formatEncoded() looks at; more print as "{?}"
+constexpr size_t MAX_ENCODED_ARGS = 16;
+
+namespace detail {
+    
+    inline bool put(uint8_t*& p, const uint8_t* end, const void* data, size_t len) {
+        if (static_cast<size_t>(end - p) < len) return false;
+        std::memcpy(p, data, len);
+        p += len;
+        return true;
+    }
+    
+    inline bool putTagged(uint8_t*& p, const uint8_t* end, ArgType type, const void* data, size_t len) {
+        uint8_t tag = static_cast<uint8_t>(type);
+        return put(p, end, &tag, 1) && put(p, end, data, len);
+    }
+    
+    inline bool putString(uint8_t*& p, const uint8_t* end, std::string_view text) {
+        if (text.size() > 0xFFFF) text = text.substr(0, 0xFFFF);
+        uint16_t len = static_cast<uint16_t>(text.size());
+        return putTagged(p, end, ArgType::String, &len, 2) && put(p, end, text.data(), text.size());
+    }
+    
+    template <typename T>
+    bool encodeOne(uint8_t*& p, const uint8_t* end, const T& value) {
+        if constexpr (std::is_array_v<T>) {
+            return putString(p, end, std::string_view(value));
+        } else if constexpr (std::is_same_v<T, bool>) {
+            uint8_t v = value ? 1 : 0;
+            return putTagged(p, end, ArgType::Bool, &v, 1);
+        } else if constexpr (std::is_same_v<T, char>) {
+            return putTagged(p, end, ArgType::Char, &value, 1);
+        } else if constexpr (std::is_enum_v<T>) {
+            int64_t v = static_cast<int64_t>(value);
+            return putTagged(p, end, ArgType::Int, &v, 8);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            int64_t v = value;
+            return putTagged(p, end, ArgType::Int, &v, 8);
+        } else if constexpr (std::is_integral_v<T>) {
+            uint64_t v = value;
+            return putTagged(p, end, ArgType::UInt, &v, 8);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            double v = static_cast<double>(value);
+            return putTagged(p, end, ArgType::Float, &v, 8);
+        } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+            return putString(p, end, value ? std::string_view(value) : std::string_view("(null)"));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            return putString(p, end, std::string_view(value));
+        } else {
+            static_assert(sizeof(T) == 0, "Type not supported by logfmt");
+            return false;
+        }
+    }
+
+} // namespace detail
+
+// Serialize args into out; false if they don't fit in cap bytes
+template <typename... Args>
+bool encodeArgs(uint8_t* out, size_t cap, size_t& len, const Args&... args) {
+    uint8_t* p = out;
+    [[maybe_unused]] const uint8_t* end = out + cap;
+    bool ok = (detail::encodeOne(p, end, args) && ...);
+    len = static_cast<size_t>(p - out);
+    return ok;
+}
+
+// Format fmt with arguments read back from an encodeArgs() blob
+void formatEncoded(std::string& out, std::string_view fmt, const uint8_t* args, size_t len);
+
+} // namespace logfmt
+} // namespace knc
@@ -1,27 +1,109 @@
 /**
  * @file Logger.h
- * @brief Thread-safe logging with file rotation
+ * @brief Asynchronous logging with file rotation
+ *
+ * Once init() has run, log() only copies the record into a ring owned by the
+ * calling thread (single producer, no lock) and returns. A writer thread
+ * drains every ring in batches: records are ordered by time, formatted once,
+ * written with one file write + one flush per batch, and the file is rotated
+ * on a running byte count.
+ *
+ * When a thread's ring is full, records below AsyncLogConfig::dropBelow are
+ * dropped and counted (the writer reports the count in the log), the others
+ * wait for the writer to make room. Before init(), after shutdown() and
+ * for messages too long for a ring slot, log() writes synchronously.
+ *
+ * LOG_*F records keep their arguments unformatted in the ring (format id +
+ * encoded values); the writer formats them, or with AsyncLogConfig::binary
+ * writes them to the file as they are (BinaryLog.h) for tools/log_decoder.
  */
 
 #pragma once
+#include "LogFormat.h"
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <array>
+#include <unordered_map>
 #include <chrono>
+#include <atomic>
 
 namespace knc {
 
 enum class LogLevel { LVL_DEBUG, LVL_INFO, LVL_WARN, LVL_ERROR };
 
+// Backend tuning ([Logging] section of the server config)
+struct AsyncLogConfig {
+    bool enabled = true;
+    size_t ringSlots = 1024;                  // records per producer thread (power of two)
+    LogLevel dropBelow = LogLevel::LVL_WARN;  // full ring: drop records below this level, the rest wait
+    int flushIntervalMs = 50;                 // writer wake-up period when idle
+    size_t maxFileSize = 10 * 1024 * 1024;    // rotate after this many bytes
+    bool binary = false;                      // file gets binary records (console keeps WARN and above)
+};
+
 class Logger {
 public:
+    // Records longer than this are written synchronously instead of queued
+    static constexpr size_t MAX_MESSAGE = 400;
+    static constexpr size_t MAX_CATEGORY = 15;
+    // Distinct LOG_*F call sites; later ones are formatted on the calling thread
+    static constexpr size_t MAX_FORMATS = 4096;
+    
     static Logger& instance() {
         static Logger inst;
         return inst;
     }
-
-    void init(const std::string& filepath, LogLevel minLevel = LogLevel::LVL_INFO);
-    void log(LogLevel level, const std::string& category, const std::string& message);
+    
+    void init(const std::string& filepath, LogLevel minLevel = LogLevel::LVL_INFO,
+              const AsyncLogConfig& async = AsyncLogConfig());
+    // Drain every ring and stop the writer; later records are written synchronously
+    void shutdown();
+    
+    void log(LogLevel level, std::string_view category, std::string_view message);
+    // Cheap check so hot paths can skip building messages that would be dropped
+    bool enabled(LogLevel level) const { return level >= m_minLevel.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel level) { m_minLevel.store(level, std::memory_order_relaxed); }
+    
+    // Records dropped because their thread's ring was full
+    uint64_t droppedRecords() const { return m_dropped.load(std::memory_order_relaxed); }
+    
+    // Id of a LOG_*F format string (must be a literal: only the pointer is kept), 0 if the table is full
+    uint16_t registerFormat(const char* fmt);
+    
+    // {}-style message (see LogFormat.h). With a format id the arguments are queued
+    // raw and formatted by the writer, otherwise formatted here in a per-thread buffer.
+    template <typename... Args>
+    void logf(LogLevel level, uint16_t formatId, const char* category, std::string_view fmt, const Args&... args) {
+        if (!enabled(level)) return;
+        if (formatId != 0 && m_running.load(std::memory_order_acquire)) {
+            if constexpr (sizeof...(Args) == 0) {
+                if (logEncoded(level, category, formatId, nullptr, 0)) return;
+            } else {
+                uint8_t encoded[MAX_MESSAGE];
+                size_t len = 0;
+                if (logfmt::encodeArgs(encoded, sizeof(encoded), len, args...) &&
+                    logEncoded(level, category, formatId, encoded, len)) {
+                    return;
+                }
+            }
+        }
+        thread_local std::string t_message;
+        t_message.clear();
+        logfmt::formatTo(t_message, fmt, args...);
+        log(level, category, t_message);
+    }
+    
+    // Session id stamped on records logged by this thread (see LogSessionScope)
+    static uint32_t& threadSession() {
+        thread_local uint32_t t_session = 0;
+        return t_session;
+    }
     
     void debug(const std::string& cat, const std::string& msg) { log(LogLevel::LVL_DEBUG, cat, msg); }
     void info(const std::string& cat, const std::string& msg)  { log(LogLevel::LVL_INFO, cat, msg); }
@@ -29,23 +111,129 @@ public:
     void error(const std::string& cat, const std::string& msg) { log(LogLevel::LVL_ERROR, cat, msg); }
 
 private:
-    Logger() = default;
+    struct Record;
+    struct Ring;
+    
+    // One record on its way out, from a ring slot or a synchronous caller
+    struct Entry {
+        int64_t monoNs;
+        uint32_t sessionId;
+        uint16_t formatId;
+        LogLevel level;
+        std::string_view category;
+        std::string_view payload;  // text, or encoded arguments when formatId != 0
+    };
+    
+    Logger();
+    ~Logger();
+    
+    Ring* threadRing();
+    bool logEncoded(LogLevel level, std::string_view category, uint16_t formatId, const uint8_t* args, size_t len);
+    bool enqueue(Ring& ring, LogLevel level, std::string_view category, uint16_t formatId,
+                 const void* payload, size_t len);
+    void wakeWriter();
+    void writerLoop();
+    // Pop everything queued so far and write it; returns false when nothing was queued
+    bool drainRings();
+    // Output helpers, caller holds m_mutex
+    void emit(const Entry& entry);
+    void formatLine(int64_t timeMs, LogLevel level, std::string_view category, std::string_view message);
+    void writeBinary(const Entry& entry);
+    void writeBinaryHeader();
+    void writeOut();
+    void rotate();
+    int64_t wallMs(int64_t monoNs) const { return m_anchorWallMs + (monoNs - m_anchorMonoNs) / 1000000; }
+    size_t formatTimestamp(int64_t timeMs, char* out);
+    static const char* levelToString(LogLevel level);
+    
+    std::atomic<LogLevel> m_minLevel{LogLevel::LVL_INFO};
+    AsyncLogConfig m_config;
+    // Wall clock at the time m_anchorMonoNs was read; records only carry the steady clock
+    int64_t m_anchorWallMs = 0;
+    int64_t m_anchorMonoNs = 0;
+    
+    // LOG_*F format strings by id (0 unused)
+    std::mutex m_formatsMutex;
+    std::array<std::atomic<const char*>, MAX_FORMATS> m_formats{};
+    size_t m_formatCount = 0;
+    
+    // Output side, guarded by m_mutex (writer thread, or synchronous callers)
     std::mutex m_mutex;
     std::ofstream m_file;
-    LogLevel m_minLevel = LogLevel::LVL_INFO;
-    size_t m_maxFileSize = 10 * 1024 * 1024; // 10MB
     std::string m_filepath;
+    size_t m_fileBytes = 0;
+    std::string m_fileBuf;
+    std::string m_consoleBuf;
+    int64_t m_cachedSecond = -1;
+    char m_cachedTime[24] = {};
+    uint64_t m_droppedReported = 0;
+    std::string m_messageScratch;
+    std::string m_lineScratch;
+    // Binary sink: category ids, and which ids the current file already defines
+    std::unordered_map<std::string, uint16_t> m_categoryIds;
+    std::vector<bool> m_categoryDefined;
+    std::vector<bool> m_formatDefined;
     
-    void rotateIfNeeded();
-    std::string levelToString(LogLevel level);
-    std::string timestamp();
+    // Producer rings, registered on a thread's first record
+    std::mutex m_ringsMutex;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+    std::vector<std::shared_ptr<Ring>> m_writerRings;  // writer-side copy
+    std::vector<size_t> m_writerEnds;
+    std::vector<const Record*> m_batch;
+    
+    std::thread m_writer;
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_wakePending{false};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCv;
+    std::atomic<uint64_t> m_dropped{0};
 };
 
 // Convenience macros
-#define LOG_DEBUG(cat, msg) knc::Logger::instance().debug(cat, msg)
-#define LOG_INFO(cat, msg)  knc::Logger::instance().info(cat, msg)
-#define LOG_WARN(cat, msg)  knc::Logger::instance().warn(cat, msg)
-#define LOG_ERROR(cat, msg) knc::Logger::instance().error(cat, msg)
+// The level is checked before the message expression is evaluated, so disabled
+// levels cost one relaxed load: no string building, no remoteAddress() lookups.
+#define KNC_LOG_AT(level, cat, msg) \
+    do { \
+        knc::Logger& knc_logger_ = knc::Logger::instance(); \
+        if (knc_logger_.enabled(level)) knc_logger_.log(level, cat, msg); \
+    } while (0)
+
+#define LOG_DEBUG(cat, msg) KNC_LOG_AT(knc::LogLevel::LVL_DEBUG, cat, msg)
+#define LOG_INFO(cat, msg)  KNC_LOG_AT(knc::LogLevel::LVL_INFO, cat, msg)
+#define LOG_WARN(cat, msg)  KNC_LOG_AT(knc::LogLevel::LVL_WARN, cat, msg)
+#define LOG_ERROR(cat, msg) KNC_LOG_AT(knc::LogLevel::LVL_ERROR, cat, msg)
+
+// Deferred formatting: LOG_DEBUGF("GAME", "RECV CMD=0x{:02X} from {}", cmd, addr)
+// Arguments are only evaluated when the level is enabled. The format must be a
+// string literal: each call site registers it once and the record carries the
+// raw arguments, formatting happens on the writer thread.
+#define KNC_LOGF_AT(level, cat, fmt, ...) \
+    do { \
+        knc::Logger& knc_logger_ = knc::Logger::instance(); \
+        if (knc_logger_.enabled(level)) { \
+            static const uint16_t knc_format_id_ = knc_logger_.registerFormat(fmt); \
+            knc_logger_.logf(level, knc_format_id_, cat, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUGF(cat, fmt, ...) KNC_LOGF_AT(knc::LogLevel::LVL_DEBUG, cat, fmt, ##__VA_ARGS__)
+#define LOG_INFOF(cat, fmt, ...)  KNC_LOGF_AT(knc::LogLevel::LVL_INFO, cat, fmt, ##__VA_ARGS__)
+#define LOG_WARNF(cat, fmt, ...)  KNC_LOGF_AT(knc::LogLevel::LVL_WARN, cat, fmt, ##__VA_ARGS__)
+#define LOG_ERRORF(cat, fmt, ...) KNC_LOGF_AT(knc::LogLevel::LVL_ERROR, cat, fmt, ##__VA_ARGS__)
+
+// Tags every record logged on this thread with a session id until the scope ends
+class LogSessionScope {
+public:
+    explicit LogSessionScope(uint32_t sessionId) : m_previous(Logger::threadSession()) {
+        Logger::threadSession() = sessionId;
+    }
+    ~LogSessionScope() { Logger::threadSession() = m_previous; }
+    LogSessionScope(const LogSessionScope&) = delete;
+    LogSessionScope& operator=(const LogSessionScope&) = delete;
+
+private:
+    uint32_t m_previous;
+};
 
 // Print a styled server header
 void PrintServerHeader(const char* serverName, const char* version = "1.0");
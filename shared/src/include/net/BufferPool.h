@@ -0,0 +1,40 @@
+/**
+ * @file BufferPool.h
+ * @brief Per-thread recycling of packet payloads and serialized frames
+ *
+ * Steady-state traffic (positions, drift/boost, snapshots) builds and drops
+ * the same small buffers over and over. Instead of returning them to the
+ * heap, each thread keeps a bounded free list of byte vectors (capacity is
+ * kept, contents are not) and a ring of shared frames that are reused once
+ * every Session holding them has finished writing.
+ *
+ * Buffers may be released on another thread than the one that acquired them,
+ * they simply join that thread's free list.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace knc {
+
+class BufferPool {
+public:
+    // Free vectors kept per thread, and the largest capacity worth keeping
+    static constexpr size_t MAX_FREE = 64;
+    static constexpr size_t MAX_POOLED_CAPACITY = 64 * 1024;
+    // Shared frames recycled per thread
+    static constexpr size_t SHARED_SLOTS = 64;
+    
+    // Empty vector with at least sizeHint capacity (recycled when possible)
+    static std::vector<uint8_t> acquire(size_t sizeHint = 0);
+    // Give a vector back; oversized or surplus buffers are freed
+    static void release(std::vector<uint8_t>&& buffer);
+    
+    // Empty frame for Session::send, reused once no session references it any more
+    static std::shared_ptr<std::vector<uint8_t>> acquireShared(size_t sizeHint = 0);
+};
+
+} // namespace knc
@@ -0,0 +1,144 @@
+/**
+ * @file DispatchTable.h
+ * @brief Opcode -> handler table with per-opcode limits and counters
+ *
+ * Two levels indexed directly by the header bytes: one entry per CMD, plus
+ * an optional 256-entry page per CMD for opcodes whose flag byte is a
+ * sub-command (X_COMPACT_MOVE, CMD > 255). A lookup is two array loads, no
+ * hashing and no switch.
+ *
+ * Each entry carries the handler, a name for logs, payload size bounds,
+ * the handshake states it is accepted in (bit mask) and relaxed atomic
+ * counters, so every registered opcode gets traffic stats for free.
+ *
+ * Handler is whatever the owner calls: a plain function pointer on the
+ * server hot path, std::function on the client.
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace knc {
+
+template <typename Handler>
+class DispatchTable {
+public:
+    static constexpr uint32_t ANY_STATE = 0xFFFFFFFFu;
+    
+    // Acceptance rules of one opcode
+    struct Rule {
+        uint16_t minSize = 0;
+        uint16_t maxSize = 0xFFFF;
+        uint32_t states = ANY_STATE;  // bit (1 << state) per allowed handshake state
+    };
+    
+    struct Stats {
+        std::atomic<uint64_t> packets{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> rejected{0};
+    };
+    
+    struct Entry {
+        Handler handler{};
+        const char* name = nullptr;
+        Rule rule;
+        mutable Stats stats;
+        uint16_t cmdFull = 0;
+        bool perFlag = false;  // registered for one flag only
+        
+        bool registered() const { return name != nullptr; }
+    };
+    
+    enum class Verdict { Ok, Unknown, BadSize, BadState };
+    
+    DispatchTable() {
+        for (size_t cmd = 0; cmd < 256; ++cmd) {
+            m_byCmd[cmd].cmdFull = static_cast<uint16_t>(cmd);
+        }
+    }
+    
+    // Handler for cmd whatever the flag byte is
+    Entry& on(uint8_t cmd, const char* name, Handler handler, Rule rule = {}) {
+        return assign(m_byCmd[cmd], cmd, false, name, std::move(handler), rule);
+    }
+    
+    // Handler for one cmd + flag pair; wins over the cmd-wide entry
+    Entry& onFull(uint16_t cmdFull, const char* name, Handler handler, Rule rule = {}) {
+        uint8_t cmd = cmdFull & 0xFF;
+        uint8_t flag = (cmdFull >> 8) & 0xFF;
+        if (!m_byFlag[cmd]) {
+            m_byFlag[cmd] = std::make_unique<std::array<Entry, 256>>();
+        }
+        return assign((*m_byFlag[cmd])[flag], cmdFull, true, name, std::move(handler), rule);
+    }
+    
+    // Registered entry for a received header, nullptr if none
+    const Entry* find(uint8_t cmd, uint8_t flag) const {
+        if (const auto& page = m_byFlag[cmd]) {
+            const Entry& entry = (*page)[flag];
+            if (entry.registered()) return &entry;
+        }
+        const Entry& entry = m_byCmd[cmd];
+        return entry.registered() ? &entry : nullptr;
+    }
+    
+    const Entry* find(uint16_t cmdFull) const {
+        return find(static_cast<uint8_t>(cmdFull & 0xFF), static_cast<uint8_t>(cmdFull >> 8));
+    }
+    
+    // Apply the entry's rules and count the packet (accepted or not)
+    Verdict check(const Entry* entry, size_t payloadSize, uint32_t stateBit = ANY_STATE) const {
+        if (!entry) {
+            m_unknown.fetch_add(1, std::memory_order_relaxed);
+            return Verdict::Unknown;
+        }
+        Verdict verdict = Verdict::Ok;
+        if (payloadSize < entry->rule.minSize || payloadSize > entry->rule.maxSize) {
+            verdict = Verdict::BadSize;
+        } else if (!(entry->rule.states & stateBit)) {
+            verdict = Verdict::BadState;
+        }
+        if (verdict != Verdict::Ok) {
+            entry->stats.rejected.fetch_add(1, std::memory_order_relaxed);
+            return verdict;
+        }
+        entry->stats.packets.fetch_add(1, std::memory_order_relaxed);
+        entry->stats.bytes.fetch_add(payloadSize, std::memory_order_relaxed);
+        return Verdict::Ok;
+    }
+    
+    // Visit every registered entry (stats dumps)
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t cmd = 0; cmd < 256; ++cmd) {
+            if (m_byCmd[cmd].registered()) fn(m_byCmd[cmd]);
+            if (const auto& page = m_byFlag[cmd]) {
+                for (const Entry& entry : *page) {
+                    if (entry.registered()) fn(entry);
+                }
+            }
+        }
+    }
+    
+    uint64_t unknownCount() const { return m_unknown.load(std::memory_order_relaxed); }
+
+private:
+    Entry& assign(Entry& entry, uint16_t cmdFull, bool perFlag, const char* name, Handler handler, Rule rule) {
+        entry.handler = std::move(handler);
+        entry.name = name;
+        entry.rule = rule;
+        entry.cmdFull = cmdFull;
+        entry.perFlag = perFlag;
+        return entry;
+    }
+    
+    std::array<Entry, 256> m_byCmd;
+    std::array<std::unique_ptr<std::array<Entry, 256>>, 256> m_byFlag;
+    mutable std::atomic<uint64_t> m_unknown{0};
+};
+
+} // namespace knc
@@ -0,0 +1,112 @@
+/**
+ * @file MovementCodec.h
+ * @brief Compact kart movement encoding (custom client <-> server only)
+ *
+ * Positions are quantized to a fixed-point grid relative to a track origin,
+ * rotation to 16 bits. Each snapshot is sent as zigzag varint deltas
+ * against the last snapshot the peer acknowledged (or against zero when
+ * there is none), so a kart that barely moved costs a few bytes instead of
+ * the 24-byte legacy 0x31 frame.
+ *
+ * Payload of X_COMPACT_MOVE / MOVE_DATA:
+ *   [seq:u8][base:u8]          base == seq -> no baseline (full snapshot)
+ *   [count:varuint]
+ *   count * [entityId:varuint][mask:u8][dx][dy][dz][drot]   (zigzag varints, only fields set in mask)
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace knc {
+
+// Negotiated by the X_COMPACT_MOVE caps exchange
+constexpr uint8_t MOVEMENT_CODEC_VERSION = 1;
+
+// Fixed-point grid: world = origin + q * step
+struct MovementQuantizer {
+    float originX = 0.0f;
+    float originY = 0.0f;
+    float originZ = 0.0f;
+    float step = 1.0f / 32.0f;
+    
+    int32_t quantize(float value, float origin) const;
+    float dequantize(int32_t q, float origin) const;
+    
+    // Radians, wrapped to [0, 2pi)
+    static uint16_t quantizeAngle(float rad);
+    static float dequantizeAngle(uint16_t q);
+};
+
+// Quantized state of one kart
+struct MoveState {
+    uint32_t entityId = 0;
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t z = 0;
+    uint16_t rot = 0;
+};
+
+namespace varint {
+    void writeU32(std::vector<uint8_t>& out, uint32_t value);
+    void writeS32(std::vector<uint8_t>& out, int32_t value);
+    bool readU32(const uint8_t*& p, const uint8_t* end, uint32_t& value);
+    bool readS32(const uint8_t*& p, const uint8_t* end, int32_t& value);
+}
+
+class MovementEncoder {
+public:
+    static constexpr size_t HISTORY = 32;
+    
+    // Append the payload for the current set of states (delta vs last acked snapshot).
+    // Returns the number of entries written; 0 means nothing changed since the baseline.
+    // History and scratch storage is reused, so steady-state encoding does not allocate.
+    size_t encode(const std::vector<MoveState>& states, std::vector<uint8_t>& out);
+    
+    // Peer decoded snapshot seq - it becomes the baseline for the next ones
+    void acknowledge(uint8_t seq);
+    void reset();
+
+private:
+    struct Snapshot {
+        uint8_t seq = 0;
+        bool valid = false;
+        std::vector<MoveState> states;  // sorted by entityId
+    };
+    
+    const Snapshot* baseline() const;
+    
+    std::array<Snapshot, HISTORY> m_history;
+    std::vector<MoveState> m_sorted;  // scratch, swapped into the history slot
+    std::vector<uint8_t> m_body;      // scratch, entries before the count is known
+    uint8_t m_nextSeq = 0;
+    int m_ackedSeq = -1;
+};
+
+class MovementDecoder {
+public:
+    // Upper bound for a room's karts; the payload comes from the peer, so a
+    // frame that would hold more entities than this is rejected
+    static constexpr size_t MAX_ENTITIES = 64;
+    
+    explicit MovementDecoder(size_t maxEntities = MAX_ENTITIES) : m_maxEntities(maxEntities) { reset(); }
+    
+    // Decode a MOVE_DATA payload into the full current state set (sorted by entityId).
+    // False on a corrupt frame, an unknown baseline or more than maxEntities entities.
+    bool decode(const uint8_t* data, size_t len, std::vector<MoveState>& out);
+    
+    // Last successfully decoded seq (to acknowledge), -1 before the first one
+    int lastSeq() const { return m_lastSeq; }
+    void reset();
+
+private:
+    std::array<std::vector<MoveState>, MovementEncoder::HISTORY> m_history;
+    std::array<int, MovementEncoder::HISTORY> m_historySeq{};
+    std::vector<MoveState> m_scratch;  // swapped into the history slot
+    size_t m_maxEntities;
+    int m_lastSeq = -1;
+};
+
+} // namespace knc
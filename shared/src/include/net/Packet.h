@@ -4,6 +4,10 @@
  * 
  * Packet format:
  * [Size:2][CMD:1][Flag:1][Reserved:4][Payload:N]
+ *
+ * Payload storage comes from the per-thread BufferPool and goes back to it
+ * when the packet is destroyed, so building packets in steady state does
+ * not touch the heap.
  */
 
 #pragma once
@@ -17,18 +21,29 @@ namespace knc {
 
 class Packet {
 public:
-    Packet() = default;
+    Packet();
     Packet(uint8_t cmd, uint8_t flag = 0);
+    ~Packet();
+    
+    Packet(const Packet& other);
+    Packet(Packet&& other) noexcept = default;
+    Packet& operator=(const Packet& other);
+    Packet& operator=(Packet&& other) noexcept;
     
     // Factory for CMD > 255 (avoids ambiguity with Packet(uint8_t, uint8_t))
     static Packet fromCmdFull(uint16_t cmdFull);
     
+    // Owning copy of an already split header + payload (used by PacketView::copy)
+    static Packet fromRaw(const PacketHeader& header, const uint8_t* payload, size_t len);
+    
     // Parsing
     static std::optional<Packet> parse(const uint8_t* data, size_t len);
     static size_t peekSize(const uint8_t* data, size_t len);
     
     // Serialization
     std::vector<uint8_t> serialize() const;
+    // Append [header][payload] to out (coalesced frames, pooled send buffers)
+    void appendTo(std::vector<uint8_t>& out) const;
     
     // Header access
     uint8_t cmd() const { return m_header.cmd; }
@@ -36,11 +51,15 @@ public:
     uint16_t cmdFull() const { return m_header.cmd | (m_header.flag << 8); }  // Full 16-bit CMD
     uint16_t payloadSize() const { return m_header.size; }
     size_t totalSize() const { return PACKET_HEADER_SIZE + m_payload.size(); }
+    const PacketHeader& header() const { return m_header; }
     
     // Payload access
     const std::vector<uint8_t>& payload() const { return m_payload; }
     std::vector<uint8_t>& payload() { return m_payload; }
     
+    // Size hint for builders that know their payload length up front
+    Packet& reserve(size_t payloadSize);
+    
     // Payload builders
     Packet& writeInt8(int8_t val);
     Packet& writeUInt8(uint8_t val);
@@ -52,6 +71,8 @@ public:
     Packet& writeBytes(const uint8_t* data, size_t len);
     Packet& writeString(const std::string& str);
     Packet& writeWString(const std::u16string& str);
+    // Grow the payload by len bytes and return where they start (schema encoders write in place)
+    uint8_t* appendRaw(size_t len);
     
     // Payload readers (with position tracking)
     int8_t readInt8();
@@ -70,6 +91,9 @@ public:
     size_t remaining() const { return m_payload.size() - m_readPos; }
 
 private:
+    template <typename T>
+    Packet& writeLE(T val);
+    
     PacketHeader m_header{};
     std::vector<uint8_t> m_payload;
     size_t m_readPos = 0;
@@ -0,0 +1,209 @@
+/**
+ * @file PacketSchema.h
+ * @brief Compile-time wire layouts for fixed-size packet structures
+ *
+ * A layout is declared once as a list of field descriptors and gives a
+ * static WIRE_SIZE (checked with static_assert against the certified
+ * Protocol.h structs), an encoder that writes straight into the payload and
+ * a matching decoder:
+ *
+ *   using ItemInfoSchema = schema::Schema<ItemInfo,
+ *       schema::Field<&ItemInfo::templateId>,
+ *       ...
+ *       schema::Field<&ItemInfo::equipped, int32_t>,   // bool sent as int32
+ *       schema::Pad<36>>;                               // not modelled, sent as zero
+ *
+ *   ItemInfoSchema::writeList(pkt, items);   // [count:i32][N * WIRE_SIZE]
+ *
+ * Packed wire structs (VehicleData, PlayerInfo...) use PodSchema and are
+ * copied with a single memcpy, lists included.
+ *
+ * The wire format is little-endian; like the PacketHeader memcpy in
+ * Packet/PacketView this assumes a little-endian host.
+ */
+
+#pragma once
+#include "Packet.h"
+#include "PacketView.h"
+#include "Protocol.h"
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "PacketSchema copies little-endian wire data directly and needs a little-endian host"
+#endif
+
+namespace knc {
+namespace schema {
+
+namespace detail {
+    template <typename P> struct MemberTraits;
+    template <typename C, typename M> struct MemberTraits<M C::*> {
+        using Class = C;
+        using Type = M;
+    };
+}
+
+// =============================================================================
+// FIELD DESCRIPTORS
+// =============================================================================
+
+// One member (scalar or fixed array) sent as Wire (defaults to the member type)
+template <auto Member, typename Wire = void>
+struct Field {
+    using Class = typename detail::MemberTraits<decltype(Member)>::Class;
+    using Type = typename detail::MemberTraits<decltype(Member)>::Type;
+    using Elem = std::remove_extent_t<Type>;
+    using WireElem = std::conditional_t<std::is_void_v<Wire>, Elem, Wire>;
+    
+    static_assert(std::rank_v<Type> <= 1, "Only scalars and one-dimensional arrays");
+    static_assert(std::is_arithmetic_v<Elem> || std::is_enum_v<Elem>, "Field member must be a number");
+    static_assert(std::is_arithmetic_v<WireElem> || std::is_enum_v<WireElem>, "Field wire type must be a number");
+    
+    static constexpr size_t COUNT = std::is_array_v<Type> ? std::extent_v<Type> : 1;
+    static constexpr size_t SIZE = sizeof(WireElem) * COUNT;
+    
+    static void encode(const Class& obj, uint8_t* out) {
+        const Elem* src = elements(obj);
+        if constexpr (std::is_same_v<Elem, WireElem>) {
+            std::memcpy(out, src, SIZE);
+        } else {
+            for (size_t i = 0; i < COUNT; ++i) {
+                WireElem value = static_cast<WireElem>(src[i]);
+                std::memcpy(out + i * sizeof(WireElem), &value, sizeof(WireElem));
+            }
+        }
+    }
+    
+    static void decode(const uint8_t* in, Class& obj) {
+        Elem* dst = elements(obj);
+        if constexpr (std::is_same_v<Elem, WireElem>) {
+            std::memcpy(dst, in, SIZE);
+        } else {
+            for (size_t i = 0; i < COUNT; ++i) {
+                WireElem value;
+                std::memcpy(&value, in + i * sizeof(WireElem), sizeof(WireElem));
+                dst[i] = static_cast<Elem>(value);
+            }
+        }
+    }
+
+private:
+    static const Elem* elements(const Class& obj) {
+        if constexpr (std::is_array_v<Type>) return obj.*Member;
+        else return &(obj.*Member);
+    }
+    static Elem* elements(Class& obj) {
+        if constexpr (std::is_array_v<Type>) return obj.*Member;
+        else return &(obj.*Member);
+    }
+};
+
+// N bytes the host struct doesn't model: written as zero, skipped when decoding
+template <size_t N>
+struct Pad {
+    static constexpr size_t SIZE = N;
+    
+    template <typename T>
+    static void encode(const T&, uint8_t* out) { std::memset(out, 0, N); }
+    template <typename T>
+    static void decode(const uint8_t*, T&) {}
+};
+
+// =============================================================================
+// PACKET I/O (shared by Schema and PodSchema)
+// =============================================================================
+
+template <typename Derived, typename T>
+struct SchemaIO {
+    using Type = T;
+    
+    static void write(Packet& pkt, const T& obj) {
+        Derived::encode(obj, pkt.appendRaw(Derived::WIRE_SIZE));
+    }
+    
+    // [count:i32][count * WIRE_SIZE], one payload resize for the whole list
+    static void writeList(Packet& pkt, const std::vector<T>& items) {
+        pkt.writeInt32(static_cast<int32_t>(items.size()));
+        if (items.empty()) return;
+        Derived::encodeRange(items.data(), items.size(), pkt.appendRaw(items.size() * Derived::WIRE_SIZE));
+    }
+    
+    static bool read(PacketView& view, T& obj) {
+        const uint8_t* data = view.readRaw(Derived::WIRE_SIZE);
+        if (!data) return false;
+        Derived::decode(data, obj);
+        return true;
+    }
+    
+    static bool readList(PacketView& view, std::vector<T>& out) {
+        int32_t count = view.readInt32();
+        if (count < 0 || static_cast<size_t>(count) > view.remaining() / Derived::WIRE_SIZE) {
+            return false;
+        }
+        out.resize(count);
+        const uint8_t* data = view.readRaw(count * Derived::WIRE_SIZE);
+        for (int32_t i = 0; i < count; ++i) {
+            Derived::decode(data + i * Derived::WIRE_SIZE, out[i]);
+        }
+        return true;
+    }
+    
+    static void encodeRange(const T* items, size_t count, uint8_t* out) {
+        for (size_t i = 0; i < count; ++i) {
+            Derived::encode(items[i], out + i * Derived::WIRE_SIZE);
+        }
+    }
+};
+
+// =============================================================================
+// SCHEMAS
+// =============================================================================
+
+// Host struct T mapped field by field (in wire order) onto its wire layout
+template <typename T, typename... Fields>
+struct Schema : SchemaIO<Schema<T, Fields...>, T> {
+    static constexpr size_t WIRE_SIZE = (size_t{0} + ... + Fields::SIZE);
+    
+    static void encode(const T& obj, uint8_t* out) {
+        size_t offset = 0;
+        ((Fields::encode(obj, out + offset), offset += Fields::SIZE), ...);
+    }
+    
+    static void decode(const uint8_t* in, T& obj) {
+        size_t offset = 0;
+        ((Fields::decode(in + offset, obj), offset += Fields::SIZE), ...);
+    }
+};
+
+// Packed wire struct that already is the wire layout: one memcpy per object or list
+template <typename T>
+struct PodSchema : SchemaIO<PodSchema<T>, T> {
+    static_assert(std::is_trivially_copyable_v<T>, "PodSchema needs a trivially copyable wire struct");
+    
+    static constexpr size_t WIRE_SIZE = sizeof(T);
+    
+    static void encode(const T& obj, uint8_t* out) { std::memcpy(out, &obj, WIRE_SIZE); }
+    static void decode(const uint8_t* in, T& obj) { std::memcpy(&obj, in, WIRE_SIZE); }
+    static void encodeRange(const T* items, size_t count, uint8_t* out) {
+        std::memcpy(out, items, count * WIRE_SIZE);
+    }
+};
+
+} // namespace schema
+
+// Certified wire structs (Protocol.h)
+using VehicleDataSchema   = schema::PodSchema<VehicleData>;
+using ItemDataSchema      = schema::PodSchema<ItemData>;
+using AccessoryDataSchema = schema::PodSchema<AccessoryData>;
+using SmallItemSchema     = schema::PodSchema<SmallItem>;
+using PlayerInfoSchema    = schema::PodSchema<PlayerInfo>;
+using PlayerJoinSchema    = schema::PodSchema<PlayerJoinData>;
+
+static_assert(VehicleDataSchema::WIRE_SIZE == 0x2C, "VehicleData wire size");
+static_assert(ItemDataSchema::WIRE_SIZE == 0x38, "ItemData wire size");
+static_assert(AccessoryDataSchema::WIRE_SIZE == 0x1C, "AccessoryData wire size");
+static_assert(PlayerInfoSchema::WIRE_SIZE == 0x4C8, "PlayerInfo wire size");
+
+} // namespace knc
@@ -0,0 +1,70 @@
+/**
+ * @file PacketView.h
+ * @brief Non-owning view over a received packet
+ *
+ * Points straight into the Session receive buffer and is only valid for
+ * the duration of the handler call. Handlers that need to keep the packet
+ * around (deferred work, queues) must call copy().
+ */
+
+#pragma once
+#include "Protocol.h"
+#include "Packet.h"
+#include <vector>
+#include <string>
+
+namespace knc {
+
+class PacketView {
+public:
+    PacketView() = default;
+    PacketView(const PacketHeader& header, const uint8_t* payload, size_t len)
+        : m_header(header), m_payload(payload), m_size(len) {}
+    // View over an owned packet (e.g. one copied for deferred processing)
+    explicit PacketView(const Packet& packet)
+        : m_header(packet.header()), m_payload(packet.payload().data()), m_size(packet.payload().size()) {}
+
+    // View over a contiguous [header][payload] frame, nullopt if incomplete
+    static std::optional<PacketView> fromFrame(const uint8_t* data, size_t len);
+
+    // Header access
+    uint8_t cmd() const { return m_header.cmd; }
+    uint8_t flag() const { return m_header.flag; }
+    uint16_t cmdFull() const { return m_header.cmd | (m_header.flag << 8); }
+    uint16_t payloadSize() const { return static_cast<uint16_t>(m_size); }
+    size_t totalSize() const { return PACKET_HEADER_SIZE + m_size; }
+    const PacketHeader& header() const { return m_header; }
+
+    // Payload access (no copy)
+    const uint8_t* data() const { return m_payload; }
+    size_t size() const { return m_size; }
+
+    // Owning copy for handlers that keep the packet beyond the callback
+    Packet copy() const;
+
+    // Payload readers (with position tracking) - same semantics as Packet
+    int8_t readInt8();
+    uint8_t readUInt8();
+    int16_t readInt16();
+    uint16_t readUInt16();
+    int32_t readInt32();
+    uint32_t readUInt32();
+    float readFloat();
+    std::vector<uint8_t> readBytes(size_t len);
+    std::string readString(size_t maxLen = 256);
+    std::u16string readWString(size_t maxChars = 128);
+    // Pointer to the next len bytes (and skip them), nullptr if fewer remain
+    const uint8_t* readRaw(size_t len);
+
+    void resetReadPos() { m_readPos = 0; }
+    size_t readPos() const { return m_readPos; }
+    size_t remaining() const { return m_size - m_readPos; }
+
+private:
+    PacketHeader m_header{};
+    const uint8_t* m_payload = nullptr;
+    size_t m_size = 0;
+    size_t m_readPos = 0;
+};
+
+} // namespace knc
@@ -8,6 +8,7 @@
 
 #pragma once
 #include <cstdint>
+#include <cstddef>
 
 namespace knc {
 
@@ -185,6 +186,9 @@ namespace CMD {
     constexpr uint8_t S_RACE_DATA           = 0xC4;  // 196: 4+4+wstring+wstring
     constexpr uint8_t S_RACE_PLAYER_6       = 0xC5;  // 197: Race player data variant
     constexpr uint8_t S_RACE_DATA_2         = 0xC6;  // 198: Race data
+    // Race standings: same opcodes as S_ENTITY_DATA_252 / S_ENTITY_DATA_254 below
+    constexpr uint8_t S_POSITION_LIST       = 0xFC;  // 252: int32 count + count * {entityId, rank, time}
+    constexpr uint8_t S_POSITION_ADD        = 0xFE;  // 254: int32 entityId (entry state=1, value=0)
     
     // Extended Equipment (130-140) - IDA VERIFIED
     constexpr uint8_t S_EXT_DATA_130        = 0x82;  // 130: 0x18C bytes (396 bytes!) sub_47B710
@@ -351,6 +355,19 @@ namespace CMD {
     
     // Internal server-to-server
     constexpr uint8_t I_SERVER_REGISTER     = 0xF0;  // GameServer registration to LoginServer
+    // LoginServer -> GameServer over the registration connection, sent when a client is
+    // redirected: [token:str][clientIp:str][accountId:i32][characterId:i32][hasCharacter:u8]
+    // + if hasCharacter: [name:str][level:i32][xp:i32][gold:i32][cash:i32][wins:i32][losses:i32]
+    constexpr uint8_t I_SESSION_HANDOFF     = 0xF1;
+    
+    // Custom client extensions (never sent to original clients)
+    // Sub-command in the header flag, see net/MovementCodec.h
+    constexpr uint8_t X_COMPACT_MOVE        = 0xF2;
+    namespace CompactMove {
+        constexpr uint8_t CAPS = 0x00;  // C->S: u8 version | S->C: u8 version, float originX/Y/Z, float step
+        constexpr uint8_t ACK  = 0x01;  // u8 last decoded seq (both directions)
+        constexpr uint8_t DATA = 0x02;  // MovementCodec payload (both directions)
+    }
 
 } // namespace CMD
 
@@ -505,6 +522,8 @@ namespace GameConst {
     constexpr int MAX_PLAYERS_PER_ROOM = 8;
     constexpr int MAX_ROOMS = 100;
     constexpr int TICK_RATE = 20;
+    constexpr int MIN_SNAPSHOT_HZ = 10;  // Server.snapshot_hz bounds
+    constexpr int MAX_SNAPSHOT_HZ = 30;
 }
 
 } // namespace knc
@@ -0,0 +1,83 @@
+/**
+ * @file RingBuffer.h
+ * @brief Fixed-capacity byte ring used as the Session receive buffer
+ *
+ * Bytes are read from the socket straight into the free region(s) and
+ * consumed from the front once a full frame has been dispatched.
+ * Nothing is ever shifted: consuming a frame is just an index bump.
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <memory>
+
+namespace knc {
+
+class RingBuffer {
+public:
+    // capacity is rounded up to a power of two
+    explicit RingBuffer(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        m_capacity = cap;
+        m_data = std::make_unique<uint8_t[]>(cap);
+    }
+
+    size_t capacity() const { return m_capacity; }
+    size_t size() const { return m_tail - m_head; }
+    size_t freeSpace() const { return m_capacity - size(); }
+    bool empty() const { return m_head == m_tail; }
+
+    // Free space as at most two contiguous regions (second one is the wrap-around)
+    void writableRegions(uint8_t*& first, size_t& firstLen, uint8_t*& second, size_t& secondLen) {
+        size_t tailOff = m_tail & (m_capacity - 1);
+        size_t free = freeSpace();
+        firstLen = std::min(free, m_capacity - tailOff);
+        secondLen = free - firstLen;
+        first = m_data.get() + tailOff;
+        second = m_data.get();
+    }
+
+    // Mark len bytes (written through writableRegions) as readable
+    void commit(size_t len) { m_tail += len; }
+
+    // Pointer to the first len readable bytes if they are contiguous, nullptr if they wrap
+    const uint8_t* contiguous(size_t len) const {
+        size_t headOff = m_head & (m_capacity - 1);
+        if (len > size() || headOff + len > m_capacity) return nullptr;
+        return m_data.get() + headOff;
+    }
+
+    // Copy the first len readable bytes without consuming them
+    bool peek(uint8_t* dst, size_t len) const {
+        if (len > size()) return false;
+        size_t headOff = m_head & (m_capacity - 1);
+        size_t firstLen = std::min(len, m_capacity - headOff);
+        std::memcpy(dst, m_data.get() + headOff, firstLen);
+        if (len > firstLen) {
+            std::memcpy(dst + firstLen, m_data.get(), len - firstLen);
+        }
+        return true;
+    }
+
+    void consume(size_t len) {
+        m_head += std::min(len, size());
+        // Rewind when drained so the next frames start at offset 0 and stay contiguous
+        if (m_head == m_tail) {
+            m_head = m_tail = 0;
+        }
+    }
+
+    void clear() { m_head = m_tail = 0; }
+
+private:
+    std::unique_ptr<uint8_t[]> m_data;
+    size_t m_capacity = 0;
+    size_t m_head = 0;  // monotonically increasing read index
+    size_t m_tail = 0;  // monotonically increasing write index
+};
+
+} // namespace knc
@@ -7,26 +7,45 @@
 #include <asio.hpp>
 #include <memory>
 #include <vector>
-#include <queue>
+#include <deque>
+#include <atomic>
 #include <functional>
 #include "Packet.h"
+#include "PacketView.h"
+#include "RingBuffer.h"
+#include "security/RateLimiter.h"
+#include "security/AntiCheatState.h"
 
 namespace knc {
 
 class Session : public std::enable_shared_from_this<Session> {
 public:
     using Ptr = std::shared_ptr<Session>;
-    using PacketHandler = std::function<void(Session::Ptr, Packet&)>;
+    // The session handle is only borrowed for the call, copy it to keep it
+    using PacketHandler = std::function<void(const Session::Ptr&, PacketView&)>;
     using DisconnectHandler = std::function<void(Session::Ptr)>;
+    // Serialized frame shared read-only between every recipient of a broadcast
+    using SharedBuffer = std::shared_ptr<const std::vector<uint8_t>>;
     
+    // The socket should be bound to its own strand (accept with asio::make_strand)
+    // so every completion handler of this session runs serialized
     Session(asio::ip::tcp::socket socket);
     ~Session();
     
     void start();
+    // Thread-safe; the disconnect handler runs afterwards on the session strand
     void stop();
+    // stop() that also forbids the disconnect handler from keeping the session for a resume
+    // (anti-cheat kick, packet flood, client quit)
+    void kick();
     
+    // Thread-safe: may be called from any thread, the write is queued on the session strand
     void send(const Packet& packet);
     void send(const std::vector<uint8_t>& data);
+    void send(SharedBuffer data);
+    
+    // Serialize once for N recipients (Room::broadcast, lobby chat...) into a pooled frame
+    static SharedBuffer makeShared(const Packet& packet);
     
     // Handlers
     void setPacketHandler(PacketHandler handler) { m_packetHandler = handler; }
@@ -34,18 +53,26 @@ public:
     
     // Info
     uint32_t id() const { return m_id; }
-    std::string remoteAddress() const;
-    uint16_t remotePort() const;
+    // Peer endpoint captured at accept: no getpeername() per log line, still valid after close
+    const std::string& remoteAddress() const { return m_remoteAddress; }
+    uint16_t remotePort() const { return m_remotePort; }
+    uint32_t droppedPackets() const { return m_rateLimiter.getDroppedCount(); }
     bool isConnected() const { return m_connected; }
+    bool isResumable() const { return !m_kicked; }
+    
+    // Strand executor - post here to run code serialized with this session's handlers
+    asio::ip::tcp::socket::executor_type executor() { return m_socket.get_executor(); }
     
     // Session data
     uint32_t accountId = 0;
     uint32_t characterId = 0;
-    uint32_t roomId = 0;
+    std::atomic<uint32_t> roomId{0};  // Read from other sessions' strands (lobby lists, whispers)
     std::string sessionToken;
     std::string authenticatedUser;  // Username from valid launcher login
     std::u16string characterName;   // Character name (UTF-16)
     bool launcherAuthenticated = false;  // True if validated via launcher
+    std::atomic<bool> compactMovement{false};  // Custom client negotiated X_COMPACT_MOVE
+    AntiCheatState antiCheat;  // See AntiCheatHandler
     
     // Handshake state
     enum class HandshakeState { 
@@ -64,17 +91,28 @@ private:
     
     asio::ip::tcp::socket m_socket;
     uint32_t m_id;
-    bool m_connected = false;
+    std::atomic<bool> m_connected{false};
+    std::atomic<bool> m_kicked{false};
+    std::string m_remoteAddress;
+    uint16_t m_remotePort = 0;
     
-    std::vector<uint8_t> m_readBuffer;
-    std::vector<uint8_t> m_recvBuffer;
-    std::queue<std::vector<uint8_t>> m_writeQueue;
+    // Receive ring - frames are decoded in place, only wrapped frames are linearized
+    static constexpr size_t RECV_RING_SIZE = 64 * 1024;
+    RingBuffer m_recvRing;
+    std::vector<uint8_t> m_frameScratch;
+    // Flooded opcodes are dropped here, before the packet handler
+    RateLimiter m_rateLimiter;
+    // Write state below is only touched on the session strand
+    // Frames queued while a write is in flight are flushed together in one gathered write
+    std::deque<SharedBuffer> m_writeQueue;
+    std::vector<SharedBuffer> m_inFlight;
+    std::vector<asio::const_buffer> m_writeBuffers;
     bool m_writing = false;
     
     PacketHandler m_packetHandler;
     DisconnectHandler m_disconnectHandler;
     
-    static uint32_t s_nextId;
+    static std::atomic<uint32_t> s_nextId;
 };
 
 } // namespace knc
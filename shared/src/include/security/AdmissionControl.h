@@ -0,0 +1,94 @@
+/**
+ * @file AdmissionControl.h
+ * @brief Accept-stage connection throttling per source IP and subnet
+ *
+ * Decides right after accept(), before a Session, its receive ring or any
+ * DB work exists for the connection, whether it is let in:
+ * - concurrent connections per IP and per subnet (/24 IPv4, /64 IPv6)
+ * - new connections per second per IP and per subnet (token buckets)
+ * - connections still in the handshake, server-wide
+ *
+ * A refused socket is just closed. The server releases what admit() took:
+ * handshakeDone() once the client is authenticated (or gone), release()
+ * when the connection closes. Sockets that never finish the handshake are
+ * closed by the server after Config::handshakeTimeout.
+ *
+ * Thread-safe: admit runs on the accept path, the releases on any strand.
+ */
+
+#pragma once
+#include <asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include "security/RateLimiter.h"
+
+namespace knc {
+
+class AdmissionControl {
+public:
+    struct Config {
+        bool enabled = true;
+        uint32_t maxPerIp = 8;                      // Concurrent, 0 = unlimited
+        uint32_t maxPerSubnet = 32;
+        RateLimiter::Budget ipRate{5, 10};          // New connections per second
+        RateLimiter::Budget subnetRate{20, 40};
+        uint32_t maxPending = 256;                  // Handshakes in progress, server-wide
+        std::chrono::milliseconds handshakeTimeout{10000};
+    };
+    
+    enum class Verdict { Admit, IpLimit, SubnetLimit, IpRate, SubnetRate, PendingLimit };
+    
+    // Not thread-safe: call before the first accept
+    void configure(const Config& config) { m_config = config; }
+    const Config& config() const { return m_config; }
+    
+    // Admit takes one connection and one pending handshake for this address
+    Verdict admit(const asio::ip::address& address);
+    void handshakeDone();
+    void release(const asio::ip::address& address);
+    
+    static const char* verdictName(Verdict verdict);
+    
+    struct Stats {
+        uint64_t admitted = 0;
+        uint64_t rejected = 0;
+        uint32_t pending = 0;
+        size_t trackedAddresses = 0;
+    };
+    Stats stats() const;
+
+private:
+    // IPv4 as v4-mapped IPv6, so one key type covers both families
+    struct Key {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+        bool operator==(const Key& o) const { return hi == o.hi && lo == o.lo; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const { return std::hash<uint64_t>()(k.hi * 0x9E3779B97F4A7C15ull ^ k.lo); }
+    };
+    struct Entry {
+        uint32_t connections = 0;
+        uint32_t tokens = 0;
+        uint32_t lastRefill = 0;
+    };
+    using Table = std::unordered_map<Key, Entry, KeyHash>;
+    
+    static void keys(const asio::ip::address& address, Key& ip, Key& subnet);
+    static Entry& entry(Table& table, const Key& key, const RateLimiter::Budget& rate, uint32_t nowMs);
+    void release(Table& table, const Key& key);
+    void sweep(uint32_t nowMs);
+    
+    Config m_config;
+    mutable std::mutex m_mutex;
+    Table m_ips;
+    Table m_subnets;
+    uint32_t m_pending = 0;
+    uint32_t m_sinceSweep = 0;
+    uint64_t m_admitted = 0;
+    uint64_t m_rejected = 0;
+};
+
+} // namespace knc
@@ -0,0 +1,63 @@
+/**
+ * @file AntiCheatState.h
+ * @brief Per-session anti-cheat state
+ *
+ * Held inline in the Session, so it lives and dies with the connection and
+ * needs no lookup. Position checks run where the session's room packets
+ * are handled, on the room's worker. When the player switches rooms, packets
+ * of the old room may still be queued on its worker while the new room's
+ * worker already gets positions, so the history has an owner: the new room
+ * only takes it (acquire) once the old room's worker has released it
+ * (release, when it removes the player, after its queued packets). Positions
+ * of the new room before that are dropped. No lock on the history itself.
+ * The violation count is atomic because a resumed session carries it over
+ * from the parked one.
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace knc {
+
+// Position with timestamp for movement validation
+struct PositionRecord {
+    float x, y, z;
+    std::chrono::steady_clock::time_point timestamp;
+};
+
+// Last CAPACITY positions in a fixed ring: push overwrites the oldest, no shifting
+class PositionHistory {
+public:
+    static constexpr size_t CAPACITY = 64;   // ~1 second at 60 updates/s
+    
+    void push(const PositionRecord& record) {
+        m_records[m_next] = record;
+        m_next = (m_next + 1) % CAPACITY;
+        if (m_size < CAPACITY) ++m_size;
+    }
+    
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+    void clear() { m_size = 0; m_next = 0; }
+    
+    // 0 = oldest
+    const PositionRecord& at(size_t i) const { return m_records[(m_next + CAPACITY - m_size + i) % CAPACITY]; }
+    const PositionRecord& back() const { return m_records[(m_next + CAPACITY - 1) % CAPACITY]; }
+
+private:
+    std::array<PositionRecord, CAPACITY> m_records{};
+    size_t m_next = 0;
+    size_t m_size = 0;
+};
+
+struct AntiCheatState {
+    PositionHistory positions;
+    uint16_t offTrackSamples = 0;       // Consecutive positions away from the track mesh
+    std::atomic<uint32_t> owner{0};     // Room whose worker may touch the two above, 0 = none
+    std::atomic<int> violations{0};
+};
+
+} // namespace knc
@@ -1,23 +1,53 @@
 /**
  * @file BanManager.h
  * @brief IP and account ban management
+ *
+ * IP bans are addresses or CIDR ranges, IPv4 and IPv6 ("203.0.113.7",
+ * "198.51.100.0/24", "2001:db8::/32"). They are compiled into a binary
+ * trie per address family; a lookup walks at most prefix-length nodes, so
+ * the cost per accepted connection does not grow with the number of bans.
+ *
+ * The trie is immutable once published (RCU style): isBanned() takes a
+ * reference to the current snapshot and walks it without the ban lock,
+ * while ban/unban/expiry build a new snapshot and swap it in. A replaced
+ * snapshot is freed when its last reader drops the reference.
+ *
+ * Every ban can expire. Expiry times sit in a min-heap and a timer thread
+ * wakes for the earliest one; lookups also check the time themselves, so a
+ * ban ends on time even between two timer wakeups.
+ *
+ * Bans are stored in the `bans` table: loadFromDB() at startup, and every
+ * ban that changes something (new, or longer than the current one) and
+ * every unban writes through. A ban takes effect in memory at once and its
+ * row is written on a DB worker, so banning never waits on MariaDB; a write
+ * that fails is retried by saveToDB().
  */
 
 #pragma once
-#include <string>
+#include <asio.hpp>
+#include <atomic>
 #include <chrono>
-#include <unordered_set>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace knc {
 
 struct Ban {
-    std::string accountId;
-    std::string ipAddress;
+    uint32_t accountId = 0;     // Account bans
+    std::string ipAddress;      // IP bans: address or CIDR range (normalized)
     std::string reason;
     std::string bannedBy;
     std::chrono::system_clock::time_point expiresAt;
     bool isPermanent = false;
+    bool persisted = false;     // Written to the bans table
 };
 
 class BanManager {
@@ -27,30 +57,81 @@ public:
         return inst;
     }
     
-    // Check if banned
+    // Check if banned (IP checks don't take the ban lock)
     bool isBanned(const std::string& ip) const;
+    bool isBanned(const asio::ip::address& ip) const;
     bool isBanned(uint32_t accountId) const;
     
-    // Add ban
-    void banIP(const std::string& ip, const std::string& reason, 
+    // Add ban; ip may be a CIDR range. durationMinutes 0 = permanent.
+    // false if the address does not parse
+    bool banIP(const std::string& ip, const std::string& reason,
                const std::string& by, int durationMinutes = 0);
     void banAccount(uint32_t accountId, const std::string& reason,
                     const std::string& by, int durationMinutes = 0);
     
-    // Remove ban
+    // Remove ban (ip as given to banIP)
     void unbanIP(const std::string& ip);
     void unbanAccount(uint32_t accountId);
     
-    // Load/save from database
+    // Load the active bans from the database and start the expiry timer
     void loadFromDB();
+    // Write bans whose write-through failed
     void saveToDB();
+    // Stop the expiry timer
+    void shutdown();
+    
+    size_t ipBanCount() const;
+    size_t accountBanCount() const;
 
 private:
-    BanManager() = default;
+    friend struct BanManagerTest;   // tests/security/test_ban_manager.cpp
+    
+    BanManager();
+    ~BanManager();
+    
+    using Clock = std::chrono::system_clock;
+    
+    // Parsed address or range, host bits cleared
+    struct Prefix {
+        bool v6 = false;
+        uint8_t bytes[16] = {};
+        int length = 0;
+    };
+    static bool parsePrefix(const std::string& text, Prefix& out);
+    static std::string formatPrefix(const Prefix& prefix);
+    
+    class Snapshot;
+    
+    struct Expiry {
+        Clock::time_point at;
+        uint32_t accountId;     // 0 = IP ban
+        std::string ip;
+        bool operator>(const Expiry& o) const { return at > o.at; }
+    };
+    
+    Ban makeBan(const std::string& reason, const std::string& by, int durationMinutes) const;
+    void scheduleExpiry(const Ban& ban);
+    void publish();     // rebuild the IP snapshot (m_mutex held)
+    void expiryLoop();
+    bool persist(const Ban& ban);
+    void persistAsync(const Ban& ban);
+    void markPersisted(const Ban& ban);
+    
     mutable std::mutex m_mutex;
-    std::unordered_set<std::string> m_bannedIPs;
-    std::unordered_set<uint32_t> m_bannedAccounts;
+    std::unordered_map<std::string, Ban> m_ipBans;       // by normalized range
+    std::unordered_map<uint32_t, Ban> m_accountBans;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> m_expiries;
+    
+    // Published snapshot: only through std::atomic_load / std::atomic_store
+    std::shared_ptr<const Snapshot> m_snapshot;
+    
+    std::thread m_thread;
+    std::condition_variable m_cv;
+    bool m_running = false;
+    
+    // persistAsync() writes queued on the DB workers (m_mutex)
+    size_t m_writesInFlight = 0;
+    std::condition_variable m_writesDone;
 };
 
 } // namespace knc
-
@@ -1,43 +1,78 @@
 /**
  * @file RateLimiter.h
  * @brief Per-connection and per-opcode rate limiting
+ *
+ * Token buckets: every opcode has its own bucket, plus one for all opcodes
+ * together. A bucket refills `rate` tokens per second up to `burst`, and
+ * each packet takes one token. A packet that finds its bucket empty is
+ * dropped before it reaches any handler.
+ *
+ * The state is two flat 256-entry arrays held inline in the Session: check()
+ * is an index, a multiply and a compare, with no allocation, no lock and no
+ * clock read (the caller reads the clock once per receive batch).
+ *
+ * Budgets are process-wide, set once at startup with configure().
  */
 
 #pragma once
+#include <array>
 #include <cstdint>
-#include <chrono>
-#include <unordered_map>
-#include <mutex>
 
 namespace knc {
 
 class RateLimiter {
 public:
+    struct Budget {
+        uint32_t rate = 0;      // Tokens per second, 0 = unlimited
+        uint32_t burst = 0;     // Bucket size
+    };
+    
     struct Config {
-        int globalMaxPerSec = 100;
-        int defaultMinIntervalMs = 50;
-        std::unordered_map<uint8_t, int> opcodeMinIntervalMs;
+        bool enabled = true;
+        Budget total{300, 600};                 // All opcodes together
+        std::array<Budget, 256> opcode;         // Per opcode
+        // Drops within one second before the connection is closed (0 = never)
+        uint32_t maxDropsPerSec = 200;
+        
+        Config() { opcode.fill(Budget{60, 120}); }
     };
     
-    RateLimiter() = default;
-    explicit RateLimiter(const Config& config) : m_config(config) {}
+    enum class Verdict { Allow, Drop, Disconnect };
+    
+    // Not thread-safe: call before any session is accepted
+    static void configure(const Config& config);
+    static const Config& config() { return s_config; }
     
-    // Returns true if packet should be allowed, false if rate limited
-    bool check(uint8_t cmd);
+    // Buckets start full
+    explicit RateLimiter(uint32_t nowMs = 0) { reset(nowMs); }
     
-    // Reset all counters (e.g., on new connection)
-    void reset();
+    // nowMs: any monotonic millisecond clock, the same for every call
+    Verdict check(uint8_t cmd, uint32_t nowMs);
+    
+    void reset(uint32_t nowMs);
     
     // Stats
-    int getDroppedCount() const { return m_droppedCount; }
+    uint32_t getDroppedCount() const { return m_droppedCount; }
+    
+    // One bucket (also used by AdmissionControl). Tokens are kept in thousandths
+    // so a refill of a few ms is not lost; capacity() is a full bucket
+    static bool take(uint32_t& tokens, uint32_t& last, const Budget& budget, uint32_t nowMs);
+    static uint32_t capacity(const Budget& budget);
 
 private:
-    Config m_config;
-    std::unordered_map<uint8_t, std::chrono::steady_clock::time_point> m_lastPacketTime;
-    int m_packetsThisSecond = 0;
-    std::chrono::steady_clock::time_point m_secondStart;
-    int m_droppedCount = 0;
+    // Adds the tokens earned since `last` without taking one; true if one is available
+    static bool refill(uint32_t& tokens, uint32_t& last, const Budget& budget, uint32_t nowMs);
+    
+    std::array<uint32_t, 256> m_tokens;
+    std::array<uint32_t, 256> m_lastRefill;
+    uint32_t m_totalTokens = 0;
+    uint32_t m_totalLastRefill = 0;
+    
+    uint32_t m_dropWindowStart = 0;
+    uint32_t m_dropsInWindow = 0;
+    uint32_t m_droppedCount = 0;
+    
+    static Config s_config;
 };
 
 } // namespace knc
-
@@ -1,87 +1,307 @@
 /**
  * @file Database.cpp
- * @brief MariaDB connection pool
+ * @brief MariaDB connection pool and asynchronous executor
  */
 
 #include "db/Database.h"
 #include "logging/Logger.h"
+#include <algorithm>
+#include <cstring>
 
 namespace knc {
 
 #ifdef KNC_HAS_MARIADB
 
+// my_bool in MariaDB Connector/C, bool in newer MySQL clients
+using BindFlag = std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>;
+
+// Client errors that mean the server went away (errmsg.h)
+constexpr unsigned int ERR_SERVER_GONE = 2006;
+constexpr unsigned int ERR_SERVER_LOST = 2013;
+
+static bool lostServer(unsigned int err) {
+    return err == ERR_SERVER_GONE || err == ERR_SERVER_LOST;
+}
+
 bool Database::init(const DBConfig& config) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_config = config;
-    
-    for (int i = 0; i < config.poolSize; ++i) {
-        MYSQL* conn = mysql_init(nullptr);
-        if (!conn) {
-            LOG_ERROR("DB", "mysql_init failed");
-            return false;
-        }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_config = config;
+        m_config.poolMin = std::max(1, config.poolMin);
+        m_config.poolMax = std::max(m_config.poolMin, config.poolMax);
+        m_poolStopping = false;
         
-        if (!mysql_real_connect(conn, 
-                config.host.c_str(),
-                config.user.c_str(),
-                config.password.c_str(),
-                config.database.c_str(),
-                config.port, nullptr, 0)) {
-            LOG_ERROR("DB", std::string("Connect failed: ") + mysql_error(conn));
-            mysql_close(conn);
-            return false;
+        for (int i = 0; i < m_config.poolMin; ++i) {
+            MYSQL* mysql = connect();
+            if (!mysql) {
+                for (Connection* conn : m_idle) closeConnection(conn);
+                m_idle.clear();
+                m_open = 0;
+                return false;
+            }
+            Connection* conn = new Connection;
+            conn->mysql = mysql;
+            conn->lastUsed = Clock::now();
+            m_idle.push_back(conn);
+            ++m_open;
         }
-        
-        mysql_set_character_set(conn, "utf8mb4");
-        m_pool.push(conn);
+        m_initialized = true;
     }
     
-    m_initialized = true;
-    LOG_INFO("DB", "Pool initialized with " + std::to_string(config.poolSize) + " connections");
+    LOG_INFOF("DB", "Pool initialized with {} connections (max {})", m_config.poolMin, m_config.poolMax);
+    m_maintenance = std::thread(&Database::maintenanceLoop, this);
+    startWorkers(config.workerThreads);
     return true;
 }
 
 void Database::shutdown() {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    while (!m_pool.empty()) {
-        mysql_close(m_pool.front());
-        m_pool.pop();
+    // Workers finish the queued jobs first, they still need their connections
+    stopWorkers();
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_poolStopping = true;
+    }
+    m_poolCv.notify_all();
+    m_maintenanceCv.notify_all();
+    if (m_maintenance.joinable()) {
+        m_maintenance.join();
     }
+    if (m_initialized) {
+        logPoolStats();
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Connection* conn : m_idle) closeConnection(conn);
+    for (Connection* conn : m_broken) closeConnection(conn);
+    m_idle.clear();
+    m_broken.clear();
+    m_open = 0;
     m_initialized = false;
 }
 
-MYSQL* Database::getConnection() {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    if (m_pool.empty()) return nullptr;
-    MYSQL* conn = m_pool.front();
-    m_pool.pop();
-    
-    // Check connection still valid
-    if (mysql_ping(conn) != 0) {
-        mysql_close(conn);
-        conn = mysql_init(nullptr);
-        mysql_real_connect(conn,
+MYSQL* Database::connect() {
+    MYSQL* mysql = mysql_init(nullptr);
+    if (!mysql) {
+        LOG_ERROR("DB", "mysql_init failed");
+        return nullptr;
+    }
+    
+    if (!mysql_real_connect(mysql, 
             m_config.host.c_str(),
             m_config.user.c_str(),
             m_config.password.c_str(),
             m_config.database.c_str(),
-            m_config.port, nullptr, 0);
+            m_config.port, nullptr, 0)) {
+        LOG_ERROR("DB", std::string("Connect failed: ") + mysql_error(mysql));
+        mysql_close(mysql);
+        return nullptr;
     }
-    return conn;
+    
+    mysql_set_character_set(mysql, "utf8mb4");
+    return mysql;
+}
+
+void Database::closeStatements(Connection* conn) {
+    for (auto& [sql, stmt] : conn->statements) {
+        mysql_stmt_close(stmt);
+    }
+    conn->statements.clear();
+}
+
+void Database::closeConnection(Connection* conn) {
+    closeStatements(conn);
+    if (conn->mysql) mysql_close(conn->mysql);
+    delete conn;
 }
 
-void Database::releaseConnection(MYSQL* conn) {
+// =============================================================================
+// POOL
+// =============================================================================
+
+Database::Connection* Database::getConnection() {
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::milliseconds(m_config.acquireTimeoutMs);
+    bool waited = false;
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_initialized) return nullptr;
+    ++m_stats.acquires;
+    
+    auto recordWait = [&]() {
+        if (!waited) return;
+        uint64_t us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        ++m_stats.waits;
+        m_stats.totalWaitUs += us;
+        m_stats.maxWaitUs = std::max(m_stats.maxWaitUs, us);
+    };
+    
+    while (true) {
+        // Warmest connection first: its statements are most likely prepared
+        if (!m_idle.empty()) {
+            Connection* conn = m_idle.back();
+            m_idle.pop_back();
+            recordWait();
+            lock.unlock();
+            if (validate(conn)) return conn;
+            // Went to the reconnect list, try the next one
+            lock.lock();
+            continue;
+        }
+        
+        // Grow: connect outside the lock, the slot is reserved by m_open
+        if (m_open < m_config.poolMax && !m_poolStopping) {
+            ++m_open;
+            lock.unlock();
+            if (MYSQL* mysql = connect()) {
+                Connection* conn = new Connection;
+                conn->mysql = mysql;
+                conn->lastUsed = Clock::now();
+                lock.lock();
+                recordWait();
+                int open = m_open;
+                lock.unlock();
+                LOG_DEBUGF("DB", "Pool grew to {} connections", open);
+                return conn;
+            }
+            lock.lock();
+            --m_open;
+            // Server unreachable: fall through and wait like a full pool
+        }
+        
+        if (m_poolStopping) return nullptr;
+        
+        ++m_waiting;
+        waited = true;
+        m_poolCv.wait_until(lock, deadline);
+        --m_waiting;
+        
+        if (Clock::now() >= deadline && m_idle.empty()) {
+            ++m_stats.timeouts;
+            recordWait();
+            int open = m_open;
+            lock.unlock();
+            LOG_WARNF("DB", "No free connection after {} ms ({} open, max {})",
+                      m_config.acquireTimeoutMs, open, m_config.poolMax);
+            return nullptr;
+        }
+    }
+}
+
+void Database::releaseConnection(Connection* conn) {
+    conn->lastUsed = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_idle.push_back(conn);
+    }
+    m_poolCv.notify_one();
+}
+
+bool Database::validate(Connection* conn) {
+    // A connection used recently is trusted: no round-trip per query
+    if (conn->mysql && !conn->suspect &&
+        Clock::now() - conn->lastUsed < std::chrono::milliseconds(m_config.validateIdleMs)) {
+        return true;
+    }
+    conn->suspect = false;
+    if (conn->mysql && mysql_ping(conn->mysql) == 0) {
+        return true;
+    }
+    
+    // Prepared statements die with the old session; reconnecting is left to the
+    // maintenance thread so this caller doesn't wait on a connect timeout
+    closeStatements(conn);
+    if (conn->mysql) {
+        mysql_close(conn->mysql);
+        conn->mysql = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_broken.push_back(conn);
+    }
+    m_maintenanceCv.notify_one();
+    LOG_WARN("DB", "Connection lost, reconnecting in the background");
+    return false;
+}
+
+void Database::maintenanceLoop() {
+    const auto statsInterval = std::chrono::seconds(m_config.statsIntervalSec);
+    const auto idleTimeout = std::chrono::milliseconds(m_config.idleTimeoutMs);
+    auto nextStats = Clock::now() + statsInterval;
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_poolStopping) {
+        m_maintenanceCv.wait_for(lock, std::chrono::seconds(1));
+        if (m_poolStopping) break;
+        
+        // Reconnect broken slots one at a time; if the server is still down
+        // the rest wait for the next pass
+        while (!m_broken.empty() && !m_poolStopping) {
+            Connection* conn = m_broken.back();
+            m_broken.pop_back();
+            lock.unlock();
+            conn->mysql = connect();
+            lock.lock();
+            if (!conn->mysql) {
+                m_broken.push_back(conn);
+                break;
+            }
+            conn->lastUsed = Clock::now();
+            m_idle.push_back(conn);
+            ++m_stats.reconnects;
+            m_poolCv.notify_one();
+        }
+        
+        // Shrink back towards poolMin: the least recently used idle connections
+        // sit at the front
+        auto now = Clock::now();
+        while (m_open > m_config.poolMin && !m_idle.empty() && now - m_idle.front()->lastUsed > idleTimeout) {
+            Connection* conn = m_idle.front();
+            m_idle.erase(m_idle.begin());
+            --m_open;
+            lock.unlock();
+            closeConnection(conn);
+            LOG_DEBUG("DB", "Closed idle connection");
+            lock.lock();
+        }
+        
+        if (m_config.statsIntervalSec > 0 && now >= nextStats) {
+            nextStats = now + statsInterval;
+            lock.unlock();
+            logPoolStats();
+            lock.lock();
+        }
+    }
+}
+
+DBPoolStats Database::poolStats() {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_pool.push(conn);
+    DBPoolStats stats = m_stats;
+    stats.open = m_open;
+    stats.idle = static_cast<int>(m_idle.size());
+    stats.broken = static_cast<int>(m_broken.size());
+    stats.inUse = m_open - stats.idle - stats.broken;
+    stats.waiting = m_waiting;
+    return stats;
+}
+
+void Database::logPoolStats() {
+    DBPoolStats stats = poolStats();
+    LOG_INFOF("DB", "Pool: open={} idle={} in_use={} broken={} waiting={} acquires={} waits={} timeouts={} avg_wait_us={} max_wait_us={} reconnects={}",
+              stats.open, stats.idle, stats.inUse, stats.broken, stats.waiting,
+              stats.acquires, stats.waits, stats.timeouts,
+              stats.waits ? stats.totalWaitUs / stats.waits : 0, stats.maxWaitUs, stats.reconnects);
 }
 
 bool Database::execute(const std::string& sql) {
-    MYSQL* conn = getConnection();
+    Connection* conn = getConnection();
     if (!conn) return false;
     
-    bool success = mysql_query(conn, sql.c_str()) == 0;
+    bool success = mysql_query(conn->mysql, sql.c_str()) == 0;
     if (!success) {
-        LOG_ERROR("DB", std::string("Query failed: ") + mysql_error(conn));
+        LOG_ERROR("DB", std::string("Query failed: ") + mysql_error(conn->mysql));
+        conn->suspect = lostServer(mysql_errno(conn->mysql));
     }
     
     releaseConnection(conn);
@@ -91,16 +311,17 @@ bool Database::execute(const std::string& sql) {
 std::vector<std::map<std::string, std::string>> Database::query(const std::string& sql) {
     std::vector<std::map<std::string, std::string>> results;
     
-    MYSQL* conn = getConnection();
+    Connection* conn = getConnection();
     if (!conn) return results;
     
-    if (mysql_query(conn, sql.c_str()) != 0) {
-        LOG_ERROR("DB", std::string("Query failed: ") + mysql_error(conn));
+    if (mysql_query(conn->mysql, sql.c_str()) != 0) {
+        LOG_ERROR("DB", std::string("Query failed: ") + mysql_error(conn->mysql));
+        conn->suspect = lostServer(mysql_errno(conn->mysql));
         releaseConnection(conn);
         return results;
     }
     
-    MYSQL_RES* res = mysql_store_result(conn);
+    MYSQL_RES* res = mysql_store_result(conn->mysql);
     if (res) {
         int numFields = mysql_num_fields(res);
         MYSQL_FIELD* fields = mysql_fetch_fields(res);
@@ -125,7 +346,7 @@ std::vector<std::map<std::string, std::string>> Database::query(const std::strin
 // =============================================================================
 
 std::string Database::escapeString(const std::string& input) {
-    MYSQL* conn = getConnection();
+    Connection* conn = getConnection();
     if (!conn) {
         // Fallback: basic escaping without connection
         std::string result;
@@ -147,74 +368,325 @@ std::string Database::escapeString(const std::string& input) {
     
     // Use MySQL's proper escaping function
     std::vector<char> buffer(input.size() * 2 + 1);
-    unsigned long len = mysql_real_escape_string(conn, buffer.data(), input.c_str(), 
+    unsigned long len = mysql_real_escape_string(conn->mysql, buffer.data(), input.c_str(), 
                                                   static_cast<unsigned long>(input.size()));
     releaseConnection(conn);
     return std::string(buffer.data(), len);
 }
 
+// The string-parameter API binds every parameter as text on a real prepared
+// statement; MariaDB converts it to the column type like it did for the quoted literal
+static DBParams toParams(const std::vector<std::string>& params) {
+    DBParams bound;
+    bound.reserve(params.size());
+    for (const auto& param : params) {
+        bound.emplace_back(param);
+    }
+    return bound;
+}
+
 bool Database::executePrepared(const std::string& sql, const std::vector<std::string>& params) {
-    // Build query by replacing ? placeholders with escaped values
-    std::string finalSql;
-    finalSql.reserve(sql.size() + params.size() * 32);
-    
-    size_t paramIndex = 0;
-    for (size_t i = 0; i < sql.size(); ++i) {
-        if (sql[i] == '?' && paramIndex < params.size()) {
-            finalSql += '\'';
-            finalSql += escapeString(params[paramIndex]);
-            finalSql += '\'';
-            ++paramIndex;
-        } else {
-            finalSql += sql[i];
+    return executeStmt(sql, toParams(params)) >= 0;
+}
+
+std::vector<std::map<std::string, std::string>> Database::queryPrepared(
+    const std::string& sql, 
+    const std::vector<std::string>& params
+) {
+    return queryStmt(sql, toParams(params)).toMaps();
+}
+
+// =============================================================================
+// PREPARED STATEMENTS
+// =============================================================================
+
+ResultSet Database::queryStmt(const std::string& sql, const DBParams& params) {
+    ResultSet result;
+    Connection* conn = getConnection();
+    if (!conn) return result;
+    
+    if (!runStatement(conn, sql, params, &result, nullptr)) {
+        result = ResultSet{};
+    }
+    releaseConnection(conn);
+    return result;
+}
+
+int64_t Database::executeStmt(const std::string& sql, const DBParams& params) {
+    Connection* conn = getConnection();
+    if (!conn) return -1;
+    
+    int64_t affected = -1;
+    if (!runStatement(conn, sql, params, nullptr, &affected)) {
+        affected = -1;
+    }
+    releaseConnection(conn);
+    return affected;
+}
+
+bool Database::executeBatch(const std::string& sql, const std::vector<DBParams>& rows) {
+    if (rows.empty()) return true;
+    
+    Connection* conn = getConnection();
+    if (!conn) return false;
+    
+    if (mysql_autocommit(conn->mysql, 0) != 0) {
+        LOG_ERROR("DB", std::string("Batch: cannot start transaction: ") + mysql_error(conn->mysql));
+        conn->suspect = lostServer(mysql_errno(conn->mysql));
+        releaseConnection(conn);
+        return false;
+    }
+    
+    bool success = true;
+    for (const auto& params : rows) {
+        int64_t affected = -1;
+        if (!runStatement(conn, sql, params, nullptr, &affected)) {
+            success = false;
+            break;
         }
     }
     
-    if (paramIndex != params.size()) {
-        LOG_WARN("DB", "executePrepared: param count mismatch - expected " + 
-                 std::to_string(paramIndex) + " got " + std::to_string(params.size()));
+    if (success) {
+        success = mysql_commit(conn->mysql) == 0;
+        if (!success) {
+            LOG_ERROR("DB", std::string("Batch commit failed: ") + mysql_error(conn->mysql));
+        }
+    }
+    if (!success) {
+        mysql_rollback(conn->mysql);
+        conn->suspect = conn->suspect || lostServer(mysql_errno(conn->mysql));
     }
+    mysql_autocommit(conn->mysql, 1);
     
-    return execute(finalSql);
+    releaseConnection(conn);
+    return success;
 }
 
-std::vector<std::map<std::string, std::string>> Database::queryPrepared(
-    const std::string& sql, 
-    const std::vector<std::string>& params
-) {
-    // Build query by replacing ? placeholders with escaped values
-    std::string finalSql;
-    finalSql.reserve(sql.size() + params.size() * 32);
-    
-    size_t paramIndex = 0;
-    for (size_t i = 0; i < sql.size(); ++i) {
-        if (sql[i] == '?' && paramIndex < params.size()) {
-            finalSql += '\'';
-            finalSql += escapeString(params[paramIndex]);
-            finalSql += '\'';
-            ++paramIndex;
+MYSQL_STMT* Database::statement(Connection* conn, const std::string& sql) {
+    auto it = conn->statements.find(sql);
+    if (it != conn->statements.end()) {
+        return it->second;
+    }
+    
+    MYSQL_STMT* stmt = mysql_stmt_init(conn->mysql);
+    if (!stmt) {
+        LOG_ERROR("DB", "mysql_stmt_init failed");
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, sql.c_str(), static_cast<unsigned long>(sql.size())) != 0) {
+        LOG_ERROR("DB", std::string("Prepare failed: ") + mysql_stmt_error(stmt) + " [" + sql + "]");
+        conn->suspect = lostServer(mysql_stmt_errno(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    
+    // max_length of result fields is what the fetch buffers are sized from
+    BindFlag updateMaxLength = 1;
+    mysql_stmt_attr_set(stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &updateMaxLength);
+    
+    // Queries are a fixed set of literals, the cap only guards against a caller
+    // building SQL text at runtime
+    if (static_cast<int>(conn->statements.size()) >= m_config.statementCacheSize) {
+        closeStatements(conn);
+    }
+    conn->statements.emplace(sql, stmt);
+    return stmt;
+}
+
+bool Database::runStatement(Connection* conn, const std::string& sql, const DBParams& params,
+                            ResultSet* result, int64_t* affected) {
+    MYSQL_STMT* stmt = statement(conn, sql);
+    if (!stmt) return false;
+    
+    // A failed statement is dropped from the cache, the next call prepares it again
+    auto fail = [&](const char* what) {
+        LOG_ERROR("DB", std::string(what) + ": " + mysql_stmt_error(stmt) + " [" + sql + "]");
+        conn->suspect = lostServer(mysql_stmt_errno(stmt));
+        conn->statements.erase(sql);
+        mysql_stmt_close(stmt);
+        return false;
+    };
+    
+    // -------------------------------------------------------------------------
+    // Parameters
+    // -------------------------------------------------------------------------
+    size_t paramCount = mysql_stmt_param_count(stmt);
+    if (paramCount != params.size()) {
+        LOG_WARN("DB", "Prepared statement: param count mismatch - expected " + 
+                 std::to_string(paramCount) + " got " + std::to_string(params.size()) + " [" + sql + "]");
+        return false;
+    }
+    
+    std::vector<MYSQL_BIND> paramBinds(paramCount);
+    std::vector<unsigned long> paramLengths(paramCount);
+    std::memset(paramBinds.data(), 0, paramBinds.size() * sizeof(MYSQL_BIND));
+    for (size_t i = 0; i < paramCount; ++i) {
+        MYSQL_BIND& bind = paramBinds[i];
+        const auto& value = params[i].value;
+        if (auto* v = std::get_if<int64_t>(&value)) {
+            bind.buffer_type = MYSQL_TYPE_LONGLONG;
+            bind.buffer = const_cast<int64_t*>(v);
+        } else if (auto* v = std::get_if<double>(&value)) {
+            bind.buffer_type = MYSQL_TYPE_DOUBLE;
+            bind.buffer = const_cast<double*>(v);
+        } else if (auto* v = std::get_if<std::string>(&value)) {
+            bind.buffer_type = MYSQL_TYPE_STRING;
+            bind.buffer = const_cast<char*>(v->data());
+            paramLengths[i] = static_cast<unsigned long>(v->size());
+            bind.buffer_length = paramLengths[i];
+            bind.length = &paramLengths[i];
+        } else if (auto* v = std::get_if<DBBlob>(&value)) {
+            bind.buffer_type = MYSQL_TYPE_BLOB;
+            bind.buffer = const_cast<uint8_t*>(v->data());
+            paramLengths[i] = static_cast<unsigned long>(v->size());
+            bind.buffer_length = paramLengths[i];
+            bind.length = &paramLengths[i];
         } else {
-            finalSql += sql[i];
+            bind.buffer_type = MYSQL_TYPE_NULL;
         }
     }
+    if (paramCount > 0 && mysql_stmt_bind_param(stmt, paramBinds.data()) != 0) {
+        return fail("Bind failed");
+    }
+    
+    if (mysql_stmt_execute(stmt) != 0) {
+        return fail("Execute failed");
+    }
+    
+    MYSQL_RES* meta = mysql_stmt_result_metadata(stmt);
+    if (!meta) {
+        // INSERT / UPDATE / DELETE
+        if (affected) *affected = static_cast<int64_t>(mysql_stmt_affected_rows(stmt));
+        return true;
+    }
     
-    if (paramIndex != params.size()) {
-        LOG_WARN("DB", "queryPrepared: param count mismatch - expected " + 
-                 std::to_string(paramIndex) + " got " + std::to_string(params.size()));
+    // -------------------------------------------------------------------------
+    // Result set: buffered, so max_length sizes the string buffers exactly
+    // -------------------------------------------------------------------------
+    if (mysql_stmt_store_result(stmt) != 0) {
+        mysql_free_result(meta);
+        return fail("Store result failed");
     }
     
-    return query(finalSql);
+    unsigned int columnCount = mysql_num_fields(meta);
+    MYSQL_FIELD* fields = mysql_fetch_fields(meta);
+    
+    enum class Kind : uint8_t { Int, Double, Text, Blob };
+    struct Column {
+        Kind kind;
+        int64_t intValue;
+        double doubleValue;
+        std::vector<char> buffer;
+        unsigned long length;
+        BindFlag isNull;
+    };
+    std::vector<Column> columns(columnCount);
+    std::vector<MYSQL_BIND> resultBinds(columnCount);
+    std::memset(resultBinds.data(), 0, resultBinds.size() * sizeof(MYSQL_BIND));
+    
+    std::vector<std::string> names;
+    names.reserve(columnCount);
+    for (unsigned int i = 0; i < columnCount; ++i) {
+        const MYSQL_FIELD& field = fields[i];
+        Column& col = columns[i];
+        MYSQL_BIND& bind = resultBinds[i];
+        
+        switch (field.type) {
+            case MYSQL_TYPE_TINY:
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_LONGLONG:
+            case MYSQL_TYPE_YEAR:
+                col.kind = Kind::Int;
+                bind.buffer_type = MYSQL_TYPE_LONGLONG;
+                bind.buffer = &col.intValue;
+                bind.is_unsigned = (field.flags & UNSIGNED_FLAG) ? 1 : 0;
+                break;
+            case MYSQL_TYPE_FLOAT:
+            case MYSQL_TYPE_DOUBLE:
+                col.kind = Kind::Double;
+                bind.buffer_type = MYSQL_TYPE_DOUBLE;
+                bind.buffer = &col.doubleValue;
+                break;
+            default:
+                // Charset 63 is "binary": BLOB/VARBINARY columns stay bytes
+                col.kind = (field.charsetnr == 63 &&
+                            (field.type == MYSQL_TYPE_BLOB || field.type == MYSQL_TYPE_TINY_BLOB ||
+                             field.type == MYSQL_TYPE_MEDIUM_BLOB || field.type == MYSQL_TYPE_LONG_BLOB ||
+                             field.type == MYSQL_TYPE_VAR_STRING || field.type == MYSQL_TYPE_STRING))
+                           ? Kind::Blob : Kind::Text;
+                col.buffer.resize(std::max<unsigned long>(field.max_length, 1));
+                bind.buffer_type = col.kind == Kind::Blob ? MYSQL_TYPE_BLOB : MYSQL_TYPE_STRING;
+                bind.buffer = col.buffer.data();
+                bind.buffer_length = static_cast<unsigned long>(col.buffer.size());
+                break;
+        }
+        bind.length = &col.length;
+        bind.is_null = &col.isNull;
+        
+        names.emplace_back(field.name);
+    }
+    mysql_free_result(meta);
+    if (result) {
+        result->setColumns(std::move(names));
+    }
+    
+    if (mysql_stmt_bind_result(stmt, resultBinds.data()) != 0) {
+        mysql_stmt_free_result(stmt);
+        return fail("Bind result failed");
+    }
+    
+    if (result) {
+        result->reserveRows(static_cast<size_t>(mysql_stmt_num_rows(stmt)));
+    }
+    int status;
+    while ((status = mysql_stmt_fetch(stmt)) == 0 || status == MYSQL_DATA_TRUNCATED) {
+        if (!result) continue;
+        
+        result->addRow();
+        for (unsigned int i = 0; i < columnCount; ++i) {
+            const Column& col = columns[i];
+            if (col.isNull) {
+                result->addNull();
+                continue;
+            }
+            
+            size_t length = std::min<size_t>(col.length, col.buffer.size());
+            switch (col.kind) {
+                case Kind::Int:    result->addInt(col.intValue); break;
+                case Kind::Double: result->addDouble(col.doubleValue); break;
+                case Kind::Text:   result->addText(std::string_view(col.buffer.data(), length)); break;
+                case Kind::Blob:   result->addBlob(col.buffer.data(), length); break;
+            }
+        }
+    }
+    
+    // Statement stays prepared in the cache; only the result is released
+    mysql_stmt_free_result(stmt);
+    if (status != MYSQL_NO_DATA) {
+        return fail("Fetch failed");
+    }
+    return true;
 }
 
 #else
 
 // Stub implementations when MariaDB is not available
-bool Database::init(const DBConfig&) {
+bool Database::init(const DBConfig& config) {
     LOG_WARN("DB", "MariaDB not available - database disabled");
+    // Async callers still get their (empty) completions posted back
+    startWorkers(config.workerThreads);
     return true;
 }
 
-void Database::shutdown() {}
+void Database::shutdown() {
+    stopWorkers();
+}
+
+DBPoolStats Database::poolStats() {
+    return {};
+}
 
 bool Database::execute(const std::string&) {
     return false;
@@ -252,7 +724,115 @@ std::vector<std::map<std::string, std::string>> Database::queryPrepared(
     return {};
 }
 
+ResultSet Database::queryStmt(const std::string&, const DBParams&) {
+    return {};
+}
+
+int64_t Database::executeStmt(const std::string&, const DBParams&) {
+    return -1;
+}
+
+bool Database::executeBatch(const std::string&, const std::vector<DBParams>&) {
+    return false;
+}
+
 #endif
 
+// =============================================================================
+// ASYNC EXECUTOR
+// =============================================================================
+
+void Database::queryAsync(const asio::any_io_executor& executor, std::string sql,
+                          DBParams params, std::function<void(ResultSet)> done) {
+    runAsync(executor,
+        [sql = std::move(sql), params = std::move(params)](Database& db) {
+            return db.queryStmt(sql, params);
+        },
+        std::move(done));
+}
+
+void Database::executeAsync(const asio::any_io_executor& executor, std::string sql,
+                            DBParams params, std::function<void(bool)> done) {
+    if (!done) {
+        // Fire and forget: nothing to post back
+        post([this, sql = std::move(sql), params = std::move(params)]() {
+            executeStmt(sql, params);
+        });
+        return;
+    }
+    runAsync(executor,
+        [sql = std::move(sql), params = std::move(params)](Database& db) {
+            return db.executeStmt(sql, params) >= 0;
+        },
+        std::move(done));
+}
+
+void Database::runAsync(std::function<void(Database&)> work) {
+    post([this, work = std::move(work)]() {
+        work(*this);
+    });
+}
+
+size_t Database::pendingJobs() {
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    return m_jobs.size();
+}
+
+void Database::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        if (!m_workers.empty() && !m_stopping) {
+            m_jobs.push_back(std::move(job));
+            m_jobsCv.notify_one();
+            return;
+        }
+    }
+    // No worker (before init / after shutdown): still complete, on this thread
+    job();
+}
+
+void Database::startWorkers(int count) {
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    if (!m_workers.empty()) return;
+    m_stopping = false;
+    for (int i = 0; i < std::max(1, count); ++i) {
+        m_workers.emplace_back(&Database::workerLoop, this);
+    }
+    LOG_INFO("DB", "Started " + std::to_string(m_workers.size()) + " DB worker threads");
+}
+
+void Database::stopWorkers() {
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        m_stopping = true;
+        workers.swap(m_workers);
+    }
+    m_jobsCv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void Database::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobsMutex);
+            m_jobsCv.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            // Drain what is queued even when stopping: pending writes must not be lost
+            if (m_jobs.empty()) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        
+        try {
+            job();
+        } catch (const std::exception& e) {
+            LOG_ERROR("DB", std::string("DB job failed: ") + e.what());
+        }
+    }
+}
+
 } // namespace knc
 
@@ -0,0 +1,155 @@
+/**
+ * @file ResultSet.cpp
+ * @brief Typed, columnar result of a database query
+ */
+
+#include "db/ResultSet.h"
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
+namespace knc {
+
+// =============================================================================
+// ROW ACCESS
+// =============================================================================
+
+const ResultSet::Cell* ResultSet::Row::cell(int col) const {
+    if (col < 0 || static_cast<size_t>(col) >= m_set->m_columns.size() || m_index >= m_set->m_rows) {
+        return nullptr;
+    }
+    return &m_set->m_cells[m_index * m_set->m_columns.size() + col];
+}
+
+int64_t ResultSet::Row::getInt64(int col, int64_t fallback) const {
+    const Cell* c = cell(col);
+    if (!c) return fallback;
+    switch (c->type) {
+        case Type::Int:    return c->i;
+        case Type::Double: return static_cast<int64_t>(c->d);
+        case Type::Text: {
+            // DECIMAL and computed columns can still come back as text
+            std::string_view text = getText(col);
+            const char* begin = text.data();
+            const char* end = begin + text.size();
+            if (begin != end && *begin == '+') ++begin;
+            int64_t value = fallback;
+            auto res = std::from_chars(begin, end, value);
+            return res.ec == std::errc() ? value : fallback;
+        }
+        default:           return fallback;
+    }
+}
+
+double ResultSet::Row::getDouble(int col, double fallback) const {
+    const Cell* c = cell(col);
+    if (!c) return fallback;
+    switch (c->type) {
+        case Type::Double: return c->d;
+        case Type::Int:    return static_cast<double>(c->i);
+        case Type::Text: {
+            std::string text(getText(col));
+            char* end = nullptr;
+            double value = std::strtod(text.c_str(), &end);
+            return end != text.c_str() ? value : fallback;
+        }
+        default:           return fallback;
+    }
+}
+
+std::string_view ResultSet::Row::getText(int col) const {
+    const Cell* c = cell(col);
+    if (!c || (c->type != Type::Text && c->type != Type::Blob)) return {};
+    return std::string_view(m_set->m_bytes.data() + c->offset, c->length);
+}
+
+std::string ResultSet::Row::getString(int col) const {
+    const Cell* c = cell(col);
+    if (!c) return {};
+    switch (c->type) {
+        case Type::Int:    return std::to_string(c->i);
+        case Type::Double: {
+            // Shortest text that reads back the same, like the text protocol sends
+            char buf[32];
+            for (int precision = 6; precision <= 17; ++precision) {
+                std::snprintf(buf, sizeof(buf), "%.*g", precision, c->d);
+                if (std::strtod(buf, nullptr) == c->d) break;
+            }
+            return buf;
+        }
+        case Type::Text:
+        case Type::Blob:   return std::string(getText(col));
+        default:           return {};
+    }
+}
+
+// =============================================================================
+// RESULT SET
+// =============================================================================
+
+int ResultSet::column(std::string_view name) const {
+    // A handful of columns: a linear scan beats hashing
+    for (size_t i = 0; i < m_columns.size(); ++i) {
+        if (m_columns[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::vector<std::map<std::string, std::string>> ResultSet::toMaps() const {
+    std::vector<std::map<std::string, std::string>> rows;
+    rows.reserve(m_rows);
+    for (const auto& row : *this) {
+        std::map<std::string, std::string> rowMap;
+        for (size_t i = 0; i < m_columns.size(); ++i) {
+            rowMap[m_columns[i]] = row.getString(static_cast<int>(i));
+        }
+        rows.push_back(std::move(rowMap));
+    }
+    return rows;
+}
+
+// =============================================================================
+// BUILDING
+// =============================================================================
+
+void ResultSet::setColumns(std::vector<std::string> names) {
+    m_columns = std::move(names);
+}
+
+void ResultSet::reserveRows(size_t rows) {
+    m_cells.reserve(rows * m_columns.size());
+}
+
+void ResultSet::addNull() {
+    m_cells.emplace_back();
+}
+
+void ResultSet::addInt(int64_t value) {
+    Cell& c = m_cells.emplace_back();
+    c.type = Type::Int;
+    c.i = value;
+}
+
+void ResultSet::addDouble(double value) {
+    Cell& c = m_cells.emplace_back();
+    c.type = Type::Double;
+    c.d = value;
+}
+
+void ResultSet::addText(std::string_view value) {
+    addBytes(Type::Text, value.data(), value.size());
+}
+
+void ResultSet::addBlob(const void* data, size_t len) {
+    addBytes(Type::Blob, data, len);
+}
+
+void ResultSet::addBytes(Type type, const void* data, size_t len) {
+    Cell& c = m_cells.emplace_back();
+    c.type = type;
+    c.offset = m_bytes.size();
+    c.length = static_cast<uint32_t>(len);
+    m_bytes.append(static_cast<const char*>(data), len);
+}
+
+} // namespace knc
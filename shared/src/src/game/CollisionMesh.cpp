@@ -0,0 +1,497 @@
+/**
+ * @file CollisionMesh.cpp
+ * @brief Track collision mesh (track.COL) with a BVH for position queries
+ */
+
+#include "game/CollisionMesh.h"
+#include "logging/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include "../../PakReader.h"
+
+namespace knc {
+
+namespace {
+    using Vec3 = CollisionMesh::Vec3;
+    
+    // track.COL layout (FILE_FORMATS.md 7.1)
+    constexpr size_t HEADER_SIZE = 16;
+    constexpr size_t VERTEX_SIZE = 12;
+    constexpr size_t FACE_SIZE = 6;
+    constexpr size_t ZONE_SIZE = 56;
+    constexpr size_t ZONE_NAME_OFFSET = 48;  // After the 12 floats
+    constexpr int32_t KNOWN_VERSION = 17;
+    
+    // BVH build
+    constexpr int SAH_BINS = 16;
+    constexpr uint32_t MIN_LEAF = 2;    // Never split below this
+    constexpr uint32_t MAX_LEAF = 8;    // Always split above this
+    // Traversal keeps at most one pending sibling per level: a tree no deeper
+    // than MAX_DEPTH always fits the fixed stack
+    constexpr int STACK_SIZE = 64;
+    constexpr uint32_t MAX_DEPTH = STACK_SIZE - 2;
+    
+    Vec3 operator+(const Vec3& a, const Vec3& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+    Vec3 operator-(const Vec3& a, const Vec3& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+    Vec3 operator*(const Vec3& a, float s) { return {a.x * s, a.y * s, a.z * s}; }
+    float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Vec3 cross(const Vec3& a, const Vec3& b) {
+        return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+    Vec3 vmin(const Vec3& a, const Vec3& b) { return {std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z)}; }
+    Vec3 vmax(const Vec3& a, const Vec3& b) { return {std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z)}; }
+    float axis(const Vec3& v, int a) { return a == 0 ? v.x : (a == 1 ? v.y : v.z); }
+    
+    struct Bounds {
+        Vec3 min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+        Vec3 max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+        
+        void grow(const Vec3& p) { min = vmin(min, p); max = vmax(max, p); }
+        void grow(const Bounds& b) { min = vmin(min, b.min); max = vmax(max, b.max); }
+        float area() const {
+            if (max.x < min.x) return 0.0f;
+            Vec3 d = max - min;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+    };
+    
+    float boxDistance2(const Vec3& p, const Vec3& min, const Vec3& max) {
+        float dx = std::max({min.x - p.x, 0.0f, p.x - max.x});
+        float dy = std::max({min.y - p.y, 0.0f, p.y - max.y});
+        float dz = std::max({min.z - p.z, 0.0f, p.z - max.z});
+        return dx * dx + dy * dy + dz * dz;
+    }
+    
+    // Entry distance of the ray into the box, +inf if it misses within tMax
+    float boxEnter(const Vec3& origin, const Vec3& invDir, const Vec3& min, const Vec3& max, float tMax) {
+        float t1 = (min.x - origin.x) * invDir.x, t2 = (max.x - origin.x) * invDir.x;
+        float tNear = std::min(t1, t2), tFar = std::max(t1, t2);
+        t1 = (min.y - origin.y) * invDir.y; t2 = (max.y - origin.y) * invDir.y;
+        tNear = std::max(tNear, std::min(t1, t2)); tFar = std::min(tFar, std::max(t1, t2));
+        t1 = (min.z - origin.z) * invDir.z; t2 = (max.z - origin.z) * invDir.z;
+        tNear = std::max(tNear, std::min(t1, t2)); tFar = std::min(tFar, std::max(t1, t2));
+        if (tFar < std::max(tNear, 0.0f) || tNear > tMax) return std::numeric_limits<float>::infinity();
+        return std::max(tNear, 0.0f);
+    }
+    
+    // Ericson, Real-Time Collision Detection 5.1.5
+    Vec3 closestOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c) {
+        Vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = dot(ab, ap), d2 = dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return a;
+        
+        Vec3 bp = p - b;
+        float d3 = dot(ab, bp), d4 = dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return b;
+        
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+        
+        Vec3 cp = p - c;
+        float d5 = dot(ab, cp), d6 = dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return c;
+        
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+        
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+        
+        float denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+    
+    // Moller-Trumbore, both faces; distance along the ray or -1
+    float intersect(const Vec3& origin, const Vec3& dir, const Vec3& a, const Vec3& b, const Vec3& c) {
+        Vec3 e1 = b - a, e2 = c - a;
+        Vec3 pv = cross(dir, e2);
+        float det = dot(e1, pv);
+        if (std::fabs(det) < 1e-12f) return -1.0f;
+        float invDet = 1.0f / det;
+        Vec3 tv = origin - a;
+        float u = dot(tv, pv) * invDet;
+        if (u < 0.0f || u > 1.0f) return -1.0f;
+        Vec3 qv = cross(tv, e1);
+        float v = dot(dir, qv) * invDet;
+        if (v < 0.0f || u + v > 1.0f) return -1.0f;
+        return dot(e2, qv) * invDet;
+    }
+    
+    template <typename T>
+    T readLE(const uint8_t* p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+}
+
+// =============================================================================
+// LOADING
+// =============================================================================
+
+std::shared_ptr<const CollisionMesh> CollisionMesh::load(const uint8_t* data, size_t size, const std::string& name,
+                                                         int upAxis) {
+    if (size < HEADER_SIZE) {
+        LOG_WARN("TRACK", name + ": track.COL too small");
+        return nullptr;
+    }
+    
+    const int32_t version = readLE<int32_t>(data);
+    const int32_t vertexCount = readLE<int32_t>(data + 4);
+    const int32_t faceCount = readLE<int32_t>(data + 8);
+    const int32_t zoneCount = readLE<int32_t>(data + 12);
+    if (vertexCount < 0 || faceCount < 0 || zoneCount < 0 || vertexCount > 65536) {
+        LOG_WARNF("TRACK", "{}: bad track.COL header ({} vertices, {} faces, {} zones)",
+                  name, vertexCount, faceCount, zoneCount);
+        return nullptr;
+    }
+    if (version != KNOWN_VERSION) {
+        LOG_WARNF("TRACK", "{}: track.COL version {} (expected {}), reading it anyway", name, version, KNOWN_VERSION);
+    }
+    
+    const size_t facesOffset = HEADER_SIZE + size_t(vertexCount) * VERTEX_SIZE;
+    const size_t zonesOffset = facesOffset + size_t(faceCount) * FACE_SIZE;
+    if (size < zonesOffset) {
+        LOG_WARN("TRACK", name + ": track.COL truncated");
+        return nullptr;
+    }
+    
+    auto mesh = std::make_shared<CollisionMesh>();
+    mesh->m_name = name;
+    mesh->m_upAxis = upAxis == AXIS_Y ? AXIS_Y : AXIS_Z;
+    
+    std::vector<Vec3> vertices(vertexCount);
+    for (int32_t i = 0; i < vertexCount; ++i) {
+        const uint8_t* v = data + HEADER_SIZE + size_t(i) * VERTEX_SIZE;
+        vertices[i] = Vec3{readLE<float>(v), readLE<float>(v + 4), readLE<float>(v + 8)};
+    }
+    
+    mesh->m_triangles.reserve(faceCount);
+    size_t degenerate = 0;
+    for (int32_t i = 0; i < faceCount; ++i) {
+        const uint8_t* f = data + facesOffset + size_t(i) * FACE_SIZE;
+        uint16_t i0 = readLE<uint16_t>(f), i1 = readLE<uint16_t>(f + 2), i2 = readLE<uint16_t>(f + 4);
+        if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount) {
+            LOG_WARNF("TRACK", "{}: face {} indexes past the {} vertices", name, i, vertexCount);
+            return nullptr;
+        }
+        Triangle tri{vertices[i0], vertices[i1], vertices[i2]};
+        if (dot(cross(tri.b - tri.a, tri.c - tri.a), cross(tri.b - tri.a, tri.c - tri.a)) <= 0.0f) {
+            ++degenerate;   // Zero area: can't be hit, only costs tests
+            continue;
+        }
+        mesh->m_triangles.push_back(tri);
+    }
+    
+    // Zones are optional for the queries: keep what is there
+    size_t zonesPresent = std::min<size_t>(zoneCount, (size - zonesOffset) / ZONE_SIZE);
+    if (zonesPresent < size_t(zoneCount)) {
+        LOG_WARNF("TRACK", "{}: only {} of {} zones present", name, zonesPresent, zoneCount);
+    }
+    for (size_t i = 0; i < zonesPresent; ++i) {
+        const uint8_t* z = data + zonesOffset + i * ZONE_SIZE;
+        Zone zone;
+        zone.min = Vec3{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+        zone.max = Vec3{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+        for (int c = 0; c < 4; ++c) {
+            const uint8_t* p = z + c * 12;
+            zone.corners[c] = Vec3{readLE<float>(p), readLE<float>(p + 4), readLE<float>(p + 8)};
+            zone.min = vmin(zone.min, zone.corners[c]);
+            zone.max = vmax(zone.max, zone.corners[c]);
+        }
+        const char* text = reinterpret_cast<const char*>(z + ZONE_NAME_OFFSET);
+        zone.name.assign(text, strnlen(text, ZONE_SIZE - ZONE_NAME_OFFSET));
+        mesh->m_zones.push_back(std::move(zone));
+    }
+    
+    mesh->build();
+    
+    LOG_INFOF("TRACK", "{}: {} triangles ({} degenerate skipped), {} zones, {} BVH nodes",
+              name, mesh->m_triangles.size(), degenerate, mesh->m_zones.size(), mesh->m_nodes.size());
+    return mesh;
+}
+
+bool CollisionMesh::openGameData(const std::string& gameDir) {
+    return KnC::GetPakReader().OpenGameDir(gameDir);
+}
+
+std::shared_ptr<const CollisionMesh> CollisionMesh::loadFromPak(const std::string& mapDir, int upAxis) {
+    std::string dir = mapDir;
+    while (!dir.empty() && (dir.back() == '/' || dir.back() == '\\')) dir.pop_back();
+    
+    std::vector<uint8_t> data = KnC::GetPakReader().ReadPath(dir + "/track.COL");
+    if (data.empty()) {
+        LOG_WARN("TRACK", "No track.COL in the PAKs for " + dir);
+        return nullptr;
+    }
+    return load(data.data(), data.size(), dir, upAxis);
+}
+
+// =============================================================================
+// BVH BUILD (binned SAH)
+// =============================================================================
+
+void CollisionMesh::build() {
+    m_nodes.clear();
+    if (m_triangles.empty()) return;
+    
+    const uint32_t count = static_cast<uint32_t>(m_triangles.size());
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<Vec3> centroids(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const Triangle& t = m_triangles[i];
+        centroids[i] = (t.a + t.b + t.c) * (1.0f / 3.0f);
+    }
+    
+    m_nodes.reserve(size_t(count) * 2);
+    Node root;
+    root.first = 0;
+    root.count = count;
+    m_nodes.push_back(root);
+    if (uint32_t capped = split(0, 0, order, centroids)) {
+        LOG_WARNF("TRACK", "{}: BVH depth limit hit, {} leaves kept oversized", m_name, capped);
+    }
+    
+    // Leaves index straight into the triangle array
+    std::vector<Triangle> sorted;
+    sorted.reserve(count);
+    for (uint32_t i : order) sorted.push_back(m_triangles[i]);
+    m_triangles = std::move(sorted);
+}
+
+uint32_t CollisionMesh::split(uint32_t nodeIndex, uint32_t depth, std::vector<uint32_t>& order, std::vector<Vec3>& centroids) {
+    const uint32_t first = m_nodes[nodeIndex].first;
+    const uint32_t count = m_nodes[nodeIndex].count;
+    
+    Bounds bounds, centroidBounds;
+    for (uint32_t i = first; i < first + count; ++i) {
+        const Triangle& t = m_triangles[order[i]];
+        bounds.grow(t.a);
+        bounds.grow(t.b);
+        bounds.grow(t.c);
+        centroidBounds.grow(centroids[order[i]]);
+    }
+    m_nodes[nodeIndex].min = bounds.min;
+    m_nodes[nodeIndex].max = bounds.max;
+    if (count <= MIN_LEAF) return 0;
+    // Degenerate SAH splits (e.g. one triangle peeled off per level): stop here,
+    // a fat leaf is only slower
+    if (depth >= MAX_DEPTH) return 1;
+    
+    // Cheapest bin boundary over the three axes: cost ~ area * triangles on each side
+    int bestAxis = -1;
+    int bestBin = 0;
+    float bestCost = std::numeric_limits<float>::max();
+    for (int a = 0; a < 3; ++a) {
+        const float lo = axis(centroidBounds.min, a);
+        const float extent = axis(centroidBounds.max, a) - lo;
+        if (extent <= 0.0f) continue;
+        const float scale = SAH_BINS / extent;
+        
+        Bounds binBounds[SAH_BINS];
+        uint32_t binCount[SAH_BINS] = {};
+        for (uint32_t i = first; i < first + count; ++i) {
+            int b = std::min(SAH_BINS - 1, static_cast<int>((axis(centroids[order[i]], a) - lo) * scale));
+            const Triangle& t = m_triangles[order[i]];
+            binBounds[b].grow(t.a);
+            binBounds[b].grow(t.b);
+            binBounds[b].grow(t.c);
+            ++binCount[b];
+        }
+        
+        float leftArea[SAH_BINS - 1];
+        uint32_t leftCount[SAH_BINS - 1];
+        Bounds acc;
+        uint32_t n = 0;
+        for (int b = 0; b < SAH_BINS - 1; ++b) {
+            acc.grow(binBounds[b]);
+            n += binCount[b];
+            leftArea[b] = acc.area();
+            leftCount[b] = n;
+        }
+        acc = Bounds();
+        n = 0;
+        for (int b = SAH_BINS - 1; b > 0; --b) {
+            acc.grow(binBounds[b]);
+            n += binCount[b];
+            float cost = leftArea[b - 1] * leftCount[b - 1] + acc.area() * n;
+            if (leftCount[b - 1] > 0 && n > 0 && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = a;
+                bestBin = b - 1;
+            }
+        }
+    }
+    
+    // Splitting has to beat testing every triangle here
+    const float leafCost = bounds.area() * count;
+    if (count <= MAX_LEAF && (bestAxis < 0 || bestCost >= leafCost)) return 0;
+    
+    uint32_t mid;
+    if (bestAxis >= 0) {
+        const float lo = axis(centroidBounds.min, bestAxis);
+        const float scale = SAH_BINS / (axis(centroidBounds.max, bestAxis) - lo);
+        auto it = std::partition(order.begin() + first, order.begin() + first + count, [&](uint32_t t) {
+            int b = std::min(SAH_BINS - 1, static_cast<int>((axis(centroids[t], bestAxis) - lo) * scale));
+            return b <= bestBin;
+        });
+        mid = static_cast<uint32_t>(it - order.begin());
+    } else {
+        // All centroids in one point: any halving will do
+        mid = first + count / 2;
+    }
+    if (mid == first || mid == first + count) mid = first + count / 2;
+    
+    const uint32_t left = static_cast<uint32_t>(m_nodes.size());
+    Node child;
+    child.first = first;
+    child.count = mid - first;
+    m_nodes.push_back(child);
+    child.first = mid;
+    child.count = first + count - mid;
+    m_nodes.push_back(child);
+    m_nodes[nodeIndex].first = left;
+    m_nodes[nodeIndex].count = 0;
+    
+    return split(left, depth + 1, order, centroids) + split(left + 1, depth + 1, order, centroids);
+}
+
+// =============================================================================
+// QUERIES
+// =============================================================================
+
+float CollisionMesh::nearestSurface(const Vec3& p, float maxDistance) const {
+    const float inf = std::numeric_limits<float>::infinity();
+    if (m_nodes.empty()) return inf;
+    
+    float best2 = maxDistance >= std::sqrt(std::numeric_limits<float>::max()) ? inf : maxDistance * maxDistance;
+    bool found = false;
+    
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = m_nodes[stack[--top]];
+        if (boxDistance2(p, node.min, node.max) > best2) continue;
+        
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const Triangle& t = m_triangles[i];
+                Vec3 d = p - closestOnTriangle(p, t.a, t.b, t.c);
+                float dist2 = dot(d, d);
+                if (dist2 <= best2) {
+                    best2 = dist2;
+                    found = true;
+                }
+            }
+            continue;
+        }
+        
+        // Nearer child on top of the stack: shrinks best2 before the other is checked
+        const Node& l = m_nodes[node.first];
+        const Node& r = m_nodes[node.first + 1];
+        float dl = boxDistance2(p, l.min, l.max);
+        float dr = boxDistance2(p, r.min, r.max);
+        if (dl <= dr) {
+            if (dr <= best2) stack[top++] = node.first + 1;
+            if (dl <= best2) stack[top++] = node.first;
+        } else {
+            if (dl <= best2) stack[top++] = node.first;
+            if (dr <= best2) stack[top++] = node.first + 1;
+        }
+    }
+    return found ? std::sqrt(best2) : inf;
+}
+
+bool CollisionMesh::raycast(const Vec3& origin, const Vec3& direction, float maxDistance, Hit* hit) const {
+    if (m_nodes.empty()) return false;
+    float length = std::sqrt(dot(direction, direction));
+    if (length <= 0.0f) return false;
+    const Vec3 dir = direction * (1.0f / length);
+    
+    // Axis-parallel rays: a huge inverse keeps the slab test NaN-free
+    auto inverse = [](float d) { return std::fabs(d) > 1e-20f ? 1.0f / d : std::copysign(1e30f, d); };
+    const Vec3 invDir{inverse(dir.x), inverse(dir.y), inverse(dir.z)};
+    
+    float best = maxDistance;
+    int64_t bestTriangle = -1;
+    
+    uint32_t stack[STACK_SIZE];
+    int top = 0;
+    if (boxEnter(origin, invDir, m_nodes[0].min, m_nodes[0].max, best) == std::numeric_limits<float>::infinity()) {
+        return false;
+    }
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = m_nodes[stack[--top]];
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const Triangle& t = m_triangles[i];
+                float d = intersect(origin, dir, t.a, t.b, t.c);
+                if (d >= 0.0f && d <= best) {
+                    best = d;
+                    bestTriangle = i;
+                }
+            }
+            continue;
+        }
+        
+        float tl = boxEnter(origin, invDir, m_nodes[node.first].min, m_nodes[node.first].max, best);
+        float tr = boxEnter(origin, invDir, m_nodes[node.first + 1].min, m_nodes[node.first + 1].max, best);
+        // Nearer child popped first: its hit prunes the other
+        const float inf = std::numeric_limits<float>::infinity();
+        if (tl <= tr) {
+            if (tr != inf) stack[top++] = node.first + 1;
+            if (tl != inf) stack[top++] = node.first;
+        } else {
+            if (tl != inf) stack[top++] = node.first;
+            if (tr != inf) stack[top++] = node.first + 1;
+        }
+    }
+    
+    if (bestTriangle < 0) return false;
+    if (hit) {
+        const Triangle& t = m_triangles[bestTriangle];
+        Vec3 n = cross(t.b - t.a, t.c - t.a);
+        n = n * (1.0f / std::sqrt(dot(n, n)));
+        if (dot(n, dir) > 0.0f) n = n * -1.0f;
+        hit->distance = best;
+        hit->point = origin + dir * best;
+        hit->normal = n;
+        hit->triangle = static_cast<uint32_t>(bestTriangle);
+    }
+    return true;
+}
+
+bool CollisionMesh::groundBelow(const Vec3& p, float maxDrop, Hit* hit) const {
+    const Vec3 down = m_upAxis == AXIS_Y ? Vec3{0.0f, -1.0f, 0.0f} : Vec3{0.0f, 0.0f, -1.0f};
+    return raycast(p, down, maxDrop, hit);
+}
+
+const CollisionMesh::Zone* CollisionMesh::zoneAt(const Vec3& p, float height) const {
+    for (const Zone& zone : m_zones) {
+        bool inside = true;
+        for (int a = 0; a < 3 && inside; ++a) {
+            const float margin = a == m_upAxis ? height : 0.0f;
+            inside = axis(p, a) >= axis(zone.min, a) - margin && axis(p, a) <= axis(zone.max, a) + margin;
+        }
+        if (inside) return &zone;
+    }
+    return nullptr;
+}
+
+CollisionMesh::Vec3 CollisionMesh::boundsMin() const {
+    return m_nodes.empty() ? Vec3{} : m_nodes[0].min;
+}
+
+CollisionMesh::Vec3 CollisionMesh::boundsMax() const {
+    return m_nodes.empty() ? Vec3{} : m_nodes[0].max;
+}
+
+} // namespace knc
@@ -8,6 +8,7 @@
 #include "net/Packet.h"
 #include "logging/Logger.h"
 #include <algorithm>
+#include <cmath>
 
 namespace knc {
 
@@ -39,6 +40,7 @@ bool Room::addPlayer(std::shared_ptr<Session> session, int32_t characterId,
     }
     
     m_players[session->id()] = player;
+    m_playerCount.store(m_sessions.size(), std::memory_order_relaxed);
     
     LOG_INFO("ROOM", "Player joined room " + std::to_string(m_id) + 
              ": charId=" + std::to_string(characterId) + 
@@ -63,6 +65,9 @@ void Room::removePlayer(uint32_t sessionId) {
     
     // Remove from players map
     m_players.erase(sessionId);
+    m_positions.erase(sessionId);
+    m_moveChannels.erase(sessionId);
+    m_playerCount.store(m_sessions.size(), std::memory_order_relaxed);
     
     // Reassign host if needed
     if (m_hostSessionId == sessionId && !m_sessions.empty()) {
@@ -74,6 +79,38 @@ void Room::removePlayer(uint32_t sessionId) {
     }
 }
 
+bool Room::rebindSession(uint32_t oldSessionId, std::shared_ptr<Session> session) {
+    auto it = m_players.find(oldSessionId);
+    if (it == m_players.end()) return false;
+    
+    const uint32_t newSessionId = session->id();
+    for (auto& s : m_sessions) {
+        if (s->id() == oldSessionId) {
+            s = std::move(session);
+            break;
+        }
+    }
+    
+    RoomPlayer player = it->second;
+    player.sessionId = newSessionId;
+    m_players.erase(it);
+    m_players[newSessionId] = player;
+    
+    auto pos = m_positions.find(oldSessionId);
+    if (pos != m_positions.end()) {
+        PositionSample sample = pos->second;
+        m_positions.erase(pos);
+        m_positions[newSessionId] = sample;
+    }
+    // A new connection negotiates compact movement again
+    m_moveChannels.erase(oldSessionId);
+    
+    if (m_hostSessionId == oldSessionId) {
+        m_hostSessionId = newSessionId;
+    }
+    return true;
+}
+
 RoomPlayer* Room::getPlayer(uint32_t sessionId) {
     auto it = m_players.find(sessionId);
     return (it != m_players.end()) ? &it->second : nullptr;
@@ -177,13 +214,38 @@ uint8_t Room::findEmptySlot() const {
     return 0;  // Fallback
 }
 
+void Room::updatePosition(uint32_t sessionId, int32_t characterId, float x, float y, float z, float rot) {
+    auto& sample = m_positions[sessionId];
+    sample.characterId = characterId;
+    sample.x = x;
+    sample.y = y;
+    sample.z = z;
+    sample.rot = rot;
+    sample.dirty = true;
+}
+
+void Room::clearPositions() {
+    m_positions.clear();
+    m_lastStandings.clear();
+    m_moveChannels.clear();
+    m_hasQuantizer = false;
+}
+
+void Room::initQuantizer(float x, float y, float z) {
+    // Track-relative grid, snapped to whole units
+    m_quantizer.originX = std::floor(x);
+    m_quantizer.originY = std::floor(y);
+    m_quantizer.originZ = std::floor(z);
+    m_hasQuantizer = true;
+}
+
 void Room::setState(RoomState state) {
-    m_state = state;
+    m_state.store(state, std::memory_order_relaxed);
     LOG_INFO("ROOM", "Room " + std::to_string(m_id) + " state -> " + std::to_string(static_cast<int>(state)));
 }
 
 bool Room::canStart() const {
-    if (m_state != RoomState::Waiting) return false;
+    if (state() != RoomState::Waiting) return false;
     if (m_sessions.size() < 1) return false;
     
     // For tutorial mode, 1 player is enough
@@ -196,14 +258,15 @@ bool Room::canStart() const {
 }
 
 void Room::broadcast(const Packet& packet) {
-    auto data = packet.serialize();
+    // One serialized buffer shared by every recipient
+    auto data = Session::makeShared(packet);
     for (auto& session : m_sessions) {
         session->send(data);
     }
 }
 
 void Room::broadcastExcept(const Packet& packet, uint32_t excludeSessionId) {
-    auto data = packet.serialize();
+    auto data = Session::makeShared(packet);
     for (auto& session : m_sessions) {
         if (session->id() != excludeSessionId) {
             session->send(data);
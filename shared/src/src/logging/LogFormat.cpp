@@ -0,0 +1,128 @@
+/**
+ * @file LogFormat.cpp
+ * @brief {}-style formatting for the LOG_*F macros
+ */
+
+#include "logging/LogFormat.h"
+#include <cstring>
+
+namespace knc {
+namespace logfmt {
+namespace detail {
+
+void vformat(std::string& out, std::string_view fmt, const Arg* args, size_t count) {
+    size_t next = 0;
+    size_t i = 0;
+    while (i < fmt.size()) {
+        char c = fmt[i];
+        if (c == '{') {
+            if (i + 1 < fmt.size() && fmt[i + 1] == '{') {
+                out += '{';
+                i += 2;
+                continue;
+            }
+            size_t close = fmt.find('}', i + 1);
+            if (close == std::string_view::npos) {
+                // Unterminated placeholder, keep the rest as text
+                out.append(fmt.data() + i, fmt.size() - i);
+                return;
+            }
+            std::string_view inner = fmt.substr(i + 1, close - i - 1);
+            Spec spec;
+            if (!inner.empty() && inner[0] == ':') {
+                spec = parseSpec(inner.substr(1));
+            }
+            if (next < count) {
+                args[next].append(out, args[next].value, spec);
+            } else {
+                out += "{?}";
+            }
+            ++next;
+            i = close + 1;
+            continue;
+        }
+        if (c == '}' && i + 1 < fmt.size() && fmt[i + 1] == '}') {
+            out += '}';
+            i += 2;
+            continue;
+        }
+        
+        // Copy the literal run up to the next brace in one go
+        size_t end = fmt.find_first_of("{}", i + 1);
+        if (end == std::string_view::npos) end = fmt.size();
+        out.append(fmt.data() + i, end - i);
+        i = end;
+    }
+}
+
+} // namespace detail
+
+void formatEncoded(std::string& out, std::string_view fmt, const uint8_t* args, size_t len) {
+    // Decoded values live here, the Arg list points at them
+    struct Value {
+        int64_t i;
+        uint64_t u;
+        double f;
+        bool b;
+        char c;
+        std::string_view s;
+    };
+    Value values[MAX_ENCODED_ARGS];
+    detail::Arg list[MAX_ENCODED_ARGS];
+    size_t count = 0;
+    
+    const uint8_t* p = args;
+    const uint8_t* end = args + len;
+    while (p < end && count < MAX_ENCODED_ARGS) {
+        auto type = static_cast<ArgType>(*p++);
+        Value& v = values[count];
+        size_t size = type == ArgType::Bool || type == ArgType::Char ? 1 : type == ArgType::String ? 2 : 8;
+        if (static_cast<size_t>(end - p) < size) break;
+        
+        switch (type) {
+            case ArgType::Int:
+                std::memcpy(&v.i, p, 8);
+                list[count] = detail::Arg{&v.i, &detail::append<int64_t>};
+                break;
+            case ArgType::UInt:
+                std::memcpy(&v.u, p, 8);
+                list[count] = detail::Arg{&v.u, &detail::append<uint64_t>};
+                break;
+            case ArgType::Float:
+                std::memcpy(&v.f, p, 8);
+                list[count] = detail::Arg{&v.f, &detail::append<double>};
+                break;
+            case ArgType::Bool:
+                v.b = *p != 0;
+                list[count] = detail::Arg{&v.b, &detail::append<bool>};
+                break;
+            case ArgType::Char:
+                v.c = static_cast<char>(*p);
+                list[count] = detail::Arg{&v.c, &detail::append<char>};
+                break;
+            case ArgType::String: {
+                uint16_t textLen;
+                std::memcpy(&textLen, p, 2);
+                if (static_cast<size_t>(end - p - 2) < textLen) {
+                    p = end;
+                    continue;
+                }
+                v.s = std::string_view(reinterpret_cast<const char*>(p + 2), textLen);
+                list[count] = detail::Arg{&v.s, &detail::append<std::string_view>};
+                size += textLen;
+                break;
+            }
+            default:
+                // Corrupt blob: format with what we have
+                p = end;
+                continue;
+        }
+        p += size;
+        ++count;
+    }
+    
+    detail::vformat(out, fmt, list, count);
+}
+
+} // namespace logfmt
+} // namespace knc
@@ -1,13 +1,16 @@
 /**
  * @file Logger.cpp
- * @brief Thread-safe logging with file rotation and ANSI colors
+ * @brief Asynchronous logging with file rotation and ANSI colors
  */
 
 #include "logging/Logger.h"
+#include "logging/BinaryLog.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <filesystem>
 #include <iostream>
-#include <iomanip>
-#include <sstream>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -45,7 +48,7 @@ void EnableAnsiColors() {
     g_colorsEnabled = true;
 }
 
-const char* GetCategoryColor(const std::string& cat) {
+const char* GetCategoryColor(std::string_view cat) {
     if (!g_colorsEnabled) return "";
     
     if (cat == "MAIN" || cat == "INIT") return color::white;
@@ -59,10 +62,65 @@ const char* GetCategoryColor(const std::string& cat) {
     return color::gray;
 }
 
-void Logger::init(const std::string& filepath, LogLevel minLevel) {
+// =============================================================================
+// RECORDS AND RINGS
+// =============================================================================
+
+struct Logger::Record {
+    int64_t monoNs;
+    uint32_t sessionId;
+    uint16_t formatId;     // 0 = message is text, otherwise encoded arguments
+    LogLevel level;
+    uint8_t categoryLen;
+    uint16_t messageLen;
+    char category[MAX_CATEGORY];
+    char message[MAX_MESSAGE];
+};
+
+// Single producer (the owning thread), single consumer (the writer)
+struct Logger::Ring {
+    explicit Ring(size_t slots) : records(slots), mask(slots - 1) {}
+    
+    std::vector<Record> records;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};  // next record the writer reads
+    alignas(64) std::atomic<size_t> tail{0};  // next slot the producer fills
+    std::atomic<bool> orphaned{false};        // owning thread exited
+};
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Logger::Logger()
+    : m_anchorWallMs(nowMs())
+    , m_anchorMonoNs(nowNs())
+{
+    m_formatDefined.assign(MAX_FORMATS, false);
+}
+
+Logger::~Logger() {
+    shutdown();
+}
+
+void Logger::init(const std::string& filepath, LogLevel minLevel, const AsyncLogConfig& async) {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_filepath = filepath;
-    m_minLevel = minLevel;
+    m_minLevel.store(minLevel, std::memory_order_relaxed);
+    
+    if (!m_running) {
+        m_config = async;
+        size_t slots = 16;
+        while (slots < m_config.ringSlots) slots <<= 1;
+        m_config.ringSlots = slots;
+        if (m_config.flushIntervalMs <= 0) m_config.flushIntervalMs = 50;
+    }
     
     EnableAnsiColors();
     
@@ -72,76 +130,425 @@ void Logger::init(const std::string& filepath, LogLevel minLevel) {
         std::filesystem::create_directories(dir);
     }
     
-    m_file.open(filepath, std::ios::app);
+    m_file.open(filepath, std::ios::app | std::ios::binary);
     if (!m_file.is_open()) {
         std::cerr << "Failed to open log file: " << filepath << std::endl;
     }
+    std::error_code ec;
+    auto size = std::filesystem::file_size(filepath, ec);
+    m_fileBytes = ec ? 0 : static_cast<size_t>(size);
+    if (m_config.binary) {
+        // A binary file must start with its header: never append to an older file
+        if (m_fileBytes > 0) rotate();
+        else writeBinaryHeader();
+    }
+    
+    if (m_config.enabled && !m_running) {
+        m_running.store(true, std::memory_order_release);
+        m_writer = std::thread(&Logger::writerLoop, this);
+    }
 }
 
-void Logger::log(LogLevel level, const std::string& category, const std::string& message) {
-    if (level < m_minLevel) return;
+void Logger::shutdown() {
+    if (!m_running.exchange(false)) return;
     
+    wakeWriter();
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeCv.notify_one();
+    }
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+    // Records pushed while the writer was stopping
+    drainRings();
+}
+
+void Logger::log(LogLevel level, std::string_view category, std::string_view message) {
+    if (!enabled(level)) return;
+    
+    int64_t monoNs = nowNs();
+    if (m_running.load(std::memory_order_acquire) && message.size() <= MAX_MESSAGE) {
+        if (enqueue(*threadRing(), level, category, 0, message.data(), message.size())) return;
+    }
+    
+    // No writer (or a record too long for a slot): write it ourselves
     std::lock_guard<std::mutex> lock(m_mutex);
-    rotateIfNeeded();
+    emit(Entry{monoNs, threadSession(), 0, level, category, message});
+    writeOut();
+}
+
+bool Logger::logEncoded(LogLevel level, std::string_view category, uint16_t formatId, const uint8_t* args, size_t len) {
+    return enqueue(*threadRing(), level, category, formatId, args, len);
+}
+
+uint16_t Logger::registerFormat(const char* fmt) {
+    std::lock_guard<std::mutex> lock(m_formatsMutex);
+    if (m_formatCount + 1 >= MAX_FORMATS) return 0;
+    size_t id = ++m_formatCount;
+    m_formats[id].store(fmt, std::memory_order_release);
+    return static_cast<uint16_t>(id);
+}
+
+Logger::Ring* Logger::threadRing() {
+    // Marks the ring orphaned when the thread exits, the writer frees it once drained
+    struct ThreadRing {
+        std::shared_ptr<Ring> ring;
+        ~ThreadRing() {
+            if (ring) ring->orphaned.store(true, std::memory_order_release);
+        }
+    };
+    thread_local ThreadRing t_ring;
     
-    // Build plain text for file
-    std::ostringstream fileLine;
-    fileLine << timestamp() << " [" << levelToString(level) << "] [" << category << "] " << message;
+    if (!t_ring.ring) {
+        auto ring = std::make_shared<Ring>(m_config.ringSlots);
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_rings.push_back(ring);
+        t_ring.ring = std::move(ring);
+    }
+    return t_ring.ring.get();
+}
+
+bool Logger::enqueue(Ring& ring, LogLevel level, std::string_view category, uint16_t formatId,
+                     const void* payload, size_t len) {
+    const size_t capacity = ring.mask + 1;
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
     
-    // Build colored text for console
-    std::ostringstream consoleLine;
-    const char* levelColor = color::gray;
-    const char* catColor = GetCategoryColor(category);
+    while (tail - ring.head.load(std::memory_order_acquire) >= capacity) {
+        if (level < m_config.dropBelow) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            wakeWriter();
+            return true;
+        }
+        // Too important to drop: wait for the writer (or write synchronously if it is gone)
+        if (!m_running.load(std::memory_order_acquire)) return false;
+        wakeWriter();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
     
-    switch (level) {
-        case LogLevel::LVL_DEBUG: levelColor = color::gray; break;
-        case LogLevel::LVL_INFO:  levelColor = color::white; break;
-        case LogLevel::LVL_WARN:  levelColor = color::yellow; break;
-        case LogLevel::LVL_ERROR: levelColor = color::red; break;
+    Record& record = ring.records[tail & ring.mask];
+    record.monoNs = nowNs();
+    record.sessionId = threadSession();
+    record.formatId = formatId;
+    record.level = level;
+    record.categoryLen = static_cast<uint8_t>(std::min(category.size(), MAX_CATEGORY));
+    std::memcpy(record.category, category.data(), record.categoryLen);
+    record.messageLen = static_cast<uint16_t>(len);
+    if (len > 0) std::memcpy(record.message, payload, len);
+    ring.tail.store(tail + 1, std::memory_order_release);
+    
+    // Errors go out right away; otherwise only nudge the writer when the ring fills up
+    if (level == LogLevel::LVL_ERROR ||
+        tail + 1 - ring.head.load(std::memory_order_relaxed) >= capacity / 2) {
+        wakeWriter();
+    }
+    return true;
+}
+
+void Logger::wakeWriter() {
+    // One notify per writer cycle, however many producers ask
+    if (!m_wakePending.exchange(true, std::memory_order_acq_rel)) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeCv.notify_one();
+    }
+}
+
+// =============================================================================
+// WRITER
+// =============================================================================
+
+void Logger::writerLoop() {
+    const auto interval = std::chrono::milliseconds(m_config.flushIntervalMs);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wakeCv.wait_for(lock, interval, [this]() {
+                return m_wakePending.load(std::memory_order_acquire) ||
+                       !m_running.load(std::memory_order_acquire);
+            });
+        }
+        m_wakePending.store(false, std::memory_order_release);
+        
+        if (!m_running.load(std::memory_order_acquire)) {
+            while (drainRings()) {}
+            return;
+        }
+        drainRings();
+    }
+}
+
+bool Logger::drainRings() {
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        // Rings of exited threads are dropped once the writer has caught up with them
+        m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [](const std::shared_ptr<Ring>& ring) {
+            return ring->orphaned.load(std::memory_order_acquire) &&
+                   ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire);
+        }), m_rings.end());
+        m_writerRings.assign(m_rings.begin(), m_rings.end());
+    }
+    
+    m_batch.clear();
+    m_writerEnds.resize(m_writerRings.size());
+    for (size_t i = 0; i < m_writerRings.size(); ++i) {
+        Ring& ring = *m_writerRings[i];
+        size_t head = ring.head.load(std::memory_order_relaxed);
+        size_t tail = ring.tail.load(std::memory_order_acquire);
+        for (size_t seq = head; seq < tail; ++seq) {
+            m_batch.push_back(&ring.records[seq & ring.mask]);
+        }
+        m_writerEnds[i] = tail;
+    }
+    
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (m_batch.empty() && dropped == m_droppedReported) return false;
+    
+    // Each ring is already in order, interleave the threads by time
+    std::stable_sort(m_batch.begin(), m_batch.end(), [](const Record* a, const Record* b) {
+        return a->monoNs < b->monoNs;
+    });
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const Record* record : m_batch) {
+            emit(Entry{record->monoNs, record->sessionId, record->formatId, record->level,
+                       std::string_view(record->category, record->categoryLen),
+                       std::string_view(record->message, record->messageLen)});
+        }
+        if (dropped != m_droppedReported) {
+            std::string notice = std::to_string(dropped - m_droppedReported) + " log records dropped (ring full, " +
+                                 std::to_string(dropped) + " total)";
+            emit(Entry{nowNs(), 0, 0, LogLevel::LVL_WARN, "LOG", notice});
+            m_droppedReported = dropped;
+        }
+        writeOut();
     }
     
+    // Slots can be reused only now that their text has been written
+    for (size_t i = 0; i < m_writerRings.size(); ++i) {
+        m_writerRings[i]->head.store(m_writerEnds[i], std::memory_order_release);
+    }
+    m_writerRings.clear();
+    return !m_batch.empty();
+}
+
+// =============================================================================
+// OUTPUT
+// =============================================================================
+
+void Logger::emit(const Entry& entry) {
+    bool binaryFile = m_config.binary && m_file.is_open();
+    if (binaryFile) {
+        writeBinary(entry);
+    }
+    
+    // Text output; a binary log only echoes warnings and errors to the console
+    if (!binaryFile || entry.level >= LogLevel::LVL_WARN) {
+        std::string_view message = entry.payload;
+        if (entry.formatId != 0) {
+            const char* fmt = entry.formatId < MAX_FORMATS ? m_formats[entry.formatId].load(std::memory_order_acquire) : nullptr;
+            m_messageScratch.clear();
+            logfmt::formatEncoded(m_messageScratch, fmt ? fmt : "",
+                                  reinterpret_cast<const uint8_t*>(entry.payload.data()), entry.payload.size());
+            message = m_messageScratch;
+        }
+        formatLine(wallMs(entry.monoNs), entry.level, entry.category, message);
+    }
+    
+    if (m_fileBytes + m_fileBuf.size() >= m_config.maxFileSize) {
+        writeOut();
+        rotate();
+    }
+}
+
+void Logger::writeBinary(const Entry& entry) {
+    // Category ids are assigned here, on first sight
+    auto it = m_categoryIds.find(std::string(entry.category));
+    if (it == m_categoryIds.end()) {
+        uint16_t id = static_cast<uint16_t>(m_categoryIds.size() + 1);
+        it = m_categoryIds.emplace(std::string(entry.category), id).first;
+    }
+    uint16_t categoryId = it->second;
+    if (categoryId >= m_categoryDefined.size()) {
+        m_categoryDefined.resize(categoryId + 1, false);
+    }
+    
+    if (!m_categoryDefined[categoryId]) {
+        uint8_t len = static_cast<uint8_t>(std::min<size_t>(entry.category.size(), 0xFF));
+        m_fileBuf += static_cast<char>(binlog::TAG_CATEGORY);
+        m_fileBuf.append(reinterpret_cast<const char*>(&categoryId), 2);
+        m_fileBuf += static_cast<char>(len);
+        m_fileBuf.append(entry.category.data(), len);
+        m_categoryDefined[categoryId] = true;
+    }
+    
+    if (entry.formatId != 0 && !m_formatDefined[entry.formatId]) {
+        const char* fmt = m_formats[entry.formatId].load(std::memory_order_acquire);
+        std::string_view text = fmt ? fmt : "";
+        uint16_t len = static_cast<uint16_t>(std::min<size_t>(text.size(), 0xFFFF));
+        m_fileBuf += static_cast<char>(binlog::TAG_FORMAT);
+        m_fileBuf.append(reinterpret_cast<const char*>(&entry.formatId), 2);
+        m_fileBuf.append(reinterpret_cast<const char*>(&len), 2);
+        m_fileBuf.append(text.data(), len);
+        m_formatDefined[entry.formatId] = true;
+    }
+    
+    binlog::RecordHeader header;
+    header.tag = binlog::TAG_RECORD;
+    header.level = static_cast<uint8_t>(entry.level);
+    header.categoryId = categoryId;
+    header.formatId = entry.formatId;
+    header.sessionId = entry.sessionId;
+    header.monoNs = entry.monoNs;
+    header.length = static_cast<uint16_t>(std::min<size_t>(entry.payload.size(), 0xFFFF));
+    m_fileBuf.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_fileBuf.append(entry.payload.data(), header.length);
+}
+
+void Logger::writeBinaryHeader() {
+    binlog::FileHeader header;
+    std::memcpy(header.magic, binlog::MAGIC, sizeof(header.magic));
+    header.version = binlog::VERSION;
+    header.reserved = 0;
+    header.wallMs = m_anchorWallMs;
+    header.monoNs = m_anchorMonoNs;
+    m_fileBuf.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    
+    // Every file defines its own categories and formats
+    m_categoryDefined.assign(m_categoryDefined.size(), false);
+    m_formatDefined.assign(MAX_FORMATS, false);
+}
+
+void Logger::formatLine(int64_t timeMs, LogLevel level, std::string_view category, std::string_view message) {
+    char time[32];
+    std::string_view ts(time, formatTimestamp(timeMs, time));
+    const char* levelName = levelToString(level);
+    
+    // Plain text for file (the console reuses it when colors are off)
+    std::string& line = m_config.binary ? m_lineScratch : m_fileBuf;
+    if (m_config.binary) line.clear();
+    size_t lineStart = line.size();
+    line.append(ts);
+    line += " [";
+    line += levelName;
+    line += "] [";
+    line.append(category);
+    line += "] ";
+    line.append(message);
+    line += '\n';
+    
+    // Colored text for console
+    std::string& console = m_consoleBuf;
+    size_t consoleStart = console.size();
     if (g_colorsEnabled) {
-        consoleLine << color::gray << timestamp() << " "
-                   << levelColor << "[" << levelToString(level) << "]" << color::reset << " "
-                   << catColor << "[" << category << "]" << color::reset << " "
-                   << message;
+        const char* levelColor = color::gray;
+        switch (level) {
+            case LogLevel::LVL_DEBUG: levelColor = color::gray; break;
+            case LogLevel::LVL_INFO:  levelColor = color::white; break;
+            case LogLevel::LVL_WARN:  levelColor = color::yellow; break;
+            case LogLevel::LVL_ERROR: levelColor = color::red; break;
+        }
+        console += color::gray;
+        console.append(ts);
+        console += ' ';
+        console += levelColor;
+        console += '[';
+        console += levelName;
+        console += ']';
+        console += color::reset;
+        console += ' ';
+        console += GetCategoryColor(category);
+        console += '[';
+        console.append(category);
+        console += ']';
+        console += color::reset;
+        console += ' ';
+        console.append(message);
+        console += '\n';
     } else {
-        consoleLine << fileLine.str();
+        console.append(line, lineStart, std::string::npos);
     }
     
-    // Console output
+    // Errors go to stderr, after whatever stdout output preceded them
     if (level == LogLevel::LVL_ERROR) {
-        std::cerr << consoleLine.str() << std::endl;
-    } else {
-        std::cout << consoleLine.str() << std::endl;
+        std::fwrite(console.data(), 1, consoleStart, stdout);
+        std::fflush(stdout);
+        std::fwrite(console.data() + consoleStart, 1, console.size() - consoleStart, stderr);
+        console.clear();
     }
     
-    // File output (no colors)
-    if (m_file.is_open()) {
-        m_file << fileLine.str() << std::endl;
-        m_file.flush();
+}
+
+void Logger::writeOut() {
+    if (!m_consoleBuf.empty()) {
+        std::fwrite(m_consoleBuf.data(), 1, m_consoleBuf.size(), stdout);
+        std::fflush(stdout);
+        m_consoleBuf.clear();
+    }
+    if (!m_fileBuf.empty()) {
+        if (m_file.is_open()) {
+            m_file.write(m_fileBuf.data(), static_cast<std::streamsize>(m_fileBuf.size()));
+            m_file.flush();
+            m_fileBytes += m_fileBuf.size();
+        }
+        m_fileBuf.clear();
     }
 }
 
-void Logger::rotateIfNeeded() {
+void Logger::rotate() {
     if (!m_file.is_open()) return;
+    m_file.close();
     
-    m_file.seekp(0, std::ios::end);
-    if (static_cast<size_t>(m_file.tellp()) > m_maxFileSize) {
-        m_file.close();
-        
-        // Rename old file with timestamp
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        std::ostringstream oss;
-        oss << m_filepath << "." << std::put_time(std::localtime(&time), "%Y%m%d_%H%M%S");
-        std::filesystem::rename(m_filepath, oss.str());
-        
-        m_file.open(m_filepath, std::ios::app);
+    // Rename old file with timestamp
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char suffix[32];
+    std::strftime(suffix, sizeof(suffix), ".%Y%m%d_%H%M%S", &local);
+    // Several rotations within one second get a counter instead of overwriting each other
+    std::string target = m_filepath + suffix;
+    for (int n = 1; std::filesystem::exists(target) && n < 100; ++n) {
+        target = m_filepath + suffix + "." + std::to_string(n);
+    }
+    std::error_code ec;
+    std::filesystem::rename(m_filepath, target, ec);
+    
+    m_file.open(m_filepath, std::ios::app | std::ios::binary);
+    m_fileBytes = 0;
+    if (m_config.binary) {
+        writeBinaryHeader();
     }
 }
 
-std::string Logger::levelToString(LogLevel level) {
+size_t Logger::formatTimestamp(int64_t timeMs, char* out) {
+    // localtime + strftime once per second, the milliseconds are appended by hand
+    int64_t second = timeMs / 1000;
+    if (second != m_cachedSecond) {
+        std::time_t time = static_cast<std::time_t>(second);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &time);
+#else
+        localtime_r(&time, &local);
+#endif
+        std::strftime(m_cachedTime, sizeof(m_cachedTime), "%Y-%m-%d %H:%M:%S", &local);
+        m_cachedSecond = second;
+    }
+    size_t len = std::strlen(m_cachedTime);
+    std::memcpy(out, m_cachedTime, len);
+    int ms = static_cast<int>(timeMs % 1000);
+    out[len++] = '.';
+    out[len++] = static_cast<char>('0' + ms / 100);
+    out[len++] = static_cast<char>('0' + (ms / 10) % 10);
+    out[len++] = static_cast<char>('0' + ms % 10);
+    return len;
+}
+
+const char* Logger::levelToString(LogLevel level) {
     switch (level) {
         case LogLevel::LVL_DEBUG: return "DEBUG";
         case LogLevel::LVL_INFO:  return "INFO ";
@@ -151,18 +558,6 @@ std::string Logger::levelToString(LogLevel level) {
     }
 }
 
-std::string Logger::timestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S")
-        << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return oss.str();
-}
-
 void PrintServerHeader(const char* serverName, const char* version) {
     EnableAnsiColors();
     
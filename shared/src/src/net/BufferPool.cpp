@@ -0,0 +1,95 @@
+/**
+ * @file BufferPool.cpp
+ * @brief Per-thread recycling of packet payloads and serialized frames
+ */
+
+#include "net/BufferPool.h"
+#include <array>
+#include <atomic>
+
+namespace knc {
+
+namespace {
+    struct ThreadPool {
+        std::vector<std::vector<uint8_t>> free;
+        std::array<std::shared_ptr<std::vector<uint8_t>>, BufferPool::SHARED_SLOTS> shared;
+        size_t nextShared = 0;
+        
+        ThreadPool() { free.reserve(BufferPool::MAX_FREE); }
+        ~ThreadPool();
+    };
+    
+    // Trivially destructible, so still readable while other thread_locals
+    // (a Packet held by one) are destroyed after the pool
+    thread_local bool t_poolDestroyed = false;
+    
+    ThreadPool::~ThreadPool() {
+        t_poolDestroyed = true;
+    }
+    
+    ThreadPool* threadPool() {
+        if (t_poolDestroyed) return nullptr;
+        thread_local ThreadPool pool;
+        return &pool;
+    }
+}
+
+std::vector<uint8_t> BufferPool::acquire(size_t sizeHint) {
+    std::vector<uint8_t> buffer;
+    ThreadPool* pool = threadPool();
+    if (pool && !pool->free.empty()) {
+        buffer = std::move(pool->free.back());
+        pool->free.pop_back();
+    }
+    if (buffer.capacity() < sizeHint) {
+        buffer.reserve(sizeHint);
+    }
+    return buffer;
+}
+
+void BufferPool::release(std::vector<uint8_t>&& buffer) {
+    if (buffer.capacity() == 0 || buffer.capacity() > MAX_POOLED_CAPACITY) return;
+    
+    ThreadPool* pool = threadPool();
+    if (!pool || pool->free.size() >= MAX_FREE) return;
+    
+    buffer.clear();
+    pool->free.push_back(std::move(buffer));
+}
+
+std::shared_ptr<std::vector<uint8_t>> BufferPool::acquireShared(size_t sizeHint) {
+    ThreadPool* pool = threadPool();
+    if (!pool) {
+        auto frame = std::make_shared<std::vector<uint8_t>>();
+        frame->reserve(sizeHint);
+        return frame;
+    }
+    
+    // Round-robin so the frames written longest ago are probed first
+    for (size_t probe = 0; probe < SHARED_SLOTS; ++probe) {
+        auto& slot = pool->shared[pool->nextShared];
+        pool->nextShared = (pool->nextShared + 1) % SHARED_SLOTS;
+        
+        if (!slot) {
+            slot = std::make_shared<std::vector<uint8_t>>();
+        } else if (slot.use_count() != 1) {
+            continue;  // Still queued or being written by a session
+        }
+        
+        // Pair with the release decrement of the last session that dropped it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->capacity() > MAX_POOLED_CAPACITY) {
+            std::vector<uint8_t>().swap(*slot);
+        }
+        slot->clear();
+        slot->reserve(sizeHint);
+        return slot;
+    }
+    
+    // Every slot is in flight (slow peers): fall back to a one-off frame
+    auto frame = std::make_shared<std::vector<uint8_t>>();
+    frame->reserve(sizeHint);
+    return frame;
+}
+
+} // namespace knc
@@ -0,0 +1,273 @@
+/**
+ * @file MovementCodec.cpp
+ * @brief Compact kart movement encoding
+ */
+
+#include "net/MovementCodec.h"
+#include <algorithm>
+#include <cmath>
+
+namespace knc {
+
+namespace {
+    constexpr uint8_t MASK_X = 0x01;
+    constexpr uint8_t MASK_Y = 0x02;
+    constexpr uint8_t MASK_Z = 0x04;
+    constexpr uint8_t MASK_ROT = 0x08;
+    constexpr uint8_t MASK_REMOVED = 0x80;
+    constexpr float TWO_PI = 6.28318530718f;
+    
+    bool byEntity(const MoveState& a, const MoveState& b) {
+        return a.entityId < b.entityId;
+    }
+    
+    // Deltas wrap modulo 2^32 on both sides: decoded values come from the peer
+    // and must not overflow a signed add
+    int32_t subDelta(int32_t cur, int32_t prev) {
+        return static_cast<int32_t>(static_cast<uint32_t>(cur) - static_cast<uint32_t>(prev));
+    }
+    
+    int32_t addDelta(int32_t value, int32_t delta) {
+        return static_cast<int32_t>(static_cast<uint32_t>(value) + static_cast<uint32_t>(delta));
+    }
+    
+    // Entry for cur against prev; always written for new entities (even if all zero)
+    bool writeEntry(std::vector<uint8_t>& out, const MoveState& cur, const MoveState& prev, bool force) {
+        int16_t drot = static_cast<int16_t>(static_cast<uint16_t>(cur.rot - prev.rot));
+        uint8_t mask = 0;
+        if (cur.x != prev.x) mask |= MASK_X;
+        if (cur.y != prev.y) mask |= MASK_Y;
+        if (cur.z != prev.z) mask |= MASK_Z;
+        if (drot != 0) mask |= MASK_ROT;
+        if (mask == 0 && !force) return false;
+        
+        varint::writeU32(out, cur.entityId);
+        out.push_back(mask);
+        if (mask & MASK_X) varint::writeS32(out, subDelta(cur.x, prev.x));
+        if (mask & MASK_Y) varint::writeS32(out, subDelta(cur.y, prev.y));
+        if (mask & MASK_Z) varint::writeS32(out, subDelta(cur.z, prev.z));
+        if (mask & MASK_ROT) varint::writeS32(out, drot);
+        return true;
+    }
+}
+
+// =============================================================================
+// QUANTIZER
+// =============================================================================
+
+int32_t MovementQuantizer::quantize(float value, float origin) const {
+    // Clamped: lround of a value past int32 (or NaN) is undefined
+    constexpr float LIMIT = 2147483520.0f;  // largest float below 2^31
+    float q = (value - origin) / step;
+    if (!std::isfinite(q)) return 0;
+    return static_cast<int32_t>(std::lround(std::clamp(q, -LIMIT, LIMIT)));
+}
+
+float MovementQuantizer::dequantize(int32_t q, float origin) const {
+    return origin + static_cast<float>(q) * step;
+}
+
+uint16_t MovementQuantizer::quantizeAngle(float rad) {
+    if (!std::isfinite(rad)) return 0;
+    float turns = rad / TWO_PI;
+    turns -= std::floor(turns);
+    return static_cast<uint16_t>(static_cast<uint32_t>(std::lround(turns * 65536.0f)) & 0xFFFF);
+}
+
+float MovementQuantizer::dequantizeAngle(uint16_t q) {
+    return static_cast<float>(q) * (TWO_PI / 65536.0f);
+}
+
+// =============================================================================
+// VARINT
+// =============================================================================
+
+namespace varint {
+
+void writeU32(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void writeS32(std::vector<uint8_t>& out, int32_t value) {
+    // zigzag: small negative deltas stay small
+    writeU32(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+}
+
+bool readU32(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end) return false;
+        uint8_t b = *p++;
+        value |= static_cast<uint32_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;  // more than 5 bytes - corrupt
+}
+
+bool readS32(const uint8_t*& p, const uint8_t* end, int32_t& value) {
+    uint32_t raw;
+    if (!readU32(p, end, raw)) return false;
+    value = static_cast<int32_t>((raw >> 1) ^ (~(raw & 1) + 1));
+    return true;
+}
+
+} // namespace varint
+
+// =============================================================================
+// ENCODER
+// =============================================================================
+
+const MovementEncoder::Snapshot* MovementEncoder::baseline() const {
+    if (m_ackedSeq < 0) return nullptr;
+    
+    // Slot already reused once the peer lags a full history behind
+    uint8_t age = static_cast<uint8_t>(m_nextSeq - static_cast<uint8_t>(m_ackedSeq));
+    if (age == 0 || age > HISTORY) return nullptr;
+    
+    const Snapshot& snap = m_history[m_ackedSeq % HISTORY];
+    return (snap.valid && snap.seq == m_ackedSeq) ? &snap : nullptr;
+}
+
+size_t MovementEncoder::encode(const std::vector<MoveState>& states, std::vector<uint8_t>& out) {
+    m_sorted.assign(states.begin(), states.end());
+    std::sort(m_sorted.begin(), m_sorted.end(), byEntity);
+    const std::vector<MoveState>& cur = m_sorted;
+    
+    static const std::vector<MoveState> none;
+    const Snapshot* base = baseline();
+    const std::vector<MoveState>& prev = base ? base->states : none;
+    
+    uint8_t seq = m_nextSeq++;
+    out.push_back(seq);
+    out.push_back(base ? base->seq : seq);
+    
+    // Merge walk over both sorted sets: new, changed and removed entities
+    m_body.clear();
+    size_t count = 0;
+    size_t i = 0, j = 0;
+    while (i < cur.size() || j < prev.size()) {
+        if (j >= prev.size() || (i < cur.size() && cur[i].entityId < prev[j].entityId)) {
+            writeEntry(m_body, cur[i], MoveState{}, true);
+            count++;
+            i++;
+        } else if (i >= cur.size() || prev[j].entityId < cur[i].entityId) {
+            varint::writeU32(m_body, prev[j].entityId);
+            m_body.push_back(MASK_REMOVED);
+            count++;
+            j++;
+        } else {
+            if (writeEntry(m_body, cur[i], prev[j], false)) {
+                count++;
+            }
+            i++;
+            j++;
+        }
+    }
+    
+    varint::writeU32(out, static_cast<uint32_t>(count));
+    out.insert(out.end(), m_body.begin(), m_body.end());
+    
+    // Swap rather than copy: the slot's old storage becomes next tick's scratch
+    Snapshot& slot = m_history[seq % HISTORY];
+    slot.seq = seq;
+    slot.valid = true;
+    slot.states.swap(m_sorted);
+    
+    return count;
+}
+
+void MovementEncoder::acknowledge(uint8_t seq) {
+    const Snapshot& snap = m_history[seq % HISTORY];
+    if (!snap.valid || snap.seq != seq) return;
+    
+    // Ignore late acks for snapshots older than the current baseline
+    if (m_ackedSeq >= 0 && static_cast<int8_t>(seq - static_cast<uint8_t>(m_ackedSeq)) <= 0) return;
+    
+    m_ackedSeq = seq;
+}
+
+void MovementEncoder::reset() {
+    for (auto& snap : m_history) {
+        snap.valid = false;
+        snap.states.clear();
+    }
+    m_nextSeq = 0;
+    m_ackedSeq = -1;
+}
+
+// =============================================================================
+// DECODER
+// =============================================================================
+
+bool MovementDecoder::decode(const uint8_t* data, size_t len, std::vector<MoveState>& out) {
+    if (len < 2) return false;
+    
+    uint8_t seq = data[0];
+    uint8_t base = data[1];
+    
+    std::vector<MoveState>& result = m_scratch;
+    result.clear();
+    if (base != seq) {
+        if (m_historySeq[base % MovementEncoder::HISTORY] != base) {
+            return false;  // Baseline unknown (never received or too old)
+        }
+        result = m_history[base % MovementEncoder::HISTORY];
+    }
+    
+    const uint8_t* p = data + 2;
+    const uint8_t* end = data + len;
+    uint32_t count;
+    if (!varint::readU32(p, end, count)) return false;
+    // At most every baseline entity removed and as many new ones added
+    if (count > 2 * m_maxEntities) return false;
+    
+    for (uint32_t n = 0; n < count; ++n) {
+        uint32_t entityId;
+        if (!varint::readU32(p, end, entityId) || p >= end) return false;
+        uint8_t mask = *p++;
+        
+        MoveState key;
+        key.entityId = entityId;
+        auto it = std::lower_bound(result.begin(), result.end(), key, byEntity);
+        bool found = it != result.end() && it->entityId == entityId;
+        
+        if (mask & MASK_REMOVED) {
+            if (found) result.erase(it);
+            continue;
+        }
+        if (!found) {
+            if (result.size() >= m_maxEntities) return false;
+            it = result.insert(it, key);
+        }
+        
+        int32_t d;
+        if (mask & MASK_X) { if (!varint::readS32(p, end, d)) return false; it->x = addDelta(it->x, d); }
+        if (mask & MASK_Y) { if (!varint::readS32(p, end, d)) return false; it->y = addDelta(it->y, d); }
+        if (mask & MASK_Z) { if (!varint::readS32(p, end, d)) return false; it->z = addDelta(it->z, d); }
+        if (mask & MASK_ROT) {
+            if (!varint::readS32(p, end, d)) return false;
+            it->rot = static_cast<uint16_t>(it->rot + d);
+        }
+    }
+    
+    std::vector<MoveState>& slot = m_history[seq % MovementEncoder::HISTORY];
+    slot.swap(result);
+    m_historySeq[seq % MovementEncoder::HISTORY] = seq;
+    m_lastSeq = seq;
+    out = slot;  // copy-assign reuses the caller's capacity
+    return true;
+}
+
+void MovementDecoder::reset() {
+    for (auto& states : m_history) {
+        states.clear();
+    }
+    m_historySeq.fill(-1);
+    m_lastSeq = -1;
+}
+
+} // namespace knc
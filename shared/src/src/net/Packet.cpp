@@ -5,18 +5,56 @@
  */
 
 #include "net/Packet.h"
+#include "net/BufferPool.h"
 #include <cstring>
 #include <algorithm>
+#include <type_traits>
 
 namespace knc {
 
-Packet::Packet(uint8_t cmd, uint8_t flag) {
+Packet::Packet()
+    : m_payload(BufferPool::acquire())
+{
+}
+
+Packet::Packet(uint8_t cmd, uint8_t flag)
+    : m_payload(BufferPool::acquire())
+{
     m_header.cmd = cmd;
     m_header.flag = flag;
     m_header.size = 0;
     m_header.reserved = 0;
 }
 
+Packet::~Packet() {
+    BufferPool::release(std::move(m_payload));
+}
+
+Packet::Packet(const Packet& other)
+    : m_header(other.m_header)
+    , m_payload(BufferPool::acquire(other.m_payload.size()))
+    , m_readPos(other.m_readPos)
+{
+    m_payload.assign(other.m_payload.begin(), other.m_payload.end());
+}
+
+Packet& Packet::operator=(const Packet& other) {
+    if (this != &other) {
+        m_header = other.m_header;
+        m_payload.assign(other.m_payload.begin(), other.m_payload.end());
+        m_readPos = other.m_readPos;
+    }
+    return *this;
+}
+
+Packet& Packet::operator=(Packet&& other) noexcept {
+    // Swap so our old buffer goes back to the pool with other instead of being freed
+    m_header = other.m_header;
+    m_payload.swap(other.m_payload);
+    m_readPos = other.m_readPos;
+    return *this;
+}
+
 Packet Packet::fromCmdFull(uint16_t cmdFull) {
     Packet pkt;
     pkt.m_header.cmd = cmdFull & 0xFF;
@@ -26,6 +64,16 @@ Packet Packet::fromCmdFull(uint16_t cmdFull) {
     return pkt;
 }
 
+Packet Packet::fromRaw(const PacketHeader& header, const uint8_t* payload, size_t len) {
+    Packet pkt;
+    pkt.m_header = header;
+    pkt.m_header.size = static_cast<uint16_t>(len);
+    if (len > 0) {
+        pkt.m_payload.assign(payload, payload + len);  // pooled capacity, usually no allocation
+    }
+    return pkt;
+}
+
 std::optional<Packet> Packet::parse(const uint8_t* data, size_t len) {
     if (len < PACKET_HEADER_SIZE) {
         return std::nullopt;
@@ -44,8 +92,7 @@ std::optional<Packet> Packet::parse(const uint8_t* data, size_t len) {
     
     // Copy payload
     if (payloadSize > 0) {
-        pkt.m_payload.resize(payloadSize);
-        std::memcpy(pkt.m_payload.data(), data + PACKET_HEADER_SIZE, payloadSize);
+        pkt.m_payload.assign(data + PACKET_HEADER_SIZE, data + totalSize);
     }
     
     return pkt;
@@ -58,20 +105,40 @@ size_t Packet::peekSize(const uint8_t* data, size_t len) {
 }
 
 std::vector<uint8_t> Packet::serialize() const {
-    std::vector<uint8_t> result(PACKET_HEADER_SIZE + m_payload.size());
-    
+    std::vector<uint8_t> result;
+    result.reserve(totalSize());
+    appendTo(result);
+    return result;
+}
+
+void Packet::appendTo(std::vector<uint8_t>& out) const {
     PacketHeader hdr = m_header;
     hdr.size = static_cast<uint16_t>(m_payload.size());
     
-    std::memcpy(result.data(), &hdr, sizeof(PacketHeader));
-    if (!m_payload.empty()) {
-        std::memcpy(result.data() + PACKET_HEADER_SIZE, m_payload.data(), m_payload.size());
+    const uint8_t* raw = reinterpret_cast<const uint8_t*>(&hdr);
+    out.insert(out.end(), raw, raw + PACKET_HEADER_SIZE);
+    out.insert(out.end(), m_payload.begin(), m_payload.end());
+}
+
+Packet& Packet::reserve(size_t payloadSize) {
+    m_payload.reserve(payloadSize);
+    return *this;
+}
+
+// Writers - one bulk append per value; the byte shifts compile to a plain
+// store on little-endian targets and keep the wire format LE everywhere else
+template <typename T>
+Packet& Packet::writeLE(T val) {
+    using U = std::make_unsigned_t<T>;
+    U bits = static_cast<U>(val);
+    uint8_t bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bytes[i] = static_cast<uint8_t>(bits >> (8 * i));
     }
-    
-    return result;
+    m_payload.insert(m_payload.end(), bytes, bytes + sizeof(T));
+    return *this;
 }
 
-// Writers
 Packet& Packet::writeInt8(int8_t val) {
     m_payload.push_back(static_cast<uint8_t>(val));
     return *this;
@@ -83,37 +150,25 @@ Packet& Packet::writeUInt8(uint8_t val) {
 }
 
 Packet& Packet::writeInt16(int16_t val) {
-    m_payload.push_back(val & 0xFF);
-    m_payload.push_back((val >> 8) & 0xFF);
-    return *this;
+    return writeLE(val);
 }
 
 Packet& Packet::writeUInt16(uint16_t val) {
-    m_payload.push_back(val & 0xFF);
-    m_payload.push_back((val >> 8) & 0xFF);
-    return *this;
+    return writeLE(val);
 }
 
 Packet& Packet::writeInt32(int32_t val) {
-    m_payload.push_back(val & 0xFF);
-    m_payload.push_back((val >> 8) & 0xFF);
-    m_payload.push_back((val >> 16) & 0xFF);
-    m_payload.push_back((val >> 24) & 0xFF);
-    return *this;
+    return writeLE(val);
 }
 
 Packet& Packet::writeUInt32(uint32_t val) {
-    m_payload.push_back(val & 0xFF);
-    m_payload.push_back((val >> 8) & 0xFF);
-    m_payload.push_back((val >> 16) & 0xFF);
-    m_payload.push_back((val >> 24) & 0xFF);
-    return *this;
+    return writeLE(val);
 }
 
 Packet& Packet::writeFloat(float val) {
     uint32_t bits;
     std::memcpy(&bits, &val, sizeof(float));
-    return writeUInt32(bits);
+    return writeLE(bits);
 }
 
 Packet& Packet::writeBytes(const uint8_t* data, size_t len) {
@@ -122,23 +177,27 @@ Packet& Packet::writeBytes(const uint8_t* data, size_t len) {
 }
 
 Packet& Packet::writeString(const std::string& str) {
-    for (char c : str) {
-        m_payload.push_back(static_cast<uint8_t>(c));
-    }
-    m_payload.push_back(0);  // Null terminator
+    const uint8_t* raw = reinterpret_cast<const uint8_t*>(str.c_str());
+    m_payload.insert(m_payload.end(), raw, raw + str.size() + 1);  // Includes null terminator
     return *this;
 }
 
 Packet& Packet::writeWString(const std::u16string& str) {
+    m_payload.reserve(m_payload.size() + (str.size() + 1) * 2);
     for (char16_t c : str) {
-        m_payload.push_back(c & 0xFF);
-        m_payload.push_back((c >> 8) & 0xFF);
+        writeLE(static_cast<uint16_t>(c));
     }
     m_payload.push_back(0);
     m_payload.push_back(0);
     return *this;
 }
 
+uint8_t* Packet::appendRaw(size_t len) {
+    size_t offset = m_payload.size();
+    m_payload.resize(offset + len);
+    return m_payload.data() + offset;
+}
+
 // Readers
 int8_t Packet::readInt8() {
     if (m_readPos >= m_payload.size()) return 0;
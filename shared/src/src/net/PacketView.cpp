@@ -0,0 +1,112 @@
+/**
+ * @file PacketView.cpp
+ * @brief Non-owning packet view - in-place payload decoding
+ */
+
+#include "net/PacketView.h"
+#include <cstring>
+#include <algorithm>
+
+namespace knc {
+
+std::optional<PacketView> PacketView::fromFrame(const uint8_t* data, size_t len) {
+    if (len < PACKET_HEADER_SIZE) {
+        return std::nullopt;
+    }
+
+    PacketHeader header;
+    std::memcpy(&header, data, sizeof(PacketHeader));
+
+    if (len < PACKET_HEADER_SIZE + header.size) {
+        return std::nullopt;
+    }
+
+    return PacketView(header, data + PACKET_HEADER_SIZE, header.size);
+}
+
+Packet PacketView::copy() const {
+    return Packet::fromRaw(m_header, m_payload, m_size);
+}
+
+// Readers
+int8_t PacketView::readInt8() {
+    if (m_readPos >= m_size) return 0;
+    return static_cast<int8_t>(m_payload[m_readPos++]);
+}
+
+uint8_t PacketView::readUInt8() {
+    if (m_readPos >= m_size) return 0;
+    return m_payload[m_readPos++];
+}
+
+int16_t PacketView::readInt16() {
+    if (m_readPos + 2 > m_size) return 0;
+    int16_t val = m_payload[m_readPos] | (m_payload[m_readPos + 1] << 8);
+    m_readPos += 2;
+    return val;
+}
+
+uint16_t PacketView::readUInt16() {
+    if (m_readPos + 2 > m_size) return 0;
+    uint16_t val = m_payload[m_readPos] | (m_payload[m_readPos + 1] << 8);
+    m_readPos += 2;
+    return val;
+}
+
+int32_t PacketView::readInt32() {
+    if (m_readPos + 4 > m_size) return 0;
+    int32_t val = m_payload[m_readPos] |
+                  (m_payload[m_readPos + 1] << 8) |
+                  (m_payload[m_readPos + 2] << 16) |
+                  (m_payload[m_readPos + 3] << 24);
+    m_readPos += 4;
+    return val;
+}
+
+uint32_t PacketView::readUInt32() {
+    return static_cast<uint32_t>(readInt32());
+}
+
+float PacketView::readFloat() {
+    uint32_t bits = readUInt32();
+    float val;
+    std::memcpy(&val, &bits, sizeof(float));
+    return val;
+}
+
+std::vector<uint8_t> PacketView::readBytes(size_t len) {
+    size_t toRead = std::min(len, m_size - m_readPos);
+    std::vector<uint8_t> result(m_payload + m_readPos, m_payload + m_readPos + toRead);
+    m_readPos += toRead;
+    return result;
+}
+
+const uint8_t* PacketView::readRaw(size_t len) {
+    if (len > m_size - m_readPos) return nullptr;
+    const uint8_t* data = m_payload + m_readPos;
+    m_readPos += len;
+    return data;
+}
+
+std::string PacketView::readString(size_t maxLen) {
+    std::string result;
+    while (m_readPos < m_size && result.size() < maxLen) {
+        char c = static_cast<char>(m_payload[m_readPos++]);
+        if (c == '\0') break;
+        result += c;
+    }
+    return result;
+}
+
+std::u16string PacketView::readWString(size_t maxChars) {
+    std::u16string result;
+    while (m_readPos + 1 < m_size && result.size() < maxChars) {
+        char16_t c = m_payload[m_readPos] | (m_payload[m_readPos + 1] << 8);
+        m_readPos += 2;
+        if (c == 0) break;
+        result += c;
+    }
+    return result;
+}
+
+} // namespace knc
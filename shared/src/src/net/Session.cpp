@@ -4,22 +4,44 @@
  */
 
 #include "net/Session.h"
+#include "net/BufferPool.h"
 #include "logging/Logger.h"
 #include <iostream>
+#include <array>
+#include <chrono>
 
 namespace knc {
 
-uint32_t Session::s_nextId = 1;
+namespace {
+    // Rate limiter clock: one read per receive batch
+    uint32_t steadyMs() {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+std::atomic<uint32_t> Session::s_nextId{1};
 
 Session::Session(asio::ip::tcp::socket socket)
     : m_socket(std::move(socket))
     , m_id(s_nextId++)
+    , m_recvRing(RECV_RING_SIZE)
+    , m_rateLimiter(steadyMs())
 {
-    m_readBuffer.resize(8192);
+    std::error_code ec;
+    auto endpoint = m_socket.remote_endpoint(ec);
+    if (ec) {
+        m_remoteAddress = "unknown";
+    } else {
+        m_remoteAddress = endpoint.address().to_string();
+        m_remotePort = endpoint.port();
+    }
 }
 
 Session::~Session() {
-    stop();
+    // No shared_from_this() here: just release the socket
+    std::error_code ec;
+    m_socket.close(ec);
 }
 
 void Session::start() {
@@ -28,64 +50,90 @@ void Session::start() {
 }
 
 void Session::stop() {
-    if (!m_connected) return;
-    m_connected = false;
+    // stop() can race from several threads (read error + kick), only the first one wins
+    if (!m_connected.exchange(false)) return;
     
-    std::error_code ec;
-    m_socket.close(ec);
+    auto self = shared_from_this();
+    asio::dispatch(m_socket.get_executor(), [this, self]() {
+        std::error_code ec;
+        m_socket.close(ec);
+    });
     
-    if (m_disconnectHandler) {
-        m_disconnectHandler(shared_from_this());
-    }
-}
-
-std::string Session::remoteAddress() const {
-    try {
-        return m_socket.remote_endpoint().address().to_string();
-    } catch (...) {
-        return "unknown";
-    }
+    // The handler reads strand-owned session fields: always run it on the strand,
+    // never inline on the caller's thread (a kick comes from a room worker)
+    asio::post(m_socket.get_executor(), [this, self]() {
+        if (m_disconnectHandler) {
+            m_disconnectHandler(self);
+        }
+    });
 }
 
-uint16_t Session::remotePort() const {
-    try {
-        return m_socket.remote_endpoint().port();
-    } catch (...) {
-        return 0;
-    }
+void Session::kick() {
+    // Set before stop() so the disconnect handler already sees it
+    m_kicked = true;
+    stop();
 }
 
 void Session::send(const Packet& packet) {
-    auto data = packet.serialize();
+    auto data = makeShared(packet);
     
-    // Log outgoing packet
-    std::string hexDump = "CMD=0x";
-    const char* hex = "0123456789ABCDEF";
-    hexDump += hex[packet.cmd() >> 4];
-    hexDump += hex[packet.cmd() & 0xF];
-    hexDump += " Size=" + std::to_string(data.size());
-    LOG_DEBUG("SESSION", "SEND to " + remoteAddress() + ": " + hexDump);
+    LOG_DEBUGF("SESSION", "SEND to {}: CMD=0x{:02X} Size={}", m_remoteAddress, packet.cmd(), data->size());
     
-    send(data);
+    send(std::move(data));
 }
 
 void Session::send(const std::vector<uint8_t>& data) {
-    if (!m_connected) return;
-    
-    bool wasEmpty = m_writeQueue.empty();
-    m_writeQueue.push(data);
+    auto frame = BufferPool::acquireShared(data.size());
+    frame->assign(data.begin(), data.end());
+    send(SharedBuffer(std::move(frame)));
+}
+
+void Session::send(SharedBuffer data) {
+    if (!m_connected || !data) return;
     
-    if (wasEmpty) {
-        doWrite();
-    }
+    // Runs inline when already on this session's strand, posted otherwise
+    auto self = shared_from_this();
+    asio::dispatch(m_socket.get_executor(), [this, self, data = std::move(data)]() mutable {
+        if (!m_connected) return;
+        
+        m_writeQueue.push_back(std::move(data));
+        
+        if (!m_writing) {
+            doWrite();
+        }
+    });
+}
+
+Session::SharedBuffer Session::makeShared(const Packet& packet) {
+    auto frame = BufferPool::acquireShared(packet.totalSize());
+    packet.appendTo(*frame);
+    return frame;
 }
 
 void Session::doRead() {
     if (!m_connected) return;
     
+    // Read straight into the ring's free space (two regions when it wraps)
+    uint8_t* first;
+    uint8_t* second;
+    size_t firstLen, secondLen;
+    m_recvRing.writableRegions(first, firstLen, second, secondLen);
+    
+    if (firstLen + secondLen == 0) {
+        // Only reachable if a frame larger than the ring got through; treat as a broken stream
+        LOG_WARN("SESSION", "Receive buffer full from " + remoteAddress());
+        stop();
+        return;
+    }
+    
+    std::array<asio::mutable_buffer, 2> buffers = {
+        asio::buffer(first, firstLen),
+        asio::buffer(second, secondLen)
+    };
+    
     auto self = shared_from_this();
     m_socket.async_read_some(
-        asio::buffer(m_readBuffer),
+        buffers,
         [this, self](std::error_code ec, std::size_t length) {
             if (ec) {
                 if (ec != asio::error::operation_aborted) {
@@ -94,9 +142,7 @@ void Session::doRead() {
                 return;
             }
             
-            // Append to receive buffer
-            m_recvBuffer.insert(m_recvBuffer.end(), 
-                m_readBuffer.begin(), m_readBuffer.begin() + length);
+            m_recvRing.commit(length);
             
             // Process complete packets
             processBuffer();
@@ -110,18 +156,29 @@ void Session::doRead() {
 void Session::doWrite() {
     if (!m_connected || m_writeQueue.empty()) return;
     
+    // Drain everything queued so far into one scatter-gather write
+    m_inFlight.clear();
+    m_writeBuffers.clear();
+    while (!m_writeQueue.empty()) {
+        m_writeBuffers.push_back(asio::buffer(*m_writeQueue.front()));
+        m_inFlight.push_back(std::move(m_writeQueue.front()));
+        m_writeQueue.pop_front();
+    }
+    m_writing = true;
+    
     auto self = shared_from_this();
     asio::async_write(
         m_socket,
-        asio::buffer(m_writeQueue.front()),
+        m_writeBuffers,
         [this, self](std::error_code ec, std::size_t /*length*/) {
+            m_writing = false;
+            m_inFlight.clear();
+            
             if (ec) {
                 stop();
                 return;
             }
             
-            m_writeQueue.pop();
-            
             if (!m_writeQueue.empty()) {
                 doWrite();
             }
@@ -130,30 +187,57 @@ void Session::doWrite() {
 }
 
 void Session::processBuffer() {
-    while (m_recvBuffer.size() >= PACKET_HEADER_SIZE) {
-        // Peek at packet size
-        size_t packetSize = Packet::peekSize(m_recvBuffer.data(), m_recvBuffer.size());
+    PacketHeader header;
+    // One handle for the whole batch instead of a refcount round-trip per frame
+    const Ptr self = shared_from_this();
+    // Everything the handlers log is tagged with this session (binary log filters)
+    LogSessionScope logSession(m_id);
+    const uint32_t nowMs = steadyMs();
+    
+    while (m_connected && m_recvRing.peek(reinterpret_cast<uint8_t*>(&header), PACKET_HEADER_SIZE)) {
+        size_t packetSize = PACKET_HEADER_SIZE + header.size;
         
-        if (packetSize == 0 || packetSize > PACKET_MAX_SIZE) {
-            // Invalid packet, disconnect
+        if (packetSize > m_recvRing.capacity()) {
+            // Can never be completed in the ring, disconnect
             LOG_WARN("SESSION", "Invalid packet size from " + remoteAddress());
             stop();
             return;
         }
         
-        if (m_recvBuffer.size() < packetSize) {
+        if (m_recvRing.size() < packetSize) {
             // Wait for more data
             break;
         }
         
-        // Parse packet
-        auto pkt = Packet::parse(m_recvBuffer.data(), m_recvBuffer.size());
-        if (pkt && m_packetHandler) {
-            m_packetHandler(shared_from_this(), *pkt);
+        // Over budget: drop unparsed, the handlers never see it
+        switch (m_rateLimiter.check(header.cmd, nowMs)) {
+            case RateLimiter::Verdict::Allow:
+                break;
+            case RateLimiter::Verdict::Drop:
+                m_recvRing.consume(packetSize);
+                continue;
+            case RateLimiter::Verdict::Disconnect:
+                LOG_WARNF("SESSION", "Packet flood from {} (opcode 0x{:02X}, {} dropped), disconnecting",
+                          remoteAddress(), header.cmd, m_rateLimiter.getDroppedCount());
+                kick();
+                return;
+        }
+        
+        // Decode in place; only a frame that wraps the ring end is copied out
+        const uint8_t* frame = m_recvRing.contiguous(packetSize);
+        if (!frame) {
+            m_frameScratch.resize(packetSize);
+            m_recvRing.peek(m_frameScratch.data(), packetSize);
+            frame = m_frameScratch.data();
+        }
+        
+        PacketView view(header, frame + PACKET_HEADER_SIZE, header.size);
+        if (m_packetHandler) {
+            m_packetHandler(self, view);
         }
         
         // Remove processed data
-        m_recvBuffer.erase(m_recvBuffer.begin(), m_recvBuffer.begin() + packetSize);
+        m_recvRing.consume(packetSize);
     }
 }
 
@@ -0,0 +1,164 @@
+/**
+ * @file AdmissionControl.cpp
+ * @brief Accept-stage connection throttling per source IP and subnet
+ */
+
+#include "security/AdmissionControl.h"
+#include <algorithm>
+#include <array>
+
+namespace knc {
+
+namespace {
+    // Idle entries (no connection, bucket refilled) are dropped every this many accepts
+    constexpr uint32_t SWEEP_EVERY = 1024;
+    
+    uint32_t steadyMs() {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+    
+    uint64_t load64(const uint8_t* p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+}
+
+void AdmissionControl::keys(const asio::ip::address& address, Key& ip, Key& subnet) {
+    std::array<uint8_t, 16> bytes{};
+    bool v4;
+    if (address.is_v4()) {
+        // ::ffff:a.b.c.d
+        auto v4bytes = address.to_v4().to_bytes();
+        bytes[10] = bytes[11] = 0xFF;
+        std::copy(v4bytes.begin(), v4bytes.end(), bytes.begin() + 12);
+        v4 = true;
+    } else {
+        auto v6 = address.to_v6();
+        bytes = v6.to_bytes();
+        v4 = v6.is_v4_mapped();
+    }
+    
+    ip.hi = load64(bytes.data());
+    ip.lo = load64(bytes.data() + 8);
+    subnet = ip;
+    if (v4) {
+        subnet.lo &= ~uint64_t(0xFF);   // /24
+    } else {
+        subnet.lo = 0;                  // /64
+    }
+}
+
+AdmissionControl::Entry& AdmissionControl::entry(Table& table, const Key& key,
+                                                 const RateLimiter::Budget& rate, uint32_t nowMs) {
+    auto [it, inserted] = table.try_emplace(key);
+    if (inserted) {
+        it->second.tokens = RateLimiter::capacity(rate);
+        it->second.lastRefill = nowMs;
+    }
+    return it->second;
+}
+
+AdmissionControl::Verdict AdmissionControl::admit(const asio::ip::address& address) {
+    const uint32_t nowMs = steadyMs();
+    Key ipKey, subnetKey;
+    keys(address, ipKey, subnetKey);
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (++m_sinceSweep >= SWEEP_EVERY) {
+        sweep(nowMs);
+    }
+    
+    Entry& ip = entry(m_ips, ipKey, m_config.ipRate, nowMs);
+    Entry& subnet = entry(m_subnets, subnetKey, m_config.subnetRate, nowMs);
+    
+    Verdict verdict = Verdict::Admit;
+    if (m_config.enabled) {
+        // Cheapest and most specific first; a refused connect still spends rate tokens
+        if (m_config.maxPending > 0 && m_pending >= m_config.maxPending) {
+            verdict = Verdict::PendingLimit;
+        } else if (m_config.maxPerIp > 0 && ip.connections >= m_config.maxPerIp) {
+            verdict = Verdict::IpLimit;
+        } else if (m_config.maxPerSubnet > 0 && subnet.connections >= m_config.maxPerSubnet) {
+            verdict = Verdict::SubnetLimit;
+        } else if (!RateLimiter::take(ip.tokens, ip.lastRefill, m_config.ipRate, nowMs)) {
+            verdict = Verdict::IpRate;
+        } else if (!RateLimiter::take(subnet.tokens, subnet.lastRefill, m_config.subnetRate, nowMs)) {
+            verdict = Verdict::SubnetRate;
+        }
+    }
+    
+    if (verdict != Verdict::Admit) {
+        ++m_rejected;
+        return verdict;
+    }
+    
+    ++ip.connections;
+    ++subnet.connections;
+    ++m_pending;
+    ++m_admitted;
+    return Verdict::Admit;
+}
+
+void AdmissionControl::handshakeDone() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending > 0) --m_pending;
+}
+
+void AdmissionControl::release(Table& table, const Key& key) {
+    auto it = table.find(key);
+    if (it != table.end() && it->second.connections > 0) {
+        // Kept until the sweep: the rate bucket must outlive the connection
+        --it->second.connections;
+    }
+}
+
+void AdmissionControl::release(const asio::ip::address& address) {
+    Key ipKey, subnetKey;
+    keys(address, ipKey, subnetKey);
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    release(m_ips, ipKey);
+    release(m_subnets, subnetKey);
+}
+
+void AdmissionControl::sweep(uint32_t nowMs) {
+    m_sinceSweep = 0;
+    auto idle = [nowMs](const Entry& e, const RateLimiter::Budget& rate) {
+        if (e.connections > 0) return false;
+        // Would be a full bucket again, same as a fresh entry
+        return rate.rate == 0 ||
+               e.tokens + uint64_t(nowMs - e.lastRefill) * rate.rate >= RateLimiter::capacity(rate);
+    };
+    for (auto it = m_ips.begin(); it != m_ips.end();) {
+        it = idle(it->second, m_config.ipRate) ? m_ips.erase(it) : std::next(it);
+    }
+    for (auto it = m_subnets.begin(); it != m_subnets.end();) {
+        it = idle(it->second, m_config.subnetRate) ? m_subnets.erase(it) : std::next(it);
+    }
+}
+
+AdmissionControl::Stats AdmissionControl::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats s;
+    s.admitted = m_admitted;
+    s.rejected = m_rejected;
+    s.pending = m_pending;
+    s.trackedAddresses = m_ips.size();
+    return s;
+}
+
+const char* AdmissionControl::verdictName(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::Admit:        return "admitted";
+        case Verdict::IpLimit:      return "too many connections from this IP";
+        case Verdict::SubnetLimit:  return "too many connections from this subnet";
+        case Verdict::IpRate:       return "IP connection rate";
+        case Verdict::SubnetRate:   return "subnet connection rate";
+        case Verdict::PendingLimit: return "too many pending handshakes";
+    }
+    return "unknown";
+}
+
+} // namespace knc
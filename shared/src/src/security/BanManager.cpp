@@ -4,61 +4,499 @@
  */
 
 #include "security/BanManager.h"
+#include "db/Database.h"
 #include "logging/Logger.h"
+#include <algorithm>
+#include <cstring>
 
 namespace knc {
 
+namespace {
+    int64_t toUnix(std::chrono::system_clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+    }
+    
+    // The longer ban wins when the same target is banned twice; true if it changed
+    bool merge(Ban& existing, const Ban& ban) {
+        if (existing.isPermanent) return false;
+        if (ban.isPermanent || ban.expiresAt > existing.expiresAt) {
+            existing = ban;
+            return true;
+        }
+        return false;
+    }
+    
+    bool isActive(const Ban& ban, std::chrono::system_clock::time_point now) {
+        return ban.isPermanent || ban.expiresAt > now;
+    }
+}
+
+// =============================================================================
+// SNAPSHOT (immutable binary trie, one per address family)
+// =============================================================================
+
+class BanManager::Snapshot {
+public:
+    void insert(const Prefix& prefix, int64_t expires) {
+        auto& nodes = m_nodes[prefix.v6 ? 1 : 0];
+        uint32_t n = 0;
+        for (int i = 0; i < prefix.length; ++i) {
+            int bit = (prefix.bytes[i >> 3] >> (7 - (i & 7))) & 1;
+            if (nodes[n].child[bit] == 0) {
+                nodes[n].child[bit] = static_cast<uint32_t>(nodes.size());
+                nodes.emplace_back();
+            }
+            n = nodes[n].child[bit];
+        }
+        Node& node = nodes[n];
+        if (!node.banned || node.expires != 0) {
+            node.expires = (node.banned && expires != 0) ? std::max(node.expires, expires) : expires;
+        }
+        node.banned = true;
+    }
+    
+    // Any active range on the path from the root to this address
+    bool contains(bool v6, const uint8_t* bytes, int64_t now) const {
+        const auto& nodes = m_nodes[v6 ? 1 : 0];
+        const int bits = v6 ? 128 : 32;
+        uint32_t n = 0;
+        for (int i = 0; ; ++i) {
+            const Node& node = nodes[n];
+            if (node.banned && (node.expires == 0 || node.expires > now)) return true;
+            if (i == bits) return false;
+            uint32_t next = node.child[(bytes[i >> 3] >> (7 - (i & 7))) & 1];
+            if (next == 0) return false;
+            n = next;
+        }
+    }
+
+private:
+    struct Node {
+        uint32_t child[2] = {0, 0};   // 0 = none (the root is never a child)
+        bool banned = false;
+        int64_t expires = 0;          // unix seconds, 0 = permanent
+    };
+    std::vector<Node> m_nodes[2] = {std::vector<Node>(1), std::vector<Node>(1)};
+};
+
+BanManager::BanManager() = default;
+
+BanManager::~BanManager() {
+    shutdown();
+}
+
+// =============================================================================
+// ADDRESSES
+// =============================================================================
+
+bool BanManager::parsePrefix(const std::string& text, Prefix& out) {
+    std::string addrText = text;
+    bool hasLength = false;
+    int length = 0;
+    size_t slash = text.find('/');
+    if (slash != std::string::npos) {
+        // Plain decimal only: stoi would take "-1", "+8" or "8x"
+        std::string lengthText = text.substr(slash + 1);
+        if (lengthText.empty() || lengthText.size() > 3) return false;
+        for (char c : lengthText) {
+            if (c < '0' || c > '9') return false;
+            length = length * 10 + (c - '0');
+        }
+        addrText = text.substr(0, slash);
+        hasLength = true;
+    }
+    
+    std::error_code ec;
+    auto addr = asio::ip::make_address(addrText, ec);
+    if (ec) return false;
+    
+    out = Prefix{};
+    if (addr.is_v6() && addr.to_v6().is_v4_mapped()) {
+        // ::ffff:a.b.c.d/n is the IPv4 range a.b.c.d/(n-96)
+        addr = asio::ip::make_address_v4(asio::ip::v4_mapped, addr.to_v6());
+        if (hasLength) length -= 96;
+    }
+    if (addr.is_v4()) {
+        auto bytes = addr.to_v4().to_bytes();
+        std::memcpy(out.bytes, bytes.data(), 4);
+        out.length = hasLength ? length : 32;
+        if (out.length < 0 || out.length > 32) return false;
+    } else {
+        auto bytes = addr.to_v6().to_bytes();
+        std::memcpy(out.bytes, bytes.data(), 16);
+        out.v6 = true;
+        out.length = hasLength ? length : 128;
+        if (out.length > 128) return false;
+    }
+    
+    // Clear the host bits: "10.1.2.3/8" is 10.0.0.0/8
+    for (int i = out.length; i < (out.v6 ? 128 : 32); ++i) {
+        out.bytes[i >> 3] &= static_cast<uint8_t>(~(0x80 >> (i & 7)));
+    }
+    return true;
+}
+
+std::string BanManager::formatPrefix(const Prefix& prefix) {
+    std::string text;
+    if (prefix.v6) {
+        asio::ip::address_v6::bytes_type bytes;
+        std::memcpy(bytes.data(), prefix.bytes, 16);
+        text = asio::ip::address_v6(bytes).to_string();
+    } else {
+        asio::ip::address_v4::bytes_type bytes;
+        std::memcpy(bytes.data(), prefix.bytes, 4);
+        text = asio::ip::address_v4(bytes).to_string();
+    }
+    // A single address is stored as the plain address
+    if (prefix.length < (prefix.v6 ? 128 : 32)) {
+        text += "/" + std::to_string(prefix.length);
+    }
+    return text;
+}
+
+// =============================================================================
+// LOOKUP
+// =============================================================================
+
 bool BanManager::isBanned(const std::string& ip) const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_bannedIPs.find(ip) != m_bannedIPs.end();
+    std::error_code ec;
+    auto addr = asio::ip::make_address(ip, ec);
+    return !ec && isBanned(addr);
+}
+
+bool BanManager::isBanned(const asio::ip::address& ip) const {
+    // Keeps the snapshot alive for this walk even if a ban replaces it meanwhile
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&m_snapshot);
+    if (!snapshot) return false;
+    
+    const int64_t now = toUnix(Clock::now());
+    if (ip.is_v4()) {
+        auto bytes = ip.to_v4().to_bytes();
+        return snapshot->contains(false, bytes.data(), now);
+    }
+    auto v6 = ip.to_v6();
+    if (v6.is_v4_mapped()) {
+        auto bytes = asio::ip::make_address_v4(asio::ip::v4_mapped, v6).to_bytes();
+        return snapshot->contains(false, bytes.data(), now);
+    }
+    auto bytes = v6.to_bytes();
+    return snapshot->contains(true, bytes.data(), now);
 }
 
 bool BanManager::isBanned(uint32_t accountId) const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_bannedAccounts.find(accountId) != m_bannedAccounts.end();
+    auto it = m_accountBans.find(accountId);
+    return it != m_accountBans.end() && isActive(it->second, Clock::now());
 }
 
-void BanManager::banIP(const std::string& ip, const std::string& reason, 
-                       const std::string& by, int durationMinutes) {
+size_t BanManager::ipBanCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_ipBans.size();
+}
+
+size_t BanManager::accountBanCount() const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_bannedIPs.insert(ip);
-    LOG_INFO("BAN", "Banned IP: " + ip + " by " + by + " reason: " + reason);
+    return m_accountBans.size();
+}
+
+// =============================================================================
+// BAN / UNBAN
+// =============================================================================
+
+Ban BanManager::makeBan(const std::string& reason, const std::string& by, int durationMinutes) const {
+    Ban ban;
+    ban.reason = reason;
+    ban.bannedBy = by;
+    ban.isPermanent = durationMinutes <= 0;
+    if (!ban.isPermanent) {
+        ban.expiresAt = Clock::now() + std::chrono::minutes(durationMinutes);
+    }
+    return ban;
+}
+
+bool BanManager::banIP(const std::string& ip, const std::string& reason,
+                       const std::string& by, int durationMinutes) {
+    Prefix prefix;
+    if (!parsePrefix(ip, prefix)) {
+        LOG_WARN("BAN", "Invalid IP ban target: " + ip);
+        return false;
+    }
+    
+    Ban ban = makeBan(reason, by, durationMinutes);
+    ban.ipAddress = formatPrefix(prefix);
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto [it, inserted] = m_ipBans.emplace(ban.ipAddress, ban);
+        changed = inserted || merge(it->second, ban);
+        if (changed) {
+            scheduleExpiry(ban);
+            publish();
+        }
+    }
+    if (!changed) {
+        LOG_DEBUG("BAN", "IP " + ban.ipAddress + " already banned at least as long");
+        return true;
+    }
+    m_cv.notify_one();
+    persistAsync(ban);
     
-    // Note: DB persistence would add expiration tracking
-    // For now, bans are in-memory and cleared on restart
-    (void)durationMinutes;
+    LOG_INFO("BAN", "Banned IP: " + ban.ipAddress + " by " + by + " reason: " + reason +
+             (ban.isPermanent ? std::string(" (permanent)") : " (" + std::to_string(durationMinutes) + " min)"));
+    return true;
 }
 
 void BanManager::banAccount(uint32_t accountId, const std::string& reason,
                             const std::string& by, int durationMinutes) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_bannedAccounts.insert(accountId);
-    LOG_INFO("BAN", "Banned account: " + std::to_string(accountId) + " by " + by + " reason: " + reason);
+    Ban ban = makeBan(reason, by, durationMinutes);
+    ban.accountId = accountId;
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto [it, inserted] = m_accountBans.emplace(accountId, ban);
+        changed = inserted || merge(it->second, ban);
+        if (changed) scheduleExpiry(ban);
+    }
+    if (!changed) {
+        LOG_DEBUG("BAN", "Account " + std::to_string(accountId) + " already banned at least as long");
+        return;
+    }
+    m_cv.notify_one();
+    persistAsync(ban);
     
-    // Note: DB persistence would add expiration tracking
-    (void)durationMinutes;
+    LOG_INFO("BAN", "Banned account: " + std::to_string(accountId) + " by " + by + " reason: " + reason +
+             (ban.isPermanent ? std::string(" (permanent)") : " (" + std::to_string(durationMinutes) + " min)"));
 }
 
 void BanManager::unbanIP(const std::string& ip) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_bannedIPs.erase(ip);
-    LOG_INFO("BAN", "Unbanned IP: " + ip);
+    Prefix prefix;
+    if (!parsePrefix(ip, prefix)) return;
+    const std::string key = formatPrefix(prefix);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_ipBans.erase(key) > 0) publish();
+    }
+    
+    // Rows that also ban an account keep that part
+    auto& db = Database::instance();
+    db.executeStmt("DELETE FROM bans WHERE ip_address = ? AND account_id IS NULL", {key});
+    db.executeStmt("UPDATE bans SET ip_address = NULL WHERE ip_address = ?", {key});
+    LOG_INFO("BAN", "Unbanned IP: " + key);
 }
 
 void BanManager::unbanAccount(uint32_t accountId) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_bannedAccounts.erase(accountId);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_accountBans.erase(accountId);
+    }
+    
+    auto& db = Database::instance();
+    db.executeStmt("DELETE FROM bans WHERE account_id = ? AND ip_address IS NULL", {accountId});
+    db.executeStmt("UPDATE bans SET account_id = NULL WHERE account_id = ?", {accountId});
     LOG_INFO("BAN", "Unbanned account: " + std::to_string(accountId));
 }
 
+// =============================================================================
+// EXPIRY
+// =============================================================================
+
+void BanManager::scheduleExpiry(const Ban& ban) {
+    if (ban.isPermanent) return;
+    m_expiries.push(Expiry{ban.expiresAt, ban.accountId, ban.ipAddress});
+}
+
+void BanManager::publish() {
+    auto snapshot = std::make_unique<Snapshot>();
+    for (const auto& [key, ban] : m_ipBans) {
+        Prefix prefix;
+        if (parsePrefix(key, prefix)) {
+            snapshot->insert(prefix, ban.isPermanent ? 0 : toUnix(ban.expiresAt));
+        }
+    }
+    
+    // Readers still walking the old one hold their own reference to it
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
+void BanManager::expiryLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_running) {
+        auto now = Clock::now();
+        bool ipChanged = false;
+        while (!m_expiries.empty() && m_expiries.top().at <= now) {
+            Expiry expiry = m_expiries.top();
+            m_expiries.pop();
+            // Stale entries (unbanned, or extended by a longer ban) are skipped
+            if (expiry.accountId != 0) {
+                auto it = m_accountBans.find(expiry.accountId);
+                if (it != m_accountBans.end() && !isActive(it->second, now)) {
+                    m_accountBans.erase(it);
+                    LOG_INFO("BAN", "Ban expired for account " + std::to_string(expiry.accountId));
+                }
+            } else {
+                auto it = m_ipBans.find(expiry.ip);
+                if (it != m_ipBans.end() && !isActive(it->second, now)) {
+                    m_ipBans.erase(it);
+                    ipChanged = true;
+                    LOG_INFO("BAN", "Ban expired for IP " + expiry.ip);
+                }
+            }
+        }
+        if (ipChanged) {
+            publish();
+        }
+        
+        // Sleep until the next expiry
+        auto wakeAt = m_expiries.empty() ? now + std::chrono::minutes(1) : m_expiries.top().at;
+        m_cv.wait_until(lock, wakeAt);
+    }
+}
+
+void BanManager::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+// =============================================================================
+// PERSISTENCE
+// =============================================================================
+
+bool BanManager::persist(const Ban& ban) {
+    DBValue account = ban.accountId != 0 ? DBValue(ban.accountId) : DBValue(nullptr);
+    DBValue ip = !ban.ipAddress.empty() ? DBValue(ban.ipAddress) : DBValue(nullptr);
+    DBValue expires = ban.isPermanent ? DBValue(nullptr) : DBValue(toUnix(ban.expiresAt));
+    return Database::instance().executeStmt(
+        "INSERT INTO bans (account_id, ip_address, reason, banned_by, expires_at) "
+        "VALUES (?, ?, ?, ?, FROM_UNIXTIME(?))",
+        {account, ip, ban.reason, ban.bannedBy, expires}) >= 0;
+}
+
+// Called right after the in-memory ban: the INSERT runs on a DB worker
+void BanManager::persistAsync(const Ban& ban) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_writesInFlight;
+    }
+    Database::instance().runAsync([this, ban](Database&) {
+        if (persist(ban)) {
+            markPersisted(ban);
+        } else {
+            LOG_WARN("BAN", "Failed to store ban, retried on save");
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_writesInFlight;
+        }
+        m_writesDone.notify_all();
+    });
+}
+
+// The stored ban is still the one written (a longer ban may have replaced it meanwhile)
+void BanManager::markPersisted(const Ban& ban) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Ban* stored = nullptr;
+    if (ban.accountId != 0) {
+        auto it = m_accountBans.find(ban.accountId);
+        if (it != m_accountBans.end()) stored = &it->second;
+    } else {
+        auto it = m_ipBans.find(ban.ipAddress);
+        if (it != m_ipBans.end()) stored = &it->second;
+    }
+    if (stored && stored->isPermanent == ban.isPermanent && stored->expiresAt == ban.expiresAt) {
+        stored->persisted = true;
+    }
+}
+
 void BanManager::loadFromDB() {
-    // Note: Would load from 'bans' table - currently in-memory only
-    LOG_INFO("BAN", "Ban manager initialized (in-memory)");
+    auto rows = Database::instance().queryStmt(
+        "SELECT account_id, ip_address, reason, banned_by, UNIX_TIMESTAMP(expires_at) AS expires "
+        "FROM bans WHERE expires_at IS NULL OR expires_at > NOW()", {});
+    const int cAccount = rows.column("account_id");
+    const int cIp = rows.column("ip_address");
+    const int cReason = rows.column("reason");
+    const int cBy = rows.column("banned_by");
+    const int cExpires = rows.column("expires");
+    
+    size_t invalid = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& row : rows) {
+            Ban ban;
+            ban.reason = row.getString(cReason);
+            ban.bannedBy = row.getString(cBy);
+            ban.isPermanent = row.isNull(cExpires);
+            if (!ban.isPermanent) {
+                ban.expiresAt = Clock::time_point(std::chrono::seconds(row.getInt64(cExpires)));
+            }
+            ban.persisted = true;
+            
+            std::string ipText = row.getString(cIp);
+            if (!ipText.empty()) {
+                Prefix prefix;
+                if (parsePrefix(ipText, prefix)) {
+                    Ban ipBan = ban;
+                    ipBan.ipAddress = formatPrefix(prefix);
+                    auto [it, inserted] = m_ipBans.emplace(ipBan.ipAddress, ipBan);
+                    if (!inserted) merge(it->second, ipBan);
+                    scheduleExpiry(ipBan);
+                } else {
+                    ++invalid;
+                }
+            }
+            
+            uint32_t accountId = static_cast<uint32_t>(row.getInt64(cAccount));
+            if (accountId != 0) {
+                Ban accountBan = ban;
+                accountBan.accountId = accountId;
+                auto [it, inserted] = m_accountBans.emplace(accountId, accountBan);
+                if (!inserted) merge(it->second, accountBan);
+                scheduleExpiry(accountBan);
+            }
+        }
+        publish();
+        
+        if (!m_running) {
+            m_running = true;
+            m_thread = std::thread(&BanManager::expiryLoop, this);
+        }
+    }
+    m_cv.notify_one();
+    
+    LOG_INFOF("BAN", "Loaded {} IP/range bans and {} account bans", ipBanCount(), accountBanCount());
+    if (invalid > 0) {
+        LOG_WARNF("BAN", "{} bans with an unparsable ip_address ignored", invalid);
+    }
 }
 
 void BanManager::saveToDB() {
-    // Note: Would persist to 'bans' table - currently in-memory only
-    LOG_DEBUG("BAN", "Ban save requested (in-memory mode)");
+    std::vector<Ban> pending;
+    {
+        // A ban whose write is still queued would be inserted twice
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_writesDone.wait(lock, [this]() { return m_writesInFlight == 0; });
+        for (const auto& [key, ban] : m_ipBans) {
+            if (!ban.persisted) pending.push_back(ban);
+        }
+        for (const auto& [id, ban] : m_accountBans) {
+            if (!ban.persisted) pending.push_back(ban);
+        }
+    }
+    
+    size_t written = 0;
+    for (const Ban& ban : pending) {
+        if (!persist(ban)) continue;
+        ++written;
+        markPersisted(ban);
+    }
+    if (!pending.empty()) {
+        LOG_INFOF("BAN", "Saved {}/{} pending bans", written, pending.size());
+    }
 }
 
 } // namespace knc
@@ -4,52 +4,90 @@
  */
 
 #include "security/RateLimiter.h"
+#include <algorithm>
+#include <limits>
 
 namespace knc {
 
-bool RateLimiter::check(uint8_t cmd) {
-    auto now = std::chrono::steady_clock::now();
+RateLimiter::Config RateLimiter::s_config;
+
+namespace {
+    constexpr uint32_t TOKEN = 1000;
     
-    // Reset per-second counter if needed
-    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - m_secondStart);
-    if (elapsed.count() >= 1) {
-        m_packetsThisSecond = 0;
-        m_secondStart = now;
+    void normalize(RateLimiter::Budget& budget) {
+        // A bucket smaller than one packet would drop everything
+        if (budget.rate > 0) budget.burst = std::max<uint32_t>(budget.burst, 1);
     }
-    
-    // Global rate limit
-    if (m_packetsThisSecond >= m_config.globalMaxPerSec) {
-        ++m_droppedCount;
-        return false;
+}
+
+uint32_t RateLimiter::capacity(const Budget& budget) {
+    return static_cast<uint32_t>(std::min<uint64_t>(uint64_t(budget.burst) * TOKEN,
+                                                    std::numeric_limits<uint32_t>::max()));
+}
+
+void RateLimiter::configure(const Config& config) {
+    s_config = config;
+    normalize(s_config.total);
+    for (auto& budget : s_config.opcode) {
+        normalize(budget);
     }
+}
+
+bool RateLimiter::refill(uint32_t& tokens, uint32_t& last, const Budget& budget, uint32_t nowMs) {
+    if (budget.rate == 0) return true;
     
-    // Per-opcode rate limit
-    int minInterval = m_config.defaultMinIntervalMs;
-    auto it = m_config.opcodeMinIntervalMs.find(cmd);
-    if (it != m_config.opcodeMinIntervalMs.end()) {
-        minInterval = it->second;
+    // Refill for the time since the last packet (unsigned difference survives wraparound)
+    const uint64_t cap = capacity(budget);
+    const uint32_t elapsed = nowMs - last;
+    if (elapsed > 0) {
+        tokens = static_cast<uint32_t>(std::min<uint64_t>(cap, tokens + uint64_t(elapsed) * budget.rate));
+        last = nowMs;
     }
+    return tokens >= TOKEN;
+}
+
+bool RateLimiter::take(uint32_t& tokens, uint32_t& last, const Budget& budget, uint32_t nowMs) {
+    if (!refill(tokens, last, budget, nowMs)) return false;
+    if (budget.rate > 0) tokens -= TOKEN;
+    return true;
+}
+
+RateLimiter::Verdict RateLimiter::check(uint8_t cmd, uint32_t nowMs) {
+    const Config& config = s_config;
+    if (!config.enabled) return Verdict::Allow;
     
-    auto lastIt = m_lastPacketTime.find(cmd);
-    if (lastIt != m_lastPacketTime.end()) {
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastIt->second).count();
-        if (ms < minInterval) {
-            ++m_droppedCount;
-            return false;
-        }
+    // Both buckets must have a token before either is charged: a dropped packet
+    // costs nothing, so one flooded opcode can't drain the others' shared budget
+    const Budget& opcode = config.opcode[cmd];
+    const bool opcodeOk = refill(m_tokens[cmd], m_lastRefill[cmd], opcode, nowMs);
+    const bool totalOk = refill(m_totalTokens, m_totalLastRefill, config.total, nowMs);
+    if (opcodeOk && totalOk) {
+        if (opcode.rate > 0) m_tokens[cmd] -= TOKEN;
+        if (config.total.rate > 0) m_totalTokens -= TOKEN;
+        return Verdict::Allow;
     }
     
-    // Update counters
-    ++m_packetsThisSecond;
-    m_lastPacketTime[cmd] = now;
-    
-    return true;
+    ++m_droppedCount;
+    if (nowMs - m_dropWindowStart >= 1000) {
+        m_dropWindowStart = nowMs;
+        m_dropsInWindow = 0;
+    }
+    if (config.maxDropsPerSec > 0 && ++m_dropsInWindow > config.maxDropsPerSec) {
+        return Verdict::Disconnect;
+    }
+    return Verdict::Drop;
 }
 
-void RateLimiter::reset() {
-    m_lastPacketTime.clear();
-    m_packetsThisSecond = 0;
-    m_secondStart = std::chrono::steady_clock::now();
+void RateLimiter::reset(uint32_t nowMs) {
+    const Config& config = s_config;
+    for (size_t i = 0; i < m_tokens.size(); ++i) {
+        m_tokens[i] = capacity(config.opcode[i]);
+    }
+    m_lastRefill.fill(nowMs);
+    m_totalTokens = capacity(config.total);
+    m_totalLastRefill = nowMs;
+    m_dropWindowStart = nowMs;
+    m_dropsInWindow = 0;
     m_droppedCount = 0;
 }
 
@@ -0,0 +1,36 @@
+/**
+ * @file Check.h
+ * @brief Minimal assertions for the unit test executables
+ *
+ * A failed CHECK prints the expression and keeps going, so one run reports
+ * every failure; main() returns checkResult() (1 if anything failed).
+ */
+
+#pragma once
+#include <cstdio>
+
+namespace knc::test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int checkResult(const char* name) {
+    if (failures() > 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures());
+        return 1;
+    }
+    std::printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+} // namespace knc::test
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++knc::test::failures();                                                    \
+        }                                                                               \
+    } while (0)
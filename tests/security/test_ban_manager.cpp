@@ -0,0 +1,274 @@
+/**
+ * @file test_ban_manager.cpp
+ * @brief BanManager: CIDR parsing, trie lookups, expiry and ban merging
+ *
+ * Runs without a database: the write-through fails and is only logged.
+ */
+
+#include "Check.h"
+#include "security/BanManager.h"
+#include "logging/Logger.h"
+
+#include <optional>
+
+namespace knc {
+
+// Reaches the parser and the ban map; expired bans cannot be made through
+// banIP() since its durations are whole minutes from now
+struct BanManagerTest {
+    static BanManager& bans() { return BanManager::instance(); }
+
+    static void clear() {
+        auto& bm = bans();
+        std::lock_guard<std::mutex> lock(bm.m_mutex);
+        bm.m_ipBans.clear();
+        bm.m_accountBans.clear();
+        bm.m_expiries = {};
+        bm.publish();
+    }
+
+    // Normalized form of a ban target, nullopt if it does not parse
+    static std::optional<std::string> normalize(const std::string& text) {
+        BanManager::Prefix prefix;
+        if (!BanManager::parsePrefix(text, prefix)) return std::nullopt;
+        return BanManager::formatPrefix(prefix);
+    }
+
+    static void addIpBan(const std::string& range, BanManager::Clock::time_point expiresAt,
+                         bool permanent) {
+        auto& bm = bans();
+        Ban ban;
+        ban.ipAddress = *normalize(range);
+        ban.expiresAt = expiresAt;
+        ban.isPermanent = permanent;
+        std::lock_guard<std::mutex> lock(bm.m_mutex);
+        bm.m_ipBans[ban.ipAddress] = ban;
+        bm.publish();
+    }
+
+    static std::optional<Ban> ipBan(const std::string& key) {
+        auto& bm = bans();
+        std::lock_guard<std::mutex> lock(bm.m_mutex);
+        auto it = bm.m_ipBans.find(key);
+        if (it == bm.m_ipBans.end()) return std::nullopt;
+        return it->second;
+    }
+
+    static std::optional<Ban> accountBan(uint32_t accountId) {
+        auto& bm = bans();
+        std::lock_guard<std::mutex> lock(bm.m_mutex);
+        auto it = bm.m_accountBans.find(accountId);
+        if (it == bm.m_accountBans.end()) return std::nullopt;
+        return it->second;
+    }
+};
+
+} // namespace knc
+
+using namespace knc;
+using T = BanManagerTest;
+using std::chrono::minutes;
+using std::chrono::system_clock;
+
+// =============================================================================
+// PREFIX PARSING
+// =============================================================================
+
+static void testParsePrefix() {
+    // Host bits are cleared, full-length prefixes print as a plain address
+    CHECK(T::normalize("10.1.2.3/8") == "10.0.0.0/8");
+    CHECK(T::normalize("10.1.2.3/32") == "10.1.2.3");
+    CHECK(T::normalize("10.1.2.3") == "10.1.2.3");
+    CHECK(T::normalize("0.0.0.0/0") == "0.0.0.0/0");
+    CHECK(T::normalize("255.255.255.255/0") == "0.0.0.0/0");
+    CHECK(T::normalize("2001:db8::1/128") == "2001:db8::1");
+    CHECK(T::normalize("2001:db8:ffff::1/32") == "2001:db8::/32");
+    CHECK(T::normalize("::/0") == "::/0");
+
+    // v4-mapped ranges fold onto IPv4 (length - 96)
+    CHECK(T::normalize("::ffff:192.168.1.77/120") == "192.168.1.0/24");
+    CHECK(T::normalize("::ffff:192.168.1.77") == "192.168.1.77");
+    CHECK(T::normalize("::ffff:10.0.0.0/104") == T::normalize("10.0.0.0/8"));
+
+    CHECK(!T::normalize("10.0.0.1/33"));
+    CHECK(!T::normalize("::/129"));
+    CHECK(!T::normalize("10.0.0.1/-1"));
+    CHECK(!T::normalize("10.0.0.1/x"));
+    CHECK(!T::normalize("10.0.0.1/"));
+    CHECK(!T::normalize("10.0.0.1/+8"));
+    CHECK(!T::normalize("10.0.0.1/8x"));
+    CHECK(!T::normalize("not-an-ip"));
+    CHECK(!T::normalize("::ffff:1.2.3.4/95"));    // wider than the mapped block
+}
+
+// =============================================================================
+// TRIE LOOKUPS
+// =============================================================================
+
+static void testWholeFamily() {
+    T::clear();
+    auto& bm = T::bans();
+    CHECK(bm.banIP("0.0.0.0/0", "test", "test"));
+    CHECK(bm.isBanned("1.2.3.4"));
+    CHECK(bm.isBanned("255.255.255.255"));
+    CHECK(bm.isBanned("::ffff:8.8.8.8"));
+    CHECK(!bm.isBanned("2001:db8::1"));
+
+    T::clear();
+    CHECK(bm.banIP("::/0", "test", "test"));
+    CHECK(bm.isBanned("2001:db8::1"));
+    CHECK(bm.isBanned("::1"));
+    CHECK(!bm.isBanned("1.2.3.4"));
+}
+
+static void testSingleAddress() {
+    T::clear();
+    auto& bm = T::bans();
+    CHECK(bm.banIP("203.0.113.7/32", "test", "test"));
+    CHECK(bm.isBanned("203.0.113.7"));
+    CHECK(bm.isBanned("::ffff:203.0.113.7"));
+    CHECK(!bm.isBanned("203.0.113.6"));
+    CHECK(!bm.isBanned("203.0.113.8"));
+
+    CHECK(bm.banIP("2001:db8::7/128", "test", "test"));
+    CHECK(bm.isBanned("2001:db8::7"));
+    CHECK(!bm.isBanned("2001:db8::6"));
+    CHECK(!bm.isBanned("2001:db8::8"));
+    CHECK(!bm.isBanned("2001:db9::7"));
+
+    CHECK(!bm.isBanned("garbage"));
+}
+
+static void testOverlappingRanges() {
+    T::clear();
+    auto& bm = T::bans();
+    CHECK(bm.banIP("198.51.100.128/25", "test", "test"));
+    CHECK(!bm.isBanned("198.51.100.5"));
+    CHECK(bm.isBanned("198.51.100.200"));
+
+    CHECK(bm.banIP("198.51.100.0/24", "test", "test"));
+    CHECK(bm.ipBanCount() == 2);
+    CHECK(bm.isBanned("198.51.100.5"));
+    CHECK(bm.isBanned("198.51.100.200"));
+    CHECK(!bm.isBanned("198.51.101.1"));
+
+    // Lifting the outer range leaves the inner one
+    bm.unbanIP("198.51.100.0/24");
+    CHECK(!bm.isBanned("198.51.100.5"));
+    CHECK(bm.isBanned("198.51.100.200"));
+
+    // Unbanning takes the range as given, host bits and all
+    bm.unbanIP("198.51.100.200/25");
+    CHECK(!bm.isBanned("198.51.100.200"));
+    CHECK(bm.ipBanCount() == 0);
+}
+
+static void testV4Mapped() {
+    T::clear();
+    auto& bm = T::bans();
+    CHECK(bm.banIP("::ffff:192.0.2.77/120", "test", "test"));
+    CHECK(T::ipBan("192.0.2.0/24").has_value());
+    CHECK(bm.isBanned("192.0.2.9"));
+    CHECK(bm.isBanned("::ffff:192.0.2.9"));
+    CHECK(!bm.isBanned("192.0.3.9"));
+
+    // The mapped and plain spellings are the same ban
+    CHECK(bm.banIP("192.0.2.0/24", "test", "test"));
+    CHECK(bm.ipBanCount() == 1);
+    bm.unbanIP("::ffff:192.0.2.0/120");
+    CHECK(!bm.isBanned("192.0.2.9"));
+}
+
+// =============================================================================
+// EXPIRY AND MERGING
+// =============================================================================
+
+static void testExpiredVsPermanent() {
+    T::clear();
+    auto& bm = T::bans();
+    auto past = system_clock::now() - minutes(1);
+    auto future = system_clock::now() + minutes(60);
+
+    // Not yet swept by the expiry timer, but no longer matching
+    T::addIpBan("100.64.0.0/16", past, false);
+    CHECK(!bm.isBanned("100.64.1.1"));
+
+    // A live ban inside an expired range still matches, the rest does not
+    T::addIpBan("100.64.1.0/24", {}, true);
+    CHECK(bm.isBanned("100.64.1.1"));
+    CHECK(!bm.isBanned("100.64.2.1"));
+
+    // An expired ban inside a live range does not hide it
+    T::clear();
+    T::addIpBan("100.64.0.0/16", future, false);
+    T::addIpBan("100.64.1.0/24", past, false);
+    CHECK(bm.isBanned("100.64.1.1"));
+    CHECK(bm.isBanned("100.64.2.1"));
+
+    // Permanent bans ignore expiresAt
+    T::clear();
+    T::addIpBan("100.64.0.0/16", past, true);
+    CHECK(bm.isBanned("100.64.1.1"));
+
+    CHECK(bm.banIP("100.65.0.1", "test", "test", 60));
+    CHECK(bm.isBanned("100.65.0.1"));
+}
+
+static void testMergeOrdering() {
+    T::clear();
+    auto& bm = T::bans();
+    const std::string ip = "192.0.2.10";
+
+    CHECK(bm.banIP(ip, "first", "test", 10));
+    auto ban = T::ipBan(ip);
+    CHECK(ban && !ban->isPermanent);
+    auto tenMinutes = ban->expiresAt;
+
+    // Longer replaces shorter
+    CHECK(bm.banIP(ip, "longer", "test", 60));
+    ban = T::ipBan(ip);
+    CHECK(ban && ban->reason == "longer" && ban->expiresAt > tenMinutes + minutes(40));
+    auto sixtyMinutes = ban->expiresAt;
+
+    // Shorter never cuts a ban down
+    CHECK(bm.banIP(ip, "shorter", "test", 5));
+    ban = T::ipBan(ip);
+    CHECK(ban && ban->reason == "longer" && ban->expiresAt == sixtyMinutes);
+
+    // Permanent wins and stays
+    CHECK(bm.banIP(ip, "forever", "test", 0));
+    CHECK(bm.banIP(ip, "later", "test", 120));
+    ban = T::ipBan(ip);
+    CHECK(ban && ban->isPermanent && ban->reason == "forever");
+    CHECK(bm.ipBanCount() == 1);
+
+    // Account bans merge the same way
+    bm.banAccount(42, "first", "test", 60);
+    bm.banAccount(42, "shorter", "test", 5);
+    auto account = T::accountBan(42);
+    CHECK(account && account->reason == "first");
+    bm.banAccount(42, "forever", "test");
+    bm.banAccount(42, "later", "test", 120);
+    account = T::accountBan(42);
+    CHECK(account && account->isPermanent && account->reason == "forever");
+    CHECK(bm.isBanned(42u));
+    CHECK(!bm.isBanned(43u));
+
+    bm.unbanAccount(42);
+    CHECK(!bm.isBanned(42u));
+}
+
+int main() {
+    Logger::instance().setLevel(LogLevel::LVL_ERROR);
+
+    testParsePrefix();
+    testWholeFamily();
+    testSingleAddress();
+    testOverlappingRanges();
+    testV4Mapped();
+    testExpiredVsPermanent();
+    testMergeOrdering();
+
+    T::clear();
+    return knc::test::checkResult("test_ban_manager");
+}
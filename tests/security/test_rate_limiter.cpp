@@ -0,0 +1,183 @@
+/**
+ * @file test_rate_limiter.cpp
+ * @brief RateLimiter: token bucket refill, burst cap, charging and drop windows
+ */
+
+#include "Check.h"
+#include "security/RateLimiter.h"
+
+#include <limits>
+
+using namespace knc;
+using Budget = RateLimiter::Budget;
+using Verdict = RateLimiter::Verdict;
+
+// Every opcode and the total share one budget unless a test says otherwise
+static RateLimiter::Config makeConfig(Budget opcode, Budget total, uint32_t maxDropsPerSec = 0) {
+    RateLimiter::Config config;
+    config.opcode.fill(opcode);
+    config.total = total;
+    config.maxDropsPerSec = maxDropsPerSec;
+    return config;
+}
+
+// =============================================================================
+// SINGLE BUCKET
+// =============================================================================
+
+static void testTakeKeepsFractions() {
+    const Budget budget{10, 2};             // One token per 100 ms
+    uint32_t tokens = RateLimiter::capacity(budget);
+    uint32_t last = 0;
+    CHECK(tokens == 2000);
+
+    CHECK(RateLimiter::take(tokens, last, budget, 0));
+    CHECK(RateLimiter::take(tokens, last, budget, 0));
+    CHECK(!RateLimiter::take(tokens, last, budget, 0));
+    CHECK(!RateLimiter::take(tokens, last, budget, 99));
+    CHECK(RateLimiter::take(tokens, last, budget, 100));
+
+    // Two 50 ms refills make a token: the thousandths are not rounded away
+    CHECK(!RateLimiter::take(tokens, last, budget, 150));
+    CHECK(RateLimiter::take(tokens, last, budget, 200));
+    CHECK(tokens == 0);
+
+    // rate 0 is unlimited and never charged
+    const Budget unlimited{0, 0};
+    uint32_t none = 0;
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(RateLimiter::take(none, last, unlimited, 200));
+    }
+    CHECK(none == 0);
+}
+
+static void testRefillAcrossWrap() {
+    const Budget budget{10, 5};
+    uint32_t tokens = 0;
+    uint32_t last = std::numeric_limits<uint32_t>::max() - 49;     // 50 ms before the wrap
+
+    CHECK(!RateLimiter::take(tokens, last, budget, 0));            // 50 ms later
+    CHECK(tokens == 500);
+    CHECK(last == 0);
+    CHECK(RateLimiter::take(tokens, last, budget, 50));
+    CHECK(tokens == 0);
+
+    // A whole session straddling the wrap: one token per second
+    RateLimiter::configure(makeConfig({1, 1}, {0, 0}));
+    const uint32_t start = std::numeric_limits<uint32_t>::max() - 499;
+    RateLimiter limiter(start);
+    CHECK(limiter.check(7, start) == Verdict::Allow);
+    CHECK(limiter.check(7, start + 600) == Verdict::Drop);          // 100 ms past the wrap
+    CHECK(limiter.check(7, start + 1000) == Verdict::Allow);
+    CHECK(limiter.check(7, start + 1000) == Verdict::Drop);
+}
+
+static void testBurstCap() {
+    const Budget budget{100, 5};
+    uint32_t tokens = 0;
+    uint32_t last = 0;
+
+    // A minute idle still only buys `burst` packets
+    int allowed = 0;
+    while (RateLimiter::take(tokens, last, budget, 60000)) ++allowed;
+    CHECK(allowed == 5);
+
+    // Huge budgets saturate instead of overflowing
+    const Budget huge{std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()};
+    CHECK(RateLimiter::capacity(huge) == std::numeric_limits<uint32_t>::max());
+    uint32_t big = RateLimiter::capacity(huge) - 1;
+    uint32_t bigLast = 0;
+    CHECK(RateLimiter::take(big, bigLast, huge, 1000000));
+    CHECK(big == RateLimiter::capacity(huge) - 1000);
+
+    // Default config: the opcode burst (120) caps before the total (600)
+    RateLimiter::configure(RateLimiter::Config{});
+    RateLimiter limiter(0);
+    allowed = 0;
+    for (int i = 0; i < 200; ++i) {
+        if (limiter.check(3, 0) == Verdict::Allow) ++allowed;
+    }
+    CHECK(allowed == 120);
+
+    // A burst below one packet is raised to one
+    RateLimiter::configure(makeConfig({1, 0}, {0, 0}));
+    CHECK(RateLimiter::config().opcode[3].burst == 1);
+    RateLimiter single(0);
+    CHECK(single.check(3, 0) == Verdict::Allow);
+    CHECK(single.check(3, 0) == Verdict::Drop);
+}
+
+// =============================================================================
+// RATE LIMITER
+// =============================================================================
+
+static void testBothOrNeither() {
+    // Opcodes: 1 per second, 3 banked. Total: 10 per second, 1 banked
+    RateLimiter::configure(makeConfig({1, 3}, {10, 1}));
+    RateLimiter limiter(0);
+
+    CHECK(limiter.check(2, 0) == Verdict::Allow);
+    // Total is empty: these must not touch opcode 2's two remaining tokens
+    for (int i = 0; i < 5; ++i) {
+        CHECK(limiter.check(2, 0) == Verdict::Drop);
+    }
+    CHECK(limiter.check(2, 100) == Verdict::Allow);
+    CHECK(limiter.check(2, 200) == Verdict::Allow);
+
+    // Opcode 2 is now empty: its drops must not touch the total's token
+    CHECK(limiter.check(2, 300) == Verdict::Drop);
+    CHECK(limiter.check(2, 300) == Verdict::Drop);
+    CHECK(limiter.check(4, 300) == Verdict::Allow);
+    CHECK(limiter.check(4, 300) == Verdict::Drop);
+
+    CHECK(limiter.getDroppedCount() == 8);
+}
+
+static void testDisconnectThreshold() {
+    RateLimiter::configure(makeConfig({1, 1}, {0, 0}, 3));
+    RateLimiter limiter(0);
+
+    CHECK(limiter.check(9, 0) == Verdict::Allow);
+    CHECK(limiter.check(9, 0) == Verdict::Drop);
+    CHECK(limiter.check(9, 10) == Verdict::Drop);
+    CHECK(limiter.check(9, 20) == Verdict::Drop);
+    CHECK(limiter.check(9, 30) == Verdict::Disconnect);
+    CHECK(limiter.check(9, 999) == Verdict::Disconnect);
+
+    // A new one-second window starts counting again
+    CHECK(limiter.check(9, 1000) == Verdict::Allow);
+    CHECK(limiter.check(9, 1000) == Verdict::Drop);
+    CHECK(limiter.check(9, 1000) == Verdict::Drop);
+    CHECK(limiter.check(9, 1000) == Verdict::Drop);
+    CHECK(limiter.check(9, 1000) == Verdict::Disconnect);
+    CHECK(limiter.getDroppedCount() == 9);
+
+    // 0 never disconnects
+    RateLimiter::configure(makeConfig({1, 1}, {0, 0}, 0));
+    RateLimiter lenient(0);
+    lenient.check(9, 0);
+    bool disconnected = false;
+    for (int i = 0; i < 1000; ++i) {
+        disconnected |= lenient.check(9, 0) == Verdict::Disconnect;
+    }
+    CHECK(!disconnected);
+
+    // Disabled: everything passes
+    auto config = makeConfig({1, 1}, {1, 1}, 1);
+    config.enabled = false;
+    RateLimiter::configure(config);
+    RateLimiter off(0);
+    for (int i = 0; i < 10; ++i) {
+        CHECK(off.check(9, 0) == Verdict::Allow);
+    }
+}
+
+int main() {
+    testTakeKeepsFractions();
+    testRefillAcrossWrap();
+    testBurstCap();
+    testBothOrNeither();
+    testDisconnectThreshold();
+
+    return knc::test::checkResult("test_rate_limiter");
+}
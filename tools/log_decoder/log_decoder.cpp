@@ -0,0 +1,409 @@
+/**
+ * @file log_decoder.cpp
+ * @brief Turns binary server logs (Logging.format = binary) back into text or JSON
+ *
+ *   log_decoder [options] gameserver.klog [more files...]
+ *
+ *   --json             one JSON object per line instead of the text log format
+ *   --category NAME    keep only this category (repeatable)
+ *   --session ID       keep only records logged for this session
+ *   --level LEVEL      minimum level (DEBUG, INFO, WARN, ERROR)
+ *   --from TIME        keep records at or after TIME
+ *   --to TIME          keep records before TIME
+ *   -o FILE            write to FILE instead of stdout
+ *
+ * TIME is local "YYYY-MM-DD HH:MM:SS" (or with a 'T') or milliseconds since
+ * the epoch. Files are streamed through a large buffer and output is written
+ * in big blocks, so decoding runs at disk speed on multi-GB logs; format
+ * strings are only looked up for records that pass the filters.
+ */
+
+#include "logging/BinaryLog.h"
+#include "logging/LogFormat.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace knc;
+
+namespace {
+
+constexpr size_t READ_BUFFER = 8 * 1024 * 1024;
+constexpr size_t WRITE_BUFFER = 4 * 1024 * 1024;
+
+const char* LEVEL_NAMES[] = { "DEBUG", "INFO ", "WARN ", "ERROR" };
+const char* LEVEL_JSON[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+struct Options {
+    bool json = false;
+    std::vector<std::string> categories;
+    bool filterSession = false;
+    uint32_t session = 0;
+    int minLevel = 0;
+    int64_t fromMs = std::numeric_limits<int64_t>::min();
+    int64_t toMs = std::numeric_limits<int64_t>::max();
+    std::string output;
+    std::vector<std::string> inputs;
+};
+
+// =============================================================================
+// I/O
+// =============================================================================
+
+// Sequential reader over one file with a big refillable window
+class Reader {
+public:
+    explicit Reader(FILE* file) : m_file(file), m_buf(READ_BUFFER) {}
+    
+    // Make n bytes available at data(); false if the file ends first
+    bool ensure(size_t n) {
+        if (m_end - m_pos >= n) return true;
+        if (m_pos > 0) {
+            std::memmove(m_buf.data(), m_buf.data() + m_pos, m_end - m_pos);
+            m_end -= m_pos;
+            m_offset += m_pos;
+            m_pos = 0;
+        }
+        if (n > m_buf.size()) m_buf.resize(n);
+        while (m_end < n) {
+            size_t got = std::fread(m_buf.data() + m_end, 1, m_buf.size() - m_end, m_file);
+            if (got == 0) return false;
+            m_end += got;
+        }
+        return true;
+    }
+    
+    const uint8_t* data() const { return m_buf.data() + m_pos; }
+    void skip(size_t n) { m_pos += n; }
+    uint64_t offset() const { return m_offset + m_pos; }
+
+private:
+    FILE* m_file;
+    std::vector<uint8_t> m_buf;
+    size_t m_pos = 0;
+    size_t m_end = 0;
+    uint64_t m_offset = 0;
+};
+
+class Writer {
+public:
+    explicit Writer(FILE* out) : m_out(out) { m_buf.reserve(WRITE_BUFFER + 4096); }
+    ~Writer() { flush(); }
+    
+    std::string& buffer() { return m_buf; }
+    void commit() {
+        if (m_buf.size() >= WRITE_BUFFER) flush();
+    }
+    void flush() {
+        if (!m_buf.empty()) {
+            std::fwrite(m_buf.data(), 1, m_buf.size(), m_out);
+            m_buf.clear();
+        }
+    }
+
+private:
+    FILE* m_out;
+    std::string m_buf;
+};
+
+// =============================================================================
+// FORMATTING
+// =============================================================================
+
+// Local time, localtime() once per second
+class TimeFormatter {
+public:
+    void append(std::string& out, int64_t ms) {
+        int64_t second = ms / 1000;
+        if (second != m_second) {
+            std::time_t time = static_cast<std::time_t>(second);
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &time);
+#else
+            localtime_r(&time, &local);
+#endif
+            std::strftime(m_text, sizeof(m_text), "%Y-%m-%d %H:%M:%S", &local);
+            m_second = second;
+        }
+        int millis = static_cast<int>(ms % 1000);
+        out += m_text;
+        out += '.';
+        out += static_cast<char>('0' + millis / 100);
+        out += static_cast<char>('0' + (millis / 10) % 10);
+        out += static_cast<char>('0' + millis % 10);
+    }
+
+private:
+    int64_t m_second = -1;
+    char m_text[24] = {};
+};
+
+void appendJsonString(std::string& out, std::string_view text) {
+    static const char* hex = "0123456789abcdef";
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xF];
+                    out += hex[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// =============================================================================
+// DECODING
+// =============================================================================
+
+bool decodeFile(const std::string& path, const Options& options, Writer& writer, TimeFormatter& clock) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+        return false;
+    }
+    Reader reader(file);
+    
+    binlog::FileHeader header;
+    if (!reader.ensure(sizeof(header))) {
+        std::fprintf(stderr, "%s: too short for a binary log\n", path.c_str());
+        std::fclose(file);
+        return false;
+    }
+    std::memcpy(&header, reader.data(), sizeof(header));
+    reader.skip(sizeof(header));
+    if (std::memcmp(header.magic, binlog::MAGIC, sizeof(header.magic)) != 0 || header.version != binlog::VERSION) {
+        std::fprintf(stderr, "%s: not a binary log (or unsupported version)\n", path.c_str());
+        std::fclose(file);
+        return false;
+    }
+    
+    // Ids are per file, defined before first use
+    std::vector<std::string> categories;
+    std::vector<char> categoryWanted;
+    std::vector<std::string> formats;
+    std::string message;
+    bool ok = true;
+    
+    while (reader.ensure(1)) {
+        uint8_t tag = reader.data()[0];
+        
+        if (tag == binlog::TAG_CATEGORY) {
+            if (!reader.ensure(4)) break;
+            uint16_t id;
+            std::memcpy(&id, reader.data() + 1, 2);
+            uint8_t len = reader.data()[3];
+            if (!reader.ensure(4 + len)) break;
+            std::string name(reinterpret_cast<const char*>(reader.data() + 4), len);
+            reader.skip(4 + len);
+            
+            if (id >= categories.size()) {
+                categories.resize(id + 1);
+                categoryWanted.resize(id + 1, 0);
+            }
+            bool wanted = options.categories.empty();
+            for (const auto& c : options.categories) {
+                if (c == name) wanted = true;
+            }
+            categories[id] = std::move(name);
+            categoryWanted[id] = wanted ? 1 : 0;
+        } else if (tag == binlog::TAG_FORMAT) {
+            if (!reader.ensure(5)) break;
+            uint16_t id, len;
+            std::memcpy(&id, reader.data() + 1, 2);
+            std::memcpy(&len, reader.data() + 3, 2);
+            if (!reader.ensure(5 + len)) break;
+            if (id >= formats.size()) formats.resize(id + 1);
+            formats[id].assign(reinterpret_cast<const char*>(reader.data() + 5), len);
+            reader.skip(5 + len);
+        } else if (tag == binlog::TAG_RECORD) {
+            binlog::RecordHeader record;
+            if (!reader.ensure(sizeof(record))) break;
+            std::memcpy(&record, reader.data(), sizeof(record));
+            if (!reader.ensure(sizeof(record) + record.length)) break;
+            const uint8_t* payload = reader.data() + sizeof(record);
+            reader.skip(sizeof(record) + record.length);
+            
+            // Filters first: rejected records cost a header copy and nothing else
+            if (record.level < options.minLevel || record.level > 3) continue;
+            if (record.categoryId >= categories.size() || !categoryWanted[record.categoryId]) continue;
+            if (options.filterSession && record.sessionId != options.session) continue;
+            int64_t timeMs = header.wallMs + (record.monoNs - header.monoNs) / 1000000;
+            if (timeMs < options.fromMs || timeMs >= options.toMs) continue;
+            
+            std::string_view text;
+            if (record.formatId == 0) {
+                text = std::string_view(reinterpret_cast<const char*>(payload), record.length);
+            } else {
+                message.clear();
+                std::string_view fmt = record.formatId < formats.size() ? std::string_view(formats[record.formatId]) : "";
+                logfmt::formatEncoded(message, fmt, payload, record.length);
+                text = message;
+            }
+            
+            std::string& out = writer.buffer();
+            if (options.json) {
+                out += "{\"time\":\"";
+                clock.append(out, timeMs);
+                out += "\",\"ts\":";
+                out += std::to_string(timeMs);
+                out += ",\"level\":\"";
+                out += LEVEL_JSON[record.level];
+                out += "\",\"category\":";
+                appendJsonString(out, categories[record.categoryId]);
+                out += ",\"session\":";
+                out += std::to_string(record.sessionId);
+                out += ",\"message\":";
+                appendJsonString(out, text);
+                out += "}\n";
+            } else {
+                clock.append(out, timeMs);
+                out += " [";
+                out += LEVEL_NAMES[record.level];
+                out += "] [";
+                out += categories[record.categoryId];
+                out += "] ";
+                out += text;
+                out += '\n';
+            }
+            writer.commit();
+        } else {
+            std::fprintf(stderr, "%s: corrupt frame (tag %u) at offset %llu\n", path.c_str(), tag,
+                         static_cast<unsigned long long>(reader.offset()));
+            ok = false;
+            break;
+        }
+    }
+    
+    // A server killed mid-write leaves a partial last frame: everything before it was decoded
+    std::fclose(file);
+    return ok;
+}
+
+// =============================================================================
+// COMMAND LINE
+// =============================================================================
+
+bool parseTime(const char* text, int64_t& ms) {
+    size_t len = std::strlen(text);
+    if (len > 0 && std::strspn(text, "0123456789") == len) {
+        ms = std::strtoll(text, nullptr, 10);
+        return true;
+    }
+    std::tm local{};
+    char sep;
+    if (std::sscanf(text, "%d-%d-%d%c%d:%d:%d", &local.tm_year, &local.tm_mon, &local.tm_mday, &sep,
+                    &local.tm_hour, &local.tm_min, &local.tm_sec) != 7) {
+        return false;
+    }
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_isdst = -1;
+    std::time_t time = std::mktime(&local);
+    if (time == static_cast<std::time_t>(-1)) return false;
+    ms = static_cast<int64_t>(time) * 1000;
+    return true;
+}
+
+int parseLevel(const std::string& name) {
+    if (name == "DEBUG") return 0;
+    if (name == "INFO") return 1;
+    if (name == "WARN") return 2;
+    if (name == "ERROR") return 3;
+    return -1;
+}
+
+void printUsage(const char* exe) {
+    std::fprintf(stderr,
+        "Usage: %s [options] file.klog [more files...]\n"
+        "  --json             JSON lines output\n"
+        "  --category NAME    keep only this category (repeatable)\n"
+        "  --session ID       keep only records of this session\n"
+        "  --level LEVEL      minimum level (DEBUG, INFO, WARN, ERROR)\n"
+        "  --from TIME        records at or after TIME (\"YYYY-MM-DD HH:MM:SS\" or epoch ms)\n"
+        "  --to TIME          records before TIME\n"
+        "  -o FILE            output file (default stdout)\n", exe);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--category" && hasValue) {
+            options.categories.push_back(argv[++i]);
+        } else if (arg == "--session" && hasValue) {
+            options.filterSession = true;
+            options.session = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--level" && hasValue) {
+            options.minLevel = parseLevel(argv[++i]);
+            if (options.minLevel < 0) {
+                std::fprintf(stderr, "Unknown level: %s\n", argv[i]);
+                return 1;
+            }
+        } else if ((arg == "--from" || arg == "--to") && hasValue) {
+            int64_t& target = arg == "--from" ? options.fromMs : options.toMs;
+            if (!parseTime(argv[++i], target)) {
+                std::fprintf(stderr, "Bad time: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "-o" && hasValue) {
+            options.output = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            options.inputs.push_back(arg);
+        }
+    }
+    
+    if (options.inputs.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    FILE* out = stdout;
+    if (!options.output.empty()) {
+        out = std::fopen(options.output.c_str(), "wb");
+        if (!out) {
+            std::fprintf(stderr, "Cannot create %s\n", options.output.c_str());
+            return 1;
+        }
+    }
+    
+    bool ok = true;
+    {
+        Writer writer(out);
+        TimeFormatter clock;
+        for (const auto& input : options.inputs) {
+            ok = decodeFile(input, options, writer, clock) && ok;
+        }
+    }
+    
+    if (out != stdout) std::fclose(out);
+    return ok ? 0 : 2;
+}